@@ -0,0 +1 @@
+66
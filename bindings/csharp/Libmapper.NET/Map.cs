@@ -29,7 +29,12 @@ public class Map : Mapper.Object
         /// <summary>
         ///     Updates sent via TCP
         /// </summary>
-        Tcp
+        Tcp,
+
+        /// <summary>
+        ///     Updates sent via UDP, with lost updates retransmitted
+        /// </summary>
+        Rudp
     }
 
     public Map()
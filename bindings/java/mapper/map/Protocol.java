@@ -5,7 +5,8 @@ package mapper.map;
 public enum Protocol {
     UNDEFINED   (0),
     UDP         (1),
-    TCP         (2);
+    TCP         (2),
+    RUDP        (3);
 
     Protocol(int value) {
         this._value = value;
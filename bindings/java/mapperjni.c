@@ -65,7 +65,8 @@ const char *location_strings[] = {
 const char *protocol_strings[] = {
     "UNDEFINED",
     "UDP",
-    "TCP"
+    "TCP",
+    "RUDP"
 };
 
 const char *stealing_strings[] = {
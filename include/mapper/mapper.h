@@ -326,7 +326,8 @@ typedef void mpr_sig_handler(mpr_sig signal, mpr_sig_evt event, mpr_id instance,
  *  \param parent           The object to add a signal to.
  *  \param direction    	The signal direction.
  *  \param name             The name of the signal.
- *  \param length           The length of the signal vector, or `1` for a scalar.
+ *  \param length           The length of the signal vector, or `1` for a scalar. Vectors may
+ *                          have up to 65535 elements.
  *  \param type             The type of the signal value.
  *  \param unit             The unit of the signal, or `NULL` for none.
  *  \param minimum          Pointer to a minimum value, or `NULL` for none.
@@ -346,7 +347,8 @@ mpr_sig mpr_sig_new(mpr_dev parent, mpr_dir direction, const char *name, int len
 void mpr_sig_free(mpr_sig signal);
 
 /*! Update the value of a signal instance.  The signal will be routed according
- *  to external requests.
+ *  to external requests.  If called from a thread other than the one polling the device, the
+ *  update is queued without blocking or allocating memory and applied by the polling thread.
  *  \param signal       The signal to operate on.
  *  \param instance     A pointer to the identifier of the instance to update,
  *                      or `0` for the default instance.
@@ -359,6 +361,21 @@ void mpr_sig_free(mpr_sig signal);
 void mpr_sig_set_value(mpr_sig signal, mpr_id instance, int length, mpr_type type,
                        const void *value);
 
+/*! Update the values of several instances of a signal at once.  This is equivalent to calling
+ *  `mpr_sig_set_value()` for each instance, except that outgoing maps are processed only once
+ *  for the whole batch.
+ *  \param signal       The signal to operate on.
+ *  \param num          The number of instances to update.
+ *  \param instances    An array of `num` instance identifiers.
+ *  \param length       Length of the value of each instance. Expected to be equal to the signal
+ *                      length.
+ *  \param type         Data type of the values argument.
+ *  \param values       A pointer to the packed values of all instances: `num * length` elements
+ *                      of the given type, with the value of `instances[i]` starting at element
+ *                      `i * length`.  Pass `0` to release all of the listed instances. */
+void mpr_sig_set_values(mpr_sig signal, int num, const mpr_id *instances, int length,
+                        mpr_type type, const void *values);
+
 /*! Get the value of a signal instance.
  *  \param signal       The signal to operate on.
  *  \param instance     A pointer to the identifier of the instance to query,
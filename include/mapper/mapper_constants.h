@@ -109,6 +109,8 @@ typedef enum {
     MPR_PROTO_UNDEFINED,        /*!< Not yet defined */
     MPR_PROTO_UDP,              /*!< Map updates are sent using UDP. */
     MPR_PROTO_TCP,              /*!< Map updates are sent using TCP. */
+    MPR_PROTO_RUDP,             /*!< Map updates are sent using UDP with sequence numbers and
+                                 *   retransmission of lost updates. */
     MPR_NUM_PROTO
 } mpr_proto;
 
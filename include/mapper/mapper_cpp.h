@@ -746,7 +746,8 @@ namespace mapper {
         enum class Protocol
         {
             UDP         = MPR_PROTO_UDP,    /*!< Map updates are sent using UDP. */
-            TCP         = MPR_PROTO_TCP     /*!< Map updates are sent using TCP. */
+            TCP         = MPR_PROTO_TCP,    /*!< Map updates are sent using TCP. */
+            RUDP        = MPR_PROTO_RUDP    /*!< Map updates are sent using reliable UDP. */
         };
     private:
         /* This constructor accepts a between 2 and 10 signal object arguments inclusive. It is
@@ -994,6 +995,37 @@ namespace mapper {
         Signal& set_value(Values... vals)
             { return _set_value(vals...); }
 
+        /*! Set the current values of several Instances of this Signal at once. Outgoing Maps
+         *  are processed once for the whole batch.
+         *  \param ids      An array of Instance Ids.
+         *  \param num      The number of Instance Ids.
+         *  \param vals     The packed values of the Instances, with the value of `ids[i]`
+         *                  starting at element `i * len`.
+         *  \param len      The length of each value.
+         *  \return         Self. */
+        Signal& set_values(const Id *ids, unsigned int num, const int *vals, unsigned int len)
+            { mpr_sig_set_values(_obj, num, ids, len, MPR_INT32, vals); RETURN_SELF }
+        Signal& set_values(const Id *ids, unsigned int num, const float *vals, unsigned int len)
+            { mpr_sig_set_values(_obj, num, ids, len, MPR_FLT, vals); RETURN_SELF }
+        Signal& set_values(const Id *ids, unsigned int num, const double *vals, unsigned int len)
+            { mpr_sig_set_values(_obj, num, ids, len, MPR_DBL, vals); RETURN_SELF }
+
+        /*! Set the current values of several Instances of this Signal at once. Outgoing Maps
+         *  are processed once for the whole batch.
+         *  \param ids      A `std::vector` of Instance Ids.
+         *  \param vals     A `std::vector` of `int`, `float`, or `double` holding the packed
+         *                  values of the Instances; its size must be a multiple of the number of
+         *                  Ids.
+         *  \return         Self. */
+        template <typename T>
+        Signal& set_values(const std::vector<Id>& ids, const std::vector<T>& vals)
+        {
+            if (ids.empty() || vals.size() < ids.size())
+                RETURN_SELF
+            return set_values(ids.data(), (unsigned int)ids.size(), vals.data(),
+                              (unsigned int)(vals.size() / ids.size()));
+        }
+
         const void *value() const
             { return mpr_sig_get_value(_obj, 0, 0); }
         const void *value(Time time) const
@@ -2765,6 +2797,7 @@ namespace mapper {
         switch (d) {
             case Map::Protocol::UDP: os << "UDP"; break;
             case Map::Protocol::TCP: os << "TCP"; break;
+            case Map::Protocol::RUDP: os << "RUDP"; break;
         }
         return os;
     }
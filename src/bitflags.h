@@ -7,29 +7,43 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include "mpr_atomic.h"
 #include "mpr_inline.h"
 
 typedef char *mpr_bitflags;
 
-/* A mpr_bitflags object consists of a char array with at least num_flags bits.
- * The bit 0 is used to indicate whether all bits are set.
- * Bits 1–7 are used to store the length of the bitflag array.
- * On allocation any extra bits are set to 1 for efficient comparison. */
+/* A mpr_bitflags object consists of a char array with at least num_flags bits, preceded by a
+ * 32-bit header. Bit 0 of the header is used to indicate whether all bits are set and the
+ * remaining bits store the number of flags. On allocation any extra bits are set to 1 for
+ * efficient comparison. */
+
+#define MPR_BITFLAGS_HDR_SIZE sizeof(uint32_t)
+
+/* The header is always aligned since the array is allocated with malloc. */
+#define MPR_BITFLAGS_HDR(BITFLAGS) (*(uint32_t*)(BITFLAGS))
+
+/* Number of bytes used for the flags, excluding the header. */
+#define MPR_BITFLAGS_NUM_BYTES(NUM_FLAGS) (((NUM_FLAGS) - 1) / 8 + 1)
+
+MPR_INLINE static unsigned int mpr_bitflags_get_num_flags(mpr_bitflags bitflags)
+{
+    return MPR_BITFLAGS_HDR(bitflags) >> 1;
+}
 
 MPR_INLINE static mpr_bitflags mpr_bitflags_new(unsigned int num_flags)
 {
     mpr_bitflags bitflags;
+    unsigned int num_bytes;
     if (!num_flags)
         return 0;
-    /* allocate an extra byte for length prefix */
-    unsigned int num_bytes = (num_flags - 1) / 8 + 2;
-    assert(num_flags < 128);
-    bitflags = calloc(1, num_bytes);
+    assert(num_flags < (1u << 31));
+    num_bytes = MPR_BITFLAGS_NUM_BYTES(num_flags);
+    bitflags = calloc(1, MPR_BITFLAGS_HDR_SIZE + num_bytes);
     if (num_flags % 8) {
         /* set extraneous bits to one */
-        bitflags[num_bytes - 1] |= 255 << (num_flags % 8);
+        bitflags[MPR_BITFLAGS_HDR_SIZE + num_bytes - 1] |= 255 << (num_flags % 8);
     }
-    bitflags[0] = num_flags << 1;
+    MPR_BITFLAGS_HDR(bitflags) = num_flags << 1;
     return bitflags;
 }
 
@@ -42,22 +56,28 @@ MPR_INLINE static void mpr_bitflags_free(mpr_bitflags bitflags)
 MPR_INLINE static mpr_bitflags mpr_bitflags_realloc(mpr_bitflags bitflags,
                                                     unsigned int new_num_flags)
 {
-    unsigned int old_num_flags = bitflags[0] >> 1;
-    unsigned int old_num_bytes = (old_num_flags - 1) / 8 + 2;
+    unsigned int old_num_flags = mpr_bitflags_get_num_flags(bitflags);
+    unsigned int old_num_bytes = MPR_BITFLAGS_NUM_BYTES(old_num_flags);
 
     if (new_num_flags < old_num_flags) {
-        char all_set = bitflags[0] & 0x01;
-        unsigned int new_num_bytes = (new_num_flags - 1) / 8 + 2;
+        uint32_t all_set = MPR_BITFLAGS_HDR(bitflags) & 0x01;
+        unsigned int new_num_bytes = MPR_BITFLAGS_NUM_BYTES(new_num_flags);
         if (new_num_bytes < old_num_bytes)
-            bitflags = realloc(bitflags, new_num_bytes);
-        bitflags[0] = (new_num_flags << 1) | all_set;
+            bitflags = realloc(bitflags, MPR_BITFLAGS_HDR_SIZE + new_num_bytes);
+        if (new_num_flags % 8) {
+            /* set extraneous bits to one */
+            bitflags[MPR_BITFLAGS_HDR_SIZE + new_num_bytes - 1] |= 255 << (new_num_flags % 8);
+        }
+        MPR_BITFLAGS_HDR(bitflags) = (new_num_flags << 1) | all_set;
     }
-    else if (new_num_flags > (bitflags[0] >> 1)) {
+    else if (new_num_flags > old_num_flags) {
         mpr_bitflags new_bitflags = mpr_bitflags_new(new_num_flags);
-        int i = old_num_bytes - 1;
-        new_bitflags[i] |= (bitflags[i] & (255 >> (8 - (old_num_flags % 8))));
-        while (--i)
-            new_bitflags[i] = bitflags[i];
+        char *src = bitflags + MPR_BITFLAGS_HDR_SIZE, *dst = new_bitflags + MPR_BITFLAGS_HDR_SIZE;
+        unsigned int last = old_num_bytes - 1;
+        memcpy(dst, src, last);
+        /* leave the extraneous bits of the old last byte cleared */
+        dst[last] |= old_num_flags % 8 ? (src[last] & (255 >> (8 - (old_num_flags % 8))))
+                                       : src[last];
         /* leave all_set flag at zero since new flags have not been set */
         free(bitflags);
         bitflags = new_bitflags;
@@ -67,49 +87,58 @@ MPR_INLINE static mpr_bitflags mpr_bitflags_realloc(mpr_bitflags bitflags,
 
 MPR_INLINE static void mpr_bitflags_set(mpr_bitflags bitflags, unsigned int idx)
 {
-    bitflags[idx / 8 + 1] |= (1 << (idx % 8));
+    bitflags[MPR_BITFLAGS_HDR_SIZE + idx / 8] |= (1 << (idx % 8));
+}
+
+/* Set a flag that may be taken concurrently by mpr_bitflags_take(). */
+MPR_INLINE static void mpr_bitflags_set_atomic(mpr_bitflags bitflags, unsigned int idx)
+{
+    mpr_atomic_or8(&bitflags[MPR_BITFLAGS_HDR_SIZE + idx / 8], 1 << (idx % 8));
 }
 
 MPR_INLINE static void mpr_bitflags_set_all(mpr_bitflags bitflags)
 {
-    memset(bitflags + 1, 255, ((bitflags[0] >> 1) - 1) / 8 + 1);
-    bitflags[0] |= 0x01;
+    memset(bitflags + MPR_BITFLAGS_HDR_SIZE, 255,
+           MPR_BITFLAGS_NUM_BYTES(mpr_bitflags_get_num_flags(bitflags)));
+    MPR_BITFLAGS_HDR(bitflags) |= 0x01;
 }
 
 MPR_INLINE static int mpr_bitflags_get_all(mpr_bitflags bitflags)
 {
-    if (bitflags[0] & 0x01)
+    if (MPR_BITFLAGS_HDR(bitflags) & 0x01)
         return 1;
     else {
-        unsigned int i, num_bytes = ((bitflags[0] >> 1) - 1) / 8 + 1;
-        for (i = 1; i <= num_bytes; i++) {
+        unsigned int i, num_bytes = MPR_BITFLAGS_NUM_BYTES(mpr_bitflags_get_num_flags(bitflags));
+        const char *bytes = bitflags + MPR_BITFLAGS_HDR_SIZE;
+        for (i = 0; i < num_bytes; i++) {
             /* bitflags are padded with 1's so we can simply compare byte to 0xFF */
-            if (bitflags[i] != (char)0xFF)
+            if (bytes[i] != (char)0xFF)
                 return 0;
         }
-        bitflags[0] |= 0x01;
+        MPR_BITFLAGS_HDR(bitflags) |= 0x01;
         return 1;
     }
 }
 
 MPR_INLINE static int mpr_bitflags_get_sum(mpr_bitflags bitflags)
 {
-    if (bitflags[0] & 0x01)
-        return bitflags[0] >> 1;
+    unsigned int num_flags = mpr_bitflags_get_num_flags(bitflags);
+    if (MPR_BITFLAGS_HDR(bitflags) & 0x01)
+        return num_flags;
     else {
-        unsigned int num_flags = bitflags[0] >> 1;
-        unsigned int num_bytes = (num_flags - 1) / 8 + 1;
-        unsigned int i = 1, sum = 0;
-        for (i = 1; i <= num_bytes; i++) {
-            char byte = bitflags[i];
-            if (byte) {
-                int j;
-                for (j = 0; j < 8 && j < num_flags; j++) {
-                    sum += byte & 0x01;
-                    byte >>= 1;
-                }
+        unsigned int num_bytes = MPR_BITFLAGS_NUM_BYTES(num_flags);
+        const unsigned char *bytes = (const unsigned char*)bitflags + MPR_BITFLAGS_HDR_SIZE;
+        unsigned int i, sum = 0;
+        for (i = 0; i < num_bytes; i++) {
+            unsigned char byte = bytes[i];
+            if (i == num_bytes - 1 && num_flags % 8) {
+                /* ignore the extraneous bits */
+                byte &= 255 >> (8 - (num_flags % 8));
+            }
+            while (byte) {
+                sum += byte & 0x01;
+                byte >>= 1;
             }
-            num_flags -= 8;
         }
         return sum;
     }
@@ -117,41 +146,60 @@ MPR_INLINE static int mpr_bitflags_get_sum(mpr_bitflags bitflags)
 
 MPR_INLINE static void mpr_bitflags_unset(mpr_bitflags bitflags, unsigned int idx)
 {
-    bitflags[idx / 8 + 1] &= (0xFF ^ (1 << (idx % 8)));
-    bitflags[0] &= ~0x01;
+    bitflags[MPR_BITFLAGS_HDR_SIZE + idx / 8] &= (0xFF ^ (1 << (idx % 8)));
+    MPR_BITFLAGS_HDR(bitflags) &= ~0x01;
 }
 
 MPR_INLINE static int mpr_bitflags_get(mpr_bitflags bitflags, unsigned int idx)
 {
-    return bitflags[idx / 8 + 1] & (1 << (idx % 8));
+    return bitflags[MPR_BITFLAGS_HDR_SIZE + idx / 8] & (1 << (idx % 8));
 }
 
 MPR_INLINE static int mpr_bitflags_compare(mpr_bitflags l, mpr_bitflags r)
 {
-    return (l[0] != r[0]) || memcmp(l, r, ((l[0] >> 1) - 1) / 8 + 2);
+    return (MPR_BITFLAGS_HDR(l) != MPR_BITFLAGS_HDR(r))
+           || memcmp(l + MPR_BITFLAGS_HDR_SIZE, r + MPR_BITFLAGS_HDR_SIZE,
+                     MPR_BITFLAGS_NUM_BYTES(mpr_bitflags_get_num_flags(l)));
 }
 
 MPR_INLINE static void mpr_bitflags_clear(mpr_bitflags bitflags)
 {
-    unsigned int num_flags = bitflags[0] >> 1;
-    unsigned int num_bytes = (num_flags - 1) / 8 + 1;
-    memset(bitflags + 1, 0, num_bytes);
+    unsigned int num_flags = mpr_bitflags_get_num_flags(bitflags);
+    unsigned int num_bytes = MPR_BITFLAGS_NUM_BYTES(num_flags);
+    memset(bitflags + MPR_BITFLAGS_HDR_SIZE, 0, num_bytes);
     if (num_flags % 8) {
         /* set extraneous bits to one */
-        bitflags[num_bytes] |= 255 << (num_flags % 8);
+        bitflags[MPR_BITFLAGS_HDR_SIZE + num_bytes - 1] |= 255 << (num_flags % 8);
     }
-    bitflags[0] &= ~0x01;
+    MPR_BITFLAGS_HDR(bitflags) &= ~0x01;
+}
+
+/* Move the flags set in src to dst, which must have the same length, and clear them from src.
+ * Flags set concurrently with mpr_bitflags_set_atomic() are either moved or left in src. */
+MPR_INLINE static void mpr_bitflags_take(mpr_bitflags dst, mpr_bitflags src)
+{
+    unsigned int num_flags = mpr_bitflags_get_num_flags(src);
+    unsigned int i, num_bytes = MPR_BITFLAGS_NUM_BYTES(num_flags);
+    char pad = (num_flags % 8) ? 255 << (num_flags % 8) : 0;
+    char *d = dst + MPR_BITFLAGS_HDR_SIZE, *s = src + MPR_BITFLAGS_HDR_SIZE;
+    MPR_BITFLAGS_HDR(dst) = MPR_BITFLAGS_HDR(src);
+    MPR_BITFLAGS_HDR(src) &= ~0x01;
+    for (i = 0; i < num_bytes - 1; i++)
+        d[i] = mpr_atomic_swap8(&s[i], 0);
+    /* keep extraneous bits set to one */
+    d[num_bytes - 1] = mpr_atomic_swap8(&s[num_bytes - 1], pad);
 }
 
 MPR_INLINE static void mpr_bitflags_cpy(mpr_bitflags dst, mpr_bitflags src)
 {
     /* TODO: check whether sizes match? */
-    memcpy(dst, src, ((src[0] >> 1) - 1) / 8 + 2);
+    memcpy(dst, src,
+           MPR_BITFLAGS_HDR_SIZE + MPR_BITFLAGS_NUM_BYTES(mpr_bitflags_get_num_flags(src)));
 }
 
 MPR_INLINE static void mpr_bitflags_print(mpr_bitflags bitflags)
 {
-    unsigned int i, num_flags = bitflags[0] >> 1;
+    unsigned int i, num_flags = mpr_bitflags_get_num_flags(bitflags);
     printf("%d:[", num_flags);
     for (i = 0; i < num_flags; i++)
         printf("%d", mpr_bitflags_get(bitflags, i) ? 1 : 0);
@@ -160,7 +208,7 @@ MPR_INLINE static void mpr_bitflags_print(mpr_bitflags bitflags)
     for (; i < num_flags; i++)
         printf("%d", mpr_bitflags_get(bitflags, i) ? 1 : 0);
     printf("]");
-    if (bitflags[0] & 0x01)
+    if (MPR_BITFLAGS_HDR(bitflags) & 0x01)
         printf("*");
 }
 
@@ -15,6 +15,7 @@
 #include "device.h"
 #include "graph.h"
 #include "map.h"
+#include "mpr_atomic.h"
 #include "path.h"
 #include "table.h"
 
@@ -38,6 +39,7 @@ extern const char* net_msg_strings[NUM_MSG_STRINGS];
     int num_maps_in;    /*!< Number of associated incoming maps. */     \
     int num_maps_out;   /*!< Number of associated outgoing maps. */     \
     int num_linked;     /*!< Number of linked devices. */               \
+    int sync_interval;  /*!< Advertised heartbeat interval, or 0. */    \
     uint8_t subscribed;
 
 /*! A record that keeps information about a device. */
@@ -48,6 +50,7 @@ struct _mpr_dev {
 typedef struct _mpr_subscriber {
     struct _mpr_subscriber *next;
     lo_address addr;
+    mpr_net_dst_t dst;  /* resolved address for sending serialised bundles over UDP */
     char *host;
     char *port;
     int protocol; /* TODO: merge with flags */
@@ -66,6 +69,41 @@ typedef struct _mpr_allocated_t {
                                  *   distributed allocation network. */
 } mpr_allocated_t, *mpr_allocated;
 
+/*! An open-addressing hash table of instance id maps using linear probing. Id maps with equal
+ *  keys are kept in probe order from newest to oldest. */
+typedef struct _mpr_id_map_tbl {
+    struct _mpr_id_map **slots;     /*!< The table slots, or NULL if nothing has been added. */
+    uint32_t size;                  /*!< The number of slots, always a power of two. */
+    uint32_t num;                   /*!< The number of occupied slots. */
+} mpr_id_map_tbl_t;
+
+#define UPDATE_QUEUE_SIZE 0x10000   /* 64 KiB of pending updates per device, must be a power of two */
+#define UPDATE_MAX (UPDATE_QUEUE_SIZE / 4)
+#define UPDATE_SKIP 0x80000000      /* flags the space left unused at the end of the queue */
+
+/*! A signal update made by a thread other than the one polling the device. It is followed by the
+ *  value of the update. */
+typedef struct _mpr_sig_update {
+    uint32_t size;                  /*!< Size of the record, stored last to publish it. */
+    int32_t len;                    /*!< Length of the value, or 0 to release the instance. */
+    mpr_sig sig;                    /*!< The updated signal, or NULL if it has been removed. */
+    mpr_id id;
+    mpr_type type;
+} mpr_sig_update_t, *mpr_sig_update;
+
+/*! Lock-free multiple-producer/single-consumer queue of signal updates. Producers reserve a
+ *  record by advancing head with compare-and-swap, write it, and then publish it by storing its
+ *  size in the first word. Records are never split at the end of the buffer. The polling thread
+ *  applies published records in order and clears them before releasing the space, so that
+ *  unpublished records always read as zero. */
+typedef struct _mpr_sig_update_queue {
+    char *data;
+    uint32_t head;                  /*!< Reserve index, advanced by producers. */
+    char pad[60];
+    uint32_t tail;                  /*!< Read index, only modified by the polling thread. */
+    uint32_t dropped;               /*!< Updates dropped because the queue was full. */
+} mpr_sig_update_queue_t;
+
 struct _mpr_local_dev {
     MPR_DEV_STRUCT_ITEMS
 
@@ -75,14 +113,17 @@ struct _mpr_local_dev {
     mpr_subscriber subscribers;         /*!< Linked-list of subscribed peers. */
 
     struct {
-        struct _mpr_id_map **active;    /*!< The list of active instance id maps. */
+        mpr_id_map_tbl_t *by_LID;       /*!< Active instance id maps by local id, per group. */
+        mpr_id_map_tbl_t *by_GID;       /*!< Active instance id maps by global id, per group. */
         struct _mpr_id_map *reserve;    /*!< The list of reserve instance id maps. */
     } id_maps;
 
+    mpr_sig_update_queue_t updates;     /*!< Signal updates made by other threads. */
+
     mpr_time time;
     mpr_time t_next;
     int num_sig_groups;
-    mpr_dir updated;
+    uint32_t updated;       /*!< mpr_dir flags, may be set by interrupts. */
     uint8_t time_is_stale;  // only need 1 bit
     uint8_t timed;          // only need 1 bit
     uint8_t locked;         // only need 1 bit
@@ -93,6 +134,7 @@ struct _mpr_local_dev {
 /* prototypes */
 static int check_registration(mpr_local_dev dev);
 static void process_maps(mpr_local_dev dev);
+static void drop_sig_updates(mpr_local_dev dev, mpr_sig sig);
 
 size_t mpr_dev_get_struct_size(int is_local)
 {
@@ -202,9 +244,10 @@ mpr_dev mpr_dev_new(const char *name_prefix, mpr_graph graph)
 
     dev->ordinal_allocator.val = 1;
     dev->ordinal_allocator.count_time = mpr_get_current_time();
-    dev->id_maps.active = (mpr_id_map*) malloc(sizeof(mpr_id_map));
-    dev->id_maps.active[0] = 0;
+    dev->id_maps.by_LID = (mpr_id_map_tbl_t*) calloc(1, sizeof(mpr_id_map_tbl_t));
+    dev->id_maps.by_GID = (mpr_id_map_tbl_t*) calloc(1, sizeof(mpr_id_map_tbl_t));
     dev->num_sig_groups = 1;
+    dev->updates.data = (char*) calloc(1, UPDATE_QUEUE_SIZE);
 
     return (mpr_dev)dev;
 }
@@ -281,19 +324,24 @@ void mpr_dev_free(mpr_dev dev)
 
     /* Release device id maps */
     for (i = 0; i < ldev->num_sig_groups; i++) {
-        while (ldev->id_maps.active[i]) {
-            mpr_id_map id_map = ldev->id_maps.active[i];
-            ldev->id_maps.active[i] = id_map->next;
-            free(id_map);
+        mpr_id_map_tbl_t *tbl = &ldev->id_maps.by_LID[i];
+        uint32_t j;
+        for (j = 0; j < tbl->size; j++) {
+            if (tbl->slots[j])
+                free(tbl->slots[j]);
         }
+        free(tbl->slots);
+        free(ldev->id_maps.by_GID[i].slots);
     }
-    free(ldev->id_maps.active);
+    free(ldev->id_maps.by_LID);
+    free(ldev->id_maps.by_GID);
 
     while (ldev->id_maps.reserve) {
         mpr_id_map id_map = ldev->id_maps.reserve;
         ldev->id_maps.reserve = id_map->next;
         free(id_map);
     }
+    FUNC_IF(free, ldev->updates.data);
 
     dev->obj.status |= MPR_STATUS_REMOVED;
     if (own_graph)
@@ -372,6 +420,7 @@ void mpr_dev_remove_sig(mpr_dev dev, mpr_sig sig)
     if (dev->obj.is_local) {
         mpr_obj_incr_version((mpr_obj)dev);
         dev->obj.status |= MPR_DEV_SIG_CHANGED;
+        drop_sig_updates((mpr_local_dev)dev, sig);
     }
 }
 
@@ -467,8 +516,9 @@ static void process_maps(mpr_local_dev dev)
     /* TODO: speed this up! */
     dev->t_next = MPR_TIME_MAX;
 
-    /* cache and clear the `updated` flags since local maps may be updated during link processing */
-    dev->updated = 0;
+    /* cache and clear the `updated` flags since local maps may be updated during link processing;
+     * interrupts may set them at any time so take them atomically */
+    updated = mpr_atomic_swap(&dev->updated, 0);
 
     /* process updated maps (both incoming and outgoing) */
     // TODO: is it useful to order the maps based on direction?
@@ -501,6 +551,10 @@ static void process_maps(mpr_local_dev dev)
             mpr_link_process_bundles(link, dev->time);
             list = mpr_list_get_next(list);
         }
+        /* send updates shared by the destinations of widely fanned-out signals */
+        mpr_net_send_mcast(mpr_graph_get_net(graph));
+        /* send any datagrams queued for batched sending */
+        mpr_net_flush_dgrams(mpr_graph_get_net(graph));
     }
 
     /* TODO: verify that we are not generating local-map slot messages during the previous step
@@ -532,6 +586,7 @@ void mpr_local_dev_check_map_timing(mpr_local_dev dev)
         if (mpr_local_map_get_is_timed((mpr_local_map)map)) {
             dev->timed = 1;
             dev->t_next = MPR_TIME_0;
+            mpr_net_set_updated(mpr_graph_get_net(dev->obj.graph));
             return;
         }
         list = mpr_list_get_next(list);
@@ -539,12 +594,101 @@ void mpr_local_dev_check_map_timing(mpr_local_dev dev)
     dev->timed = 0;
 }
 
+int mpr_local_dev_queue_update(mpr_local_dev dev, mpr_sig sig, mpr_id id, int len, mpr_type type,
+                               const void *val)
+{
+    mpr_sig_update_queue_t *q = &dev->updates;
+    mpr_sig_update u;
+    uint32_t head, tail, offset, skip, vsize, size, idx;
+    RETURN_ARG_UNLESS(q->data && !mpr_net_get_is_poll_thread(mpr_graph_get_net(dev->obj.graph)), 0);
+
+    vsize = len * mpr_type_get_size(type);
+    size = (sizeof(mpr_sig_update_t) + vsize + 7) & ~7;
+    if (size > UPDATE_MAX) {
+        mpr_atomic_add(&q->dropped, 1);
+        return 1;
+    }
+    head = mpr_atomic_get(&q->head);
+    do {
+        /* skip the end of the buffer if the record would not fit there */
+        offset = head & (UPDATE_QUEUE_SIZE - 1);
+        skip = UPDATE_QUEUE_SIZE - offset < size ? UPDATE_QUEUE_SIZE - offset : 0;
+        tail = mpr_atomic_get(&q->tail);
+        if (UPDATE_QUEUE_SIZE - (head - tail) < skip + size) {
+            mpr_atomic_add(&q->dropped, 1);
+            return 1;
+        }
+    } while (!mpr_atomic_cas(&q->head, &head, head + skip + size));
+
+    idx = head;
+    if (skip) {
+        mpr_atomic_set((uint32_t*)(q->data + offset), skip | UPDATE_SKIP);
+        offset = 0;
+    }
+    u = (mpr_sig_update)(q->data + offset);
+    u->len = len;
+    u->sig = sig;
+    u->id = id;
+    u->type = type;
+    if (vsize)
+        memcpy(u + 1, val, vsize);
+    mpr_atomic_set(&u->size, size);
+    mpr_net_set_updated(mpr_graph_get_net(dev->obj.graph));
+
+    /* the polling thread checks for records left behind before blocking, so it only needs to be
+     * woken if it may have seen the queue empty */
+    if (mpr_atomic_get(&q->tail) == idx)
+        mpr_net_wake(mpr_graph_get_net(dev->obj.graph));
+    return 1;
+}
+
+/* Apply the queued signal updates. Returns 1 if a record is still being written. */
+static int apply_sig_updates(mpr_local_dev dev)
+{
+    mpr_sig_update_queue_t *q = &dev->updates;
+    RETURN_ARG_UNLESS(q->data, 0);
+    while (1) {
+        uint32_t offset = q->tail & (UPDATE_QUEUE_SIZE - 1), size;
+        mpr_sig_update u = (mpr_sig_update)(q->data + offset);
+        if (!(size = mpr_atomic_get(&u->size)))
+            break;
+        if (!(size & UPDATE_SKIP) && u->sig) {
+            if (u->len)
+                mpr_sig_set_value(u->sig, u->id, u->len, u->type, u + 1);
+            else
+                mpr_sig_release_inst(u->sig, u->id);
+        }
+        size &= ~UPDATE_SKIP;
+        memset(q->data + offset, 0, size);
+        mpr_atomic_set(&q->tail, q->tail + size);
+    }
+    return mpr_atomic_get(&q->head) != q->tail;
+}
+
+/* Forget the queued updates of a signal that is being removed. */
+static void drop_sig_updates(mpr_local_dev dev, mpr_sig sig)
+{
+    mpr_sig_update_queue_t *q = &dev->updates;
+    uint32_t idx, size;
+    RETURN_UNLESS(q->data);
+    for (idx = q->tail; idx - q->tail < UPDATE_QUEUE_SIZE; idx += size & ~UPDATE_SKIP) {
+        mpr_sig_update u = (mpr_sig_update)(q->data + (idx & (UPDATE_QUEUE_SIZE - 1)));
+        if (!(size = mpr_atomic_get(&u->size)))
+            break;
+        if (!(size & UPDATE_SKIP) && u->sig == sig)
+            u->sig = 0;
+    }
+}
+
 int mpr_local_dev_update_maps(mpr_local_dev dev) {
     mpr_time t;
+    int pending = apply_sig_updates(dev);
     mpr_time_set(&t, MPR_NOW);
     mpr_time_add_dbl(&t, dev->clk_offset);
     mpr_dev_set_time((mpr_dev)dev, t);
 
+    if (pending)
+        return 0;
     if (dev->timed) {
         int next_ms = floor(mpr_time_get_diff(dev->t_next, t) * 1000);
         if (next_ms < 0)
@@ -556,8 +700,15 @@ int mpr_local_dev_update_maps(mpr_local_dev dev) {
 }
 
 void mpr_dev_update_maps(mpr_dev dev) {
+    mpr_net net;
     RETURN_UNLESS(dev && dev->obj.is_local);
-    mpr_local_dev_update_maps((mpr_local_dev)dev);
+    net = mpr_graph_get_net(dev->obj.graph);
+    if (mpr_net_get_is_poll_thread(net))
+        mpr_local_dev_update_maps((mpr_local_dev)dev);
+    else {
+        /* queued updates are processed by the polling thread */
+        mpr_net_wake(net);
+    }
 }
 
 static int mpr_dev_send_sigs(mpr_local_dev dev, mpr_dir dir, int force)
@@ -650,13 +801,122 @@ void mpr_dev_reserve_id_map(mpr_local_dev dev)
     dev->id_maps.reserve = id_map;
 }
 
+/* Active id maps are indexed twice: by local id and by global id. The tables are kept at most
+ * half full so that probe sequences stay short. */
+#define ID_MAP_TBL_MIN_SIZE 16
+
+MPR_INLINE static uint64_t id_map_key(mpr_id_map id_map, int by_GID)
+{
+    return by_GID ? id_map->GID : id_map->LID;
+}
+
+/* Store an id map in the first empty slot of its probe sequence. */
+static void id_map_tbl_append(mpr_id_map_tbl_t *tbl, mpr_id_map id_map, int by_GID)
+{
+    uint32_t mask = tbl->size - 1, i = mpr_id_hash(id_map_key(id_map, by_GID)) & mask;
+    while (tbl->slots[i])
+        i = (i + 1) & mask;
+    tbl->slots[i] = id_map;
+    ++tbl->num;
+}
+
+static void id_map_tbl_grow(mpr_id_map_tbl_t *tbl, int by_GID)
+{
+    mpr_id_map *slots = tbl->slots;
+    uint32_t i, empty = 0, size = tbl->size;
+    tbl->size = size ? size * 2 : ID_MAP_TBL_MIN_SIZE;
+    tbl->slots = (mpr_id_map*) calloc(1, tbl->size * sizeof(mpr_id_map));
+    tbl->num = 0;
+    if (!slots)
+        return;
+    /* Walk the old table in probe order starting from an empty slot so that id maps with equal
+     * keys keep their relative order. */
+    while (slots[empty])
+        ++empty;
+    for (i = 1; i <= size; i++) {
+        mpr_id_map id_map = slots[(empty + i) & (size - 1)];
+        if (id_map)
+            id_map_tbl_append(tbl, id_map, by_GID);
+    }
+    free(slots);
+}
+
+static void id_map_tbl_insert(mpr_id_map_tbl_t *tbl, mpr_id_map id_map, int by_GID)
+{
+    uint64_t key = id_map_key(id_map, by_GID);
+    uint32_t mask, i;
+    if ((tbl->num + 1) * 2 > tbl->size)
+        id_map_tbl_grow(tbl, by_GID);
+    mask = tbl->size - 1;
+    i = mpr_id_hash(key) & mask;
+    while (tbl->slots[i]) {
+        if (id_map_key(tbl->slots[i], by_GID) == key) {
+            /* newer id maps are found first: take this slot and move the older one along */
+            mpr_id_map tmp = tbl->slots[i];
+            tbl->slots[i] = id_map;
+            id_map = tmp;
+        }
+        i = (i + 1) & mask;
+    }
+    tbl->slots[i] = id_map;
+    ++tbl->num;
+}
+
+/* Remove an id map using backward-shift deletion. Returns 1 if the id map was found. */
+static int id_map_tbl_remove(mpr_id_map_tbl_t *tbl, mpr_id_map id_map, int by_GID)
+{
+    uint32_t mask, i, j;
+    RETURN_ARG_UNLESS(tbl->num, 0);
+    mask = tbl->size - 1;
+    i = mpr_id_hash(id_map_key(id_map, by_GID)) & mask;
+    while (tbl->slots[i] != id_map) {
+        RETURN_ARG_UNLESS(tbl->slots[i], 0);
+        i = (i + 1) & mask;
+    }
+    j = i;
+    while (1) {
+        uint32_t home;
+        j = (j + 1) & mask;
+        if (!tbl->slots[j])
+            break;
+        home = mpr_id_hash(id_map_key(tbl->slots[j], by_GID)) & mask;
+        /* leave id maps whose home slot lies between the hole and their current slot */
+        if (((j - home) & mask) < ((j - i) & mask))
+            continue;
+        tbl->slots[i] = tbl->slots[j];
+        i = j;
+    }
+    tbl->slots[i] = 0;
+    --tbl->num;
+    return 1;
+}
+
+/* Returns the slot index of the first id map with a matching key, or -1 if there is none. */
+static int id_map_tbl_find(mpr_id_map_tbl_t *tbl, uint64_t key, int by_GID, int skip_released)
+{
+    uint32_t mask, i;
+    RETURN_ARG_UNLESS(tbl->num, -1);
+    mask = tbl->size - 1;
+    i = mpr_id_hash(key) & mask;
+    while (tbl->slots[i]) {
+        mpr_id_map id_map = tbl->slots[i];
+        if (id_map_key(id_map, by_GID) == key && (!skip_released || id_map->LID_refcount > 0))
+            return i;
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
 int mpr_local_dev_get_num_id_maps(mpr_local_dev dev, int active)
 {
     int count = 0;
-    mpr_id_map *id_map = active ? &(dev)->id_maps.active[0] : &(dev)->id_maps.reserve;
-    while (*id_map) {
+    mpr_id_map id_map;
+    if (active)
+        return dev->id_maps.by_LID[0].num;
+    id_map = dev->id_maps.reserve;
+    while (id_map) {
         ++count;
-        id_map = &(*id_map)->next;
+        id_map = id_map->next;
     }
     return count;
 }
@@ -664,11 +924,12 @@ int mpr_local_dev_get_num_id_maps(mpr_local_dev dev, int active)
 #ifdef DEBUG
 void mpr_local_dev_print_id_maps(mpr_local_dev dev)
 {
+    mpr_id_map_tbl_t *tbl = &dev->id_maps.by_LID[0];
+    uint32_t i;
     printf("ID MAPS for %s:\n", dev->name);
-    mpr_id_map *id_maps = &dev->id_maps.active[0];
-    while (*id_maps) {
-        mpr_id_map_print(*id_maps);
-        id_maps = &(*id_maps)->next;
+    for (i = 0; i < tbl->size; i++) {
+        if (tbl->slots[i])
+            mpr_id_map_print(tbl->slots[i]);
     }
 }
 #endif
@@ -687,8 +948,9 @@ mpr_id_map mpr_dev_add_id_map(mpr_local_dev dev, int group, mpr_id LID, mpr_id G
     id_map->GID_refcount = 0;
     id_map->indirect = indirect;
     dev->id_maps.reserve = id_map->next;
-    id_map->next = dev->id_maps.active[group];
-    dev->id_maps.active[group] = id_map;
+    id_map->next = 0;
+    id_map_tbl_insert(&dev->id_maps.by_LID[group], id_map, 0);
+    id_map_tbl_insert(&dev->id_maps.by_GID[group], id_map, 1);
 #ifdef DEBUG
     mpr_local_dev_print_id_maps(dev);
 #endif
@@ -697,17 +959,13 @@ mpr_id_map mpr_dev_add_id_map(mpr_local_dev dev, int group, mpr_id LID, mpr_id G
 
 void mpr_dev_remove_id_map(mpr_local_dev dev, int group, mpr_id_map rem)
 {
-    mpr_id_map *map = &dev->id_maps.active[group];
+    RETURN_UNLESS(rem);
     trace_dev(dev, "mpr_dev_remove_id_map(%s) %"PR_MPR_ID" -> %"PR_MPR_ID"\n",
               dev->name, rem->LID, rem->GID);
-    while (*map) {
-        if ((*map) == rem) {
-            *map = (*map)->next;
-            rem->next = dev->id_maps.reserve;
-            dev->id_maps.reserve = rem;
-            break;
-        }
-        map = &(*map)->next;
+    if (id_map_tbl_remove(&dev->id_maps.by_LID[group], rem, 0)) {
+        id_map_tbl_remove(&dev->id_maps.by_GID[group], rem, 1);
+        rem->next = dev->id_maps.reserve;
+        dev->id_maps.reserve = rem;
     }
 #ifdef DEBUG
     mpr_local_dev_print_id_maps(dev);
@@ -755,41 +1013,32 @@ int mpr_dev_GID_decref(mpr_local_dev dev, int group, mpr_id_map id_map)
 
 mpr_id_map mpr_dev_get_id_map_by_LID(mpr_local_dev dev, int group, mpr_id LID)
 {
-    mpr_id_map id_map = dev->id_maps.active[group];
-    while (id_map) {
-        if (id_map->LID == LID && id_map->LID_refcount > 0) {
-            return id_map;
-        }
-        id_map = id_map->next;
-    }
-    return 0;
+    mpr_id_map_tbl_t *tbl = &dev->id_maps.by_LID[group];
+    int i = id_map_tbl_find(tbl, LID, 0, 1);
+    return i >= 0 ? tbl->slots[i] : 0;
 }
 
 mpr_id_map mpr_dev_get_id_map_by_GID(mpr_local_dev dev, int group, mpr_id GID)
 {
-    mpr_id_map id_map = dev->id_maps.active[group];
-    while (id_map) {
-        if (id_map->GID == GID)
-            return id_map;
-        id_map = id_map->next;
-    }
-    return 0;
+    mpr_id_map_tbl_t *tbl = &dev->id_maps.by_GID[group];
+    int i = id_map_tbl_find(tbl, GID, 1, 0);
+    return i >= 0 ? tbl->slots[i] : 0;
 }
 
 /* TODO: rename this function */
 mpr_id_map mpr_dev_get_id_map_GID_free(mpr_local_dev dev, int group, mpr_id last_GID)
 {
-    int searching = last_GID != 0;
-    mpr_id_map id_map = dev->id_maps.active[group];
-    while (id_map && searching) {
-        if (id_map->GID == last_GID)
-            searching = 0;
-        id_map = id_map->next;
+    mpr_id_map_tbl_t *tbl = &dev->id_maps.by_GID[group];
+    int i = 0;
+    if (last_GID) {
+        /* continue the search after the id map returned last */
+        RETURN_ARG_UNLESS((i = id_map_tbl_find(tbl, last_GID, 1, 0)) >= 0, 0);
+        ++i;
     }
-    while (id_map) {
-        if (!id_map->remapped && id_map->GID_refcount <= 0)
+    for (; i < (int)tbl->size; i++) {
+        mpr_id_map id_map = tbl->slots[i];
+        if (id_map && !id_map->remapped && id_map->GID_refcount <= 0)
             return id_map;
-        id_map = id_map->next;
     }
     return 0;
 }
@@ -1188,12 +1437,14 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
             sub->addr = lo_address_new(host, port);
         }
         sub->protocol = proto;
+        mpr_net_resolve_dst(&sub->dst, host, port);
         sub->host = strdup(host);
         sub->port = strdup(port);
         sub->lease_exp = t.sec + timeout_sec;
         sub->flags = flags;
         sub->next = dev->subscribers;
         dev->subscribers = sub;
+        mpr_net_add_subscribed_dev(net, dev);
     }
     if (sub)
         addr = sub->addr;
@@ -1239,14 +1490,24 @@ void mpr_dev_update_subscribers(mpr_local_dev ldev)
     }
 }
 
-int mpr_dev_check_synced(mpr_dev dev, mpr_time time)
+void mpr_dev_set_synced(mpr_dev dev, mpr_time time)
 {
-    return !dev->synced.sec || (dev->synced.sec > time.sec);
+    mpr_time_set(&dev->synced, time);
 }
 
-void mpr_dev_set_synced(mpr_dev dev, mpr_time time)
+mpr_time mpr_dev_get_synced(mpr_dev dev)
 {
-    mpr_time_set(&dev->synced, time);
+    return dev->synced;
+}
+
+void mpr_dev_set_sync_interval(mpr_dev dev, int interval)
+{
+    dev->sync_interval = interval;
+}
+
+int mpr_dev_get_sync_interval(mpr_dev dev)
+{
+    return dev->sync_interval;
 }
 
 int mpr_dev_has_local_link(mpr_dev dev)
@@ -1259,14 +1520,17 @@ int mpr_dev_has_local_link(mpr_dev dev)
     return 0;
 }
 
+/* may be called from interrupts while the device is being polled */
 void mpr_local_dev_set_sending(mpr_local_dev dev)
 {
-    dev->updated |= MPR_DIR_OUT;
+    mpr_atomic_or(&dev->updated, MPR_DIR_OUT);
+    mpr_net_set_updated(mpr_graph_get_net(dev->obj.graph));
 }
 
 void mpr_local_dev_set_receiving(mpr_local_dev dev)
 {
-    dev->updated |= MPR_DIR_IN;
+    mpr_atomic_or(&dev->updated, MPR_DIR_IN);
+    mpr_net_set_updated(mpr_graph_get_net(dev->obj.graph));
 }
 
 int mpr_local_dev_has_subscribers(mpr_local_dev dev)
@@ -1278,7 +1542,9 @@ void mpr_local_dev_send_to_subscribers(mpr_local_dev dev, lo_bundle bundle,
                                        int msg_type, lo_server *servers)
 {
     mpr_subscriber *sub = &dev->subscribers;
+    mpr_net net = mpr_graph_get_net(dev->obj.graph);
     mpr_time t;
+    int serialised = 0;
     if (!*sub)
         return;
 
@@ -1302,10 +1568,23 @@ void mpr_local_dev_send_to_subscribers(mpr_local_dev dev, lo_bundle bundle,
             free(temp);
             continue;
         }
-        if ((*sub)->flags & msg_type)
-            lo_send_bundle_from((*sub)->addr, servers[MPR_PROTO_TCP == (*sub)->protocol], bundle);
+        if ((*sub)->flags & msg_type) {
+            lo_server server = servers[MPR_PROTO_TCP == (*sub)->protocol];
+            int sent = 0;
+            if (MPR_PROTO_TCP != (*sub)->protocol) {
+                /* serialise the bundle once and share it between all UDP subscribers */
+                if (!serialised)
+                    serialised = mpr_net_serialise(net, bundle) ? 1 : -1;
+                if (serialised > 0)
+                    sent = mpr_net_send_serialised(net, server, &(*sub)->dst);
+            }
+            if (!sent)
+                lo_send_bundle_from((*sub)->addr, server, bundle);
+        }
         sub = &(*sub)->next;
     }
+    if (serialised > 0)
+        mpr_net_flush_dgrams(net);
 }
 
 void mpr_local_dev_restart_registration(mpr_local_dev dev, int start_ordinal)
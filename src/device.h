@@ -94,9 +94,17 @@ mpr_link mpr_dev_get_link_by_remote(mpr_dev dev, mpr_dev remote);
 
 void mpr_dev_set_synced(mpr_dev dev, mpr_time time);
 
-int mpr_dev_has_local_link(mpr_dev dev);
+mpr_time mpr_dev_get_synced(mpr_dev dev);
+
+/*! Set the heartbeat interval advertised in the sync messages of a remote device. */
+void mpr_dev_set_sync_interval(mpr_dev dev, int interval);
+
+/*! Get the heartbeat interval advertised by a remote device.
+ *  \param dev          The device to query.
+ *  \return             The interval in seconds, or 0 if the device has not advertised one. */
+int mpr_dev_get_sync_interval(mpr_dev dev);
 
-int mpr_dev_check_synced(mpr_dev dev, mpr_time time);
+int mpr_dev_has_local_link(mpr_dev dev);
 
 size_t mpr_dev_get_struct_size(int is_local);
 
@@ -150,4 +158,18 @@ void mpr_local_dev_check_map_timing(mpr_local_dev dev);
 /* returns the number of ms until next device event */
 int mpr_local_dev_update_maps(mpr_local_dev dev);
 
+/*! Queue a signal update made by a thread other than the one polling the device, to be applied
+ *  by the polling thread the next time it updates the device's maps. Updates that do not fit in
+ *  the queue are dropped.
+ *  \param dev          The device owning the signal.
+ *  \param sig          The signal to update.
+ *  \param id           The id of the instance to update.
+ *  \param len          The length of the value, or 0 to release the instance.
+ *  \param type         The type of the value.
+ *  \param val          The value.
+ *  eturn             0 if called from the polling thread, in which case the update should be
+ *                      applied directly, or 1 otherwise. */
+int mpr_local_dev_queue_update(mpr_local_dev dev, mpr_sig sig, mpr_id id, int len, mpr_type type,
+                               const void *val);
+
 #endif /* __MPR_DEVICE_H__ */
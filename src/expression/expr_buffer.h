@@ -11,7 +11,7 @@ typedef struct _ebuffer
 {
     evalue vals;
     mpr_type *types;
-    uint8_t *lens;
+    uint16_t *lens;
     unsigned int size;
     unsigned int len;
 } *ebuffer;
@@ -23,7 +23,7 @@ ebuffer ebuffer_new(void)
 }
 
 /* Reallocate evaluation stack if necessary. */
-void ebuffer_realloc(ebuffer buff, uint8_t num_slots, uint8_t vec_len)
+void ebuffer_realloc(ebuffer buff, uint8_t num_slots, uint16_t vec_len)
 {
     if (buff->len < num_slots) {
         buff->len = num_slots;
@@ -32,9 +32,9 @@ void ebuffer_realloc(ebuffer buff, uint8_t num_slots, uint8_t vec_len)
         else
             buff->types = malloc(buff->len * sizeof(mpr_type));
         if (buff->lens)
-            buff->lens = realloc(buff->lens, buff->len * sizeof(uint8_t));
+            buff->lens = realloc(buff->lens, buff->len * sizeof(uint16_t));
         else
-            buff->lens = malloc(buff->len * sizeof(uint8_t));
+            buff->lens = malloc(buff->len * sizeof(uint16_t));
     }
 
     /* evaluation buffer size needs to multiplied by vector length */
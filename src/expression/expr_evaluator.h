@@ -112,14 +112,15 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
     estack stk = expr->stack;
     etoken_t *tok = stk->tokens, *end = tok + stk->num_tokens, *init = tok + stk->init_offset;
     int dp = -1, sp = -stk->vec_len, status = 1 | EXPR_EVAL_DONE;
-    /* Note: signal, history, and vector reduce are currently limited to 255 items here */
-    uint8_t alive = 1, muted = 0, cache = 0, vlen = stk->vec_len;
-    uint8_t hist_offset = 0, sig_offset = 0, vec_offset = 0;
+    /* Note: signal and history reduce are currently limited to 255 items here */
+    uint8_t alive = 1, muted = 0, cache = 0, hist_offset = 0, sig_offset = 0;
+    uint16_t vlen = stk->vec_len, vec_offset = 0;
     mpr_value x = NULL;
     mpr_time then;
 
     evalue vals = buff->vals;
-    uint8_t *lens = buff->lens, src_updated = 0;
+    uint16_t *lens = buff->lens;
+    uint8_t src_updated = 0;
     mpr_type *types = buff->types;
 
     if (v_out) {
@@ -522,7 +523,8 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
             break;
         }
         case TOK_OP: {
-            uint8_t i, max_len, rlen, arity = tok->op.arity;
+            uint8_t i, arity = tok->op.arity;
+            uint16_t max_len, rlen;
             INCR_STACK_PTR(1 - arity);
             /* first copy vals[sp] elements if necessary */
             max_len = lens[dp];
@@ -608,7 +610,8 @@ int mpr_expr_eval(mpr_expr expr, ebuffer buff, mpr_value *v_in, mpr_value *v_var
         }
         case TOK_FN: {
             int i, diff;
-            uint8_t max_len, llen, rlen = 0, arity = tok->fn.arity;
+            uint16_t max_len, llen, rlen = 0;
+            uint8_t arity = tok->fn.arity;
             INCR_STACK_PTR(1 - arity);
             /* TODO: use preprocessor macro or inline func here */
             /* first copy vals[sp] elements if necessary */
@@ -71,18 +71,18 @@ static double periodicd(double period, double t_start, double t_now)
     return (floor((t_now - t_start + 0.001) / period) + 1) * period + t_start;
 }
 
-#define COMP_VFUNC(NAME, TYPE, OP, CMP, RET, T)     \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE ret = 1 - RET;                    \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++) {                     \
-        if (val[i].T OP CMP) {                      \
-            ret = RET;                              \
-            break;                                  \
-        }                                           \
-    }                                               \
-    val[0].T = ret;                                 \
+#define COMP_VFUNC(NAME, TYPE, OP, CMP, RET, T)      \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE ret = 1 - RET;                     \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++) {                      \
+        if (val[i].T OP CMP) {                       \
+            ret = RET;                               \
+            break;                                   \
+        }                                            \
+    }                                                \
+    val[0].T = ret;                                  \
 }
 COMP_VFUNC(valli, int, ==, 0, 0, i)
 COMP_VFUNC(vallf, float, ==, 0.f, 0, f)
@@ -91,76 +91,84 @@ COMP_VFUNC(vanyi, int, !=, 0, 1, i)
 COMP_VFUNC(vanyf, float, !=, 0.f, 1, f)
 COMP_VFUNC(vanyd, double, !=, 0., 1, d)
 
-#define LEN_VFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    val[0].T = dim[0];                              \
+#define LEN_VFUNC(NAME, TYPE, T)                     \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    val[0].T = dim[0];                               \
 }
 LEN_VFUNC(vleni, int, i)
 LEN_VFUNC(vlenf, float, f)
 LEN_VFUNC(vlend, double, d)
 
-#define SUM_VFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE aggregate = 0;                    \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++)                       \
-        aggregate += val[i].T;                      \
-    val[0].T = aggregate;                           \
+/* Use several partial sums so that successive additions do not depend on each other, which
+ * speeds up the sum (and mean) of long vectors. */
+#define SUM_VFUNC(NAME, TYPE, T)                     \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE s0 = 0, s1 = 0, s2 = 0, s3 = 0;    \
+    int i, len = dim[0];                             \
+    for (i = 0; i + 3 < len; i += 4) {               \
+        s0 += val[i].T;                              \
+        s1 += val[i + 1].T;                          \
+        s2 += val[i + 2].T;                          \
+        s3 += val[i + 3].T;                          \
+    }                                                \
+    for (; i < len; i++)                             \
+        s0 += val[i].T;                              \
+    val[0].T = (s0 + s1) + (s2 + s3);                \
 }
 SUM_VFUNC(vsumi, int, i)
 SUM_VFUNC(vsumf, float, f)
 SUM_VFUNC(vsumd, double, d)
 
-#define PROD_VFUNC(NAME, TYPE, T)                   \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE product = 0;                      \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++)                       \
-        product *= val[i].T;                        \
-    val[0].T = product;                             \
+#define PROD_VFUNC(NAME, TYPE, T)                    \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE product = 0;                       \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++)                        \
+        product *= val[i].T;                         \
+    val[0].T = product;                              \
 }
 PROD_VFUNC(vprodi, int, i)
 PROD_VFUNC(vprodf, float, f)
 PROD_VFUNC(vprodd, double, d)
 
-#define MEAN_VFUNC(NAME, TYPE, T)                   \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    vsum##T(val, dim, inc);                         \
-    val[0].T /= dim[0];                             \
+#define MEAN_VFUNC(NAME, TYPE, T)                    \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    vsum##T(val, dim, inc);                          \
+    val[0].T /= dim[0];                              \
 }
 MEAN_VFUNC(vmeanf, float, f)
 MEAN_VFUNC(vmeand, double, d)
 
-#define CENTER_VFUNC(NAME, TYPE, T)                 \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE max = val[0].T, min = max;        \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++) {                     \
-        if (val[i].T > max)                         \
-            max = val[i].T;                         \
-        if (val[i].T < min)                         \
-            min = val[i].T;                         \
-    }                                               \
-    val[0].T = (max + min) * 0.5;                   \
+#define CENTER_VFUNC(NAME, TYPE, T)                  \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE max = val[0].T, min = max;         \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++) {                      \
+        if (val[i].T > max)                          \
+            max = val[i].T;                          \
+        if (val[i].T < min)                          \
+            min = val[i].T;                          \
+    }                                                \
+    val[0].T = (max + min) * 0.5;                    \
 }
 CENTER_VFUNC(vcenterf, float, f)
 CENTER_VFUNC(vcenterd, double, d)
 
-#define EXTREMA_VFUNC(NAME, OP, TYPE, T)            \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE extrema = val[0].T;               \
-    int i, len = dim[0];                            \
-    for (i = 1; i < len; i++) {                     \
-        if (val[i].T OP extrema)                    \
-            extrema = val[i].T;                     \
-    }                                               \
-    val[0].T = extrema;                             \
+#define EXTREMA_VFUNC(NAME, OP, TYPE, T)             \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE extrema = val[0].T;                \
+    int i, len = dim[0];                             \
+    for (i = 1; i < len; i++) {                      \
+        if (val[i].T OP extrema)                     \
+            extrema = val[i].T;                      \
+    }                                                \
+    val[0].T = extrema;                              \
 }
 EXTREMA_VFUNC(vmaxi, >, int, i)
 EXTREMA_VFUNC(vmini, <, int, i)
@@ -185,74 +193,74 @@ DEC_SORT_FUNC(int, i)
 DEC_SORT_FUNC(float, f)
 DEC_SORT_FUNC(double, d)
 
-#define SORT_VFUNC(NAME, TYPE, T)                               \
-static void NAME(evalue val, uint8_t *dim, int inc)             \
-{                                                               \
-    evalue dir = val + inc;                                     \
-    if (dir[0].T >= 0)                                          \
-        qsort(val, dim[0], sizeof(evalue_t), inc_sort_func##T); \
-    else                                                        \
-        qsort(val, dim[0], sizeof(evalue_t), dec_sort_func##T); \
+#define SORT_VFUNC(NAME, TYPE, T)                                \
+static void NAME(evalue val, uint16_t *dim, int inc)             \
+{                                                                \
+    evalue dir = val + inc;                                      \
+    if (dir[0].T >= 0)                                           \
+        qsort(val, dim[0], sizeof(evalue_t), inc_sort_func##T);  \
+    else                                                         \
+        qsort(val, dim[0], sizeof(evalue_t), dec_sort_func##T);  \
 }
 SORT_VFUNC(vsorti, int, i)
 SORT_VFUNC(vsortf, float, f)
 SORT_VFUNC(vsortd, double, d)
 
-#define MEDIAN_VFUNC(NAME, TYPE, T)                         \
-static void NAME(evalue val, uint8_t *dim, int inc)         \
-{                                                           \
-    register int idx = floor(dim[0] * 0.5);                 \
-    register double tmp;                                    \
-    qsort(val, dim[0], sizeof(evalue_t), inc_sort_func##T); \
-    tmp = (double)val[idx].T;                               \
-    if (dim[0] > 2 && !(dim[0] % 2)) {                      \
-        tmp += val[--idx].T;                                \
-        tmp *= 0.5;                                         \
-    }                                                       \
-    val[0].T = (TYPE)tmp;                                   \
+#define MEDIAN_VFUNC(NAME, TYPE, T)                          \
+static void NAME(evalue val, uint16_t *dim, int inc)         \
+{                                                            \
+    register int idx = floor(dim[0] * 0.5);                  \
+    register double tmp;                                     \
+    qsort(val, dim[0], sizeof(evalue_t), inc_sort_func##T);  \
+    tmp = (double)val[idx].T;                                \
+    if (dim[0] > 2 && !(dim[0] % 2)) {                       \
+        tmp += val[--idx].T;                                 \
+        tmp *= 0.5;                                          \
+    }                                                        \
+    val[0].T = (TYPE)tmp;                                    \
 }
 MEDIAN_VFUNC(vmediani, int, i)
 MEDIAN_VFUNC(vmedianf, float, f)
 MEDIAN_VFUNC(vmediand, double, d)
 
-#define NORM_VFUNC(NAME, TYPE, T)                   \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    register TYPE tmp = 0;                          \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++)                       \
-        tmp += pow##T(val[i].T, 2);                 \
-    val[0].T = sqrt##T(tmp);                        \
+#define NORM_VFUNC(NAME, TYPE, T)                    \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    register TYPE tmp = 0;                           \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++)                        \
+        tmp += val[i].T * val[i].T;                  \
+    val[0].T = sqrt##T(tmp);                         \
 }
 NORM_VFUNC(vnormf, float, f)
 NORM_VFUNC(vnormd, double, d)
 
-#define DOT_VFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue a, uint8_t *dim, int inc)   \
-{                                                   \
-    register TYPE dot = 0;                          \
-    evalue b = a + inc;                             \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++)                       \
-        dot += a[i].T * b[i].T;                     \
-    a[0].T = dot;                                   \
+#define DOT_VFUNC(NAME, TYPE, T)                     \
+static void NAME(evalue a, uint16_t *dim, int inc)   \
+{                                                    \
+    register TYPE dot = 0;                           \
+    evalue b = a + inc;                              \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++)                        \
+        dot += a[i].T * b[i].T;                      \
+    a[0].T = dot;                                    \
 }
 DOT_VFUNC(vdoti, int, i)
 DOT_VFUNC(vdotf, float, f)
 DOT_VFUNC(vdotd, double, d)
 
-#define INDEX_VFUNC(NAME, TYPE, T)                  \
-static void NAME(evalue a, uint8_t *dim, int inc)   \
-{                                                   \
-    evalue b = a + inc;                             \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++) {                     \
-        if (a[i].T == b[0].T) {                     \
-            a[0].T = (TYPE)i;                       \
-            return;                                 \
-        }                                           \
-    }                                               \
-    a[0].T = (TYPE)-1;                              \
+#define INDEX_VFUNC(NAME, TYPE, T)                   \
+static void NAME(evalue a, uint16_t *dim, int inc)   \
+{                                                    \
+    evalue b = a + inc;                              \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++) {                      \
+        if (a[i].T == b[0].T) {                      \
+            a[0].T = (TYPE)i;                        \
+            return;                                  \
+        }                                            \
+    }                                                \
+    a[0].T = (TYPE)-1;                               \
 }
 INDEX_VFUNC(vindexi, int, i)
 INDEX_VFUNC(vindexf, float, f)
@@ -262,73 +270,73 @@ INDEX_VFUNC(vindexd, double, d)
  * should probably have separate function for signed and unsigned: angle vs. rotation */
 
 #define atan2d atan2
-#define ANGLE_VFUNC(NAME, TYPE, T)                              \
-static void NAME(evalue a, uint8_t *dim, int inc)               \
-{                                                               \
-    register TYPE theta;                                        \
-    evalue b = a + inc;                                         \
-    theta = atan2##T(b[1].T, b[0].T) - atan2##T(a[1].T, a[0].T);\
-    if (theta > M_PI)                                           \
-        theta -= 2 * M_PI;                                      \
-    else if (theta < -M_PI)                                     \
-        theta += 2 * M_PI;                                      \
-    a[0].T = theta;                                             \
+#define ANGLE_VFUNC(NAME, TYPE, T)                               \
+static void NAME(evalue a, uint16_t *dim, int inc)               \
+{                                                                \
+    register TYPE theta;                                         \
+    evalue b = a + inc;                                          \
+    theta = atan2##T(b[1].T, b[0].T) - atan2##T(a[1].T, a[0].T); \
+    if (theta > M_PI)                                            \
+        theta -= 2 * M_PI;                                       \
+    else if (theta < -M_PI)                                      \
+        theta += 2 * M_PI;                                       \
+    a[0].T = theta;                                              \
 }
 ANGLE_VFUNC(vanglef, float, f)
 ANGLE_VFUNC(vangled, double, d)
 
-#define MAXMIN_VFUNC(NAME, TYPE, T)                 \
-static void NAME(evalue max, uint8_t *dim, int inc) \
-{                                                   \
-    evalue min = max + inc, new = min + inc;        \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++) {                     \
-        if (new[i].T > max[i].T)                    \
-            max[i].T = new[i].T;                    \
-        if (new[i].T < min[i].T)                    \
-            min[i].T = new[i].T;                    \
-    }                                               \
+#define MAXMIN_VFUNC(NAME, TYPE, T)                  \
+static void NAME(evalue max, uint16_t *dim, int inc) \
+{                                                    \
+    evalue min = max + inc, new = min + inc;         \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++) {                      \
+        if (new[i].T > max[i].T)                     \
+            max[i].T = new[i].T;                     \
+        if (new[i].T < min[i].T)                     \
+            min[i].T = new[i].T;                     \
+    }                                                \
 }
 MAXMIN_VFUNC(vmaxmini, int, i)
 MAXMIN_VFUNC(vmaxminf, float, f)
 MAXMIN_VFUNC(vmaxmind, double, d)
 
-#define SUMNUM_VFUNC(NAME, TYPE, T)                 \
-static void NAME(evalue sum, uint8_t *dim, int inc) \
-{                                                   \
-    evalue num = sum + inc, new = num + inc;        \
-    int i, len = dim[0];                            \
-    for (i = 0; i < len; i++) {                     \
-        sum[i].T += new[i].T;                       \
-        num[i].T += 1;                              \
-    }                                               \
+#define SUMNUM_VFUNC(NAME, TYPE, T)                  \
+static void NAME(evalue sum, uint16_t *dim, int inc) \
+{                                                    \
+    evalue num = sum + inc, new = num + inc;         \
+    int i, len = dim[0];                             \
+    for (i = 0; i < len; i++) {                      \
+        sum[i].T += new[i].T;                        \
+        num[i].T += 1;                               \
+    }                                                \
 }
 SUMNUM_VFUNC(vsumnumi, int, i)
 SUMNUM_VFUNC(vsumnumf, float, f)
 SUMNUM_VFUNC(vsumnumd, double, d)
 
-#define CONCAT_VFUNC(NAME, TYPE, T)                                     \
-static void NAME(evalue cat, uint8_t *dim, int inc)                     \
-{                                                                       \
-    evalue num = cat + inc, new = num + inc;                            \
-    uint8_t i, j, newlen = dim[2];                                      \
-    for (i = dim[0], j = 0; j < newlen && i < (int)num[0].T; i++, j++)  \
-        cat[i].T = new[j].T;                                            \
-    dim[0] = i;                                                         \
+#define CONCAT_VFUNC(NAME, TYPE, T)                                      \
+static void NAME(evalue cat, uint16_t *dim, int inc)                     \
+{                                                                        \
+    evalue num = cat + inc, new = num + inc;                             \
+    uint16_t i, j, newlen = dim[2];                                      \
+    for (i = dim[0], j = 0; j < newlen && i < (int)num[0].T; i++, j++)   \
+        cat[i].T = new[j].T;                                             \
+    dim[0] = i;                                                          \
 }
 CONCAT_VFUNC(vconcati, int, i)
 CONCAT_VFUNC(vconcatf, float, f)
 CONCAT_VFUNC(vconcatd, double, d)
 
-#define REV_VFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue val, uint8_t *dim, int inc) \
-{                                                   \
-    int i = 0, j = dim[0] - 1;                      \
-    while (i < j) {                                 \
-        register TYPE tmp = val[i].T;               \
-        val[i++].T = val[j].T;                      \
-        val[j--].T = tmp;                           \
-    }                                               \
+#define REV_VFUNC(NAME, TYPE, T)                     \
+static void NAME(evalue val, uint16_t *dim, int inc) \
+{                                                    \
+    int i = 0, j = dim[0] - 1;                       \
+    while (i < j) {                                  \
+        register TYPE tmp = val[i].T;                \
+        val[i++].T = val[j].T;                       \
+        val[j--].T = tmp;                            \
+    }                                                \
 }
 REV_VFUNC(vrevi, int, i)
 REV_VFUNC(vrevf, float, f)
@@ -336,33 +344,33 @@ REV_VFUNC(vrevd, double, d)
 
 /* Fast quaternion multiplication adapted from:
  * http://www.j3d.org/matrix_faq/matrfaq_latest.html#Q53 */
-#define MULT_QFUNC(NAME, TYPE, T)                                   \
-static void NAME(evalue l, uint8_t *dim, int inc)                   \
-{                                                                   \
-    evalue r = l + inc;                                             \
-    TYPE ww = (l[3].T + l[1].T) * (r[1].T + r[2].T);                \
-    TYPE yy = (l[0].T - l[2].T) * (r[0].T + r[3].T);                \
-    TYPE zz = (l[0].T + l[2].T) * (r[0].T - r[3].T);                \
-    TYPE xx = ww + yy + zz;                                         \
-    TYPE qq = 0.5 * (xx + (l[3].T - l[1].T) * (r[1].T - r[2].T));   \
-    TYPE w = qq - ww + (l[3].T - l[2].T) * (r[2].T - r[3].T);       \
-    TYPE x = qq - xx + (l[1].T + l[0].T) * (r[1].T + r[0].T);       \
-    TYPE y = qq - yy + (l[0].T - l[1].T) * (r[2].T + r[3].T);       \
-    TYPE z = qq - zz + (l[3].T + l[2].T) * (r[0].T - r[1].T);       \
-    l[0].T = w;                                                     \
-    l[1].T = x;                                                     \
-    l[2].T = y;                                                     \
-    l[3].T = z;                                                     \
+#define MULT_QFUNC(NAME, TYPE, T)                                    \
+static void NAME(evalue l, uint16_t *dim, int inc)                   \
+{                                                                    \
+    evalue r = l + inc;                                              \
+    TYPE ww = (l[3].T + l[1].T) * (r[1].T + r[2].T);                 \
+    TYPE yy = (l[0].T - l[2].T) * (r[0].T + r[3].T);                 \
+    TYPE zz = (l[0].T + l[2].T) * (r[0].T - r[3].T);                 \
+    TYPE xx = ww + yy + zz;                                          \
+    TYPE qq = 0.5 * (xx + (l[3].T - l[1].T) * (r[1].T - r[2].T));    \
+    TYPE w = qq - ww + (l[3].T - l[2].T) * (r[2].T - r[3].T);        \
+    TYPE x = qq - xx + (l[1].T + l[0].T) * (r[1].T + r[0].T);        \
+    TYPE y = qq - yy + (l[0].T - l[1].T) * (r[2].T + r[3].T);        \
+    TYPE z = qq - zz + (l[3].T + l[2].T) * (r[0].T - r[1].T);        \
+    l[0].T = w;                                                      \
+    l[1].T = x;                                                      \
+    l[2].T = y;                                                      \
+    l[3].T = z;                                                      \
 }
 MULT_QFUNC(qmultf, float, f)
 MULT_QFUNC(qmultd, double, d)
 
-#define CONJ_QFUNC(NAME, TYPE, T)                   \
-static void NAME(evalue q, uint8_t *dim, int inc)   \
-{                                                   \
-    q[1].T *= -1;                                   \
-    q[2].T *= -1;                                   \
-    q[3].T *= -1;                                   \
+#define CONJ_QFUNC(NAME, TYPE, T)                    \
+static void NAME(evalue q, uint16_t *dim, int inc)   \
+{                                                    \
+    q[1].T *= -1;                                    \
+    q[2].T *= -1;                                    \
+    q[3].T *= -1;                                    \
 }
 CONJ_QFUNC(qconjf, float, f)
 CONJ_QFUNC(qconjd, double, d)
@@ -372,66 +380,66 @@ CONJ_QFUNC(qconjd, double, d)
 #define qinvmagf(Q) (1. / qmagf(Q))
 #define qinvmagd(Q) (1. / qmagd(Q))
 
-#define INV_QFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue q, uint8_t *dim, int inc)   \
-{                                                   \
-    TYPE m = qmag##T(q);                            \
-    if (m == 0)                                     \
-        return;                                     \
-    m = 1. / m;                                     \
-    q[0].T *= m;                                    \
-    m *= -1.;                                       \
-    q[1].T *= m;                                    \
-    q[2].T *= m;                                    \
-    q[3].T *= m;                                    \
+#define INV_QFUNC(NAME, TYPE, T)                     \
+static void NAME(evalue q, uint16_t *dim, int inc)   \
+{                                                    \
+    TYPE m = qmag##T(q);                             \
+    if (m == 0)                                      \
+        return;                                      \
+    m = 1. / m;                                      \
+    q[0].T *= m;                                     \
+    m *= -1.;                                        \
+    q[1].T *= m;                                     \
+    q[2].T *= m;                                     \
+    q[3].T *= m;                                     \
 }
 INV_QFUNC(qinvf, float, f)
 INV_QFUNC(qinvd, double, d)
 
-#define SLERP_QFUNC(NAME, TYPE, T)                                                              \
-static void NAME(evalue l, uint8_t *dim, int inc)                                               \
-{                                                                                               \
-    evalue r = l + inc;                                                                         \
-    TYPE w = (r + inc)[0].T;                                                                    \
-    int i;                                                                                      \
-    TYPE dot = l[0].T * r[0].T + l[1].T * r[1].T + l[2].T * r[2].T + l[3].T * r[3].T;           \
-    if (dot < 0.) {                                                                             \
-        for (i = 0; i < 4; i++)                                                                 \
-            r[i].T *= -1.;                                                                      \
-        dot = l[0].T * r[0].T + l[1].T * r[1].T + l[2].T * r[2].T + l[3].T * r[3].T;            \
-    }                                                                                           \
-    if (dot > 0.9995) {                                                                         \
-        l[0].T += (r[0].T - l[0].T) * w;                                                        \
-        l[1].T += (r[1].T - l[1].T) * w;                                                        \
-        l[2].T += (r[2].T - l[2].T) * w;                                                        \
-        l[3].T += (r[3].T - l[3].T) * w;                                                        \
-        /* normalize */                                                                         \
-        TYPE m = qmag##T(l);                                                                    \
-        if (0 == m)                                                                             \
-            return;                                                                             \
-        m = 1. / m;                                                                             \
-        for (i = 0; i < 4; i++)                                                                 \
-            l[i].T *= m;                                                                        \
-        return;                                                                                 \
-    }                                                                                           \
-    else if (dot > 1)                                                                           \
-        dot = 1.;                                                                               \
-    else if (dot < -1)                                                                          \
-        dot = -1.;                                                                              \
-    TYPE theta0 = acos##T(dot);                                                                 \
-    /*TYPE theta = (0. < theta0 && theta0 < (M_PI * 0.5)) ? theta0 * w : (theta0 - M_PI) * w;*/ \
-    TYPE theta = theta0 * w;                                                                    \
-    TYPE o[4];                                                                                  \
-    for (i = 0; i < 4; i++)                                                                     \
-        o[i] = r[i].T - l[i].T * dot;                                                           \
-    /* normalize */                                                                             \
-    TYPE invmag = 1. / sqrt##T(o[0] * o[0] + o[1] * o[1] + o[2] * o[2] + o[3] * o[3]);          \
-    for (i = 0; i < 4; i++)                                                                     \
-        o[i] *= invmag;                                                                         \
-    TYPE costheta = cos##T(theta);                                                              \
-    TYPE sintheta = sin##T(theta);                                                              \
-    for (i = 0; i < 4; i++)                                                                     \
-       l[i].T = l[i].T * costheta + o[i] * sintheta;                                            \
+#define SLERP_QFUNC(NAME, TYPE, T)                                                               \
+static void NAME(evalue l, uint16_t *dim, int inc)                                               \
+{                                                                                                \
+    evalue r = l + inc;                                                                          \
+    TYPE w = (r + inc)[0].T;                                                                     \
+    int i;                                                                                       \
+    TYPE dot = l[0].T * r[0].T + l[1].T * r[1].T + l[2].T * r[2].T + l[3].T * r[3].T;            \
+    if (dot < 0.) {                                                                              \
+        for (i = 0; i < 4; i++)                                                                  \
+            r[i].T *= -1.;                                                                       \
+        dot = l[0].T * r[0].T + l[1].T * r[1].T + l[2].T * r[2].T + l[3].T * r[3].T;             \
+    }                                                                                            \
+    if (dot > 0.9995) {                                                                          \
+        l[0].T += (r[0].T - l[0].T) * w;                                                         \
+        l[1].T += (r[1].T - l[1].T) * w;                                                         \
+        l[2].T += (r[2].T - l[2].T) * w;                                                         \
+        l[3].T += (r[3].T - l[3].T) * w;                                                         \
+        /* normalize */                                                                          \
+        TYPE m = qmag##T(l);                                                                     \
+        if (0 == m)                                                                              \
+            return;                                                                              \
+        m = 1. / m;                                                                              \
+        for (i = 0; i < 4; i++)                                                                  \
+            l[i].T *= m;                                                                         \
+        return;                                                                                  \
+    }                                                                                            \
+    else if (dot > 1)                                                                            \
+        dot = 1.;                                                                                \
+    else if (dot < -1)                                                                           \
+        dot = -1.;                                                                               \
+    TYPE theta0 = acos##T(dot);                                                                  \
+    /*TYPE theta = (0. < theta0 && theta0 < (M_PI * 0.5)) ? theta0 * w : (theta0 - M_PI) * w;*/  \
+    TYPE theta = theta0 * w;                                                                     \
+    TYPE o[4];                                                                                   \
+    for (i = 0; i < 4; i++)                                                                      \
+        o[i] = r[i].T - l[i].T * dot;                                                            \
+    /* normalize */                                                                              \
+    TYPE invmag = 1. / sqrt##T(o[0] * o[0] + o[1] * o[1] + o[2] * o[2] + o[3] * o[3]);           \
+    for (i = 0; i < 4; i++)                                                                      \
+        o[i] *= invmag;                                                                          \
+    TYPE costheta = cos##T(theta);                                                               \
+    TYPE sintheta = sin##T(theta);                                                               \
+    for (i = 0; i < 4; i++)                                                                      \
+       l[i].T = l[i].T * costheta + o[i] * sintheta;                                             \
 }
 SLERP_QFUNC(qslerpf, float, f)
 SLERP_QFUNC(qslerpd, double, d)
@@ -446,17 +454,17 @@ SLERP_QFUNC(qslerpd, double, d)
 
 /* TODO: consider merits of adding an `accum` function. */
 
-#define DIFF_VFUNC(NAME, TYPE, T)                   \
-static void NAME(evalue out, uint8_t *dim, int inc) \
-{                                                   \
-    evalue mem = out + inc;                         \
-    evalue new = mem + inc;                         \
-    uint8_t i;                                      \
-    for (i = 0; i < dim[0]; i++) {                  \
-        out[i].T = new[i].T - mem[i].T;             \
-        /* store current value of `new` */          \
-        mem[i].T = new[i].T;                        \
-    }                                               \
+#define DIFF_VFUNC(NAME, TYPE, T)                    \
+static void NAME(evalue out, uint16_t *dim, int inc) \
+{                                                    \
+    evalue mem = out + inc;                          \
+    evalue new = mem + inc;                          \
+    uint16_t i;                                      \
+    for (i = 0; i < dim[0]; i++) {                   \
+        out[i].T = new[i].T - mem[i].T;              \
+        /* store current value of `new` */           \
+        mem[i].T = new[i].T;                         \
+    }                                                \
 }
 DIFF_VFUNC(vdiffi, int, i)
 DIFF_VFUNC(vdifff, float, f)
@@ -470,64 +478,64 @@ DIFF_VFUNC(vdiffd, double, d)
  *  1       1       0       no change
  */
 
-#define EDGE_VFUNC(NAME, TYPE, T)                     \
-static void NAME(evalue out, uint8_t *dim, int inc)   \
-{                                                     \
-    evalue mem = out + inc;                           \
-    evalue new = mem + inc;                           \
-    uint8_t i;                                        \
-    for (i = 0; i < dim[0]; i++) {                    \
-        out[i].T = (new[i].T != 0) - (mem[i].T != 0); \
-        /* store current value of `new` */            \
-        mem[i].T = new[i].T;                          \
-    }                                                 \
+#define EDGE_VFUNC(NAME, TYPE, T)                      \
+static void NAME(evalue out, uint16_t *dim, int inc)   \
+{                                                      \
+    evalue mem = out + inc;                            \
+    evalue new = mem + inc;                            \
+    uint16_t i;                                        \
+    for (i = 0; i < dim[0]; i++) {                     \
+        out[i].T = (new[i].T != 0) - (mem[i].T != 0);  \
+        /* store current value of `new` */             \
+        mem[i].T = new[i].T;                           \
+    }                                                  \
 }
 EDGE_VFUNC(vedgei, int, i)
 EDGE_VFUNC(vedgef, float, f)
 EDGE_VFUNC(vedged, double, d)
 
-#define EMA_VFUNC(NAME, TYPE, T)                                 \
-static void NAME(evalue ema, uint8_t *dim, int inc)              \
-{                                                                \
-    evalue new = ema + inc, weight = new + inc;                  \
-    uint8_t i;                                                   \
-    for (i = 0; i < dim[0]; i++) {                               \
-        ema[i].T += (new[i].T - ema[i].T) * abs##T(weight[i].T); \
-    }                                                            \
+#define EMA_VFUNC(NAME, TYPE, T)                                  \
+static void NAME(evalue ema, uint16_t *dim, int inc)              \
+{                                                                 \
+    evalue new = ema + inc, weight = new + inc;                   \
+    uint16_t i;                                                   \
+    for (i = 0; i < dim[0]; i++) {                                \
+        ema[i].T += (new[i].T - ema[i].T) * abs##T(weight[i].T);  \
+    }                                                             \
 }
 EMA_VFUNC(vemaf, float, f)
 EMA_VFUNC(vemad, double, d)
 
-#define EMD_VFUNC(NAME, TYPE, T)                        \
-static void NAME(evalue emd, uint8_t *dim, int inc)     \
-{                                                       \
-    evalue ema = emd + inc,                             \
-           new = ema + inc,                             \
-           weight = new + inc;                          \
-    uint8_t i;                                          \
-    for (i = 0; i < dim[0]; i++) {                      \
-        register TYPE diff = new[i].T - ema[i].T;       \
-        register TYPE w = abs##T(weight[i].T);          \
-        emd[i].T += (abs##T(diff) - emd[i].T) * w;      \
-        ema[i].T += diff * w;                           \
-    }                                                   \
+#define EMD_VFUNC(NAME, TYPE, T)                         \
+static void NAME(evalue emd, uint16_t *dim, int inc)     \
+{                                                        \
+    evalue ema = emd + inc,                              \
+           new = ema + inc,                              \
+           weight = new + inc;                           \
+    uint16_t i;                                          \
+    for (i = 0; i < dim[0]; i++) {                       \
+        register TYPE diff = new[i].T - ema[i].T;        \
+        register TYPE w = abs##T(weight[i].T);           \
+        emd[i].T += (abs##T(diff) - emd[i].T) * w;       \
+        ema[i].T += diff * w;                            \
+    }                                                    \
 }
 EMD_VFUNC(vemdf, float, f)
 EMD_VFUNC(vemdd, double, d)
 
-#define SCHMITT_VFUNC(NAME, TYPE, T)                    \
-static void NAME(evalue mem, uint8_t *dim, int inc)     \
-{                                                       \
-    evalue new = mem + inc,                             \
-           low = new + inc,                             \
-           high = low + inc;                            \
-    uint8_t i;                                          \
-    for (i = 0; i < dim[0]; i++) {                      \
-        if (mem[i].T)                                   \
-            mem[i].T = new[i].T > low[i].T;             \
-        else                                            \
-            mem[i].T = new[i].T >= high[i].T;           \
-    }                                                   \
+#define SCHMITT_VFUNC(NAME, TYPE, T)                     \
+static void NAME(evalue mem, uint16_t *dim, int inc)     \
+{                                                        \
+    evalue new = mem + inc,                              \
+           low = new + inc,                              \
+           high = low + inc;                             \
+    uint16_t i;                                          \
+    for (i = 0; i < dim[0]; i++) {                       \
+        if (mem[i].T)                                    \
+            mem[i].T = new[i].T > low[i].T;              \
+        else                                             \
+            mem[i].T = new[i].T >= high[i].T;            \
+    }                                                    \
 }
 SCHMITT_VFUNC(vschmiti, int, i)
 SCHMITT_VFUNC(vschmitf, float, f)
@@ -709,9 +717,9 @@ static struct {
     uint8_t memory;
     uint8_t reduce;
     uint8_t len;
-    void (*fn_int)(evalue, uint8_t*, int);
-    void (*fn_flt)(evalue, uint8_t*, int);
-    void (*fn_dbl)(evalue, uint8_t*, int);
+    void (*fn_int)(evalue, uint16_t*, int);
+    void (*fn_flt)(evalue, uint16_t*, int);
+    void (*fn_dbl)(evalue, uint16_t*, int);
 } vfn_tbl[] = {
     { "all",     1, 0, 1, 0, valli,    vallf,    valld    },
     { "any",     1, 0, 1, 0, vanyi,    vanyf,    vanyd    },
@@ -811,7 +819,7 @@ typedef double fn_dbl_arity1(double);
 typedef double fn_dbl_arity2(double,double);
 typedef double fn_dbl_arity3(double,double,double);
 typedef double fn_dbl_arity4(double,double,double,double);
-typedef void vfn_template(evalue, uint8_t*, int);
+typedef void vfn_template(evalue, uint16_t*, int);
 
 static int strncmp_lc(const char *a, const char *b, int len)
 {
@@ -152,7 +152,7 @@ int expr_parser_build_stack(mpr_expr expr, const char *str,
     uint8_t assigning = 0, is_const = 1, out_assigned = 0, vectorizing = 0;
     uint8_t lambda_allowed = 0, reduce_types = 0;
     uint8_t decorating_var = 0;
-    uint8_t vec_len_ctx = 0;
+    uint16_t vec_len_ctx = 0;
 
     temp_var_cache temp_vars = NULL;
     /* TODO: optimise these vars */
@@ -762,7 +762,7 @@ int expr_parser_build_stack(mpr_expr expr, const char *str,
                             break;
                         }
                         case RT_VECTOR: {
-                            uint8_t vec_len = 0;
+                            uint16_t vec_len = 0;
                             etoken t;
                             /* Fail if variables in substack have vector idx other than zero */
                             /* TODO: use start variable or expr instead */
@@ -15,7 +15,7 @@ typedef struct _estack
     uint8_t num_tokens;
     uint8_t num_subexpr;
     uint8_t size;
-    uint8_t vec_len;
+    uint16_t vec_len;
     uint8_t initialized;
 } estack_t, *estack;
 
@@ -615,7 +615,7 @@ static etoken estack_check_type(estack stk, expr_var_t *vars, int enable_optimiz
     int i, sp = stk->num_tokens - 1, arity, can_precompute = 1, optimize = NONE;
     etoken_t *tokens = stk->tokens;
     mpr_type type = tokens[sp].gen.datatype;
-    uint8_t vec_len = tokens[sp].gen.vec_len;
+    uint16_t vec_len = tokens[sp].gen.vec_len;
 
     switch (tokens[sp].toktype & TOKEN_MASK) {
         case TOK_OP:
@@ -75,7 +75,7 @@ struct generic_type {
     enum etoken_type toktype;
     mpr_type datatype;
     mpr_type casttype;
-    uint8_t vec_len;
+    uint16_t vec_len;
     uint8_t flags;
 };
 
@@ -87,7 +87,7 @@ struct literal_type {
     enum etoken_type toktype;
     mpr_type datatype;
     mpr_type casttype;
-    uint8_t vec_len;
+    uint16_t vec_len;
     uint8_t flags;
     /* end of generic_type */
     union {
@@ -107,7 +107,7 @@ struct operator_type {
     enum etoken_type toktype;
     mpr_type datatype;
     mpr_type casttype;
-    uint8_t vec_len;
+    uint16_t vec_len;
     uint8_t flags;
     /* end of generic_type */
     expr_op_t idx;
@@ -125,12 +125,12 @@ struct variable_type {
     enum etoken_type toktype;
     mpr_type datatype;
     mpr_type casttype;
-    uint8_t vec_len;
+    uint16_t vec_len;
     uint8_t flags;
     /* end of generic_type */
     int8_t idx;
     uint8_t offset;         /* only used by TOK_ASSIGN* and TOK_COPY_FROM */
-    uint8_t vec_idx;        /* only used by TOK_VAR and TOK_ASSIGN */
+    uint16_t vec_idx;       /* only used by TOK_VAR and TOK_ASSIGN */
     expr_op_t op_idx;
 };
 
@@ -144,7 +144,7 @@ struct function_type {
     enum etoken_type toktype;
     mpr_type datatype;
     mpr_type casttype;
-    uint8_t vec_len;
+    uint16_t vec_len;
     uint8_t flags;
     /* end of generic_type */
     int8_t idx;
@@ -162,12 +162,12 @@ struct control_type {
     enum etoken_type toktype;
     mpr_type datatype;
     mpr_type casttype;
-    uint8_t vec_len;
+    uint16_t vec_len;
     uint8_t flags;
     /* end of generic_type */
     int8_t cache_offset;
-    uint8_t reduce_start;
-    uint8_t reduce_stop;
+    uint16_t reduce_start;
+    uint16_t reduce_stop;
     uint8_t branch_offset;
 };
 
@@ -179,7 +179,7 @@ struct conditional_type {
     enum etoken_type toktype;
     mpr_type datatype;
     mpr_type casttype;
-    uint8_t vec_len;
+    uint16_t vec_len;
     uint8_t flags;
     /* end of generic_type */
     int8_t jump_offset;
@@ -46,12 +46,12 @@ typedef enum {
 typedef struct _expr_var {
     char *name;
     mpr_type datatype;
-    uint8_t vec_len;
+    uint16_t vec_len;
     uint8_t flags;
 } expr_var_t, *expr_var;
 
 void expr_var_set(expr_var var, const char *name, uint8_t name_len,
-                  mpr_type type, uint8_t len, uint8_t flags)
+                  mpr_type type, uint16_t len, uint8_t flags)
 {
     if (name_len) {
         var->name = malloc(name_len + 1);
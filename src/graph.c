@@ -23,6 +23,7 @@
 #endif
 
 #define AUTOSUB_INTERVAL 60
+#define EXPIRY_SLOTS 64     /* one-second slots in the timer wheel of remote devices */
 extern const char* net_msg_strings[NUM_MSG_STRINGS];
 
 /*! Debug tracer */
@@ -55,6 +56,13 @@ typedef struct _mpr_subscription {
     uint32_t lease_expiration_sec;
 } *mpr_subscription;
 
+/*! Remote devices that may expire during one second of the timer wheel. */
+typedef struct _mpr_expiry_slot {
+    mpr_dev *devs;
+    int num;
+    int size;
+} mpr_expiry_slot_t;
+
 typedef struct _mpr_graph {
     mpr_obj_t obj;                  /* always first */
     mpr_net net;
@@ -67,6 +75,17 @@ typedef struct _mpr_graph {
     /*! Linked-list of autorenewing device subscriptions. */
     mpr_subscription subscriptions;
 
+    /*! Timer wheel holding each remote device in the slot of the second it may expire. Devices
+     *  that have synced since they were scheduled are moved when their slot comes due, so the
+     *  device list does not need to be scanned on every poll. */
+    struct {
+        mpr_expiry_slot_t slots[EXPIRY_SLOTS];
+        uint32_t sec;               /*!< The last second checked. */
+    } expiry;
+
+    mpr_dev *local_devs;            /*!< Local devices, checked on every housekeeping pass. */
+    int num_local_devs;
+
     mpr_expr_eval_buffer expr_eval_buff;
 
     /*! Flags indicating whether information on signals and mappings should
@@ -305,6 +324,7 @@ void mpr_graph_free_cbs(mpr_graph g)
 void mpr_graph_free(mpr_graph g)
 {
     mpr_list list;
+    int i;
     RETURN_UNLESS(g);
 
     /* remove callbacks now so they won't be called when removing devices */
@@ -350,6 +370,9 @@ void mpr_graph_free(mpr_graph g)
         }
         mpr_graph_remove_dev(g, (mpr_dev)dev, MPR_STATUS_REMOVED);
     }
+    for (i = 0; i < EXPIRY_SLOTS; i++)
+        FUNC_IF(free, g->expiry.slots[i].devs);
+    FUNC_IF(free, g->local_devs);
 
     FUNC_IF(mpr_expr_free_eval_buffer, g->expr_eval_buff);
     mpr_net_free(g->net);
@@ -482,6 +505,72 @@ static void remove_by_qry(mpr_graph g, mpr_list l, mpr_graph_evt e)
 
 /**** Device records ****/
 
+static void expiry_add(mpr_graph g, mpr_dev d, uint32_t sec)
+{
+    mpr_expiry_slot_t *slot = &g->expiry.slots[sec % EXPIRY_SLOTS];
+    if (slot->num >= slot->size) {
+        slot->size = slot->size ? slot->size * 2 : 8;
+        slot->devs = realloc(slot->devs, slot->size * sizeof(mpr_dev));
+    }
+    slot->devs[slot->num++] = d;
+}
+
+static void expiry_remove(mpr_graph g, mpr_dev d)
+{
+    int i, j;
+    for (i = 0; i < EXPIRY_SLOTS; i++) {
+        mpr_expiry_slot_t *slot = &g->expiry.slots[i];
+        for (j = 0; j < slot->num; j++) {
+            if (slot->devs[j] == d) {
+                slot->devs[j] = slot->devs[--slot->num];
+                return;
+            }
+        }
+    }
+}
+
+/* Check the remote devices scheduled in the slots that have come due since the last check. */
+static void expire_devs(mpr_graph g, uint32_t now)
+{
+    if (!g->expiry.sec)
+        g->expiry.sec = now;
+    else if (now - g->expiry.sec > EXPIRY_SLOTS)
+        g->expiry.sec = now - EXPIRY_SLOTS;
+
+    while (g->expiry.sec < now) {
+        mpr_expiry_slot_t *slot = &g->expiry.slots[++g->expiry.sec % EXPIRY_SLOTS];
+        mpr_dev *devs = slot->devs;
+        int i, num = slot->num;
+
+        /* detach the slot since devices may be scheduled in it again */
+        slot->devs = 0;
+        slot->num = slot->size = 0;
+        for (i = 0; i < num; i++) {
+            mpr_dev dev = devs[i];
+            uint32_t synced = mpr_dev_get_synced(dev).sec;
+            int timeout = mpr_net_get_sync_timeout(g->net, dev);
+            if (!synced) {
+                /* device is only known from maps or links */
+                expiry_add(g, dev, now + timeout);
+            }
+            else if (synced + timeout > now) {
+                /* device has "checked in" since it was scheduled */
+                expiry_add(g, dev, synced + timeout);
+            }
+            else if (mpr_dev_has_local_link(dev)) {
+                /* do nothing if device is linked to local device; will be handled in network.c */
+                expiry_add(g, dev, now + 1);
+            }
+            else {
+                /* remove subscription */
+                mpr_graph_subscribe(g, dev, 0, 0);
+                mpr_graph_remove_dev(g, dev, MPR_STATUS_EXPIRED);
+            }
+        }
+        FUNC_IF(free, devs);
+    }
+}
+
 static mpr_subscription get_subscription(mpr_graph g, mpr_dev d)
 {
     mpr_subscription s = g->subscriptions;
@@ -517,6 +606,11 @@ mpr_dev mpr_graph_add_dev(mpr_graph g, const char *name, mpr_msg props, const ch
         dev = (mpr_dev)mpr_list_add_item((void**)&g->devs, mpr_dev_get_struct_size(0), 0);
         mpr_obj_init((mpr_obj)dev, g, MPR_DEV);
         mpr_dev_init(dev, 0, no_slash, id);
+        {
+            mpr_time now;
+            mpr_time_set(&now, MPR_NOW);
+            expiry_add(g, dev, now.sec + mpr_net_get_sync_timeout(g->net, dev));
+        }
 #ifdef DEBUG
         trace_graph(g, "added device ");
         mpr_prop_print(1, MPR_DEV, dev);
@@ -577,6 +671,19 @@ void mpr_graph_remove_dev(mpr_graph g, mpr_dev d, mpr_graph_evt e)
     remove_by_qry(g, mpr_dev_get_links(d, MPR_DIR_UNDEFINED), e);
     remove_by_qry(g, mpr_dev_get_sigs(d, MPR_DIR_ANY), e);
 
+    if (((mpr_obj)d)->is_local) {
+        int i;
+        for (i = 0; i < g->num_local_devs; i++) {
+            if (g->local_devs[i] == d) {
+                memmove(&g->local_devs[i], &g->local_devs[i + 1],
+                        (--g->num_local_devs - i) * sizeof(mpr_dev));
+                break;
+            }
+        }
+    }
+    else
+        expiry_remove(g, d);
+
     mpr_list_remove_item((void**)&g->devs, d);
     mpr_graph_call_cbs(g, (mpr_obj)d, MPR_DEV, e);
 
@@ -902,41 +1009,29 @@ void mpr_graph_print(mpr_graph g, int properties)
 /* TODO: consider throttling */
 void mpr_graph_housekeeping(mpr_graph g)
 {
-    mpr_list list = mpr_list_from_data(g->devs);
+    mpr_list list;
     mpr_subscription s;
     mpr_time t;
+    int i;
     mpr_time_set(&t, MPR_NOW);
 
-    /* check if any known devices have expired */
-    t.sec -= TIMEOUT_SEC;
-    while (list) {
-        mpr_obj dev = *list;
-        list = mpr_list_get_next(list);
-        /* check if device has "checked in" recently – could be /sync ping or any sent metadata */
-        if (!dev->is_local) {
-            if (!mpr_dev_check_synced((mpr_dev)dev, t)) {
-                /* do nothing if device is linked to local device; will be handled in network.c */
-                if (!mpr_dev_has_local_link((mpr_dev)dev)) {
-                    /* remove subscription */
-                    mpr_graph_subscribe(g, (mpr_dev)dev, 0, 0);
-                    mpr_graph_remove_dev(g, (mpr_dev)dev, MPR_STATUS_EXPIRED);
-                }
-                continue;
-            }
+    /* check if any known devices have expired – "checking in" could be /sync ping or any sent
+     * metadata */
+    expire_devs(g, t.sec);
+
+    for (i = g->num_local_devs - 1; i >= 0; i--) {
+        mpr_obj dev = (mpr_obj)g->local_devs[i];
+        if (dev->status & MPR_STATUS_REMOVED) {
+            trace_graph(g, "Cleaning up removed device.\n");
+            mpr_graph_remove_dev(g, (mpr_dev)dev, MPR_STATUS_REMOVED);
         }
-        else {
-            if (dev->status & MPR_STATUS_REMOVED) {
-                trace_graph(g, "Cleaning up removed device.\n");
-                mpr_graph_remove_dev(g, (mpr_dev)dev, MPR_STATUS_REMOVED);
-            }
-            else if (!(dev->status & (MPR_STATUS_STAGED | MPR_STATUS_ACTIVE))) {
-                mpr_net_add_dev(g->net, (mpr_local_dev)dev);
-                dev->status |= MPR_STATUS_STAGED;
-                mpr_graph_call_cbs(g, dev, MPR_DEV, MPR_STATUS_NEW);
-            }
-            else if (dev->status & MPR_STATUS_MODIFIED)
-                mpr_graph_call_cbs(g, dev, MPR_DEV, MPR_STATUS_MODIFIED);
+        else if (!(dev->status & (MPR_STATUS_STAGED | MPR_STATUS_ACTIVE))) {
+            mpr_net_add_dev(g->net, (mpr_local_dev)dev);
+            dev->status |= MPR_STATUS_STAGED;
+            mpr_graph_call_cbs(g, dev, MPR_DEV, MPR_STATUS_NEW);
         }
+        else if (dev->status & MPR_STATUS_MODIFIED)
+            mpr_graph_call_cbs(g, dev, MPR_DEV, MPR_STATUS_MODIFIED);
     }
 
     /* check if any signals need to be removed */
@@ -1159,6 +1254,10 @@ mpr_obj mpr_graph_add_obj(mpr_graph g, int obj_type, int is_local)
 
     if (MPR_MAP == obj_type)
         ++g->staged_maps;
+    else if (MPR_DEV == obj_type && is_local) {
+        g->local_devs = realloc(g->local_devs, (g->num_local_devs + 1) * sizeof(mpr_dev));
+        g->local_devs[g->num_local_devs++] = (mpr_dev)obj;
+    }
 
     return obj;
 }
@@ -1168,13 +1267,14 @@ int mpr_graph_generate_unique_id(mpr_graph g)
     return ++g->resource_counter;
 }
 
-void mpr_graph_sync_dev(mpr_graph g, const char *name)
+void mpr_graph_sync_dev(mpr_graph g, const char *name, int interval)
 {
     mpr_dev dev = mpr_graph_get_dev_by_name(g, name);
     if (dev) {
         RETURN_UNLESS(!mpr_obj_get_is_local((mpr_obj)dev));
         trace_graph(g, "updating sync record for device '%s'\n", name);
         mpr_dev_set_synced(dev, MPR_NOW);
+        mpr_dev_set_sync_interval(dev, interval);
         if (!mpr_dev_get_is_subscribed(dev) && g->autosub) {
             trace_graph(g, "autosubscribing to device '%s'.\n", name);
             mpr_graph_subscribe(g, dev, g->autosub, -1);
@@ -97,7 +97,7 @@ mpr_obj mpr_graph_add_obj(mpr_graph g, int obj_type, int is_local);
 
 int mpr_graph_generate_unique_id(mpr_graph g);
 
-void mpr_graph_sync_dev(mpr_graph g, const char *name);
+void mpr_graph_sync_dev(mpr_graph g, const char *name, int interval);
 
 int mpr_graph_get_autosub(mpr_graph g);
 
@@ -15,4 +15,15 @@ typedef uint64_t mpr_id;
 MPR_INLINE static mpr_id mpr_id_from_str(const char *str)
     { return (mpr_id) crc32(0L, (const Bytef *)str, strlen(str)) << 32; }
 
+/*! Hash an id for indexing into hash tables, using the 64-bit finaliser from MurmurHash3. */
+MPR_INLINE static uint32_t mpr_id_hash(mpr_id id)
+{
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdULL;
+    id ^= id >> 33;
+    id *= 0xc4ceb9fe1a85ec53ULL;
+    id ^= id >> 33;
+    return (uint32_t)id;
+}
+
 #endif /* __MPR_ID_H__ */
@@ -12,10 +12,11 @@
 #define RELEASED_LOCALLY  0x02
 #define RELEASED_REMOTELY 0x04
 
-/*! The instance ID map is a linked list of int32 instance ids for coordinating
- *  remote and local instances. */
+/*! The instance ID map associates local and global instance ids for coordinating remote and
+ *  local instances. Active id maps are indexed by their device using hash tables; the next
+ *  pointer is only used for the list of reserve id maps. */
 typedef struct _mpr_id_map {
-    struct _mpr_id_map *next;       /*!< The next id map in the list. */
+    struct _mpr_id_map *next;       /*!< The next id map in the reserve list. */
 
     uint64_t GID;                   /*!< Hash for originating device. */
     uint64_t LID;                   /*!< Local instance id to map. */
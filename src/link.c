@@ -1,3 +1,5 @@
+#include "config.h"
+
 #include <string.h>
 #include <math.h>
 #include <stdlib.h>
@@ -6,271 +8,2792 @@
 #include <limits.h>
 #include <assert.h>
 
+#include "bitflags.h"
 #include "link.h"
+#include "mpr_atomic.h"
 #include "mpr_time.h"
 #include "network.h"
 #include "object.h"
+#include "path.h"
 #include "table.h"
 #include "mpr_debug.h"
 
 #include <mapper/mapper.h>
 
-#define NUM_BUNDLES 2
+#ifdef HAVE_SHM_OPEN
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+#endif
+
+#if defined(HAVE_SYS_SOCKET_H) && defined(HAVE_FCNTL_H) && defined(HAVE_ERRNO_H) && !defined(WIN32)
+ #include <sys/socket.h>
+ #include <netinet/in.h>
+ #include <netinet/tcp.h>
+ #include <arpa/inet.h>
+ #include <fcntl.h>
+ #include <errno.h>
+ #include <unistd.h>
+ #define HAVE_TCP_QUEUE
+#endif
+
+#define OSC_BUNDLE_LIMIT 0x10000    /* larger UDP bundles are built using liblo instead */
+#define OUT_QUEUE_SIZE 0x20000      /* 128 KiB of pending messages per link, must be a power of two */
+#define OUT_MSG_MAX    0x8000       /* larger messages are copied to the heap instead */
+
+typedef struct _mpr_bundle {
+    lo_bundle udp;
+    lo_bundle tcp;
+    lo_bundle rudp;
+    struct {
+        char *buf;                  /*!< UDP bundle encoded in place, kept between cycles. */
+        size_t len;
+        size_t size;
+        int num_msgs;
+    } osc;
+} mpr_bundle_t, *mpr_bundle;
+
+/*! Header of a message waiting in the outbound queue of a link. It follows the 32-bit record
+ *  size and is followed by the message encoded as an OSC bundle element: the message length,
+ *  then the path, type tags and arguments. Messages are always copied into the queue since
+ *  slots reuse their buffers for the next update. */
+typedef struct _mpr_out_msg {
+    mpr_sig sig;                    /*!< Destination signal for links between local devices. */
+    char *ext;                      /*!< Heap copy of a message too large for the queue. */
+    mpr_time time;
+    uint32_t len;                   /*!< Length of the encoded bundle element. */
+    uint32_t proto;
+    int32_t priority;               /*!< Priority class of the map relative to normal. */
+} mpr_out_msg_t;
+
+#define OUT_HDR_SIZE (sizeof(uint32_t) + sizeof(mpr_out_msg_t))
+
+/*! Queue of pending messages. Signal updates made by other threads are queued by their device
+ *  and applied by the polling thread, so messages are only added by the polling thread, but a
+ *  record may be reserved while another is still being written if a signal is updated from an
+ *  interrupt on that thread, so head is advanced with compare-and-swap. Records are published by
+ *  storing their nonzero size in the first word. The polling thread consumes published records in
+ *  order and clears them before releasing the space, so that unpublished records always read as
+ *  zero. */
+typedef struct _mpr_out_queue {
+    char *data;
+    uint32_t head;                  /*!< Reserve index. */
+    char pad[60];
+    uint32_t tail;                  /*!< Read index. */
+    uint32_t dropped;               /*!< Messages dropped because the queue was full. */
+    char *buf;                      /*!< Scratch buffer for the consumer. */
+    size_t buf_size;
+    lo_arg **argv;                  /*!< Arguments decoded in buf for local dispatch. */
+    int argv_size;
+} mpr_out_queue_t;
+
+/*! Clock and timing information. */
+typedef struct _mpr_sync_time_t {
+    mpr_time time;
+    int msg_id;
+} mpr_sync_time_t;
+
+typedef struct _mpr_sync_clock_t {
+    double rate;
+    double latency;
+    double jitter;
+    mpr_sync_time_t sent;
+    mpr_sync_time_t rcvd;
+    double weight;
+    int8_t slope;
+} mpr_sync_clock_t, *mpr_sync_clock;
+
+#ifdef HAVE_SHM_OPEN
+#define SHM_RING_MAGIC  0x6d707273  /* 'mprs' */
+#define SHM_RING_SIZE   0x40000     /* 256 KiB per link direction, must be a power of two */
+#define SHM_NAME_LEN    48
+#define SHM_HOLD_LIMIT  SHM_RING_SIZE   /* bytes held back while the ring is full */
+
+/*! Header of a single-producer/single-consumer ring buffer stored in shared memory. The data
+ *  region follows the header. Records consist of a 32-bit length followed by the serialised
+ *  bundle, padded to a multiple of 4 bytes. */
+typedef struct _mpr_shm_ring_hdr {
+    uint32_t magic;
+    uint32_t size;                      /*!< Size of the data region in bytes. */
+    uint32_t closed;                    /*!< Set by the consumer when it stops reading. */
+    uint32_t waiting;                   /*!< Set by the consumer before blocking on sockets. */
+    char pad1[48];
+    uint32_t head;                      /*!< Write index, only modified by the producer. */
+    char pad2[60];
+    uint32_t tail;                      /*!< Read index, only modified by the consumer. */
+    char pad3[60];
+} mpr_shm_ring_hdr_t, *mpr_shm_ring_hdr;
+
+typedef struct _mpr_shm_ring {
+    mpr_shm_ring_hdr hdr;
+    char *data;
+    char name[SHM_NAME_LEN];
+} mpr_shm_ring_t, *mpr_shm_ring;
+#endif /* HAVE_SHM_OPEN */
+
+#define RUDP_WINDOW     32      /* number of sent bundles kept for retransmission */
+#define RUDP_MAX_TRIES  3       /* number of times a missing bundle is requested */
+#define RUDP_RTO_RTTS   4       /* retransmit timeout in round trips */
+#define RUDP_MIN_RTO    0.02    /* bounds of the retransmit timeout in seconds */
+#define RUDP_MAX_RTO    1.0
+
+/*! A message in a sent reliable UDP bundle. */
+typedef struct _mpr_rudp_msg {
+    uint32_t offset;                /*!< Offset of the serialised message in the packet buffer. */
+    uint32_t len;                   /*!< Length of the serialised message. */
+    uint32_t key;                   /*!< Destination path, slot and instance ids. */
+    int can_merge;                  /*!< Zero if the message must be retransmitted regardless. */
+} mpr_rudp_msg_t;
+
+/*! A sent reliable UDP bundle kept for retransmission. */
+typedef struct _mpr_rudp_pkt {
+    uint32_t seq;
+    char *buf;
+    size_t len;                     /*!< Length of the encoded bundle, including its header. */
+    size_t size;
+    mpr_rudp_msg_t *msgs;
+    int num_msgs;                   /*!< Number of messages, or -1 if the slot is unused. */
+    int cls;                        /*!< Priority class the bundle was sent with. */
+    int size_msgs;
+} mpr_rudp_pkt_t, *mpr_rudp_pkt;
+
+/*! The sequence number of the last sent bundle carrying a value for a message key. */
+typedef struct _mpr_rudp_key {
+    uint32_t key;
+    uint32_t seq;
+    int used;
+} mpr_rudp_key_t;
+
+/*! A sequence number that has not been received yet. */
+typedef struct _mpr_rudp_gap {
+    uint32_t seq;
+    int tries;
+} mpr_rudp_gap_t;
+
+/* transports used for data sent to a remote device on the same host, in order of preference */
+typedef enum {
+    LOCAL_TRANSPORT_UDP,            /*!< Loopback UDP, as for any other remote device. */
+    LOCAL_TRANSPORT_UNIX,           /*!< Datagrams on the AF_UNIX socket of the remote device. */
+    LOCAL_TRANSPORT_SHM             /*!< Shared memory ring, falling back to AF_UNIX. */
+} local_transport_t;
+
+#define PACING_CHECK_SEC 1.0    /* how often the link properties of maps are read */
+
+/* traffic classes requested by maps using the property "priority", flushed from high to low */
+typedef enum {
+    PRIORITY_LOW,                   /*!< Bulk data, marked DSCP CS1. */
+    PRIORITY_NORMAL,                /*!< Best effort, sent from the device sockets. */
+    PRIORITY_HIGH,                  /*!< Control data, marked DSCP EF. */
+    NUM_PRIORITIES
+} priority_t;
+
+/*! Priority classes of the maps using a link, and the sockets used to mark their datagrams. */
+typedef struct _mpr_priority {
+    int num_maps;
+    int any;                        /*!< Nonzero if any map is not in the normal class. */
+    mpr_time checked;               /*!< When the map properties were last read. */
+    int fd[NUM_PRIORITIES];         /*!< UDP sockets for marked datagrams, or -1. */
+    int tcp_class;                  /*!< Class the TCP queue socket is marked with. */
+    int msgs[NUM_PRIORITIES];       /*!< Messages sent since they were last reported. */
+} mpr_priority_t;
+
+/*! The latest held message carrying a value for a message key. */
+typedef struct _mpr_pacing_key {
+    uint32_t key;
+    int idx;                        /*!< Index of the message in the held messages. */
+    int used;
+} mpr_pacing_key_t;
+
+/*! Outgoing UDP messages held back to respect the pacing budget of a link. Messages are stored
+ *  serialised after a bundle header, so that the live ones can be sent as a single datagram. */
+typedef struct _mpr_pacing {
+    double interval;                /*!< Minimum time between bundles, or 0 if not paced. */
+    double latency;                 /*!< Maximum time an update may be held. */
+    mpr_time checked;               /*!< When the map properties were last read. */
+    mpr_time sent;                  /*!< When the last paced bundle was sent. */
+    mpr_time first;                 /*!< When the oldest held message was added. */
+    int cls;                        /*!< Highest priority class of the held messages. */
+    char *buf;
+    size_t len;                     /*!< Length of the bundle without the superseded messages. */
+    size_t end;                     /*!< End of the messages stored in the buffer. */
+    size_t size;
+    mpr_rudp_msg_t *msgs;           /*!< Held messages; superseded ones have zero length. */
+    int num_msgs;
+    int size_msgs;
+    mpr_pacing_key_t *keys;         /*!< Latest held message of each message key. */
+    int num_keys;
+    int size_keys;                  /*!< Size of the key table, a power of two. */
+} mpr_pacing_t;
+
+#define FEC_MAX_DEPTH   4       /* maximum number of previous bundles repeated in each bundle */
+#define FEC_WINDOW      32      /* number of recent bundles tracked by the receiver */
+#define FEC_SEQ_LEN     28      /* length of an encoded "/@fec", "/@seq" or "/@rtx" element */
+
+/*! Forward error correction for UDP bundles. Each bundle is tagged with a sequence number and
+ *  repeats the messages of the previous bundles that it does not supersede, so the receiver can
+ *  recover the messages of lost bundles without a round trip. */
+typedef struct _mpr_fec {
+    int depth;                      /*!< Number of previous bundles repeated, or 0 if disabled. */
+    mpr_time checked;               /*!< When the map properties were last read. */
+    uint32_t tx_seq;                /*!< Next sequence number to send. */
+    mpr_rudp_pkt_t sent[FEC_MAX_DEPTH + 1]; /*!< Bundle elements of the last bundles sent. */
+    char *buf;                      /*!< Scratch buffer for encoding bundles. */
+    size_t size;
+    uint32_t rx_seq;                /*!< Next sequence number expected. */
+    uint32_t rx_mask;               /*!< Bundles received before rx_seq, most recent first. */
+    int rx_started;
+} mpr_fec_t;
+
+#define CHUNK_MTU       1472    /* largest UDP payload that is not fragmented on a 1500 byte MTU */
+#define CHUNK_HDR_LEN   40      /* length of a "/@chk" message without the chunk data */
+#define CHUNK_DATA_LEN  (CHUNK_MTU - CHUNK_HDR_LEN)
+#define CHUNK_MAX_LEN   0x400000    /* largest datagram reassembled by the receiver */
+#define CHUNK_WINDOW    32      /* late chunks of this many previous datagrams are ignored */
+
+/*! Datagrams split into chunks. The receiver reassembles one datagram at a time; a chunk of a
+ *  newer datagram discards the one that is incomplete. */
+typedef struct _mpr_chunk {
+    uint32_t tx_seq;                /*!< Next sequence number to send. */
+    char *buf;                      /*!< Scratch buffer for serialising bundles. */
+    size_t size;
+    char *rx_buf;                   /*!< Datagram being reassembled. */
+    size_t rx_size;
+    mpr_bitflags rx_known;          /*!< Chunks of the datagram that have arrived. */
+    uint32_t rx_seq;                /*!< Sequence number of the datagram being reassembled. */
+    int rx_len;                     /*!< Length of the datagram being reassembled. */
+    int rx_missing;                 /*!< Number of chunks still missing, 0 once dispatched. */
+    int rx_started;
+} mpr_chunk_t;
+
+typedef struct _mpr_rudp {
+    mpr_rudp_pkt_t *win;            /*!< Sent bundles, indexed by sequence number. */
+    mpr_rudp_key_t *keys;           /*!< Latest bundle of the message keys in the window. */
+    int num_keys;
+    int size_keys;                  /*!< Size of the key table, a power of two. */
+    uint32_t tx_seq;                /*!< Next sequence number to send. */
+    uint32_t tx_last;               /*!< Next sequence number when "/@last" was last sent. */
+    uint32_t rx_seq;                /*!< Next sequence number expected. */
+    int rx_started;
+    mpr_rudp_gap_t gaps[RUDP_WINDOW];
+    int num_gaps;
+    mpr_time tx_probe;              /*!< Time to announce the last bundle if nothing else is sent. */
+    mpr_time rx_nack;               /*!< Time to request the missing bundles again. */
+} mpr_rudp_t;
+
+#ifdef HAVE_TCP_QUEUE
+#define TCP_QUEUE_LIMIT 0x10000     /* default byte limit of the outbound TCP queue */
+
+#ifdef MSG_NOSIGNAL
+ #define TCP_SEND_FLAGS MSG_NOSIGNAL
+#else
+ #define TCP_SEND_FLAGS 0
+#endif
+
+typedef enum {
+    TCP_QUEUE_MERGE,                /*!< Drop queued bundles superseded by newer values first. */
+    TCP_QUEUE_DROP_OLDEST,          /*!< Drop the oldest queued bundles. */
+    TCP_QUEUE_DROP_NEWEST           /*!< Drop the bundle that does not fit. */
+} tcp_queue_policy;
+
+/*! A serialised bundle waiting in the outbound TCP queue. */
+typedef struct _mpr_tcp_rec {
+    uint32_t len;                   /*!< Length including the stream framing. */
+    uint32_t *keys;                 /*!< Destination path and slot of each message. */
+    int num_keys;                   /*!< Number of keys, or -1 if the bundle cannot be merged. */
+} mpr_tcp_rec_t, *mpr_tcp_rec;
+
+/*! Nonblocking outbound TCP stream. Bundles are framed with their length as liblo expects and
+ *  written back to back, so everything queued is sent with a single call once the socket
+ *  becomes writable. */
+typedef struct _mpr_tcp_queue {
+    int fd;
+    char *buf;
+    size_t len;
+    size_t size;
+    size_t sent;                    /*!< Bytes of the first record already written. */
+    size_t reported;                /*!< Queue length last added to the device statistics. */
+    mpr_tcp_rec_t *recs;
+    int num_recs;
+    int size_recs;
+} mpr_tcp_queue_t;
+#endif /* HAVE_TCP_QUEUE */
+
+typedef struct _mpr_link {
+    mpr_obj_t obj;                      /* always first for type punning */
+    mpr_dev devs[2];
+    mpr_map *maps;
+    int num_maps;
+
+    struct {
+        lo_address admin;               /*!< Network address of remote endpoint */
+        struct {
+            lo_address udp;             /*!< Network address of remote endpoint */
+            lo_address tcp;             /*!< Network address of remote endpoint */
+        } data;
+        mpr_net_dst_t udp;              /*!< Resolved data address for batched sending */
+    } addr;
+
+    int is_local_only;
+    int is_same_host;                   /*!< Remote device is in another process on this host. */
+    local_transport_t transport;        /*!< Preferred transport if is_same_host is set. */
+
+    mpr_out_queue_t out;                /*!< Messages waiting to be sent. */
+    mpr_bundle_t bundles[NUM_PRIORITIES];   /*!< Bundles assembled from the queue for each class. */
+    mpr_priority_t prio;
+
+#ifdef HAVE_SHM_OPEN
+    struct {
+        mpr_shm_ring in;                /*!< Ring written by the remote device. */
+        mpr_shm_ring out;               /*!< Ring read by the remote device. */
+        char *buf;                      /*!< Scratch buffer for (de)serialising bundles. */
+        size_t buf_size;
+        char *held;                     /*!< Records waiting for space in the outgoing ring. */
+        uint32_t held_len;
+        uint32_t held_size;
+        uint32_t batch;                 /*!< Ring index of the first record written since the
+                                         *   consumer was last checked. */
+        int written;                    /*!< Set if records have been written since then. */
+    } shm;
+#endif
+
+#ifdef HAVE_TCP_QUEUE
+    mpr_tcp_queue_t tcp;
+#endif
+
+#ifdef HAVE_UNIX_SOCKETS
+    struct {
+        int fd;                         /*!< Datagram socket connected to the remote device. */
+        char *buf;                      /*!< Scratch buffer for serialising bundles. */
+        size_t buf_size;
+    } un;
+#endif
+
+    mpr_rudp_t rudp;
+    mpr_pacing_t pacing;
+    mpr_fec_t fec;
+    mpr_chunk_t chunk;
+
+    mpr_sync_clock_t clock;
+    uint8_t net_lists;                  /*!< Lists of the network poll loop holding the link. */
+} mpr_link_t;
+
+size_t mpr_link_get_struct_size(void)
+{
+    return sizeof(mpr_link_t);
+}
+
+mpr_link mpr_link_new(mpr_local_dev local_dev, mpr_dev remote_dev)
+{
+    int is_local = (   mpr_obj_get_is_local((mpr_obj)local_dev)
+                    || mpr_obj_get_is_local((mpr_obj)remote_dev));
+    return mpr_graph_add_link(mpr_obj_get_graph((mpr_obj)local_dev), (mpr_dev)local_dev,
+                              remote_dev, is_local);
+}
+
+/* Add a link to or remove it from one of the lists visited by the network poll loop. */
+static void set_in_net_list(mpr_link link, net_link_list_t list, int in_list)
+{
+    int flag = 1 << list;
+    RETURN_UNLESS(!(link->net_lists & flag) != !in_list);
+    if (in_list)
+        mpr_net_add_link(mpr_graph_get_net(link->obj.graph), link, list);
+    else
+        mpr_net_remove_link(mpr_graph_get_net(link->obj.graph), link, list);
+    link->net_lists ^= flag;
+}
+
+static void add_dev_stat(mpr_link link, const char *key, int val, int is_peak)
+{
+    mpr_obj dev = (mpr_obj)link->devs[LINK_LOCAL_DEV];
+    int old = mpr_obj_get_prop_as_int32(dev, MPR_PROP_EXTRA, key);
+    if (!is_peak)
+        val += old;
+    else if (val <= old)
+        return;
+    mpr_tbl_add_record(mpr_obj_get_prop_tbl(dev), MPR_PROP_EXTRA, key, 1, MPR_INT32, &val,
+                       MPR_TBL_MOD_NONE | MPR_TBL_ACC_LOC);
+}
+
+int mpr_link_get_is_ready(mpr_link link)
+{
+    return link && link->addr.data.udp;
+}
+
+int mpr_link_get_is_local_only(mpr_link link)
+{
+    return link->is_local_only;
+}
+
+lo_address mpr_link_get_admin_addr(mpr_link link)
+{
+    return link->addr.admin;
+}
+
+#ifdef HAVE_SHM_OPEN
+static void shm_ring_get_name(char *name, mpr_dev src, mpr_dev dst)
+{
+    snprintf(name, SHM_NAME_LEN, "/mpr.%"PR_MPR_ID".%"PR_MPR_ID,
+             mpr_obj_get_id((mpr_obj)src), mpr_obj_get_id((mpr_obj)dst));
+}
+
+/* The consumer creates the ring; the producer opens it once it exists. */
+static mpr_shm_ring shm_ring_open(const char *name, int create)
+{
+    mpr_shm_ring ring;
+    mpr_shm_ring_hdr hdr;
+    size_t len = sizeof(mpr_shm_ring_hdr_t) + SHM_RING_SIZE;
+    int fd;
+
+    if (create) {
+        /* remove any stale ring left behind by a previous process */
+        shm_unlink(name);
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+        RETURN_ARG_UNLESS(fd >= 0, 0);
+        if (ftruncate(fd, len) < 0) {
+            close(fd);
+            shm_unlink(name);
+            return 0;
+        }
+    }
+    else {
+        struct stat st;
+        fd = shm_open(name, O_RDWR, 0);
+        RETURN_ARG_UNLESS(fd >= 0, 0);
+        if (fstat(fd, &st) < 0 || (size_t)st.st_size < len) {
+            close(fd);
+            return 0;
+        }
+    }
+    hdr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == hdr) {
+        if (create)
+            shm_unlink(name);
+        return 0;
+    }
+    if (create) {
+        hdr->size = SHM_RING_SIZE;
+        hdr->closed = hdr->waiting = 0;
+        hdr->head = hdr->tail = 0;
+        __atomic_store_n(&hdr->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+    }
+    else if (   __atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC
+             || hdr->size != SHM_RING_SIZE || __atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE)) {
+        munmap(hdr, len);
+        return 0;
+    }
+    ring = (mpr_shm_ring)calloc(1, sizeof(mpr_shm_ring_t));
+    ring->hdr = hdr;
+    ring->data = (char*)hdr + sizeof(mpr_shm_ring_hdr_t);
+    strncpy(ring->name, name, SHM_NAME_LEN - 1);
+    return ring;
+}
+
+static void shm_ring_close(mpr_shm_ring ring, int is_consumer)
+{
+    if (is_consumer) {
+        __atomic_store_n(&ring->hdr->closed, 1, __ATOMIC_RELEASE);
+        shm_unlink(ring->name);
+    }
+    munmap(ring->hdr, sizeof(mpr_shm_ring_hdr_t) + SHM_RING_SIZE);
+    free(ring);
+}
+
+/* Copy into or out of the data region, wrapping at the end. */
+static void shm_ring_copy(mpr_shm_ring ring, uint32_t idx, void *buf, uint32_t len, int write)
+{
+    uint32_t offset = idx & (SHM_RING_SIZE - 1), first = SHM_RING_SIZE - offset;
+    if (first > len)
+        first = len;
+    if (write) {
+        memcpy(ring->data + offset, buf, first);
+        memcpy(ring->data, (char*)buf + first, len - first);
+    }
+    else {
+        memcpy(buf, ring->data + offset, first);
+        memcpy((char*)buf + first, ring->data, len - first);
+    }
+}
+
+static int shm_ring_write(mpr_shm_ring ring, void *data, uint32_t len)
+{
+    mpr_shm_ring_hdr hdr = ring->hdr;
+    uint32_t head = hdr->head, tail = __atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE);
+    uint32_t size = sizeof(uint32_t) + ((len + 3) & ~3);
+
+    RETURN_ARG_UNLESS(SHM_RING_SIZE - (head - tail) >= size, 0);
+    *(uint32_t*)(ring->data + (head & (SHM_RING_SIZE - 1))) = len;
+    shm_ring_copy(ring, head + sizeof(uint32_t), data, len, 1);
+    __atomic_store_n(&hdr->head, head + size, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/* Write a record to the outgoing ring, noting where the records written since the consumer was
+ * last checked begin. */
+static int shm_write(mpr_link link, const void *data, uint32_t len)
+{
+    uint32_t head = link->shm.out->hdr->head;
+    RETURN_ARG_UNLESS(shm_ring_write(link->shm.out, (void*)data, len), 0);
+    if (!link->shm.written) {
+        link->shm.batch = head;
+        link->shm.written = 1;
+    }
+    return 1;
+}
+
+/* Move held records into the ring in order. Returns non-zero if some are still held. */
+static int shm_write_held(mpr_link link)
+{
+    uint32_t pos = 0, len;
+    while (pos < link->shm.held_len) {
+        memcpy(&len, link->shm.held + pos, sizeof(uint32_t));
+        if (!shm_write(link, link->shm.held + pos + sizeof(uint32_t), len))
+            break;
+        pos += sizeof(uint32_t) + ((len + 3) & ~3);
+    }
+    if (pos) {
+        link->shm.held_len -= pos;
+        memmove(link->shm.held, link->shm.held + pos, link->shm.held_len);
+    }
+    return link->shm.held_len != 0;
+}
+
+/* Hold a record until the consumer has made space in the ring. Sending it through a socket
+ * instead would let it overtake the records still in the ring, so the oldest held records are
+ * dropped once the limit is reached, as a full socket buffer would. */
+static void shm_hold(mpr_link link, const void *data, uint32_t len)
+{
+    uint32_t size = sizeof(uint32_t) + ((len + 3) & ~3), pos = 0, rec_len;
+    int dropped = 0;
+    while (pos < link->shm.held_len && link->shm.held_len - pos + size > SHM_HOLD_LIMIT) {
+        memcpy(&rec_len, link->shm.held + pos, sizeof(uint32_t));
+        pos += sizeof(uint32_t) + ((rec_len + 3) & ~3);
+        ++dropped;
+    }
+    if (pos) {
+        link->shm.held_len -= pos;
+        memmove(link->shm.held, link->shm.held + pos, link->shm.held_len);
+    }
+    if (link->shm.held_len + size > link->shm.held_size) {
+        link->shm.held_size = link->shm.held_len + size;
+        link->shm.held = realloc(link->shm.held, link->shm.held_size);
+    }
+    memcpy(link->shm.held + link->shm.held_len, &len, sizeof(uint32_t));
+    memcpy(link->shm.held + link->shm.held_len + sizeof(uint32_t), data, len);
+    link->shm.held_len += size;
+    if (dropped)
+        add_dev_stat(link, "shm_dropped", dropped, 0);
+}
+
+/* Send a bundle through the outgoing ring; returns 0 if the socket should be used instead. The
+ * ring carries serialised OSC bundles rather than raw values since the consumer dispatches them
+ * with the handlers used for its sockets. */
+static int shm_send_bundle(mpr_link link, lo_bundle lb)
+{
+    size_t len;
+    RETURN_ARG_UNLESS(link->shm.out, 0);
+    if (__atomic_load_n(&link->shm.out->hdr->closed, __ATOMIC_ACQUIRE)) {
+        trace_dev(link->devs[LINK_LOCAL_DEV], "shared memory ring to device '%s' closed\n",
+                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+        shm_ring_close(link->shm.out, 0);
+        link->shm.out = 0;
+        link->shm.held_len = 0;
+        link->shm.written = 0;
+        return 0;
+    }
+    len = lo_bundle_length(lb);
+    /* a bundle larger than the ring can never be written to it */
+    RETURN_ARG_UNLESS(len <= SHM_RING_SIZE - sizeof(uint32_t), 0);
+    if (len > link->shm.buf_size) {
+        link->shm.buf = realloc(link->shm.buf, len);
+        link->shm.buf_size = len;
+    }
+    RETURN_ARG_UNLESS(lo_bundle_serialise(lb, link->shm.buf, &len), 0);
+    /* held records are written first to keep the bundles in order */
+    if ((link->shm.held_len && shm_write_held(link)) || !shm_write(link, link->shm.buf, len)) {
+        shm_hold(link, link->shm.buf, len);
+        set_in_net_list(link, NET_LINKS_SHM_HELD, 1);
+    }
+    return 1;
+}
+
+/* Wake the remote consumer if it may be blocked waiting on its sockets. The consumer only blocks
+ * after finding the ring empty, so it needs waking only if it had read everything before the
+ * records written since the last check; it is woken at most once each time it starts waiting. */
+static void shm_wake_consumer(mpr_link link, lo_server server)
+{
+    mpr_shm_ring_hdr hdr;
+    lo_bundle lb;
+    RETURN_UNLESS(link->shm.out && link->shm.written);
+    link->shm.written = 0;
+    hdr = link->shm.out->hdr;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    RETURN_UNLESS(__atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE) == link->shm.batch);
+    RETURN_UNLESS(__atomic_exchange_n(&hdr->waiting, 0, __ATOMIC_RELAXED));
+    if ((lb = lo_bundle_new(LO_TT_IMMEDIATE))) {
+        lo_send_bundle_from(link->addr.data.udp, server, lb);
+        lo_bundle_free(lb);
+    }
+}
+
+static void shm_maybe_open_out(mpr_link link)
+{
+    char name[SHM_NAME_LEN];
+    RETURN_UNLESS(link->is_same_host && LOCAL_TRANSPORT_SHM == link->transport && !link->shm.out);
+    shm_ring_get_name(name, link->devs[LINK_LOCAL_DEV], link->devs[LINK_REMOTE_DEV]);
+    if ((link->shm.out = shm_ring_open(name, 0))) {
+        trace_dev(link->devs[LINK_LOCAL_DEV], "using shared memory ring %s for data to device "
+                  "'%s'\n", name, mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+    }
+}
+#endif /* HAVE_SHM_OPEN */
+
+#ifdef HAVE_UNIX_SOCKETS
+/* Connect a datagram socket to the AF_UNIX path advertised by a remote device on this host. */
+static void un_open(mpr_link link)
+{
+    struct sockaddr_un sa;
+    const char *path;
+    RETURN_UNLESS(link->is_same_host && link->transport >= LOCAL_TRANSPORT_UNIX && link->un.fd < 0);
+    path = mpr_obj_get_prop_as_str((mpr_obj)link->devs[LINK_REMOTE_DEV], MPR_PROP_EXTRA,
+                                   "unix_path");
+    RETURN_UNLESS(path && strlen(path) < sizeof(sa.sun_path));
+    memset(&sa, 0, sizeof(struct sockaddr_un));
+    sa.sun_family = AF_UNIX;
+    strcpy(sa.sun_path, path);
+    RETURN_UNLESS((link->un.fd = socket(AF_UNIX, SOCK_DGRAM, 0)) >= 0);
+    if (   fcntl(link->un.fd, F_SETFL, O_NONBLOCK) < 0
+        || connect(link->un.fd, (struct sockaddr*)&sa, sizeof(struct sockaddr_un)) < 0) {
+        trace_dev(link->devs[LINK_LOCAL_DEV], "couldn't connect to AF_UNIX socket %s\n", path);
+        close(link->un.fd);
+        link->un.fd = -1;
+        return;
+    }
+    trace_dev(link->devs[LINK_LOCAL_DEV], "using AF_UNIX socket %s for data to device '%s'\n",
+              path, mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+}
+
+/* Send a datagram through the AF_UNIX socket; returns 0 if the UDP socket should be used instead. */
+static int un_send(mpr_link link, const char *data, size_t len)
+{
+    RETURN_ARG_UNLESS(link->un.fd >= 0, 0);
+    if (send(link->un.fd, data, len, 0) >= 0)
+        return 1;
+    if (EAGAIN == errno || EWOULDBLOCK == errno || ENOBUFS == errno) {
+        /* the receive queue of the remote device is full: drop the datagram as UDP would */
+        return 1;
+    }
+    trace_dev(link->devs[LINK_LOCAL_DEV], "AF_UNIX socket to device '%s' closed\n",
+              mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+    close(link->un.fd);
+    link->un.fd = -1;
+    return 0;
+}
+
+static int un_send_bundle(mpr_link link, lo_bundle lb)
+{
+    size_t len;
+    RETURN_ARG_UNLESS(link->un.fd >= 0, 0);
+    len = lo_bundle_length(lb);
+    if (len > link->un.buf_size) {
+        link->un.buf = realloc(link->un.buf, len);
+        link->un.buf_size = len;
+    }
+    RETURN_ARG_UNLESS(lo_bundle_serialise(lb, link->un.buf, &len), 0);
+    return un_send(link, link->un.buf, len);
+}
+#endif /* HAVE_UNIX_SOCKETS */
+
+/* Choose the transport for a remote device on the same host. Devices prefer shared memory, but
+ * the property "local_transport" of the local device can limit them to "unix" or "udp". */
+static local_transport_t get_local_transport(mpr_link link)
+{
+    const char *str = mpr_obj_get_prop_as_str((mpr_obj)link->devs[LINK_LOCAL_DEV],
+                                              MPR_PROP_EXTRA, "local_transport");
+    if (str && !strcmp(str, "udp"))
+        return LOCAL_TRANSPORT_UDP;
+    if (str && !strcmp(str, "unix"))
+        return LOCAL_TRANSPORT_UNIX;
+    return LOCAL_TRANSPORT_SHM;
+}
+
+/* Links holding records are retried by the network poll loop until the ring has space. */
+int mpr_link_flush_shm(mpr_link link)
+{
+#ifdef HAVE_SHM_OPEN
+    int held = 0;
+    /* a closed ring is noticed the next time a bundle is sent */
+    if (link->shm.out && !__atomic_load_n(&link->shm.out->hdr->closed, __ATOMIC_ACQUIRE)) {
+        held = shm_write_held(link);
+        shm_wake_consumer(link, mpr_net_get_dev_server(mpr_graph_get_net(link->obj.graph),
+                                                       (mpr_local_dev)link->devs[LINK_LOCAL_DEV],
+                                                       SERVER_DATA_UDP));
+    }
+    else
+        link->shm.held_len = 0;
+    set_in_net_list(link, NET_LINKS_SHM_HELD, held);
+    return held;
+#else
+    return 0;
+#endif
+}
+
+int mpr_link_set_shm_waiting(mpr_link link, int waiting)
+{
+#ifdef HAVE_SHM_OPEN
+    mpr_shm_ring_hdr hdr;
+    RETURN_ARG_UNLESS(link->shm.in, 0);
+    hdr = link->shm.in->hdr;
+    __atomic_store_n(&hdr->waiting, waiting, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE) != hdr->tail;
+#else
+    return 0;
+#endif
+}
+
+int mpr_link_recv_shm(mpr_link link)
+{
+#ifdef HAVE_SHM_OPEN
+    mpr_shm_ring ring = link->shm.in;
+    mpr_shm_ring_hdr hdr;
+    lo_server server;
+    uint32_t head, tail;
+    int count = 0;
+    RETURN_ARG_UNLESS(ring, 0);
+
+    hdr = ring->hdr;
+    server = mpr_net_get_dev_server(mpr_graph_get_net(link->obj.graph),
+                                    (mpr_local_dev)link->devs[LINK_LOCAL_DEV], SERVER_DATA_UDP);
+    head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+    tail = hdr->tail;
+    while (tail != head) {
+        uint32_t len = *(uint32_t*)(ring->data + (tail & (SHM_RING_SIZE - 1)));
+        if (len > SHM_RING_SIZE - sizeof(uint32_t)) {
+            /* corrupt record: discard the ring contents */
+            trace_dev(link->devs[LINK_LOCAL_DEV], "error: bad record in shared memory ring\n");
+            tail = head;
+            break;
+        }
+        if (len > link->shm.buf_size) {
+            link->shm.buf = realloc(link->shm.buf, len);
+            link->shm.buf_size = len;
+        }
+        shm_ring_copy(ring, tail + sizeof(uint32_t), link->shm.buf, len, 0);
+        tail += sizeof(uint32_t) + ((len + 3) & ~3);
+        /* release the space before dispatching since handlers may take a while */
+        __atomic_store_n(&hdr->tail, tail, __ATOMIC_RELEASE);
+        lo_server_dispatch_data(server, link->shm.buf, len);
+        ++count;
+    }
+    __atomic_store_n(&hdr->tail, tail, __ATOMIC_RELEASE);
+    return count;
+#else
+    return 0;
+#endif
+}
+
+static uint32_t mix_inst_key(uint32_t key, const char *id_ptr)
+{
+    int64_t id;
+    memcpy(&id, id_ptr, sizeof(int64_t));
+    return key * 31 + (uint32_t)(id ^ (id >> 32));
+}
+
+/* Key a signal update message by its path, slot and instances. Returns 0 if the message carries
+ * nulls or partial instance frames, since those release instances and may not be replaced by newer
+ * values. */
+static int get_msg_key(const char *path, lo_message msg, uint32_t *key)
+{
+    lo_arg **argv = lo_message_get_argv(msg);
+    const char *types = lo_message_get_types(msg);
+    int i, j, argc = lo_message_get_argc(msg), slot = -1;
+    uint32_t inst = 0;
+    for (i = 0; i < argc; i++) {
+        if (MPR_NULL == types[i])
+            return 0;
+        if (MPR_INT64 == types[i])
+            inst = mix_inst_key(inst, (const char*)&argv[i]->i64);
+        else if (LO_BLOB == types[i]) {
+            mpr_frame_hdr_t hdr;
+            const char *ids = lo_blob_dataptr((lo_blob)argv[i]);
+            if (lo_blob_datasize((lo_blob)argv[i]) < sizeof(hdr))
+                return 0;
+            memcpy(&hdr, ids, sizeof(hdr));
+            if (hdr.num != hdr.num_vals)
+                return 0;
+            ids += sizeof(hdr);
+            for (j = 0; j < hdr.num; j++)
+                inst = mix_inst_key(inst, ids + j * sizeof(mpr_id));
+        }
+    }
+    if (argc && MPR_INT32 == types[0])
+        slot = argv[0]->i32;
+    else if (argc > 1 && MPR_STR == types[0] && 0 == strcmp(&argv[0]->s, "@sl"))
+        slot = argv[1]->i32;
+    *key = (mpr_path_hash(path) * 31 + slot) * 31 + inst;
+    return 1;
+}
+
+/* Same as get_msg_key() for a message serialised as OSC. */
+static int get_osc_key(const char *path, const char *types, const char *data, uint32_t *key)
+{
+    int i, j, slot = -1, has_sl = 0;
+    uint32_t u, inst = 0;
+    for (i = 1; types[i]; i++) {
+        switch (types[i]) {
+            case MPR_INT32:
+                if (1 == i || (2 == i && has_sl)) {
+                    memcpy(&u, data, 4);
+                    slot = (int)lo_otoh32(u);
+                }
+                /* fall through */
+            case MPR_FLT:
+                data += 4;
+                break;
+            case MPR_INT64: {
+                uint64_t id;
+                memcpy(&id, data, 8);
+                id = lo_otoh64(id);
+                inst = mix_inst_key(inst, (const char*)&id);
+            }
+                /* fall through */
+            case MPR_DBL:
+                data += 8;
+                break;
+            case MPR_STR:
+                if (1 == i && 0 == strcmp(data, "@sl"))
+                    has_sl = 1;
+                data += (strlen(data) + 4) & ~3;
+                break;
+            case LO_BLOB: {
+                mpr_frame_hdr_t hdr;
+                memcpy(&u, data, 4);
+                u = lo_otoh32(u);
+                if (u < sizeof(hdr))
+                    return 0;
+                memcpy(&hdr, data + 4, sizeof(hdr));
+                if (hdr.num != hdr.num_vals)
+                    return 0;
+                for (j = 0; j < hdr.num; j++)
+                    inst = mix_inst_key(inst, data + 4 + sizeof(hdr) + j * sizeof(mpr_id));
+                data += 4 + ((u + 3) & ~3);
+                break;
+            }
+            default:
+                return 0;
+        }
+    }
+    *key = (mpr_path_hash(path) * 31 + slot) * 31 + inst;
+    return 1;
+}
+
+/* Link statistics are kept as local-only properties of the local device, summed over its links:
+ * "tcp_queue_bytes", "tcp_queue_peak", "tcp_queue_dropped", "tcp_queue_merged" and the message
+ * counts of each priority class. */
+#ifdef HAVE_TCP_QUEUE
+
+/* Mark a socket with the DSCP code point of a priority class, and on Linux also with the
+ * priority of its queue on the local interface. */
+static void set_socket_class(int fd, int family, int cls)
+{
+    /* EF (46) for high priority, CS1 (8) for low priority, shifted past the ECN bits */
+    int tos = PRIORITY_HIGH == cls ? 46 << 2 : PRIORITY_LOW == cls ? 8 << 2 : 0;
+#ifdef SO_PRIORITY
+    int prio = PRIORITY_HIGH == cls ? 6 : PRIORITY_LOW == cls ? 1 : 0;
+    setsockopt(fd, SOL_SOCKET, SO_PRIORITY, &prio, sizeof(prio));
+#endif
+#if defined(IPV6_TCLASS) && defined(AF_INET6)
+    if (AF_INET6 == family) {
+        setsockopt(fd, IPPROTO_IPV6, IPV6_TCLASS, &tos, sizeof(tos));
+        return;
+    }
+#endif
+    setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+}
+
+/* Open a nonblocking UDP socket connected to the remote device for the datagrams of a class.
+ * Returns -2 if it could not be opened so that the device sockets are used from then on. */
+static int prio_open(mpr_link link, int cls)
+{
+    struct sockaddr *addr = (struct sockaddr*)link->addr.udp.addr;
+    int fd;
+    RETURN_ARG_UNLESS(link->addr.udp.len, -2);
+    RETURN_ARG_UNLESS((fd = socket(addr->sa_family, SOCK_DGRAM, 0)) >= 0, -2);
+    set_socket_class(fd, addr->sa_family, cls);
+    if (   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) < 0
+        || connect(fd, addr, link->addr.udp.len) < 0) {
+        trace_dev(link->devs[LINK_LOCAL_DEV], "couldn't open priority socket to device '%s'\n",
+                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+        close(fd);
+        return -2;
+    }
+    return fd;
+}
+
+static void tcp_queue_report(mpr_link link)
+{
+    mpr_tcp_queue_t *q = &link->tcp;
+    RETURN_UNLESS(q->len != q->reported);
+    add_dev_stat(link, "tcp_queue_bytes", (int)q->len - (int)q->reported, 0);
+    add_dev_stat(link, "tcp_queue_peak", (int)q->len, 1);
+    q->reported = q->len;
+}
+
+/* Remove a queued record that has not been partially written. */
+static void tcp_queue_remove(mpr_link link, int idx)
+{
+    mpr_tcp_queue_t *q = &link->tcp;
+    size_t offset = 0;
+    int i;
+    /* the buffer only holds bytes that have not been written yet */
+    for (i = 0; i < idx; i++)
+        offset += q->recs[i].len;
+    offset -= q->sent;
+    memmove(q->buf + offset, q->buf + offset + q->recs[idx].len,
+            q->len - offset - q->recs[idx].len);
+    q->len -= q->recs[idx].len;
+    FUNC_IF(free, q->recs[idx].keys);
+    memmove(q->recs + idx, q->recs + idx + 1, (q->num_recs - idx - 1) * sizeof(mpr_tcp_rec_t));
+    --q->num_recs;
+}
+
+static void tcp_queue_close(mpr_link link)
+{
+    mpr_tcp_queue_t *q = &link->tcp;
+    int i;
+    if (q->fd >= 0)
+        close(q->fd);
+    q->fd = -1;
+    if (q->num_recs)
+        add_dev_stat(link, "tcp_queue_dropped", q->num_recs, 0);
+    for (i = 0; i < q->num_recs; i++)
+        FUNC_IF(free, q->recs[i].keys);
+    q->num_recs = 0;
+    q->len = q->sent = 0;
+    tcp_queue_report(link);
+}
+
+static int tcp_queue_connect(mpr_link link)
+{
+    mpr_tcp_queue_t *q = &link->tcp;
+    int flag = 1;
+    RETURN_ARG_UNLESS(link->addr.udp.len, 0);
+    RETURN_ARG_UNLESS((q->fd = socket(AF_INET, SOCK_STREAM, 0)) >= 0, 0);
+    setsockopt(q->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+#ifdef SO_NOSIGPIPE
+    setsockopt(q->fd, SOL_SOCKET, SO_NOSIGPIPE, &flag, sizeof(flag));
+#endif
+    if (PRIORITY_NORMAL != link->prio.tcp_class)
+        set_socket_class(q->fd, AF_INET, link->prio.tcp_class);
+    if (   fcntl(q->fd, F_SETFL, fcntl(q->fd, F_GETFL, 0) | O_NONBLOCK) < 0
+        || (   connect(q->fd, (struct sockaddr*)link->addr.udp.addr, link->addr.udp.len) < 0
+            && EINPROGRESS != errno)) {
+        trace_dev(link->devs[LINK_LOCAL_DEV], "couldn't connect TCP queue to device '%s'\n",
+                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+        close(q->fd);
+        q->fd = -1;
+        return 0;
+    }
+    return 1;
+}
+
+/* Describe each message by its path, slot and instance ids so that queued bundles holding only
+ * older values for the same destinations can be merged away. Updates for different instances of
+ * a signal are never merged with each other, and bundles releasing instances are never merged. */
+static void tcp_rec_set_keys(mpr_tcp_rec rec, lo_bundle lb)
+{
+    int i, num = lo_bundle_count(lb);
+    rec->keys = num ? malloc(num * sizeof(uint32_t)) : 0;
+    rec->num_keys = num;
+    for (i = 0; i < num; i++) {
+        const char *path;
+        lo_message msg = lo_bundle_get_message(lb, i, &path);
+        if (!get_msg_key(path, msg, &rec->keys[i])) {
+            rec->num_keys = -1;
+            return;
+        }
+    }
+}
+
+static int tcp_rec_is_superseded(mpr_tcp_rec old, mpr_tcp_rec new)
+{
+    int i, j;
+    RETURN_ARG_UNLESS(old->num_keys > 0 && new->num_keys > 0, 0);
+    for (i = 0; i < old->num_keys; i++) {
+        for (j = 0; j < new->num_keys; j++) {
+            if (old->keys[i] == new->keys[j])
+                break;
+        }
+        if (j >= new->num_keys)
+            return 0;
+    }
+    return 1;
+}
+
+/* Apply the device's queue policy until `len` more bytes fit within the queue limit. */
+static int tcp_queue_make_room(mpr_link link, mpr_tcp_rec rec, size_t limit)
+{
+    mpr_tcp_queue_t *q = &link->tcp;
+    mpr_obj dev = (mpr_obj)link->devs[LINK_LOCAL_DEV];
+    const char *str = mpr_obj_get_prop_as_str(dev, MPR_PROP_EXTRA, "tcp_queue_policy");
+    tcp_queue_policy policy = TCP_QUEUE_MERGE;
+    int i, merged = 0, dropped = 0, first = q->sent ? 1 : 0;
+
+    if (str && 0 == strcmp(str, "drop_oldest"))
+        policy = TCP_QUEUE_DROP_OLDEST;
+    else if (str && 0 == strcmp(str, "drop_newest"))
+        policy = TCP_QUEUE_DROP_NEWEST;
+
+    if (TCP_QUEUE_MERGE == policy) {
+        /* latest value wins: remove bundles holding only older updates for the same slots and
+         * instances */
+        for (i = first; i < q->num_recs && q->len + rec->len > limit; i++) {
+            if (tcp_rec_is_superseded(&q->recs[i], rec)) {
+                tcp_queue_remove(link, i--);
+                ++merged;
+            }
+        }
+    }
+    if (TCP_QUEUE_DROP_NEWEST != policy) {
+        while (q->num_recs > first && q->len + rec->len > limit) {
+            tcp_queue_remove(link, first);
+            ++dropped;
+        }
+    }
+    if (q->len + rec->len > limit)
+        ++dropped;
+    if (merged)
+        add_dev_stat(link, "tcp_queue_merged", merged, 0);
+    if (dropped)
+        add_dev_stat(link, "tcp_queue_dropped", dropped, 0);
+    return q->len + rec->len <= limit;
+}
+
+/* Add a bundle to the outbound TCP queue; returns 0 if it should be sent using liblo instead. */
+static int tcp_queue_add(mpr_link link, lo_bundle lb)
+{
+    mpr_tcp_queue_t *q = &link->tcp;
+    mpr_tcp_rec_t rec;
+    size_t len = lo_bundle_length(lb), limit;
+    uint32_t framed;
+    int max;
+
+    RETURN_ARG_UNLESS(len, 0);
+    if (q->fd < 0)
+        RETURN_ARG_UNLESS(tcp_queue_connect(link), 0);
+
+    max = mpr_obj_get_prop_as_int32((mpr_obj)link->devs[LINK_LOCAL_DEV], MPR_PROP_EXTRA,
+                                    "tcp_queue_limit");
+    limit = max > 0 ? max : TCP_QUEUE_LIMIT;
+    rec.len = len + sizeof(uint32_t);
+    rec.keys = 0;
+    rec.num_keys = -1;
+    if (q->len + rec.len > limit) {
+        tcp_rec_set_keys(&rec, lb);
+        if (!tcp_queue_make_room(link, &rec, limit)) {
+            FUNC_IF(free, rec.keys);
+            return 1;
+        }
+    }
+    else if (q->len)
+        tcp_rec_set_keys(&rec, lb);
+
+    if (q->len + rec.len > q->size) {
+        q->size = q->len + rec.len > q->size * 2 ? q->len + rec.len : q->size * 2;
+        q->buf = realloc(q->buf, q->size);
+    }
+    /* liblo frames stream packets with their length in network byte order */
+    framed = htonl(len);
+    memcpy(q->buf + q->len, &framed, sizeof(uint32_t));
+    lo_bundle_serialise(lb, q->buf + q->len + sizeof(uint32_t), &len);
+    q->len += rec.len;
+
+    if (q->num_recs >= q->size_recs) {
+        q->size_recs = q->size_recs ? q->size_recs * 2 : 8;
+        q->recs = realloc(q->recs, q->size_recs * sizeof(mpr_tcp_rec_t));
+    }
+    q->recs[q->num_recs++] = rec;
+    return 1;
+}
+#endif /* HAVE_TCP_QUEUE */
+
+#ifdef HAVE_TCP_QUEUE
+static int tcp_queue_flush(mpr_link link)
+{
+    mpr_tcp_queue_t *q = &link->tcp;
+    ssize_t ret;
+    size_t written;
+    RETURN_ARG_UNLESS(q->len, 0);
+
+    /* everything queued is written with a single call */
+    ret = send(q->fd, q->buf, q->len, TCP_SEND_FLAGS);
+    if (ret < 0) {
+        if (EAGAIN == errno || EWOULDBLOCK == errno || ENOTCONN == errno || EINTR == errno) {
+            tcp_queue_report(link);
+            return 1;
+        }
+        trace_dev(link->devs[LINK_LOCAL_DEV], "TCP connection to device '%s' failed\n",
+                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+        tcp_queue_close(link);
+        return 0;
+    }
+    written = ret;
+    memmove(q->buf, q->buf + written, q->len - written);
+    q->len -= written;
+    written += q->sent;
+    while (q->num_recs && written >= q->recs[0].len) {
+        written -= q->recs[0].len;
+        FUNC_IF(free, q->recs[0].keys);
+        memmove(q->recs, q->recs + 1, (--q->num_recs) * sizeof(mpr_tcp_rec_t));
+    }
+    q->sent = written;
+    tcp_queue_report(link);
+    return q->len > 0;
+}
+#endif /* HAVE_TCP_QUEUE */
+
+/* Links with a backlog are retried by the network poll loop until their queue drains. */
+int mpr_link_flush_tcp(mpr_link link)
+{
+#ifdef HAVE_TCP_QUEUE
+    int pending = tcp_queue_flush(link);
+    set_in_net_list(link, NET_LINKS_TCP, pending);
+    return pending;
+#else
+    return 0;
+#endif
+}
+
+/* Copy into or out of the outbound queue, wrapping at the end. */
+static void out_copy(mpr_out_queue_t *q, uint32_t idx, void *buf, uint32_t len, int write)
+{
+    uint32_t offset = idx & (OUT_QUEUE_SIZE - 1), first = OUT_QUEUE_SIZE - offset;
+    if (first > len)
+        first = len;
+    if (write) {
+        memcpy(q->data + offset, buf, first);
+        memcpy(q->data, (char*)buf + first, len - first);
+    }
+    else {
+        memcpy(buf, q->data + offset, first);
+        memcpy((char*)buf + first, q->data, len - first);
+    }
+}
+
+/* Reserve a record for the message described by m. Messages too large to be stored in the queue
+ * are copied to the heap instead. Returns 0 if the queue is full. */
+static int out_reserve(mpr_out_queue_t *q, mpr_out_msg_t *m, uint32_t *idx, uint32_t *size)
+{
+    uint32_t head, tail;
+    RETURN_ARG_UNLESS(q->data, 0);
+    m->ext = m->len > OUT_MSG_MAX ? calloc(1, m->len) : 0;
+    *size = (OUT_HDR_SIZE + (m->ext ? 0 : m->len) + 3) & ~3;
+    head = mpr_atomic_get(&q->head);
+    do {
+        tail = mpr_atomic_get(&q->tail);
+        if (OUT_QUEUE_SIZE - (head - tail) < *size) {
+            mpr_atomic_add(&q->dropped, 1);
+            FUNC_IF(free, m->ext);
+            return 0;
+        }
+    } while (!mpr_atomic_cas(&q->head, &head, head + *size));
+    *idx = head;
+    return 1;
+}
+
+/* Write part of the encoded message into a reserved record. */
+static void out_write(mpr_out_queue_t *q, uint32_t idx, mpr_out_msg_t *m, uint32_t offset,
+                      const void *buf, uint32_t len)
+{
+    if (m->ext)
+        memcpy(m->ext + offset, buf, len);
+    else
+        out_copy(q, idx + OUT_HDR_SIZE + offset, (void*)buf, len, 1);
+}
+
+/* Copy the encoded message out of a published record. */
+static void out_read(mpr_out_queue_t *q, uint32_t idx, mpr_out_msg_t *m, char *buf)
+{
+    if (m->ext)
+        memcpy(buf, m->ext, m->len);
+    else
+        out_copy(q, idx + OUT_HDR_SIZE, buf, m->len, 0);
+}
+
+/* Write the header of a reserved record and make it visible to the consumer. */
+static void out_publish(mpr_out_queue_t *q, uint32_t idx, uint32_t size, mpr_out_msg_t *m)
+{
+    out_copy(q, idx + sizeof(uint32_t), m, sizeof(mpr_out_msg_t), 1);
+    mpr_atomic_set((uint32_t*)(q->data + (idx & (OUT_QUEUE_SIZE - 1))), size);
+}
+
+/* Read the header of the record at idx if it has been published. Returns the record size, or 0
+ * if idx has reached end or the record is still being written. */
+static uint32_t out_peek(mpr_out_queue_t *q, uint32_t idx, uint32_t end, mpr_out_msg_t *m)
+{
+    uint32_t size;
+    RETURN_ARG_UNLESS(q->data && idx != end, 0);
+    size = mpr_atomic_get((uint32_t*)(q->data + (idx & (OUT_QUEUE_SIZE - 1))));
+    if (size)
+        out_copy(q, idx + sizeof(uint32_t), m, sizeof(mpr_out_msg_t), 0);
+    return size;
+}
+
+/* Clear the record at the tail and release its space to the producers. */
+static void out_release(mpr_out_queue_t *q, uint32_t size)
+{
+    uint32_t offset = q->tail & (OUT_QUEUE_SIZE - 1), first = OUT_QUEUE_SIZE - offset;
+    if (first > size)
+        first = size;
+    memset(q->data + offset, 0, first);
+    memset(q->data, 0, size - first);
+    mpr_atomic_set(&q->tail, q->tail + size);
+}
+
+void mpr_link_init(mpr_link link, mpr_graph g, mpr_dev dev1, mpr_dev dev2)
+{
+    mpr_net net = mpr_graph_get_net(g);
+    lo_message msg;
+    char cmd[256];
+    int i;
+
+    link->devs[LINK_LOCAL_DEV] = dev1;
+    link->devs[LINK_REMOTE_DEV] = dev2;
+    link->obj.is_local = mpr_obj_get_is_local((mpr_obj)dev1) || mpr_obj_get_is_local((mpr_obj)dev2);
+    link->is_local_only = mpr_obj_get_is_local((mpr_obj)dev1) && mpr_obj_get_is_local((mpr_obj)dev2);
+
+    if (!link->obj.props.synced) {
+        mpr_tbl t = link->obj.props.synced = mpr_tbl_new();
+#ifdef HAVE_TCP_QUEUE
+        link->tcp.fd = -1;
+#endif
+#ifdef HAVE_UNIX_SOCKETS
+        link->un.fd = -1;
+#endif
+        for (i = 0; i < NUM_PRIORITIES; i++)
+            link->prio.fd[i] = -1;
+        link->prio.tcp_class = PRIORITY_NORMAL;
+        for (i = 0; i <= FEC_MAX_DEPTH; i++)
+            link->fec.sent[i].num_msgs = -1;
+        mpr_tbl_add_record(t, MPR_PROP_DEV, NULL, 2, MPR_DEV, &link->devs,
+                           MPR_TBL_MOD_NONE | MPR_TBL_ACC_LOC);
+        mpr_tbl_add_record(t, MPR_PROP_ID, NULL, 1, MPR_INT64, &link->obj.id, MPR_TBL_MOD_NONE);
+        mpr_tbl_add_record(t, MPR_PROP_NUM_MAPS, NULL, 1, MPR_INT32, &link->num_maps,
+                           MPR_TBL_MOD_NONE | MPR_TBL_INDIRECT);
+    }
+    if (!link->obj.props.staged)
+        link->obj.props.staged = mpr_tbl_new();
+
+    if (!link->obj.id && mpr_obj_get_is_local((mpr_obj)link->devs[LINK_LOCAL_DEV]))
+        link->obj.id = mpr_dev_generate_unique_id(link->devs[LINK_LOCAL_DEV]);
+
+    if (link->is_local_only) {
+        mpr_link_connect(link, 0, 0, 0);
+        return;
+    }
+    else {
+        mpr_time t;
+        link->clock.weight = 1.0;
+        link->clock.rate = 1;
+        link->clock.latency = 0;
+        link->clock.jitter = 0;
+        link->clock.sent.msg_id = 0;
+        link->clock.rcvd.msg_id = -1;
+        mpr_time_set(&t, MPR_NOW);
+        mpr_time_add_dbl(&t, mpr_dev_get_offset(link->devs[LINK_LOCAL_DEV]));
+        link->clock.rcvd.time.sec = t.sec + 10;
+    }
+    /* request missing metadata */
+    snprintf(cmd, 256, "/%s/subscribe", mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+
+    msg = lo_message_new();
+    if (!msg) {
+        trace("couldn't allocate lo_message\n");
+        return;
+    }
+
+    lo_message_add_string(msg, "device");
+    mpr_net_use_bus(net);
+    mpr_net_add_msg(net, cmd, 0, msg);
+    mpr_net_send(net);
+}
+
+void mpr_link_connect(mpr_link link, const char *host, int admin_port, int data_port)
+{
+    if (!link->is_local_only) {
+        char str[16];
+        mpr_tbl tbl = mpr_obj_get_prop_tbl((mpr_obj)link->devs[LINK_REMOTE_DEV]);
+        mpr_tbl_add_record(tbl, MPR_PROP_PORT, NULL, 1, MPR_INT32, &data_port, MPR_TBL_MOD_REM);
+        sprintf(str, "%d", data_port);
+        link->addr.data.udp = lo_address_new(host, str);
+        link->addr.data.tcp = lo_address_new_with_proto(LO_TCP, host, str);
+        lo_address_set_tcp_nodelay(link->addr.data.tcp, 1);
+        /* resolve the data address once so datagrams can be queued for batched sending */
+        mpr_net_resolve_dst(&link->addr.udp, host, str);
+        sprintf(str, "%d", admin_port);
+        link->addr.admin = lo_address_new(host, str);
+        trace_dev(link->devs[LINK_LOCAL_DEV], "activated link to device '%s' at %s:%d\n",
+                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]), host, data_port);
+        link->is_same_host = mpr_net_get_host_is_local(mpr_graph_get_net(link->obj.graph), host);
+        if (link->is_same_host)
+            link->transport = get_local_transport(link);
+#ifdef HAVE_SHM_OPEN
+        if (link->is_same_host && !link->shm.in) {
+            /* create the ring for incoming data; the remote device will open it */
+            char name[SHM_NAME_LEN];
+            shm_ring_get_name(name, link->devs[LINK_REMOTE_DEV], link->devs[LINK_LOCAL_DEV]);
+            link->shm.in = shm_ring_open(name, 1);
+            set_in_net_list(link, NET_LINKS_SHM, link->shm.in != 0);
+        }
+        shm_maybe_open_out(link);
+#endif
+#ifdef HAVE_UNIX_SOCKETS
+        /* used for the datagrams that cannot be passed through shared memory */
+        un_open(link);
+#endif
+    }
+    else {
+        trace_dev(link->devs[LINK_LOCAL_DEV], "activating link to local device '%s'\n",
+                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+    }
+    if (!link->out.data)
+        link->out.data = calloc(1, OUT_QUEUE_SIZE);
+    mpr_dev_add_link(link->devs[LINK_LOCAL_DEV], link->devs[LINK_REMOTE_DEV]);
+
+    {
+        mpr_time now;
+        mpr_time_set(&now, MPR_NOW);
+        mpr_link_housekeeping(link, now);
+    }
+}
+
+void mpr_link_free(mpr_link link)
+{
+    int i;
+    for (i = 0; i < NUM_NET_LINK_LISTS; i++)
+        set_in_net_list(link, i, 0);
+    mpr_obj_free(&link->obj);
+    FUNC_IF(lo_address_free, link->addr.admin);
+    FUNC_IF(lo_address_free, link->addr.data.udp);
+    FUNC_IF(lo_address_free, link->addr.data.tcp);
+#ifdef HAVE_TCP_QUEUE
+    if (link->tcp.fd >= 0)
+        close(link->tcp.fd);
+    for (i = 0; i < link->tcp.num_recs; i++)
+        FUNC_IF(free, link->tcp.recs[i].keys);
+    FUNC_IF(free, link->tcp.recs);
+    FUNC_IF(free, link->tcp.buf);
+#endif
+#ifdef HAVE_UNIX_SOCKETS
+    if (link->un.fd >= 0)
+        close(link->un.fd);
+    FUNC_IF(free, link->un.buf);
+#endif
+    if (link->rudp.win) {
+        for (i = 0; i < RUDP_WINDOW; i++) {
+            FUNC_IF(free, link->rudp.win[i].buf);
+            FUNC_IF(free, link->rudp.win[i].msgs);
+        }
+        free(link->rudp.win);
+    }
+    FUNC_IF(free, link->rudp.keys);
+    FUNC_IF(free, link->pacing.buf);
+    FUNC_IF(free, link->pacing.msgs);
+    FUNC_IF(free, link->pacing.keys);
+    for (i = 0; i <= FEC_MAX_DEPTH; i++) {
+        FUNC_IF(free, link->fec.sent[i].buf);
+        FUNC_IF(free, link->fec.sent[i].msgs);
+    }
+    FUNC_IF(free, link->fec.buf);
+    FUNC_IF(free, link->chunk.buf);
+    FUNC_IF(free, link->chunk.rx_buf);
+    FUNC_IF(mpr_bitflags_free, link->chunk.rx_known);
+#ifdef HAVE_SHM_OPEN
+    if (link->shm.in)
+        shm_ring_close(link->shm.in, 1);
+    if (link->shm.out)
+        shm_ring_close(link->shm.out, 0);
+    FUNC_IF(free, link->shm.buf);
+    FUNC_IF(free, link->shm.held);
+#endif
+    for (i = 0; i < NUM_PRIORITIES; i++) {
+        FUNC_IF(lo_bundle_free_recursive, link->bundles[i].udp);
+        FUNC_IF(lo_bundle_free_recursive, link->bundles[i].tcp);
+        FUNC_IF(lo_bundle_free_recursive, link->bundles[i].rudp);
+        FUNC_IF(free, link->bundles[i].osc.buf);
+#ifdef HAVE_TCP_QUEUE
+        if (link->prio.fd[i] >= 0)
+            close(link->prio.fd[i]);
+#endif
+    }
+    if (link->out.data) {
+        mpr_out_msg_t m;
+        uint32_t size;
+        while ((size = out_peek(&link->out, link->out.tail, link->out.head, &m))) {
+            FUNC_IF(free, m.ext);
+            link->out.tail += size;
+        }
+        free(link->out.data);
+    }
+    FUNC_IF(free, link->out.buf);
+    FUNC_IF(free, link->out.argv);
+    mpr_dev_remove_link(link->devs[LINK_LOCAL_DEV], link->devs[LINK_REMOTE_DEV]);
+    FUNC_IF(free, link->maps);
+}
+
+static mpr_time get_remote_time(mpr_link link, mpr_time t, mpr_proto proto)
+{
+    /* add offset to timetag */
+    /* retrieve clock offset for remote device */
+    double offset = mpr_dev_get_offset(link->devs[LINK_REMOTE_DEV]);
+    if (link->is_local_only) {
+        offset -= mpr_dev_get_offset(link->devs[LINK_LOCAL_DEV]);
+        if (MPR_PROTO_UDP == proto) {
+            offset *= -1;
+        }
+    }
+
+    /* TODO: consider adding jitter compensation here */
+    /* offset += link->clock.jitter; */
+
+    mpr_time_add_dbl(&t, offset);
+    return t;
+}
+
+/* The message is serialised into the queue since the calling slot may modify or free it before
+ * the queue is processed. */
+void mpr_link_add_msg(mpr_link link, mpr_sig sig, const char *path, lo_message msg, mpr_time t,
+                      mpr_proto proto, int priority)
+{
+    mpr_out_queue_t *q = &link->out;
+    mpr_out_msg_t m;
+    uint32_t idx, size, u;
+    size_t len;
+    char *data;
+    RETURN_UNLESS(msg);
+
+    if (!path)
+        path = mpr_sig_get_path(sig);
+    RETURN_UNLESS((data = lo_message_serialise(msg, path, NULL, &len)));
+    m.sig = sig;
+    m.time = t;
+    m.len = len + 4;
+    m.proto = proto;
+    m.priority = priority;
+    if (out_reserve(q, &m, &idx, &size)) {
+        u = lo_htoo32((uint32_t)len);
+        out_write(q, idx, &m, 0, &u, 4);
+        out_write(q, idx, &m, 4, data, len);
+        out_publish(q, idx, size, &m);
+    }
+    free(data);
+}
+
+int mpr_link_add_osc(mpr_link link, mpr_sig sig, const char *path, const char *types,
+                     const char *data, int len, mpr_time t, mpr_proto proto, int priority)
+{
+    mpr_out_queue_t *q = &link->out;
+    mpr_out_msg_t m;
+    size_t path_len, types_len;
+    uint32_t idx, size, u;
+
+    if (link->is_local_only) {
+        /* the destination signal is carried in the message header */
+        path = "";
+    }
+    else if (!path)
+        path = mpr_sig_get_path(sig);
+    path_len = (strlen(path) + 4) & ~3;
+    types_len = (strlen(types) + 4) & ~3;
+    m.sig = sig;
+    m.time = t;
+    m.len = 4 + path_len + types_len + len;
+    m.proto = proto;
+    m.priority = priority;
+    RETURN_ARG_UNLESS(out_reserve(q, &m, &idx, &size), 0);
+
+    /* bundle element: size, then the message path, type tags and arguments; the reserved space
+     * has been cleared by the consumer so the string padding is already zero */
+    u = lo_htoo32(m.len - 4);
+    out_write(q, idx, &m, 0, &u, 4);
+    out_write(q, idx, &m, 4, path, strlen(path));
+    out_write(q, idx, &m, 4 + path_len, types, strlen(types));
+    out_write(q, idx, &m, 4 + path_len + types_len, data, len);
+    out_publish(q, idx, size, &m);
+    return 1;
+}
+
+/* Read the priority classes of the maps using a link, to mark the TCP socket and to decide
+ * whether messages should be counted per class. Messages carry the class cached on their slot. */
+static void priority_update(mpr_link link, mpr_time t)
+{
+    mpr_priority_t *p = &link->prio;
+    int i, tcp_class = PRIORITY_NORMAL;
+    RETURN_UNLESS(!link->is_local_only);
+    RETURN_UNLESS(   p->num_maps != link->num_maps || !p->checked.sec
+                  || mpr_time_get_diff(t, p->checked) >= PACING_CHECK_SEC);
+    p->checked = t;
+
+    p->num_maps = link->num_maps;
+    p->any = 0;
+    for (i = 0; i < p->num_maps; i++) {
+        int cls = PRIORITY_NORMAL + mpr_map_get_priority(link->maps[i]);
+        if (PRIORITY_NORMAL != cls)
+            p->any = 1;
+        if (MPR_PROTO_TCP == mpr_map_get_protocol(link->maps[i]) && cls > tcp_class)
+            tcp_class = cls;
+    }
+    if (tcp_class == p->tcp_class)
+        return;
+    /* the TCP stream cannot be split between classes without reordering, so it is marked with
+     * the highest class of the TCP maps */
+    p->tcp_class = tcp_class;
+#ifdef HAVE_TCP_QUEUE
+    if (link->tcp.fd >= 0)
+        set_socket_class(link->tcp.fd, AF_INET, tcp_class);
+#endif
+}
+
+/* Add the number of messages sent in each class to the device statistics. */
+static void priority_report(mpr_link link)
+{
+    static const char *keys[] = {"priority_low_msgs", "priority_normal_msgs",
+                                 "priority_high_msgs"};
+    int i;
+    for (i = 0; i < NUM_PRIORITIES; i++) {
+        if (link->prio.msgs[i]) {
+            add_dev_stat(link, keys[i], link->prio.msgs[i], 0);
+            link->prio.msgs[i] = 0;
+        }
+    }
+}
+
+/* Send a datagram of the high or low priority class through the socket marked for its class.
+ * Datagrams that would block are dropped, as they would be by a full socket buffer. Returns 0
+ * if the datagram should be sent from the device sockets instead. */
+static int prio_send(mpr_link link, int cls, const char *data, size_t len)
+{
+#ifdef HAVE_TCP_QUEUE
+    int *fd = &link->prio.fd[cls];
+    RETURN_ARG_UNLESS(PRIORITY_NORMAL != cls, 0);
+    if (-1 == *fd)
+        *fd = prio_open(link, cls);
+    RETURN_ARG_UNLESS(*fd >= 0, 0);
+    if (send(*fd, data, len, 0) < 0 && EAGAIN != errno && EWOULDBLOCK != errno) {
+        trace_dev(link->devs[LINK_LOCAL_DEV], "error sending to device '%s' from priority "
+                  "socket, using device sockets\n", mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+        close(*fd);
+        *fd = -2;
+        return 0;
+    }
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* Check whether a message can be appended to the UDP bundle encoded in place. Only plain UDP to a
+ * resolved remote address or AF_UNIX socket can bypass liblo, but paced messages are always held
+ * in their serialised form. High priority messages are never paced. */
+static int osc_can_append(mpr_link link, int cls, uint32_t len)
+{
+    mpr_bundle mb = &link->bundles[cls];
+    int paced = PRIORITY_HIGH != cls && link->pacing.interval > 0;
+#ifdef HAVE_UNIX_SOCKETS
+    RETURN_ARG_UNLESS(link->addr.udp.len > 0 || paced || link->un.fd >= 0, 0);
+#else
+    RETURN_ARG_UNLESS(link->addr.udp.len > 0 || paced, 0);
+#endif
+#ifdef HAVE_SHM_OPEN
+    RETURN_ARG_UNLESS(!link->shm.out, 0);
+#endif
+    /* keep messages in order if some have already been added to the liblo bundle */
+    RETURN_ARG_UNLESS(!mb->udp || !lo_bundle_count(mb->udp), 0);
+    return mb->osc.len + 16 + len <= OSC_BUNDLE_LIMIT;
+}
+
+/* Decode the arguments of the message read into the consumer buffer in place, so that messages
+ * for local devices can be passed to the signal handler without building an lo_message. Returns
+ * the number of arguments, or -1 if the message could not be decoded. */
+static int out_decode_args(mpr_out_queue_t *q, uint32_t len, const char **types)
+{
+    char *pos = q->buf + 4, *end = q->buf + len;
+    int i, argc;
+
+    pos += (strlen(pos) + 4) & ~3;
+    RETURN_ARG_UNLESS(pos < end && ',' == *pos, -1);
+    *types = pos + 1;
+    argc = strlen(*types);
+    pos += (argc + 5) & ~3;
+    if (argc > q->argv_size) {
+        q->argv_size = argc;
+        q->argv = realloc(q->argv, argc * sizeof(lo_arg*));
+    }
+    for (i = 0; i < argc; i++) {
+        char type = (*types)[i];
+        uint32_t size;
+        q->argv[i] = (lo_arg*)pos;
+        switch (type) {
+            case 'i': case 'f': case 'c': case 'r': case 'm':
+                size = 4;
+                break;
+            case 'h': case 'd': case 't':
+                size = 8;
+                break;
+            case 's': case 'S':
+                size = (strlen(pos) + 4) & ~3;
+                break;
+            case LO_BLOB:
+                memcpy(&size, pos, 4);
+                size = (lo_otoh32(size) + 7) & ~3;
+                break;
+            default:
+                /* types without data */
+                size = 0;
+                break;
+        }
+        RETURN_ARG_UNLESS(pos + size <= end, -1);
+        if ('s' != type && 'S' != type)
+            lo_arg_host_endian((lo_type)type, pos);
+        pos += size;
+    }
+    return argc;
+}
+
+/* Move the messages published in the outbound queue into the bundles of their priority class
+ * for this cycle, or call the signal handlers directly for links between local devices. Messages
+ * published while the queue is being drained, for example by handlers, are left for the next
+ * cycle. Returns the number of messages. */
+static int out_drain(mpr_link link, mpr_net net)
+{
+    mpr_out_queue_t *q = &link->out;
+    mpr_bundle mb;
+    mpr_out_msg_t m;
+    uint32_t end, size, dropped;
+    int count = 0;
+    RETURN_ARG_UNLESS(q->data, 0);
+
+    if ((dropped = mpr_atomic_swap(&q->dropped, 0)))
+        trace_dev(link->devs[LINK_LOCAL_DEV], "outbound queue full, dropped %u messages\n",
+                  dropped);
+
+    end = mpr_atomic_get(&q->head);
+    while ((size = out_peek(q, q->tail, end, &m))) {
+        mpr_time t = get_remote_time(link, m.time, m.proto);
+        lo_message msg;
+        lo_bundle *b;
+        int result, cls = PRIORITY_NORMAL;
+        ++count;
+
+        if (!link->is_local_only) {
+            /* the class is cached on the slot that queued the message */
+            cls = PRIORITY_NORMAL + m.priority;
+            if (link->prio.any)
+                ++link->prio.msgs[cls];
+        }
+        mb = &link->bundles[cls];
+        if (!link->is_local_only && MPR_PROTO_UDP == m.proto && osc_can_append(link, cls, m.len)) {
+            if (mb->osc.len + 16 + m.len > mb->osc.size) {
+                mb->osc.size = (mb->osc.len + 16 + m.len) * 2;
+                mb->osc.buf = realloc(mb->osc.buf, mb->osc.size);
+            }
+            if (!mb->osc.len) {
+                /* bundle header: "#bundle" and the timetag */
+                uint32_t u;
+                memcpy(mb->osc.buf, "#bundle", 8);
+                u = lo_htoo32(t.sec);
+                memcpy(mb->osc.buf + 8, &u, 4);
+                u = lo_htoo32(t.frac);
+                memcpy(mb->osc.buf + 12, &u, 4);
+                mb->osc.len = 16;
+            }
+            out_read(q, q->tail, &m, mb->osc.buf + mb->osc.len);
+            FUNC_IF(free, m.ext);
+            mb->osc.len += m.len;
+            ++mb->osc.num_msgs;
+            out_release(q, size);
+            continue;
+        }
+
+        if (m.len > q->buf_size) {
+            q->buf_size = m.len;
+            q->buf = realloc(q->buf, q->buf_size);
+        }
+        out_read(q, q->tail, &m, q->buf);
+        FUNC_IF(free, m.ext);
+        /* release the space before dispatching since handlers may add more messages */
+        out_release(q, size);
+
+        if (link->is_local_only) {
+            const char *types;
+            int argc;
+            if (!m.sig)
+                continue;
+            if ((argc = out_decode_args(q, m.len, &types)) < 0) {
+                trace_dev(link->devs[LINK_LOCAL_DEV], "error: bad message in outbound queue\n");
+                continue;
+            }
+            /* The arguments are decoded in place and handed to the signal without building a
+             * liblo message. The slot encoding itself is kept: it is shared with the liblo
+             * consumers of the slot (forwarding, multicast and the release sent when a map is
+             * freed), and mpr_sig_osc_handler() holds the only implementation of instance id
+             * mapping, releases and type coercion for incoming updates. */
+            mpr_net_set_bundle_time(net, t);
+            mpr_sig_osc_handler(NULL, types, q->argv, argc, NULL, m.sig);
+            continue;
+        }
+
+        /* messages that do not fit the bundle encoded in place are added to liblo bundles */
+        if (!(msg = lo_message_deserialise(q->buf + 4, m.len - 4, &result))) {
+            trace_dev(link->devs[LINK_LOCAL_DEV], "error: bad message in outbound queue\n");
+            continue;
+        }
+        switch (m.proto) {
+            case MPR_PROTO_UDP:     b = &mb->udp;   break;
+            case MPR_PROTO_RUDP:    b = &mb->rudp;  break;
+            default:                b = &mb->tcp;   break;
+        }
+        if (!(*b))
+            *b = lo_bundle_new(t);
+        else if (!lo_bundle_count(*b))
+            lo_bundle_set_timestamp(*b, t);
+        lo_bundle_add_message(*b, q->buf + 4, msg);
+        lo_message_free(msg);
+    }
+    return count;
+}
+
+/* Read the redundancy requested by the outgoing UDP maps of the link using the property "fec",
+ * the number of previous bundles repeated in each bundle. All of the maps share the link bundles,
+ * so the largest value among them is used. */
+static void fec_update(mpr_link link, mpr_time t)
+{
+    mpr_fec_t *f = &link->fec;
+    int i, depth = 0;
+    RETURN_UNLESS(!f->checked.sec || mpr_time_get_diff(t, f->checked) >= PACING_CHECK_SEC);
+    f->checked = t;
+
+    for (i = 0; i < link->num_maps; i++) {
+        int d;
+        if (MPR_PROTO_UDP != mpr_map_get_protocol(link->maps[i]))
+            continue;
+        d = mpr_obj_get_prop_as_int32((mpr_obj)link->maps[i], MPR_PROP_EXTRA, "fec");
+        if (d > depth)
+            depth = d;
+    }
+    if (depth > FEC_MAX_DEPTH)
+        depth = FEC_MAX_DEPTH;
+#ifdef HAVE_SHM_OPEN
+    /* local transports do not lose datagrams */
+    if (link->shm.out)
+        depth = 0;
+#endif
+#ifdef HAVE_UNIX_SOCKETS
+    if (link->un.fd >= 0)
+        depth = 0;
+#endif
+    if (depth != f->depth)
+        trace_dev(link->devs[LINK_LOCAL_DEV], "repeating %d bundles to '%s'\n", depth,
+                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+    f->depth = depth;
+}
+
+/* Encode a bundle element carrying the id of the sending device and a sequence number. The path
+ * must be one of MPR_FEC_SEQ, MPR_RUDP_SEQ or MPR_RUDP_RTX, which have the same length. */
+static void put_seq_elem(char *buf, const char *path, mpr_id id, uint32_t seq)
+{
+    uint32_t u[FEC_SEQ_LEN / 4];
+    u[0] = lo_htoo32(FEC_SEQ_LEN - 4);
+    memset(u + 1, 0, 8);
+    memcpy(u + 1, path, 5);
+    memcpy(u + 3, ",hi", 4);
+    u[4] = lo_htoo32((uint32_t)((uint64_t)id >> 32));
+    u[5] = lo_htoo32((uint32_t)id);
+    u[6] = lo_htoo32(seq);
+    memcpy(buf, u, FEC_SEQ_LEN);
+}
+
+/* Index the bundle elements found in the buffer of a sent bundle between `off` and `len`. */
+static void pkt_index_msgs(mpr_rudp_pkt pkt, size_t off, size_t len)
+{
+    pkt->num_msgs = 0;
+    while (off + 4 <= len) {
+        const char *path, *types;
+        mpr_rudp_msg_t *m;
+        uint32_t u;
+        memcpy(&u, pkt->buf + off, 4);
+        u = lo_otoh32(u) + 4;
+        if (off + u > len)
+            break;
+        if (pkt->num_msgs >= pkt->size_msgs) {
+            pkt->size_msgs = pkt->size_msgs ? pkt->size_msgs * 2 : 16;
+            pkt->msgs = realloc(pkt->msgs, pkt->size_msgs * sizeof(mpr_rudp_msg_t));
+        }
+        m = &pkt->msgs[pkt->num_msgs++];
+        m->offset = off;
+        m->len = u;
+        path = pkt->buf + off + 4;
+        types = path + ((strlen(path) + 4) & ~3);
+        m->can_merge = (   ',' == types[0]
+                        && get_osc_key(path, types, types + ((strlen(types) + 4) & ~3), &m->key));
+        off += u;
+    }
+}
+
+/* Keep the elements of a sent bundle so that they can be repeated in the following bundles. */
+static void fec_store(mpr_link link, uint32_t seq, const char *data, size_t len)
+{
+    mpr_rudp_pkt pkt = &link->fec.sent[seq % (FEC_MAX_DEPTH + 1)];
+
+    pkt->seq = seq;
+    if (len > pkt->size) {
+        pkt->size = len;
+        pkt->buf = realloc(pkt->buf, pkt->size);
+    }
+    memcpy(pkt->buf, data, len);
+    pkt->len = len;
+    pkt_index_msgs(pkt, 0, len);
+}
+
+/* Check whether a repeated message is superseded by a newer value for the same slot in one of the
+ * later bundles sent in the same datagram, up to and including the bundle `last`. */
+static int fec_get_is_superseded(mpr_link link, uint32_t seq, uint32_t last, mpr_rudp_msg_t *msg)
+{
+    uint32_t i;
+    int j;
+    RETURN_ARG_UNLESS(msg->can_merge, 0);
+    for (i = seq + 1; i != last + 1; i++) {
+        mpr_rudp_pkt pkt = &link->fec.sent[i % (FEC_MAX_DEPTH + 1)];
+        if (pkt->num_msgs < 0 || pkt->seq != i)
+            continue;
+        for (j = 0; j < pkt->num_msgs; j++) {
+            if (pkt->msgs[j].can_merge && pkt->msgs[j].key == msg->key)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/* Encode a UDP bundle with forward error correction in the scratch buffer of the link: the
+ * messages of the previous bundles that are not superseded come first, each group of messages
+ * preceded by the sequence number of its bundle. Repeated messages are left out if the datagram
+ * would become too large. Returns the encoded length. */
+static size_t fec_encode(mpr_link link, const char *data, size_t len)
+{
+    mpr_fec_t *f = &link->fec;
+    mpr_id id = mpr_obj_get_id((mpr_obj)link->devs[LINK_LOCAL_DEV]);
+    uint32_t seq = f->tx_seq++, last = seq;
+    size_t pos, max_len = len + FEC_SEQ_LEN;
+    int d, i, depth = f->depth;
+
+    fec_store(link, seq, data + 16, len - 16);
+    for (d = 1; d <= depth; d++) {
+        mpr_rudp_pkt pkt = &f->sent[(seq - d) % (FEC_MAX_DEPTH + 1)];
+        if (pkt->num_msgs >= 0 && pkt->seq == seq - d)
+            max_len += FEC_SEQ_LEN + pkt->size;
+    }
+    if (max_len > OSC_BUNDLE_LIMIT) {
+        depth = 0;
+        max_len = len + FEC_SEQ_LEN;
+    }
+    if (max_len > f->size) {
+        f->size = max_len * 2;
+        f->buf = realloc(f->buf, f->size);
+    }
+
+    /* the bundle header and timetag are kept */
+    memcpy(f->buf, data, 16);
+    pos = 16;
+    for (d = depth; d > 0; d--) {
+        mpr_rudp_pkt pkt = &f->sent[(seq - d) % (FEC_MAX_DEPTH + 1)];
+        if (pkt->num_msgs < 0 || pkt->seq != seq - d)
+            continue;
+        put_seq_elem(f->buf + pos, MPR_FEC_SEQ, id, pkt->seq);
+        pos += FEC_SEQ_LEN;
+        for (i = 0; i < pkt->num_msgs; i++) {
+            mpr_rudp_msg_t *m = &pkt->msgs[i];
+            if (fec_get_is_superseded(link, pkt->seq, last, m))
+                continue;
+            memcpy(f->buf + pos, pkt->buf + m->offset, m->len);
+            pos += m->len;
+        }
+    }
+    put_seq_elem(f->buf + pos, MPR_FEC_SEQ, id, seq);
+    pos += FEC_SEQ_LEN;
+    memcpy(f->buf + pos, data + 16, len - 16);
+    return pos + len - 16;
+}
+
+/* The receiver tracks the sequence numbers of the last FEC_WINDOW bundles, and messages repeated
+ * from bundles that have already been received are skipped. */
+int mpr_link_recv_fec(mpr_link link, uint32_t seq)
+{
+    mpr_fec_t *f = &link->fec;
+    int32_t diff = (int32_t)(seq - f->rx_seq);
+    RETURN_ARG_UNLESS(!link->is_local_only, 0);
+
+    if (!f->rx_started || diff >= 0 || diff < -FEC_WINDOW) {
+        /* new bundle, or the sender has restarted its sequence */
+        if (!f->rx_started || diff < -FEC_WINDOW)
+            f->rx_mask = 0;
+        else
+            f->rx_mask = diff + 1 >= FEC_WINDOW ? 0 : f->rx_mask << (diff + 1);
+        f->rx_mask |= 1;
+        f->rx_seq = seq + 1;
+        f->rx_started = 1;
+        return 0;
+    }
+    diff = -diff - 1;
+    RETURN_ARG_UNLESS(!(f->rx_mask & (1u << diff)), 1);
+    /* the bundle was lost or reordered, its messages are taken from this one */
+    f->rx_mask |= 1u << diff;
+    add_dev_stat(link, "fec_recovered", 1, 0);
+    return 0;
+}
+
+/* Send an encoded datagram through the AF_UNIX socket if there is one, the socket marked for its
+ * priority class, or the UDP server. */
+static int send_raw_dgram(mpr_link link, lo_server server, int cls, const char *data, size_t len)
+{
+#ifdef HAVE_UNIX_SOCKETS
+    if (un_send(link, data, len))
+        return 1;
+#endif
+    if (prio_send(link, cls, data, len))
+        return 1;
+    return mpr_net_send_dgram(mpr_graph_get_net(link->obj.graph), server, &link->addr.udp, data,
+                              len);
+}
+
+/* Return the length above which datagrams are split into chunks. The MTU does not apply to
+ * AF_UNIX sockets, so only datagrams too large for the liblo buffers are split for them. Chunks
+ * are sent as raw datagrams, so nothing is split if the remote address is not resolved. */
+static size_t get_chunk_limit(mpr_link link)
+{
+#ifdef HAVE_UNIX_SOCKETS
+    if (link->un.fd >= 0)
+        return OSC_BUNDLE_LIMIT;
+#endif
+    return link->addr.udp.len > 0 ? CHUNK_MTU : CHUNK_MAX_LEN;
+}
+
+/* Split a datagram into "/@chk" messages that fit the MTU, so that large vectors do not depend
+ * on IP fragmentation and are not limited by the largest UDP datagram. Returns 0 if the datagram
+ * should be sent whole instead. */
+static int send_chunks(mpr_link link, lo_server server, int cls, const char *data, size_t len)
+{
+    mpr_id id = mpr_obj_get_id((mpr_obj)link->devs[LINK_LOCAL_DEV]);
+    uint32_t u[CHUNK_MTU / 4], i, num;
+    char *buf = (char*)u;
+
+    RETURN_ARG_UNLESS(len > get_chunk_limit(link) && len <= CHUNK_MAX_LEN, 0);
+    num = (len - 1) / CHUNK_DATA_LEN + 1;
+    memcpy(u, MPR_CHUNK "\0\0\0", 8);
+    memcpy(u + 2, ",hiiib\0\0", 8);
+    u[4] = lo_htoo32((uint32_t)((uint64_t)id >> 32));
+    u[5] = lo_htoo32((uint32_t)id);
+    u[6] = lo_htoo32(link->chunk.tx_seq++);
+    u[8] = lo_htoo32((uint32_t)len);
+    for (i = 0; i < num; i++) {
+        size_t offset = i * CHUNK_DATA_LEN, chunk_len = len - offset, padded;
+        if (chunk_len > CHUNK_DATA_LEN)
+            chunk_len = CHUNK_DATA_LEN;
+        padded = (chunk_len + 3) & ~3;
+        u[7] = lo_htoo32(i);
+        u[9] = lo_htoo32((uint32_t)chunk_len);
+        memcpy(buf + CHUNK_HDR_LEN, data + offset, chunk_len);
+        memset(buf + CHUNK_HDR_LEN + chunk_len, 0, padded - chunk_len);
+        /* later chunks that cannot be sent are lost like any other datagram */
+        if (!send_raw_dgram(link, server, cls, buf, CHUNK_HDR_LEN + padded) && !i)
+            return 0;
+    }
+    add_dev_stat(link, "chunked", 1, 0);
+    return 1;
+}
+
+/* Send an encoded datagram, split into chunks if it is too large. Datagrams are encoded with
+ * forward error correction first if the maps of the link ask for it. */
+static int send_dgram(mpr_link link, lo_server server, int cls, const char *data, size_t len)
+{
+    if (link->fec.depth && len > 16) {
+        len = fec_encode(link, data, len);
+        data = link->fec.buf;
+    }
+    if (send_chunks(link, server, cls, data, len))
+        return 1;
+    return send_raw_dgram(link, server, cls, data, len);
+}
+
+/* Send a bundle built using liblo as an encoded datagram with forward error correction. Returns
+ * 0 if it should be sent using liblo instead. */
+static int send_fec_bundle(mpr_link link, lo_server server, int cls, lo_bundle lb)
+{
+    size_t len;
+    char *data = lo_bundle_serialise(lb, NULL, &len);
+    int sent = data && send_dgram(link, server, cls, data, len);
+    FUNC_IF(free, data);
+    return sent;
+}
+
+static void send_udp_bundle(mpr_link link, lo_server server, int cls, lo_bundle lb)
+{
+    size_t len = lo_bundle_length(lb);
+    if (len > get_chunk_limit(link) && len <= CHUNK_MAX_LEN) {
+        /* serialise large bundles so that they can be split into chunks */
+        if (len > link->chunk.size) {
+            link->chunk.buf = realloc(link->chunk.buf, len);
+            link->chunk.size = len;
+        }
+        if (   lo_bundle_serialise(lb, link->chunk.buf, &len)
+            && send_chunks(link, server, cls, link->chunk.buf, len))
+            return;
+    }
+#ifdef HAVE_UNIX_SOCKETS
+    if (un_send_bundle(link, lb))
+        return;
+#endif
+    if (PRIORITY_NORMAL != cls) {
+        size_t len;
+        char *data = lo_bundle_serialise(lb, NULL, &len);
+        int sent = data && prio_send(link, cls, data, len);
+        FUNC_IF(free, data);
+        if (sent)
+            return;
+    }
+    /* queue the datagram so all links can be flushed with one system call */
+    if (mpr_net_queue_dgram(mpr_graph_get_net(link->obj.graph), server, &link->addr.udp, lb))
+        return;
+    lo_send_bundle_from(link->addr.data.udp, server, lb);
+}
+
+static lo_server get_udp_server(mpr_link link)
+{
+    return mpr_net_get_dev_server(mpr_graph_get_net(link->obj.graph),
+                                  (mpr_local_dev)link->devs[LINK_LOCAL_DEV], SERVER_DATA_UDP);
+}
+
+void mpr_link_recv_chunk(mpr_link link, uint32_t seq, int idx, int total, const void *data,
+                         int len)
+{
+    mpr_chunk_t *c = &link->chunk;
+    int num;
+    RETURN_UNLESS(!link->is_local_only && total > 0 && total <= CHUNK_MAX_LEN);
+    num = (total - 1) / CHUNK_DATA_LEN + 1;
+    RETURN_UNLESS(idx >= 0 && idx < num);
+    /* all chunks except the last are full */
+    RETURN_UNLESS(len == (idx < num - 1 ? CHUNK_DATA_LEN : total - idx * CHUNK_DATA_LEN));
+
+    if (!c->rx_started || seq != c->rx_seq) {
+        int32_t diff = (int32_t)(seq - c->rx_seq);
+        /* ignore late chunks of previous datagrams, unless the sender has restarted */
+        RETURN_UNLESS(!c->rx_started || diff > 0 || diff < -CHUNK_WINDOW);
+        if (c->rx_missing)
+            trace_dev(link->devs[LINK_LOCAL_DEV], "dropping incomplete datagram %u from device "
+                      "'%s'\n", c->rx_seq, mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+        if ((size_t)total > c->rx_size) {
+            c->rx_buf = realloc(c->rx_buf, total);
+            c->rx_size = total;
+        }
+        FUNC_IF(mpr_bitflags_free, c->rx_known);
+        c->rx_known = mpr_bitflags_new(num);
+        c->rx_seq = seq;
+        c->rx_len = total;
+        c->rx_missing = num;
+        c->rx_started = 1;
+    }
+    else if (!c->rx_missing || total != c->rx_len || mpr_bitflags_get(c->rx_known, idx)) {
+        /* repeated chunk */
+        return;
+    }
+    memcpy(c->rx_buf + idx * CHUNK_DATA_LEN, data, len);
+    mpr_bitflags_set(c->rx_known, idx);
+    RETURN_UNLESS(0 == --c->rx_missing);
+    lo_server_dispatch_data(get_udp_server(link), c->rx_buf, c->rx_len);
+}
 
-typedef struct _mpr_bundle {
-    lo_bundle udp;
-    lo_bundle tcp;
-} mpr_bundle_t, *mpr_bundle;
+static lo_message new_rudp_msg(mpr_link link)
+{
+    NEW_LO_MSG(msg, return 0);
+    lo_message_add_int64(msg, mpr_obj_get_id((mpr_obj)link->devs[LINK_LOCAL_DEV]));
+    return msg;
+}
 
-/*! Clock and timing information. */
-typedef struct _mpr_sync_time_t {
-    mpr_time time;
-    int msg_id;
-} mpr_sync_time_t;
+/* Return the sent bundle with a given sequence number if it is still in the window. */
+static mpr_rudp_pkt rudp_get_pkt(mpr_link link, uint32_t seq)
+{
+    mpr_rudp_pkt pkt;
+    RETURN_ARG_UNLESS(link->rudp.win, 0);
+    pkt = &link->rudp.win[seq % RUDP_WINDOW];
+    return (pkt->num_msgs >= 0 && pkt->seq == seq) ? pkt : 0;
+}
 
-typedef struct _mpr_sync_clock_t {
-    double rate;
-    double latency;
-    double jitter;
-    mpr_sync_time_t sent;
-    mpr_sync_time_t rcvd;
-    double weight;
-    int8_t slope;
-} mpr_sync_clock_t, *mpr_sync_clock;
+/* Find the entry of a message key in the key table, or the empty entry where it belongs. */
+static mpr_rudp_key_t *rudp_find_key(mpr_rudp_t *r, uint32_t key)
+{
+    uint32_t mask = r->size_keys - 1, i = key & mask;
+    while (r->keys[i].used && r->keys[i].key != key)
+        i = (i + 1) & mask;
+    return &r->keys[i];
+}
 
-typedef struct _mpr_link {
-    mpr_obj_t obj;                      /* always first for type punning */
-    mpr_dev devs[2];
-    mpr_map *maps;
-    int num_maps;
+/* Record that the bundle `seq` carries a value for a message key. */
+static void rudp_set_key(mpr_rudp_t *r, uint32_t key, uint32_t seq)
+{
+    mpr_rudp_key_t *k;
+    if ((r->num_keys + 1) * 2 > r->size_keys) {
+        /* keep the table at most half full so that probe sequences stay short */
+        mpr_rudp_key_t *old = r->keys;
+        int i, old_size = r->size_keys;
+        r->size_keys = old_size ? old_size * 2 : 64;
+        r->keys = calloc(r->size_keys, sizeof(mpr_rudp_key_t));
+        for (i = 0; i < old_size; i++) {
+            if (old[i].used)
+                *rudp_find_key(r, old[i].key) = old[i];
+        }
+        FUNC_IF(free, old);
+    }
+    k = rudp_find_key(r, key);
+    if (!k->used) {
+        k->used = 1;
+        k->key = key;
+        ++r->num_keys;
+    }
+    k->seq = seq;
+}
 
-    struct {
-        lo_address admin;               /*!< Network address of remote endpoint */
-        struct {
-            lo_address udp;             /*!< Network address of remote endpoint */
-            lo_address tcp;             /*!< Network address of remote endpoint */
-        } data;
-    } addr;
+/* Forget a message key when the bundle `seq` leaves the window, unless a newer bundle carries it.
+ * Entries are removed by shifting the rest of their probe sequence back. */
+static void rudp_remove_key(mpr_rudp_t *r, uint32_t key, uint32_t seq)
+{
+    uint32_t mask = r->size_keys - 1, i, j, home;
+    mpr_rudp_key_t *k = rudp_find_key(r, key);
+    RETURN_UNLESS(k->used && k->seq == seq);
+    i = k - r->keys;
+    for (j = (i + 1) & mask; r->keys[j].used; j = (j + 1) & mask) {
+        home = r->keys[j].key & mask;
+        /* move the entry unless its home lies cyclically between the hole and itself */
+        if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+            r->keys[i] = r->keys[j];
+            i = j;
+        }
+    }
+    r->keys[i].used = 0;
+    --r->num_keys;
+}
 
-    int is_local_only;
-    uint8_t bundle_idx;
+/* Keep the encoded bundle so that it can be retransmitted, leaving room for a sequence number
+ * element at its end. Returns 0 if the bundle could not be encoded. */
+static mpr_rudp_pkt rudp_store_pkt(mpr_link link, uint32_t seq, int cls, lo_bundle lb)
+{
+    mpr_rudp_t *r = &link->rudp;
+    mpr_rudp_pkt pkt;
+    size_t len = lo_bundle_length(lb);
+    int i;
 
-    mpr_bundle_t bundles[NUM_BUNDLES];  /*!< Circular buffer to handle interrupts during poll() */
+    if (!r->win) {
+        r->win = calloc(RUDP_WINDOW, sizeof(mpr_rudp_pkt_t));
+        for (i = 0; i < RUDP_WINDOW; i++)
+            r->win[i].num_msgs = -1;
+    }
+    pkt = &r->win[seq % RUDP_WINDOW];
+    /* the bundle this one replaces leaves the window */
+    for (i = 0; i < pkt->num_msgs; i++) {
+        if (pkt->msgs[i].can_merge)
+            rudp_remove_key(r, pkt->msgs[i].key, pkt->seq);
+    }
+    pkt->num_msgs = -1;
+    if (len + FEC_SEQ_LEN > pkt->size) {
+        pkt->size = len + FEC_SEQ_LEN;
+        pkt->buf = realloc(pkt->buf, pkt->size);
+    }
+    RETURN_ARG_UNLESS(lo_bundle_serialise(lb, pkt->buf, &len), 0);
+    pkt->seq = seq;
+    pkt->cls = cls;
+    pkt->len = len;
+    pkt_index_msgs(pkt, 16, len);
+    for (i = 0; i < pkt->num_msgs; i++) {
+        if (pkt->msgs[i].can_merge)
+            rudp_set_key(r, pkt->msgs[i].key, seq);
+    }
+    return pkt;
+}
 
-    mpr_sync_clock_t clock;
-} mpr_link_t;
+/* Check whether a message has been superseded by a newer value sent for the same slot and
+ * instances. Newer bundles either arrived or will be retransmitted themselves, so the old value
+ * is not needed. Values for other instances of the signal are always retransmitted. */
+static int rudp_get_is_superseded(mpr_link link, uint32_t seq, mpr_rudp_msg_t *msg)
+{
+    mpr_rudp_key_t *k;
+    RETURN_ARG_UNLESS(msg->can_merge && link->rudp.keys, 0);
+    k = rudp_find_key(&link->rudp, msg->key);
+    return k->used && (int32_t)(k->seq - seq) > 0;
+}
 
-size_t mpr_link_get_struct_size(void)
+/* The retransmit timeout is a few round trips, estimated from the latency measured by the clock
+ * sync. */
+static double rudp_get_rto(mpr_link link)
 {
-    return sizeof(mpr_link_t);
+    double rto = link->clock.latency * 2 * RUDP_RTO_RTTS;
+    return rto < RUDP_MIN_RTO ? RUDP_MIN_RTO : rto > RUDP_MAX_RTO ? RUDP_MAX_RTO : rto;
 }
 
-mpr_link mpr_link_new(mpr_local_dev local_dev, mpr_dev remote_dev)
+/* Arm or disarm one of the retransmit timers. Links with an armed timer are visited by the
+ * network poll loop. */
+static void rudp_set_timer(mpr_link link, mpr_time *timer, int armed)
 {
-    int is_local = (   mpr_obj_get_is_local((mpr_obj)local_dev)
-                    || mpr_obj_get_is_local((mpr_obj)remote_dev));
-    return mpr_graph_add_link(mpr_obj_get_graph((mpr_obj)local_dev), (mpr_dev)local_dev,
-                              remote_dev, is_local);
+    mpr_rudp_t *r = &link->rudp;
+    if (armed) {
+        mpr_time_set(timer, MPR_NOW);
+        mpr_time_add_dbl(timer, rudp_get_rto(link));
+    }
+    else
+        *timer = MPR_TIME_0;
+    set_in_net_list(link, NET_LINKS_RUDP, r->tx_probe.sec || r->rx_nack.sec);
 }
 
-int mpr_link_get_is_ready(mpr_link link)
+/* Send an encoded datagram, split into chunks if it is too large. Returns 0 if it should be sent
+ * using liblo instead. */
+static int rudp_send_dgram(mpr_link link, lo_server server, int cls, const char *data, size_t len)
 {
-    return link && link->addr.data.udp;
+    return send_chunks(link, server, cls, data, len) || send_raw_dgram(link, server, cls, data, len);
 }
 
-lo_address mpr_link_get_admin_addr(mpr_link link)
+static void rudp_retransmit(mpr_link link, uint32_t seq)
 {
-    return link->addr.admin;
+    mpr_rudp_pkt pkt = rudp_get_pkt(link, seq);
+    mpr_id id = mpr_obj_get_id((mpr_obj)link->devs[LINK_LOCAL_DEV]);
+    size_t pos;
+    int i;
+    RETURN_UNLESS(pkt);
+
+    if (pkt->len + FEC_SEQ_LEN > link->chunk.size) {
+        link->chunk.size = pkt->len + FEC_SEQ_LEN;
+        link->chunk.buf = realloc(link->chunk.buf, link->chunk.size);
+    }
+    /* the bundle header and timetag are kept */
+    memcpy(link->chunk.buf, pkt->buf, 16);
+    pos = 16;
+    for (i = 0; i < pkt->num_msgs; i++) {
+        mpr_rudp_msg_t *m = &pkt->msgs[i];
+        if (rudp_get_is_superseded(link, seq, m))
+            continue;
+        memcpy(link->chunk.buf + pos, pkt->buf + m->offset, m->len);
+        pos += m->len;
+    }
+    /* always answer so that the receiver stops requesting this bundle */
+    put_seq_elem(link->chunk.buf + pos, MPR_RUDP_RTX, id, seq);
+    pos += FEC_SEQ_LEN;
+    /* retransmits are lost like any other datagram if they cannot be sent */
+    rudp_send_dgram(link, get_udp_server(link), pkt->cls, link->chunk.buf, pos);
 }
 
-void mpr_link_init(mpr_link link, mpr_graph g, mpr_dev dev1, mpr_dev dev2)
+/* Send a bundle over reliable UDP, tagging it with the next sequence number. The bundle encoded
+ * for the window is sent as is if possible. */
+static void rudp_send_bundle(mpr_link link, lo_server server, int cls, lo_bundle lb)
 {
-    mpr_net net = mpr_graph_get_net(g);
+    uint32_t seq = link->rudp.tx_seq++;
+    mpr_id id = mpr_obj_get_id((mpr_obj)link->devs[LINK_LOCAL_DEV]);
+    mpr_rudp_pkt pkt = rudp_store_pkt(link, seq, cls, lb);
     lo_message msg;
-    char cmd[256];
 
-    link->devs[LINK_LOCAL_DEV] = dev1;
-    link->devs[LINK_REMOTE_DEV] = dev2;
-    link->obj.is_local = mpr_obj_get_is_local((mpr_obj)dev1) || mpr_obj_get_is_local((mpr_obj)dev2);
-    link->is_local_only = mpr_obj_get_is_local((mpr_obj)dev1) && mpr_obj_get_is_local((mpr_obj)dev2);
+    /* a lost bundle is only noticed by the receiver once a later one arrives, so the last one
+     * is announced if nothing else is sent within the retransmit timeout */
+    rudp_set_timer(link, &link->rudp.tx_probe, 1);
 
-    if (!link->obj.props.synced) {
-        mpr_tbl t = link->obj.props.synced = mpr_tbl_new();
-        mpr_tbl_add_record(t, MPR_PROP_DEV, NULL, 2, MPR_DEV, &link->devs,
-                           MPR_TBL_MOD_NONE | MPR_TBL_ACC_LOC);
-        mpr_tbl_add_record(t, MPR_PROP_ID, NULL, 1, MPR_INT64, &link->obj.id, MPR_TBL_MOD_NONE);
-        mpr_tbl_add_record(t, MPR_PROP_NUM_MAPS, NULL, 1, MPR_INT32, &link->num_maps,
-                           MPR_TBL_MOD_NONE | MPR_TBL_INDIRECT);
+    if (pkt) {
+        put_seq_elem(pkt->buf + pkt->len, MPR_RUDP_SEQ, id, seq);
+        if (rudp_send_dgram(link, server, cls, pkt->buf, pkt->len + FEC_SEQ_LEN))
+            return;
     }
-    if (!link->obj.props.staged)
-        link->obj.props.staged = mpr_tbl_new();
-
-    if (!link->obj.id && mpr_obj_get_is_local((mpr_obj)link->devs[LINK_LOCAL_DEV]))
-        link->obj.id = mpr_dev_generate_unique_id(link->devs[LINK_LOCAL_DEV]);
+    if ((msg = new_rudp_msg(link))) {
+        lo_message_add_int32(msg, (int32_t)seq);
+        lo_bundle_add_message(lb, MPR_RUDP_SEQ, msg);
+    }
+    send_udp_bundle(link, server, cls, lb);
+}
 
-    if (link->is_local_only) {
-        mpr_link_connect(link, 0, 0, 0);
-        return;
+/* Request the bundles that are still missing. */
+static void rudp_send_nack(mpr_link link)
+{
+    mpr_rudp_t *r = &link->rudp;
+    lo_message msg;
+    int i, j;
+    if (r->num_gaps && (msg = new_rudp_msg(link))) {
+        for (i = 0, j = 0; i < r->num_gaps; i++) {
+            lo_message_add_int32(msg, (int32_t)r->gaps[i].seq);
+            /* give up on bundles that have been requested too often */
+            if (++r->gaps[i].tries < RUDP_MAX_TRIES)
+                r->gaps[j++] = r->gaps[i];
+        }
+        r->num_gaps = j;
+        lo_send_message_from(link->addr.data.udp, get_udp_server(link), MPR_RUDP_NACK, msg);
+        lo_message_free(msg);
     }
-    else {
-        mpr_time t;
-        link->clock.weight = 1.0;
-        link->clock.rate = 1;
-        link->clock.latency = 0;
-        link->clock.jitter = 0;
-        link->clock.sent.msg_id = 0;
-        link->clock.rcvd.msg_id = -1;
-        mpr_time_set(&t, MPR_NOW);
-        mpr_time_add_dbl(&t, mpr_dev_get_offset(link->devs[LINK_LOCAL_DEV]));
-        link->clock.rcvd.time.sec = t.sec + 10;
+    /* ask again if the request or the retransmission is lost */
+    rudp_set_timer(link, &r->rx_nack, r->num_gaps > 0);
+}
+
+static void rudp_remove_gap(mpr_link link, uint32_t seq)
+{
+    mpr_rudp_t *r = &link->rudp;
+    int i;
+    for (i = 0; i < r->num_gaps; i++) {
+        if (r->gaps[i].seq == seq) {
+            memmove(r->gaps + i, r->gaps + i + 1, (--r->num_gaps - i) * sizeof(mpr_rudp_gap_t));
+            if (!r->num_gaps)
+                rudp_set_timer(link, &r->rx_nack, 0);
+            return;
+        }
     }
-    /* request missing metadata */
-    snprintf(cmd, 256, "/%s/subscribe", mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+}
 
-    msg = lo_message_new();
-    if (!msg) {
-        trace("couldn't allocate lo_message\n");
+/* Record a received sequence number, or the last one sent if `is_last` is set. */
+static void rudp_recv_seq(mpr_link link, uint32_t seq, int is_last)
+{
+    mpr_rudp_t *r = &link->rudp;
+    uint32_t end = is_last ? seq + 1 : seq, i;
+    int32_t count;
+
+    if (!r->rx_started) {
+        r->rx_started = 1;
+        r->rx_seq = seq + 1;
+        return;
+    }
+    if ((int32_t)(seq - r->rx_seq) < 0) {
+        /* late or duplicate bundle */
+        if (!is_last)
+            rudp_remove_gap(link, seq);
         return;
     }
+    /* only bundles still held in the sender's window can be recovered */
+    count = (int32_t)(end - r->rx_seq);
+    for (i = count > RUDP_WINDOW ? end - RUDP_WINDOW : r->rx_seq; i != end; i++) {
+        if (r->num_gaps >= RUDP_WINDOW)
+            memmove(r->gaps, r->gaps + 1, (--r->num_gaps) * sizeof(mpr_rudp_gap_t));
+        r->gaps[r->num_gaps].seq = i;
+        r->gaps[r->num_gaps].tries = 0;
+        ++r->num_gaps;
+    }
+    r->rx_seq = seq + 1;
+    if (count)
+        rudp_send_nack(link);
+}
 
-    lo_message_add_string(msg, "device");
-    mpr_net_use_bus(net);
-    mpr_net_add_msg(net, cmd, 0, msg);
-    mpr_net_send(net);
+void mpr_link_recv_rudp(mpr_link link, const char *path, int num, lo_arg **seqs)
+{
+    int i;
+    RETURN_UNLESS(!link->is_local_only && link->addr.data.udp);
+    if (0 == strcmp(path, MPR_RUDP_SEQ)) {
+        if (num)
+            rudp_recv_seq(link, (uint32_t)seqs[0]->i32, 0);
+    }
+    else if (0 == strcmp(path, MPR_RUDP_LAST)) {
+        if (num)
+            rudp_recv_seq(link, (uint32_t)seqs[0]->i32, 1);
+    }
+    else if (0 == strcmp(path, MPR_RUDP_NACK)) {
+        for (i = 0; i < num; i++)
+            rudp_retransmit(link, (uint32_t)seqs[i]->i32);
+    }
+    else if (0 == strcmp(path, MPR_RUDP_RTX)) {
+        for (i = 0; i < num; i++)
+            rudp_remove_gap(link, (uint32_t)seqs[i]->i32);
+    }
 }
 
-void mpr_link_connect(mpr_link link, const char *host, int admin_port, int data_port)
+/* Announce the last sequence number sent if it has not been announced yet. */
+static void rudp_send_last(mpr_link link)
 {
-    if (!link->is_local_only) {
-        char str[16];
-        mpr_tbl tbl = mpr_obj_get_prop_tbl((mpr_obj)link->devs[LINK_REMOTE_DEV]);
-        mpr_tbl_add_record(tbl, MPR_PROP_PORT, NULL, 1, MPR_INT32, &data_port, MPR_TBL_MOD_REM);
-        sprintf(str, "%d", data_port);
-        link->addr.data.udp = lo_address_new(host, str);
-        link->addr.data.tcp = lo_address_new_with_proto(LO_TCP, host, str);
-        lo_address_set_tcp_nodelay(link->addr.data.tcp, 1);
-        sprintf(str, "%d", admin_port);
-        link->addr.admin = lo_address_new(host, str);
-        trace_dev(link->devs[LINK_LOCAL_DEV], "activated link to device '%s' at %s:%d\n",
-                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]), host, data_port);
+    mpr_rudp_t *r = &link->rudp;
+    lo_message msg;
+    if (r->win && r->tx_last != r->tx_seq && (msg = new_rudp_msg(link))) {
+        lo_message_add_int32(msg, (int32_t)(r->tx_seq - 1));
+        lo_send_message_from(link->addr.data.udp, get_udp_server(link), MPR_RUDP_LAST, msg);
+        lo_message_free(msg);
+        r->tx_last = r->tx_seq;
     }
-    else {
-        trace_dev(link->devs[LINK_LOCAL_DEV], "activating link to local device '%s'\n",
-                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]));
+}
+
+int mpr_link_check_rudp(mpr_link link)
+{
+    mpr_rudp_t *r = &link->rudp;
+    double wait = -1;
+    mpr_time now;
+    mpr_time_set(&now, MPR_NOW);
+
+    if (r->tx_probe.sec && mpr_time_get_diff(r->tx_probe, now) <= 0) {
+        rudp_set_timer(link, &r->tx_probe, 0);
+        rudp_send_last(link);
     }
-    memset(link->bundles, 0, sizeof(mpr_bundle_t) * NUM_BUNDLES);
-    mpr_dev_add_link(link->devs[LINK_LOCAL_DEV], link->devs[LINK_REMOTE_DEV]);
+    if (r->rx_nack.sec && mpr_time_get_diff(r->rx_nack, now) <= 0)
+        rudp_send_nack(link);
+
+    if (r->tx_probe.sec)
+        wait = mpr_time_get_diff(r->tx_probe, now);
+    if (r->rx_nack.sec && (wait < 0 || mpr_time_get_diff(r->rx_nack, now) < wait))
+        wait = mpr_time_get_diff(r->rx_nack, now);
+    return wait < 0 ? -1 : (int)ceil(wait * 1000.);
+}
 
-    {
-        mpr_time now;
-        mpr_time_set(&now, MPR_NOW);
-        mpr_link_housekeeping(link, now);
+/* Announce the last sequence number sent and request any bundles still missing. The retransmit
+ * timers do this sooner; this covers links whose timers were disarmed after a lost probe. */
+static void rudp_housekeeping(mpr_link link)
+{
+    rudp_send_last(link);
+    rudp_send_nack(link);
+}
+
+/* Read the pacing budget from the outgoing UDP maps of the link. Maps ask for pacing with the
+ * properties "pacing_rate" (the maximum number of bundles per second) and "pacing_latency" (the
+ * maximum number of seconds an update may be held, by default one period). All of the maps share
+ * the link bundle, so the link is only paced if every map asks for it, using the highest rate and
+ * the lowest latency among them. */
+static void pacing_update(mpr_link link, mpr_time t)
+{
+    mpr_pacing_t *p = &link->pacing;
+    double interval = 0, latency = 0;
+    int i, num_udp = 0;
+    RETURN_UNLESS(!p->checked.sec || mpr_time_get_diff(t, p->checked) >= PACING_CHECK_SEC);
+    p->checked = t;
+
+    for (i = 0; i < link->num_maps; i++) {
+        mpr_obj map = (mpr_obj)link->maps[i];
+        double rate, lat;
+        if (MPR_PROTO_UDP != mpr_map_get_protocol(link->maps[i]))
+            continue;
+        ++num_udp;
+        rate = mpr_obj_get_prop_as_dbl(map, MPR_PROP_EXTRA, "pacing_rate");
+        if (rate <= 0)
+            break;
+        if (!interval || 1. / rate < interval)
+            interval = 1. / rate;
+        lat = mpr_obj_get_prop_as_dbl(map, MPR_PROP_EXTRA, "pacing_latency");
+        if (lat <= 0)
+            lat = 1. / rate;
+        if (!latency || lat < latency)
+            latency = lat;
     }
+    if (i < link->num_maps || !num_udp)
+        interval = 0;
+#ifdef HAVE_SHM_OPEN
+    /* shared memory is not subject to the constraints of the network */
+    if (link->shm.out)
+        interval = 0;
+#endif
+    if (interval != p->interval)
+        trace_dev(link->devs[LINK_LOCAL_DEV], "pacing link to '%s' at %g Hz\n",
+                  mpr_dev_get_name(link->devs[LINK_REMOTE_DEV]), interval ? 1. / interval : 0);
+    p->interval = interval;
+    p->latency = latency;
 }
 
-void mpr_link_free(mpr_link link)
+static mpr_pacing_key_t *pacing_find_key(mpr_pacing_t *p, uint32_t key)
 {
-    int i;
-    mpr_obj_free(&link->obj);
-    FUNC_IF(lo_address_free, link->addr.admin);
-    FUNC_IF(lo_address_free, link->addr.data.udp);
-    FUNC_IF(lo_address_free, link->addr.data.tcp);
-    for (i = 0; i < NUM_BUNDLES; i++) {
-        FUNC_IF(lo_bundle_free_recursive, link->bundles[i].udp);
-        FUNC_IF(lo_bundle_free_recursive, link->bundles[i].tcp);
+    uint32_t mask = p->size_keys - 1, i = key & mask;
+    while (p->keys[i].used && p->keys[i].key != key)
+        i = (i + 1) & mask;
+    return &p->keys[i];
+}
+
+/* Record that the held message `idx` carries the latest value for a message key. */
+static void pacing_set_key(mpr_pacing_t *p, uint32_t key, int idx)
+{
+    mpr_pacing_key_t *k;
+    if ((p->num_keys + 1) * 2 > p->size_keys) {
+        /* keep the table at most half full so that probe sequences stay short */
+        mpr_pacing_key_t *old = p->keys;
+        int i, old_size = p->size_keys;
+        p->size_keys = old_size ? old_size * 2 : 64;
+        p->keys = calloc(p->size_keys, sizeof(mpr_pacing_key_t));
+        for (i = 0; i < old_size; i++) {
+            if (old[i].used)
+                *pacing_find_key(p, old[i].key) = old[i];
+        }
+        FUNC_IF(free, old);
     }
-    mpr_dev_remove_link(link->devs[LINK_LOCAL_DEV], link->devs[LINK_REMOTE_DEV]);
-    FUNC_IF(free, link->maps);
+    k = pacing_find_key(p, key);
+    if (!k->used) {
+        k->used = 1;
+        k->key = key;
+        ++p->num_keys;
+    }
+    k->idx = idx;
 }
 
-/* note on memory handling of mpr_link_add_msg(): messages are owned by slot */
-void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time t, mpr_proto proto)
+static void pacing_clear_keys(mpr_pacing_t *p)
 {
-    lo_bundle *b;
-    uint8_t bundle_idx = link->bundle_idx;
-    RETURN_UNLESS(msg);
+    if (p->num_keys)
+        memset(p->keys, 0, p->size_keys * sizeof(mpr_pacing_key_t));
+    p->num_keys = 0;
+}
 
-    /* add offset to timetag */
-    /* retrieve clock offset for remote device */
-    double offset = mpr_dev_get_offset(link->devs[LINK_REMOTE_DEV]);
-    if (link->is_local_only) {
-        offset -= mpr_dev_get_offset(link->devs[LINK_LOCAL_DEV]);
-        if (MPR_PROTO_UDP == proto) {
-            offset *= -1;
+/* Move the live messages to the start of the buffer, dropping the superseded ones. The key table
+ * is rebuilt if `index` is set. */
+static void pacing_compact(mpr_pacing_t *p, int index)
+{
+    int i, num = 0;
+    uint32_t pos = 16;
+    pacing_clear_keys(p);
+    for (i = 0; i < p->num_msgs; i++) {
+        mpr_rudp_msg_t *m = &p->msgs[i];
+        if (!m->len)
+            continue;
+        if (m->offset != pos)
+            memmove(p->buf + pos, p->buf + m->offset, m->len);
+        m->offset = pos;
+        pos += m->len;
+        if (index && m->can_merge)
+            pacing_set_key(p, m->key, num);
+        p->msgs[num++] = *m;
+    }
+    p->num_msgs = num;
+    p->end = p->len = pos;
+}
+
+/* Send the held messages that have not been superseded as a single bundle. */
+static void pacing_send(mpr_link link, mpr_time now)
+{
+    mpr_pacing_t *p = &link->pacing;
+    lo_server server = get_udp_server(link);
+    int i, num;
+
+    pacing_compact(p, 0);
+    num = p->num_msgs;
+    if (num && !send_dgram(link, server, p->cls, p->buf, p->len)) {
+        /* raw datagrams are not available, so send the messages using liblo */
+        uint32_t u;
+        mpr_time t;
+        lo_bundle lb;
+        memcpy(&u, p->buf + 8, 4);
+        t.sec = lo_otoh32(u);
+        memcpy(&u, p->buf + 12, 4);
+        t.frac = lo_otoh32(u);
+        if ((lb = lo_bundle_new(t))) {
+            for (i = 0; i < num; i++) {
+                char *msg_buf = p->buf + p->msgs[i].offset + 4;
+                lo_message msg = lo_message_deserialise(msg_buf, p->msgs[i].len - 4, NULL);
+                if (msg)
+                    lo_bundle_add_message(lb, msg_buf, msg);
+            }
+            lo_send_bundle_from(link->addr.data.udp, server, lb);
+            lo_bundle_free_recursive(lb);
         }
     }
+    p->len = p->end = 16;
+    p->num_msgs = 0;
+    pacing_clear_keys(p);
+    p->sent = now;
+    set_in_net_list(link, NET_LINKS_PACED, 0);
+}
 
-    /* TODO: consider adding jitter compensation here */
-    /* offset += link->clock.jitter; */
+/* Move the messages encoded in a bundle into the held bundle, dropping any held messages for the
+ * same slot and instances since only the latest values need to be sent. The held bundle is
+ * marked with the highest class of its messages. */
+static void pacing_hold(mpr_link link, mpr_bundle mb, int cls, mpr_time now)
+{
+    mpr_pacing_t *p = &link->pacing;
+    size_t off = 16;
 
-    mpr_time_add_dbl(&t, offset);
+    if (!p->buf) {
+        p->size = mb->osc.size > 1024 ? mb->osc.size : 1024;
+        p->buf = malloc(p->size);
+        p->len = p->end = 16;
+    }
+    /* the held bundle takes the timetag of the latest bundle */
+    memcpy(p->buf, mb->osc.buf, 16);
+    while (off + 4 <= mb->osc.len) {
+        const char *path, *types, *data;
+        uint32_t u, key;
+        int can_merge;
+
+        memcpy(&u, mb->osc.buf + off, 4);
+        u = lo_otoh32(u) + 4;
+        path = mb->osc.buf + off + 4;
+        types = path + ((strlen(path) + 4) & ~3);
+        data = types + ((strlen(types) + 4) & ~3);
+        if ((can_merge = get_osc_key(path, types, data, &key)) && p->num_keys) {
+            mpr_pacing_key_t *k = pacing_find_key(p, key);
+            if (k->used) {
+                /* the superseded message is not sent */
+                p->len -= p->msgs[k->idx].len;
+                p->msgs[k->idx].len = 0;
+            }
+        }
+
+        if (p->len + u > OSC_BUNDLE_LIMIT)
+            pacing_send(link, now);
+        if (!p->num_msgs) {
+            p->first = now;
+            p->cls = cls;
+        }
+        else if (cls > p->cls)
+            p->cls = cls;
+        if (p->end + u > p->size) {
+            /* reuse the space of superseded messages before growing the buffer */
+            if (p->len < p->end)
+                pacing_compact(p, 1);
+            if (p->end + u > p->size) {
+                p->size = (p->end + u) * 2;
+                p->buf = realloc(p->buf, p->size);
+            }
+        }
+        if (p->num_msgs >= p->size_msgs) {
+            p->size_msgs = p->size_msgs ? p->size_msgs * 2 : 16;
+            p->msgs = realloc(p->msgs, p->size_msgs * sizeof(mpr_rudp_msg_t));
+        }
+        memcpy(p->buf + p->end, mb->osc.buf + off, u);
+        p->msgs[p->num_msgs].offset = p->end;
+        p->msgs[p->num_msgs].len = u;
+        p->msgs[p->num_msgs].key = key;
+        p->msgs[p->num_msgs].can_merge = can_merge;
+        if (can_merge)
+            pacing_set_key(p, key, p->num_msgs);
+        ++p->num_msgs;
+        p->len += u;
+        p->end += u;
+        off += u;
+    }
+    mb->osc.len = 0;
+    mb->osc.num_msgs = 0;
+    set_in_net_list(link, NET_LINKS_PACED, p->num_msgs > 0);
+}
 
-    /* add message to existing bundles */
-    b = (proto == MPR_PROTO_UDP) ? &link->bundles[bundle_idx].udp : &link->bundles[bundle_idx].tcp;
-    if (!(*b))
-        *b = lo_bundle_new(t);
-    else if (!lo_bundle_count(*b))
-        lo_bundle_set_timestamp(*b, t);
-    lo_bundle_add_message(*b, path, msg);
+/* Hold a bundle built using liblo with the messages encoded in place, so that its values are
+ * merged with and sent after the held values they supersede. */
+static void pacing_hold_bundle(mpr_link link, mpr_bundle mb, int cls, lo_bundle lb, mpr_time now)
+{
+    size_t len = lo_bundle_length(lb);
+    if (len > mb->osc.size) {
+        mb->osc.size = len;
+        mb->osc.buf = realloc(mb->osc.buf, mb->osc.size);
+    }
+    RETURN_UNLESS(lo_bundle_serialise(lb, mb->osc.buf, &len));
+    mb->osc.len = len;
+    pacing_hold(link, mb, cls, now);
 }
 
-/* TODO: interrupt driven signal updates may not be followed by mpr_dev_process_outputs(); in the
- * case where the interrupt has interrupted mpr_dev_poll() these messages will not be dispatched. */
-int mpr_link_process_bundles(mpr_link link, mpr_time t)
+int mpr_link_flush_paced(mpr_link link)
+{
+    mpr_pacing_t *p = &link->pacing;
+    mpr_time now;
+    double wait = 0;
+    RETURN_ARG_UNLESS(p->num_msgs, -1);
+    mpr_time_set(&now, MPR_NOW);
+    if (p->interval > 0) {
+        double latency = p->latency - mpr_time_get_diff(now, p->first);
+        wait = p->interval - mpr_time_get_diff(now, p->sent);
+        if (latency < wait)
+            wait = latency;
+    }
+    if (wait > 0)
+        return (int)ceil(wait * 1000.);
+    pacing_send(link, now);
+    return -1;
+}
+
+/* Send the bundles of one priority class. Returns the number of bundles passed through shared
+ * memory. */
+static int send_bundles(mpr_link link, int cls)
 {
-    int num_msg = 0;
     mpr_net net = mpr_graph_get_net(link->obj.graph);
-    uint8_t idx = link->bundle_idx;
-    mpr_bundle mb = &link->bundles[idx];
+    mpr_bundle mb = &link->bundles[cls];
+    mpr_local_dev ldev = (mpr_local_dev)link->devs[LINK_LOCAL_DEV];
+    lo_server server = mpr_net_get_dev_server(net, ldev, SERVER_DATA_UDP);
     lo_bundle lb;
+    int num_shm = 0, is_paced;
+    mpr_time now;
 
-    /* increment index for circular buffer of lo_bundles */
-    link->bundle_idx = (link->bundle_idx + 1) % NUM_BUNDLES;
+    /* high priority messages are never held */
+    is_paced = PRIORITY_HIGH != cls && (link->pacing.interval > 0 || link->pacing.num_msgs);
+    if (is_paced)
+        mpr_time_set(&now, MPR_NOW);
 
-    if (!link->is_local_only) {
-        mpr_local_dev ldev = (mpr_local_dev)link->devs[LINK_LOCAL_DEV];
-        if ((lb = mb->udp)) {
-            if ((num_msg = lo_bundle_count(lb))) {
-                lo_send_bundle_from(link->addr.data.udp, mpr_net_get_dev_server(net, ldev, SERVER_DATA_UDP), lb);
-            }
-            lo_bundle_clear(lb);
+    /* bundles for a remote device on the same host are passed through shared memory if
+     * possible; the ring is ordered and bundles are held while it is full, so it can carry
+     * both UDP and TCP maps */
+    if (mb->osc.len) {
+        /* bundle was encoded in place while draining the queue */
+        if (is_paced)
+            pacing_hold(link, mb, cls, now);
+        else {
+            send_dgram(link, server, cls, mb->osc.buf, mb->osc.len);
+            mb->osc.len = 0;
+            mb->osc.num_msgs = 0;
         }
-        if ((lb = mb->tcp)) {
-            int count;
-            if ((count = lo_bundle_count(lb))) {
-                num_msg += count;
-                lo_send_bundle_from(link->addr.data.tcp, mpr_net_get_dev_server(net, ldev, SERVER_DATA_TCP), lb);
+    }
+    if ((lb = mb->udp)) {
+        if (lo_bundle_count(lb)) {
+#ifdef HAVE_SHM_OPEN
+            if (shm_send_bundle(link, lb))
+                ++num_shm;
+            else
+#endif
+            if (is_paced) {
+                /* held values for the same slots must not be sent after these ones */
+                pacing_hold_bundle(link, mb, cls, lb, now);
             }
-            lo_bundle_clear(lb);
+            else if (!link->fec.depth || !send_fec_bundle(link, server, cls, lb))
+                send_udp_bundle(link, server, cls, lb);
         }
+        lo_bundle_clear(lb);
     }
-    else {
-        mpr_net net = mpr_graph_get_net(link->obj.graph);
-        lo_bundle *lbs = (lo_bundle*)mb;
-        int i;
-        for (i = 0; i < 2; i++) {
-            if ((lb = lbs[i])) {
-                const char *path;
-                int j = 0, count;
-
-                /* set out-of-band timestamp */
-                mpr_net_set_bundle_time(net, lo_bundle_get_timestamp(lb));
-                /* call handler directly instead of sending over the network */
-                count = lo_bundle_count(lb);
-                while (j < count) {
-                    /* Find the local signal matching the message path in the destination device. */
-                    lo_message m = lo_bundle_get_message(lb, j, &path);
-                    mpr_sig dst = mpr_dev_get_sig_by_name(link->devs[i], path + 1);
-                    if (dst)
-                        mpr_sig_osc_handler(NULL, lo_message_get_types(m), lo_message_get_argv(m),
-                                            lo_message_get_argc(m), m, dst);
-                    ++j;
-                }
-                lo_bundle_clear(lb);
-                num_msg += count;
-            }
+    if (is_paced)
+        mpr_link_flush_paced(link);
+    if ((lb = mb->rudp)) {
+        if (lo_bundle_count(lb)) {
+#ifdef HAVE_SHM_OPEN
+            if (shm_send_bundle(link, lb))
+                ++num_shm;
+            else
+#endif
+            rudp_send_bundle(link, server, cls, lb);
+        }
+        lo_bundle_clear(lb);
+    }
+    if ((lb = mb->tcp)) {
+        if (lo_bundle_count(lb)) {
+#ifdef HAVE_SHM_OPEN
+            if (shm_send_bundle(link, lb))
+                ++num_shm;
+            else
+#endif
+#ifdef HAVE_TCP_QUEUE
+            /* a slow receiver must not block the polling thread */
+            if (tcp_queue_add(link, lb))
+                mpr_link_flush_tcp(link);
+            else
+#endif
+            lo_send_bundle_from(link->addr.data.tcp, mpr_net_get_dev_server(net, ldev, SERVER_DATA_TCP), lb);
         }
+        lo_bundle_clear(lb);
     }
+    return num_shm;
+}
+
+/* Messages may be added to the queue by an interrupt while it is being drained; those are sent
+ * the next time the device processes its outputs. The
+ * bundles of each priority class are sent from high to low so that control data does not wait
+ * behind bulk data in the socket buffers. */
+int mpr_link_process_bundles(mpr_link link, mpr_time t)
+{
+    int i, num_msg, num_shm = 0;
+    mpr_net net = mpr_graph_get_net(link->obj.graph);
+
+    priority_update(link, t);
+    num_msg = out_drain(link, net);
+    RETURN_ARG_UNLESS(!link->is_local_only, num_msg);
+
+    fec_update(link, t);
+    for (i = PRIORITY_HIGH; i >= PRIORITY_LOW; i--)
+        num_shm += send_bundles(link, i);
+    pacing_update(link, t);
+#ifdef HAVE_SHM_OPEN
+    if (num_shm)
+        shm_wake_consumer(link, get_udp_server(link));
+#endif
+    priority_report(link);
     return num_msg;
 }
 
@@ -353,6 +2876,8 @@ void mpr_link_add_map(mpr_link link, mpr_map map)
     link->maps = realloc(link->maps, link->num_maps * sizeof(mpr_map));
     link->maps[link->num_maps - 1] = map;
 
+    /* read the priority class of the new map before the next update is sent */
+    link->prio.checked.sec = 0;
     if (link->is_local_only)
         link->clock.rcvd.time.sec = 0;
     else {
@@ -376,6 +2901,24 @@ void mpr_link_remove_map(mpr_link link, mpr_map map)
         link->maps[i] = link->maps[i + 1];
     --link->num_maps;
     link->maps = realloc(link->maps, link->num_maps * sizeof(mpr_map));
+    link->prio.checked.sec = 0;
+
+    if (link->is_local_only) {
+        /* the map signals may be about to be freed: drop any messages still queued for them */
+        mpr_out_queue_t *q = &link->out;
+        mpr_out_msg_t m;
+        uint32_t idx = q->tail, end = mpr_atomic_get(&q->head), size;
+        while ((size = out_peek(q, idx, end, &m))) {
+            int forget = m.sig && m.sig == mpr_map_get_dst_sig(map);
+            for (i = 0; m.sig && !forget && i < mpr_map_get_num_src(map); i++)
+                forget = m.sig == mpr_map_get_src_sig(map, i);
+            if (forget) {
+                m.sig = 0;
+                out_copy(q, idx + sizeof(uint32_t), &m, sizeof(mpr_out_msg_t), 1);
+            }
+            idx += size;
+        }
+    }
 
     if (link->is_local_only && !link->num_maps) {
         mpr_time_set(&link->clock.rcvd.time, MPR_NOW);
@@ -447,6 +2990,11 @@ void mpr_link_update_clock(mpr_link link, mpr_time time_remote, mpr_time time_lo
         mpr_dev_set_offset(link->devs[LINK_REMOTE_DEV], offset, 1.0);
     }
 
+#ifdef HAVE_SHM_OPEN
+    /* the remote device may have created its incoming ring since we last checked */
+    shm_maybe_open_out(link);
+#endif
+
     /* When link is new we will exchange extra to establish clock offsets */
     if (sent_id < 8) {
         send_ping(link);
@@ -502,6 +3050,8 @@ void mpr_link_housekeeping(mpr_link link, mpr_time now)
      * links are removed after the ping timeout. */
     if (!link->is_local_only && link->num_maps) {
         send_ping(link);
+        if (link->addr.data.udp)
+            rudp_housekeeping(link);
     }
 }
 
@@ -11,6 +11,25 @@ typedef struct _mpr_link *mpr_link;
 
 #define MPR_LINK 0x20
 
+/* Control messages used by reliable UDP maps. Each bundle carries its sequence number in a
+ * "/@seq" message; the receiver requests missing bundles with "/@nack", and retransmitted bundles
+ * list the sequence numbers they replace in a "/@rtx" message. "/@last" announces the last
+ * sequence number sent so that lost trailing bundles are also detected. */
+#define MPR_RUDP_SEQ    "/@seq"
+#define MPR_RUDP_LAST   "/@last"
+#define MPR_RUDP_NACK   "/@nack"
+#define MPR_RUDP_RTX    "/@rtx"
+
+/* Bundles sent with forward error correction start each group of messages with a "/@fec"
+ * message holding the id of the sending device and the sequence number of the bundle the
+ * messages were first sent in. */
+#define MPR_FEC_SEQ     "/@fec"
+
+/* UDP datagrams larger than the path MTU are split into "/@chk" messages holding the id of the
+ * sending device, the sequence number of the datagram, the index of the chunk, the length of the
+ * whole datagram and a blob with the data of the chunk. */
+#define MPR_CHUNK       "/@chk"
+
 /* TODO: replace this with something better */
 #define LINK_LOCAL_DEV   0
 #define LINK_REMOTE_DEV  1
@@ -38,12 +57,112 @@ void mpr_link_connect(mpr_link link, const char *host, int admin_port, int data_
 
 void mpr_link_free(mpr_link link);
 
+/*! Send the messages queued for a link, in order of the priority classes of their maps. Must be
+ *  called from the thread polling the device.
+ *  \param link         The link to process.
+ *  \param t            The current device time.
+ *  \return             The number of messages dispatched. */
 int mpr_link_process_bundles(mpr_link link, mpr_time t);
 
-void mpr_link_add_msg(mpr_link link, const char *path, lo_message msg, mpr_time t, mpr_proto proto);
+/*! Queue a message addressed to a signal for sending over a link. Messages are queued by the
+ *  thread polling the device, or by an interrupt on that thread while the queue is being drained;
+ *  they are sent by the next call to mpr_link_process_bundles().
+ *  \param link         The link to use.
+ *  \param sig          The signal whose path the message is addressed to. For links between
+ *                      local devices the signal handler is called directly.
+ *  \param path         An alias path to use instead of the signal path, or NULL.
+ *  \param msg          The message to send. The message is copied and remains owned by the
+ *                      calling slot.
+ *  \param t            The timetag for the message.
+ *  \param proto        The protocol to use.
+ *  \param priority     The priority class of the map: 1 for high, -1 for low, or 0. */
+void mpr_link_add_msg(mpr_link link, mpr_sig sig, const char *path, lo_message msg, mpr_time t,
+                      mpr_proto proto, int priority);
+
+/*! Queue a message that has already been encoded as OSC for sending over a link, without
+ *  building an lo_message. UDP messages are copied straight into the outgoing datagram. The same
+ *  threading rules apply as for mpr_link_add_msg().
+ *  \param link         The link to add the message to.
+ *  \param sig          The signal the message is addressed to.
+ *  \param path         An alias path to use instead of the signal path, or NULL.
+ *  \param types        The OSC type tag string, beginning with ','.
+ *  \param data         The argument data in network byte order.
+ *  \param len          The length of the argument data.
+ *  \param t            The timetag for the message.
+ *  \param proto        The protocol to use.
+ *  \param priority     The priority class of the map: 1 for high, -1 for low, or 0.
+ *  \return             1 if the message was queued, 0 if the queue is full. */
+int mpr_link_add_osc(mpr_link link, mpr_sig sig, const char *path, const char *types,
+                     const char *data, int len, mpr_time t, mpr_proto proto, int priority);
+
+/*! Handle a reliable UDP control message received from the remote device of a link.
+ *  \param link         The link to the device that sent the message.
+ *  \param path         The message path, one of the MPR_RUDP_* paths.
+ *  \param num          The number of sequence numbers in the message.
+ *  \param seqs         The sequence number arguments. */
+void mpr_link_recv_rudp(mpr_link link, const char *path, int num, lo_arg **seqs);
+
+/*! Handle the sequence number of a group of messages in a bundle sent with forward error
+ *  correction by the remote device of a link.
+ *  \param link         The link to the device that sent the bundle.
+ *  \param seq          The sequence number of the bundle the messages were first sent in.
+ *  \return             1 if the messages have already been received and should be skipped,
+ *                      0 otherwise. */
+int mpr_link_recv_fec(mpr_link link, uint32_t seq);
+
+/*! Handle a chunk of a datagram split by the remote device of a link. The datagram is dispatched
+ *  once all of its chunks have arrived.
+ *  \param link         The link to the device that sent the chunk.
+ *  \param seq          The sequence number of the datagram.
+ *  \param idx          The index of the chunk.
+ *  \param total        The length of the whole datagram.
+ *  \param data         The data of the chunk.
+ *  \param len          The length of the chunk data. */
+void mpr_link_recv_chunk(mpr_link link, uint32_t seq, int idx, int total, const void *data,
+                         int len);
+
+/*! Write as much of the outbound TCP queue as the socket accepts without blocking.
+ *  \param link         The link to flush.
+ *  \return             Non-zero if data is still waiting to be written. */
+int mpr_link_flush_tcp(mpr_link link);
+
+/*! Write the bundles held while the outgoing shared memory ring was full.
+ *  \param link         The link to flush.
+ *  \return             Non-zero if bundles are still being held. */
+int mpr_link_flush_shm(mpr_link link);
+
+/*! Send the UDP messages held back by pacing if they are due.
+ *  \param link         The link to flush.
+ *  \return             The number of milliseconds until held messages are due, or -1 if no
+ *                      messages are being held. */
+int mpr_link_flush_paced(mpr_link link);
+
+/*! Announce the last reliable UDP bundle sent and request missing bundles again once their
+ *  retransmit timeout has expired.
+ *  \param link         The link to check.
+ *  \return             The number of milliseconds until the next timeout, or -1 if none is
+ *                      pending. */
+int mpr_link_check_rudp(mpr_link link);
 
 int mpr_link_get_is_ready(mpr_link link);
 
+/*! Check whether both ends of a link belong to this process.
+ *  \param link         The link to check.
+ *  \return             Non-zero if the link connects two local devices. */
+int mpr_link_get_is_local_only(mpr_link link);
+
+/*! Mark whether the local device is about to block waiting on its sockets, so that a remote
+ *  device on the same host writing to our shared memory ring knows to wake us.
+ *  \param link         The link to update.
+ *  \param waiting      1 if about to block, 0 otherwise.
+ *  \return             Non-zero if data is already waiting in the ring. */
+int mpr_link_set_shm_waiting(mpr_link link, int waiting);
+
+/*! Dispatch any bundles waiting in the shared memory ring for this link.
+ *  \param link         The link to check.
+ *  \return             The number of bundles dispatched. */
+int mpr_link_recv_shm(mpr_link link);
+
 lo_address mpr_link_get_admin_addr(mpr_link link);
 
 void mpr_link_update_clock(mpr_link link, mpr_time then, mpr_time now,
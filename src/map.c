@@ -26,6 +26,7 @@
 
 #define MAX_LEN           1024
 #define METADATA_OK       (MPR_SLOT_DEV_KNOWN | MPR_SLOT_SIG_KNOWN | MPR_SLOT_LINK_KNOWN)
+#define MCAST_MIN_FANOUT  4     /* outgoing maps needed before a signal uses a multicast group */
 
 /* Documentation of status bitflags for maps
  * 'expired'           timeout waiting for map handshake or link heartbeat
@@ -70,6 +71,7 @@ typedef struct _mpr_local_map {
     mpr_time t_next;
     mpr_expr expr;                  /*!< The mapping expression. */
     mpr_bitflags updated_inst;      /*!< Bitflags to indicate updated instances. */
+    mpr_bitflags taken_inst;        /*!< Updated instances taken for processing. */
     mpr_value next_inst_val;
     mpr_value *var_vals;            /*!< User variables values. */
     const char **var_names;         /*!< User variables names. */
@@ -83,6 +85,10 @@ typedef struct _mpr_local_map {
     uint8_t updated;                /* requires 1 bit */
     uint8_t is_self_timed;          /* requires 1 bit */
     uint8_t is_self_map;            /* requires 1 bit */
+    uint8_t use_mcast;              /* requires 1 bit */
+
+    char alias_path[SIG_ALIAS_PATH_LEN];    /*!< Destination signal alias path, if known. */
+    char *mcast;                    /*!< Multicast group carrying the source signal updates. */
 } mpr_local_map_t;
 
 size_t mpr_map_get_struct_size(int is_local)
@@ -590,7 +596,17 @@ void mpr_map_free(mpr_map map)
         }
         FUNC_IF(free, lmap->old_var_names);
         mpr_bitflags_free(lmap->updated_inst);
+        mpr_bitflags_free(lmap->taken_inst);
         FUNC_IF(mpr_expr_free, lmap->expr);
+
+        if (lmap->mcast) {
+            mpr_net net = mpr_graph_get_net(map->obj.graph);
+            if (MPR_LOC_DST == lmap->locality)
+                mpr_net_leave_mcast(net, lmap->mcast, lmap);
+            else
+                mpr_net_release_sig_mcast(net, mpr_slot_get_sig((mpr_slot)lmap->src[0]));
+            free(lmap->mcast);
+        }
     }
 
     /* remove map from parent link */
@@ -990,10 +1006,11 @@ mpr_time mpr_map_process(mpr_local_map m, mpr_time t_now)
             // TODO: check if there is anything to send! i.e. source signal is used in the map?
             // alternately if source is not referenced in expression we could force process_loc to DST
             for (i = 0; i < m->num_src; i++) {
+                /* destinations that joined the source signal's group share a single update */
+                if (m->use_mcast && mpr_local_slot_send_mcast(m->src[i], t_now))
+                    continue;
                 /* We need to send message prepared by source slot through destination link */
-                lo_message msg;
-                if ((msg = mpr_slot_get_msg(m->src[i])))
-                    mpr_local_slot_send_msg(m->dst, msg, t_now, m->protocol);
+                mpr_local_slot_forward_msg(m->dst, m->src[i], t_now, m->protocol);
             }
         }
         return MPR_TIME_MAX;
@@ -1086,9 +1103,14 @@ mpr_time mpr_map_process(mpr_local_map m, mpr_time t_now)
 
     m->t_next = MPR_TIME_MAX;
 
+    /* signals may be updated by interrupts while the map is processed: take the flags first so
+     * that new updates are left for the next cycle instead of being cleared */
+    mpr_atomic_swap8((char*)&m->updated, 0);
+    mpr_bitflags_take(m->taken_inst, m->updated_inst);
+
     for (i = 0; i < m->num_inst; i++) {
         /* Check if this instance has been updated */
-        if (!mpr_bitflags_get(m->updated_inst, i)) {
+        if (!mpr_bitflags_get(m->taken_inst, i)) {
             if (m->is_self_timed) {
                 mpr_time t_next_inst = mpr_value_get_time(m->next_inst_val, i, 0);
                 int j;
@@ -1265,8 +1287,6 @@ mpr_time mpr_map_process(mpr_local_map m, mpr_time t_now)
         m->t_next = t_now;
         mpr_time_add_dbl(&m->t_next, 0.1);
     }
-    mpr_bitflags_clear(m->updated_inst);
-    m->updated = 0;
     return m->t_next;
 }
 
@@ -1432,10 +1452,14 @@ void mpr_map_alloc_values(mpr_local_map m, int quiet)
         m->next_inst_val = mpr_value_new(1, MPR_DBL, 1, num_inst);
 
     /* allocate update bitflags */
-    if (m->updated_inst)
+    if (m->updated_inst) {
         m->updated_inst = mpr_bitflags_realloc(m->updated_inst, num_inst);
-    else
+        m->taken_inst = mpr_bitflags_realloc(m->taken_inst, num_inst);
+    }
+    else {
         m->updated_inst = mpr_bitflags_new(num_inst);
+        m->taken_inst = mpr_bitflags_new(num_inst);
+    }
     m->num_inst = num_inst;
 
     if (!quiet) {
@@ -2246,6 +2270,33 @@ int mpr_map_set_from_msg(mpr_map m, mpr_msg msg)
             }
             case MPR_PROP_EXTRA: {
                 const char *key = mpr_msg_atom_get_key(a);
+                if (0 == strcmp(key, "alias")) {
+                    /* destination signal alias for compact updates, not a map property */
+                    if (   m->obj.is_local && MPR_DIR_OUT == mpr_slot_get_dir(m->dst)
+                        && types && MPR_INT32 == types[0]) {
+                        mpr_sig_get_alias_path((vals[0])->i32, ((mpr_local_map)m)->alias_path,
+                                               SIG_ALIAS_PATH_LEN);
+                    }
+                    break;
+                }
+                if (0 == strcmp(key, "mcast")) {
+                    /* handled by mpr_local_map_set_mcast(), not a map property */
+                    break;
+                }
+                if (0 == strcmp(key, "priority")) {
+                    if (mpr_tbl_add_record_from_msg_atom(tbl, a, MPR_TBL_MOD_REM)) {
+                        ++updated;
+                        if (m->obj.is_local) {
+                            /* cache the class on the slots that queue outgoing messages */
+                            mpr_local_map lm = (mpr_local_map)m;
+                            int priority = mpr_map_get_priority(m);
+                            mpr_local_slot_set_priority(lm->dst, priority);
+                            for (j = 0; j < m->num_src; j++)
+                                mpr_local_slot_set_priority(lm->src[j], priority);
+                        }
+                    }
+                    break;
+                }
                 if (0 == strncmp(key, "var@", 4)) {
                     /* expression user variable */
                     if (mpr_tbl_add_record_from_msg_atom(tbl, a, MPR_TBL_MOD_REM)) {
@@ -2286,6 +2337,34 @@ done:
     return updated;
 }
 
+/* Destination-processed maps receive the raw source updates, so when a source signal has many of
+ * them they can share a multicast group instead of each receiving a copy over its own link. */
+static const char *get_src_mcast(mpr_local_map m)
+{
+    mpr_sig sig;
+    mpr_link link;
+    mpr_list maps;
+    int fanout = 0;
+
+    RETURN_ARG_UNLESS(   m->one_src && 1 == m->num_src && MPR_LOC_SRC == m->locality
+                      && MPR_LOC_DST == m->process_loc && MPR_PROTO_UDP == m->protocol, 0);
+    link = mpr_slot_get_link((mpr_slot)m->dst);
+    RETURN_ARG_UNLESS(link && !mpr_link_get_is_local_only(link), 0);
+
+    sig = mpr_slot_get_sig((mpr_slot)m->src[0]);
+    maps = mpr_sig_get_maps(sig, MPR_DIR_OUT);
+    while (maps) {
+        mpr_map map = (mpr_map)*maps;
+        /* only maps sending identical messages can share the group */
+        if (   map->obj.is_local && MPR_LOC_DST == map->process_loc
+            && map->use_inst == m->use_inst)
+            ++fanout;
+        maps = mpr_list_get_next(maps);
+    }
+    RETURN_ARG_UNLESS(fanout >= MCAST_MIN_FANOUT, 0);
+    return mpr_net_get_sig_mcast(mpr_graph_get_net(m->obj.graph), sig, m->use_inst);
+}
+
 /* If the "slot_idx" argument is >= 0, we can assume this message will be sent
  * to a peer device rather than a session manager. */
 int mpr_map_send_state(mpr_map m, int slot_idx, net_msg_t cmd, int version)
@@ -2386,6 +2465,21 @@ int mpr_map_send_state(mpr_map m, int slot_idx, net_msg_t cmd, int version)
                 break;
             lo_message_add_int32(msg, mpr_slot_get_id(m->src[i]));
         }
+        /* add destination signal alias so the sources can send compact updates */
+        lo_message_add_string(msg, "@alias");
+        lo_message_add_int32(msg, mpr_sig_get_alias(mpr_slot_get_sig(m->dst)));
+    }
+
+    if (MSG_MAPPED == cmd && m->obj.is_local) {
+        /* offer or acknowledge the multicast group carrying the source signal updates */
+        mpr_local_map lm = (mpr_local_map)m;
+        const char *spec = 0;
+        if (MPR_DIR_OUT == dst_dir && !lm->mcast && (spec = get_src_mcast(lm)))
+            lm->mcast = strdup(spec);
+        if (lm->mcast) {
+            lo_message_add_string(msg, "@mcast");
+            lo_message_add_string(msg, lm->mcast);
+        }
     }
 
     /* source properties */
@@ -2679,6 +2773,74 @@ int mpr_local_map_get_is_self_map(mpr_local_map map)
     return map->is_self_map;
 }
 
+const char *mpr_local_map_get_alias_path(mpr_local_map map)
+{
+    mpr_link link;
+    RETURN_ARG_UNLESS(map->alias_path[0], 0);
+    /* updates over links between local devices are dispatched without a path */
+    link = mpr_slot_get_link((mpr_slot)map->dst);
+    return (link && !mpr_link_get_is_local_only(link)) ? map->alias_path : 0;
+}
+
+void mpr_local_map_set_mcast(mpr_local_map map, mpr_msg msg)
+{
+    const char *spec = 0;
+    int i, num_atoms;
+
+    RETURN_UNLESS(msg);
+    num_atoms = mpr_msg_get_num_atoms(msg);
+    for (i = 0; i < num_atoms; i++) {
+        mpr_msg_atom a = mpr_msg_get_atom(msg, i);
+        if (   MPR_PROP_EXTRA == MASK_PROP_BITFLAGS(mpr_msg_atom_get_prop(a))
+            && 0 == strcmp(mpr_msg_atom_get_key(a), "mcast")
+            && MPR_STR == mpr_msg_atom_get_types(a)[0]) {
+            spec = &(mpr_msg_atom_get_values(a)[0])->s;
+            break;
+        }
+    }
+    RETURN_UNLESS(spec);
+
+    if (MPR_LOC_SRC == map->locality) {
+        /* the destination has joined the group we offered */
+        if (map->mcast && 0 == strcmp(map->mcast, spec) && !map->use_mcast) {
+            trace("sending map updates to multicast group %s\n", spec);
+            map->use_mcast = 1;
+        }
+    }
+    else if (MPR_LOC_DST == map->locality && 1 == map->num_src) {
+        mpr_net net = mpr_graph_get_net(map->obj.graph);
+        char path[256];
+        RETURN_UNLESS(!map->mcast || strcmp(map->mcast, spec));
+        if (map->mcast) {
+            mpr_net_leave_mcast(net, map->mcast, map);
+            free(map->mcast);
+            map->mcast = 0;
+        }
+        path[0] = '/';
+        mpr_sig_get_full_name(mpr_slot_get_sig((mpr_slot)map->src[0]), path + 1, 255);
+        if (!mpr_net_join_mcast(net, spec, path, map))
+            map->mcast = strdup(spec);
+    }
+}
+
+void mpr_local_map_recv_mcast(mpr_local_map map, const char *types, lo_arg **argv, int argc,
+                              lo_message msg)
+{
+    mpr_net net = mpr_graph_get_net(map->obj.graph);
+    mpr_sig src = mpr_slot_get_sig((mpr_slot)map->src[0]);
+    mpr_time sent, t;
+    RETURN_UNLESS(map->obj.status & MPR_STATUS_ACTIVE);
+
+    /* the group is shared by several devices, so the source stamps updates with its own clock
+     * and each member converts the timetag using its clock offset to the source device */
+    sent = t = mpr_net_get_bundle_time(net);
+    mpr_time_add_dbl(&t, -mpr_dev_get_offset(mpr_sig_get_dev(src)));
+    mpr_net_set_bundle_time(net, t);
+    mpr_sig_handle_compact((mpr_local_sig)mpr_slot_get_sig((mpr_slot)map->dst),
+                           mpr_slot_get_id((mpr_slot)map->src[0]), types, argv, argc, msg);
+    mpr_net_set_bundle_time(net, sent);
+}
+
 int mpr_local_map_get_num_inst(mpr_local_map map)
 {
     return map->num_inst;
@@ -2723,6 +2885,15 @@ mpr_proto mpr_map_get_protocol(mpr_map map)
     return map->protocol;
 }
 
+int mpr_map_get_priority(mpr_map map)
+{
+    const char *str = mpr_obj_get_prop_as_str((mpr_obj)map, MPR_PROP_EXTRA, "priority");
+    RETURN_ARG_UNLESS(str, 0);
+    if (0 == strcmp(str, "high"))
+        return 1;
+    return 0 == strcmp(str, "low") ? -1 : 0;
+}
+
 mpr_sig mpr_map_get_src_sig(mpr_map map, int idx)
 {
     assert(idx < MAX_NUM_MAP_SRC);
@@ -2751,8 +2922,8 @@ void mpr_local_map_set_updated(mpr_local_map map, int inst_idx)
     if (inst_idx < 0)
         mpr_bitflags_set_all(map->updated_inst);
     else
-        mpr_bitflags_set(map->updated_inst, inst_idx);
-    map->updated = 1;
+        mpr_bitflags_set_atomic(map->updated_inst, inst_idx);
+    mpr_atomic_swap8((char*)&map->updated, 1);
 }
 
 int mpr_map_get_use_inst(mpr_map map)
@@ -73,6 +73,27 @@ int mpr_local_map_get_is_one_src(mpr_local_map map);
 
 int mpr_local_map_get_is_self_map(mpr_local_map map);
 
+/*! Get the path for sending compact updates to the destination signal of a map.
+ *  \param map          The map to query.
+ *  \return             The alias path announced by the destination device, or NULL if
+ *                      updates should be addressed to the full signal path. */
+const char *mpr_local_map_get_alias_path(mpr_local_map map);
+
+/*! Handle the multicast group offered by the source device of a map, or the acknowledgement
+ *  that the destination device has joined it.
+ *  \param map          The local map.
+ *  \param msg          The parsed /mapped message. */
+void mpr_local_map_set_mcast(mpr_local_map map, mpr_msg msg);
+
+/*! Apply a source signal update received through a multicast group.
+ *  \param map          The local map that joined the group.
+ *  \param types        The message type string.
+ *  \param argv         The message arguments.
+ *  \param argc         The number of message arguments.
+ *  \param msg          The message. */
+void mpr_local_map_recv_mcast(mpr_local_map map, const char *types, lo_arg **argv, int argc,
+                              lo_message msg);
+
 int mpr_map_get_locality(mpr_map map);
 
 int mpr_local_map_get_num_inst(mpr_local_map map);
@@ -85,6 +106,11 @@ mpr_loc mpr_local_map_get_process_loc_from_msg(mpr_local_map map, mpr_msg msg);
 
 mpr_proto mpr_map_get_protocol(mpr_map map);
 
+/*! Get the priority class of a map from its property "priority".
+ *  \param map          The map to check.
+ *  \return             1 for "high", -1 for "low", or 0 for the normal class. */
+int mpr_map_get_priority(mpr_map map);
+
 mpr_sig mpr_map_get_src_sig(mpr_map map, int idx);
 
 mpr_slot mpr_map_get_src_slot(mpr_map map, int idx);
@@ -0,0 +1,99 @@
+#ifndef __MPR_ATOMIC_H__
+#define __MPR_ATOMIC_H__
+
+#include <stdint.h>
+#include "mpr_inline.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* Atomic operations used to share queues and update flags between the thread polling a device
+ * and interrupts updating its signals. Loads have acquire semantics, stores
+ * release semantics, and read-modify-write operations are sequentially consistent. */
+
+MPR_INLINE static uint32_t mpr_atomic_get(volatile uint32_t *ptr)
+{
+#ifdef _MSC_VER
+    return (uint32_t)_InterlockedOr((volatile long*)ptr, 0);
+#else
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+MPR_INLINE static void mpr_atomic_set(volatile uint32_t *ptr, uint32_t val)
+{
+#ifdef _MSC_VER
+    _InterlockedExchange((volatile long*)ptr, (long)val);
+#else
+    __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+#endif
+}
+
+/* Returns the previous value. */
+MPR_INLINE static uint32_t mpr_atomic_swap(volatile uint32_t *ptr, uint32_t val)
+{
+#ifdef _MSC_VER
+    return (uint32_t)_InterlockedExchange((volatile long*)ptr, (long)val);
+#else
+    return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/* Returns the previous value. */
+MPR_INLINE static uint32_t mpr_atomic_add(volatile uint32_t *ptr, uint32_t val)
+{
+#ifdef _MSC_VER
+    return (uint32_t)_InterlockedExchangeAdd((volatile long*)ptr, (long)val);
+#else
+    return __atomic_fetch_add(ptr, val, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/* Returns the previous value. */
+MPR_INLINE static uint32_t mpr_atomic_or(volatile uint32_t *ptr, uint32_t val)
+{
+#ifdef _MSC_VER
+    return (uint32_t)_InterlockedOr((volatile long*)ptr, (long)val);
+#else
+    return __atomic_fetch_or(ptr, val, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/* Replace the value with val if it still equals *expected. Returns 1 on success, otherwise 0 with
+ * the current value stored in *expected. */
+MPR_INLINE static int mpr_atomic_cas(volatile uint32_t *ptr, uint32_t *expected, uint32_t val)
+{
+#ifdef _MSC_VER
+    uint32_t prev = (uint32_t)_InterlockedCompareExchange((volatile long*)ptr, (long)val,
+                                                          (long)*expected);
+    if (prev == *expected)
+        return 1;
+    *expected = prev;
+    return 0;
+#else
+    return __atomic_compare_exchange_n(ptr, expected, val, 0, __ATOMIC_SEQ_CST,
+                                       __ATOMIC_ACQUIRE);
+#endif
+}
+
+/* Byte-sized variants for flags. Both return the previous value. */
+MPR_INLINE static char mpr_atomic_swap8(volatile char *ptr, char val)
+{
+#ifdef _MSC_VER
+    return _InterlockedExchange8(ptr, val);
+#else
+    return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+#endif
+}
+
+MPR_INLINE static char mpr_atomic_or8(volatile char *ptr, char val)
+{
+#ifdef _MSC_VER
+    return _InterlockedOr8(ptr, val);
+#else
+    return __atomic_fetch_or(ptr, val, __ATOMIC_SEQ_CST);
+#endif
+}
+
+#endif /* __MPR_ATOMIC_H__ */
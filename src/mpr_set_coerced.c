@@ -8,6 +8,9 @@ int mpr_set_coerced(int src_len, mpr_type src_type, const void *src_val,
 {
     int i, j, min_len = src_len < dst_len ? src_len : dst_len, modified = 0;
 
+    if (min_len <= 0)
+        return 1;
+
     if (src_type == dst_type) {
         int size = mpr_type_get_size(src_type);
         do {
@@ -23,110 +26,51 @@ int mpr_set_coerced(int src_len, mpr_type src_type, const void *src_val,
         return !modified;
     }
 
+/* Convert numeric elements, repeating the source vector if it is shorter than the destination.
+ * The comparison result is accumulated instead of branched on so that the inner loop stays simple
+ * for long vectors. */
+#define COERCE_CASE(SRC_MTYPE, SRC_TYPE, DST_TYPE)                          \
+        case SRC_MTYPE: {                                                   \
+            const SRC_TYPE *src = (const SRC_TYPE*)src_val;                 \
+            DST_TYPE *dst = (DST_TYPE*)dst_val, temp;                       \
+            for (i = 0; i < dst_len; i += min_len) {                        \
+                int num = dst_len - i < min_len ? dst_len - i : min_len;    \
+                for (j = 0; j < num; j++) {                                 \
+                    temp = (DST_TYPE)src[j];                                \
+                    modified |= temp != dst[i + j];                         \
+                    dst[i + j] = temp;                                      \
+                }                                                           \
+            }                                                               \
+            break;                                                          \
+        }
+
     switch (dst_type) {
-        case MPR_FLT:{
-            float *dstf = (float*)dst_val, tempf;
+        case MPR_FLT:
             switch (src_type) {
                 case MPR_BOOL:
-                case MPR_INT32: {
-                    int *srci = (int*)src_val;
-                    for (i = 0, j = 0; i < dst_len; i++, j++) {
-                        if (j >= src_len)
-                            j = 0;
-                        tempf = (float)srci[j];
-                        if (tempf != dstf[i]) {
-                            modified = 1;
-                            dstf[i] = tempf;
-                        }
-                    }
-                    break;
-                }
-                case MPR_DBL: {
-                    double *srcd = (double*)src_val;
-                    for (i = 0, j = 0; i < dst_len; i++, j++) {
-                        if (j >= src_len)
-                            j = 0;
-                        tempf = (float)srcd[j];
-                        if (tempf != dstf[i]) {
-                            dstf[i] = tempf;
-                            modified = 1;
-                        }
-                    }
-                    break;
-                }
+                COERCE_CASE(MPR_INT32, int, float)
+                COERCE_CASE(MPR_DBL, double, float)
                 default:
                     return -1;
             }
             break;
-        }
-        case MPR_INT32: {
-            int *dsti = (int*)dst_val, tempi;
+        case MPR_INT32:
             switch (src_type) {
-                case MPR_FLT: {
-                    float *srcf = (float*)src_val;
-                    for (i = 0, j = 0; i < dst_len; i++, j++) {
-                        if (j >= src_len)
-                            j = 0;
-                        tempi = (int)srcf[j];
-                        if (tempi != dsti[i]) {
-                            dsti[i] = tempi;
-                            modified = 1;
-                        }
-                    }
-                    break;
-                }
-                case MPR_DBL: {
-                    double *srcd = (double*)src_val;
-                    for (i = 0, j = 0; i < dst_len; i++, j++) {
-                        if (j >= src_len)
-                            j = 0;
-                        tempi = (int)srcd[j];
-                        if (tempi != dsti[i]) {
-                            dsti[i] = tempi;
-                            modified = 1;
-                        }
-                    }
-                    break;
-                }
+                COERCE_CASE(MPR_FLT, float, int)
+                COERCE_CASE(MPR_DBL, double, int)
                 default:
                     return -1;
             }
             break;
-        }
-        case MPR_DBL: {
-            double *dstd = (double*)dst_val, tempd;
+        case MPR_DBL:
             switch (src_type) {
-                case MPR_INT32: {
-                    int *srci = (int*)src_val;
-                    for (i = 0, j = 0; i < dst_len; i++, j++) {
-                        if (j >= src_len)
-                            j = 0;
-                        tempd = (float)srci[j];
-                        if (tempd != dstd[i]) {
-                            dstd[i] = tempd;
-                            modified = 1;
-                        }
-                    }
-                    break;
-                }
-                case MPR_FLT: {
-                    float *srcf = (float*)src_val;
-                    for (i = 0, j = 0; i < dst_len; i++, j++) {
-                        if (j >= src_len)
-                            j = 0;
-                        tempd = (double)srcf[j];
-                        if (tempd != dstd[i]) {
-                            dstd[i] = tempd;
-                            modified = 1;
-                        }
-                    }
-                    break;
-                }
+                COERCE_CASE(MPR_INT32, int, double)
+                COERCE_CASE(MPR_FLT, float, double)
                 default:
                     return -1;
             }
             break;
-        }
+#undef COERCE_CASE
         case MPR_BOOL: {
             int *dstb = (int*)dst_val, tempb;
             switch (src_type) {
@@ -20,6 +20,34 @@ size_t mpr_sig_get_struct_size(int is_local);
 int mpr_sig_osc_handler(const char *path, const char *types, lo_arg **argv, int argc,
                         lo_message msg, void *data);
 
+/*! Handler for compact update messages addressed to a signal alias. */
+int mpr_sig_osc_alias_handler(const char *path, const char *types, lo_arg **argv, int argc,
+                              lo_message msg, void *data);
+
+/*! Apply a compact update message to a local signal, ignoring the slot id in its first argument.
+ *  \param sig          The local signal to update.
+ *  \param slot_id      The slot id to apply the update to, or -1 for the signal itself.
+ *  \param types        The message type string.
+ *  \param argv         The message arguments.
+ *  \param argc         The number of message arguments.
+ *  \param msg          The message.
+ *  \return             Zero. */
+int mpr_sig_handle_compact(mpr_local_sig sig, int slot_id, const char *types, lo_arg **argv,
+                           int argc, lo_message msg);
+
+#define SIG_ALIAS_PATH_LEN 16
+
+/*! Get the numeric alias used to address a local signal in compact update messages.
+ *  \param sig      The signal to query.
+ *  \return         The alias, unique within the signal's device. */
+int mpr_sig_get_alias(mpr_sig sig);
+
+/*! Write the OSC path corresponding to a signal alias.
+ *  \param alias    The signal alias.
+ *  \param path     A string to accept the path.
+ *  \param len      The length of the string pointed to by path. */
+void mpr_sig_get_alias_path(int alias, char *path, int len);
+
 /*! Initialize an already-allocated mpr_sig structure. */
 void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const char *name, int len,
                   mpr_type type, const char *unit, const void *min, const void *max, int *num_inst);
@@ -1,11 +1,37 @@
 #include "config.h"
 
+#if defined(HAVE_RECVMMSG) || defined(HAVE_SENDMMSG)
+ #ifndef _GNU_SOURCE
+  #define _GNU_SOURCE
+ #endif
+#endif
+
+#ifdef HAVE_SYS_SOCKET_H
+ #include <sys/socket.h>
+#endif
+
+#ifdef HAVE_NETDB_H
+ #include <netdb.h>
+#endif
+
+#if defined(HAVE_SYS_SOCKET_H) && defined(HAVE_NETDB_H)
+ #define HAVE_RAW_DGRAMS
+#endif
+
+#if defined(HAVE_SYS_SOCKET_H) && defined(SO_TIMESTAMPNS)
+ #include <time.h>
+ #define HAVE_RECV_TIMESTAMPS
+ #define RECV_CTRL_LEN CMSG_SPACE(sizeof(struct timespec))
+ #define NTP_EPOCH_OFFSET 2208988800UL  /* seconds from 1900 to 1970 */
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
 #include <math.h>
 #include <ctype.h>
+#include <errno.h>
 
 #ifdef HAVE_GETIFADDRS
  #include <ifaddrs.h>
@@ -23,10 +49,23 @@
  #endif
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+ #include <sys/epoll.h>
+ #include <unistd.h>
+ #include <fcntl.h>
+ #define HAVE_NET_POLLER
+#elif defined(HAVE_POLL_H)
+ #include <poll.h>
+ #include <unistd.h>
+ #include <fcntl.h>
+ #define HAVE_NET_POLLER
+#endif
+
 #include "link.h"
 #include "list.h"
 #include "map.h"
 #include "message.h"
+#include "mpr_atomic.h"
 #include "mpr_signal.h"
 #include "network.h"
 #include "object.h"
@@ -47,20 +86,91 @@ static void* net_thread_func(void *data);
 static unsigned __stdcall net_thread_func(void *data);
 #endif
 
+#ifdef HAVE_NET_POLLER
+static void close_tcp_conns(mpr_net net, lo_server server);
+#endif
+
 extern const char* prop_msg_strings[MPR_PROP_EXTRA+1];
 
 #define NUM_NET_SERVERS 3
-#define NUM_DEV_SERVERS 2
+#ifdef HAVE_UNIX_SOCKETS
+ #define NUM_DEV_SERVERS 3
+#else
+ #define NUM_DEV_SERVERS 2
+#endif
 
 #define SERVER_BUS      0   /* Multicast comms. */
 #define SERVER_MESH_UDP 1   /* UDP Mesh comms. */
 #define SERVER_MESH_TCP 2   /* TCP Mesh comms. */
 
 #define MAX_BUNDLE_LEN 8192
+#define SYNC_MIN_SEC 5          /* shortest interval between device syncs on the bus */
+#define SYNC_MAX_SEC 60         /* longest interval between device syncs on the bus */
+#define SYNC_JITTER 0.6         /* random fraction of the interval added to each heartbeat */
+#define SYNC_BUS_RATE 100       /* target number of sync messages per second on the bus */
+#define MAX_POLL_EVENTS 64
+#define TCP_POLL_MS 1
+#define MESH_TCP_POLL_MS 10     /* polling interval for liblo connections to the TCP mesh server */
+#define TCP_RECV_CHUNK 0x10000
+#define MAX_TCP_PACKET 0x1000000
+#define MAX_DGRAM_LEN 65536
+#define RECV_BATCH 16
+#define SEND_BATCH 64
+#define SHARED_OFFSET ((size_t)-1)
+#define MCAST_SPEC_LEN 32
+#define MCAST_NUM_PORTS 64      /* number of ports above the bus port used by signal groups */
+#define MCAST_EVENT 0x80000000  /* poller event data flag for signal multicast servers */
+#define WAKE_EVENT 0x40000000   /* poller event data flag for the wake-up pipe */
+#define TCP_EVENT 0x20000000    /* poller event data flag for accepted TCP connections */
 #define FIND 0
 #define UPDATE 1
 #define ADD 2
 
+/*! A local map receiving the updates of a remote signal through a multicast group. */
+typedef struct _mpr_mcast_sub {
+    char *path;
+    struct _mpr_local_map *map;
+} mpr_mcast_sub_t;
+
+/*! A multicast group carrying the updates of a single signal. */
+typedef struct _mpr_mcast_group {
+    char spec[MCAST_SPEC_LEN];      /*!< Group address and port as "group:port". */
+    mpr_sig sig;                    /*!< The local signal, for groups we are sending to. */
+    lo_address addr;                /*!< Group address for sending. */
+    lo_bundle bundle;               /*!< Pending updates for the group. */
+    lo_server server;               /*!< Server for receiving from the group. */
+    mpr_mcast_sub_t *subs;
+    int num_subs;
+    int num_maps;                   /*!< Local maps sending to the group. */
+    int use_inst;                   /*!< Whether the shared updates include instances. */
+} mpr_mcast_group_t, *mpr_mcast_group;
+
+/*! A connection accepted by the TCP data server of a local device. */
+typedef struct _mpr_tcp_conn {
+    int fd;
+    lo_server server;               /*!< The server that accepted the connection. */
+    char *buf;                      /*!< Data received but not yet dispatched. */
+    size_t len;
+    size_t size;
+} mpr_tcp_conn_t, *mpr_tcp_conn;
+
+/*! An OSC method served by the data servers of a local device. */
+typedef struct _mpr_dev_method {
+    char *path;
+    uint32_t hash;
+    lo_method_handler h;
+    void *data;
+    struct _mpr_dev_method *next;
+} mpr_dev_method_t, *mpr_dev_method;
+
+/*! Hash table of the methods served by the data servers of a local device. Incoming messages are
+ *  dispatched through a single catch-all liblo method instead of liblo's linear method list. */
+typedef struct _mpr_dev_methods {
+    mpr_dev_method *buckets;
+    int size;                       /*!< Number of buckets, always a power of two. */
+    int num;
+} mpr_dev_methods_t, *mpr_dev_methods;
+
 typedef enum {
     BUNDLE_DST_LOCAL,
     BUNDLE_DST_BUS,
@@ -75,8 +185,75 @@ typedef struct _mpr_net {
     lo_server *servers;
     int *server_status;
 
+#ifdef HAVE_NET_POLLER
+    struct {
+#ifdef HAVE_SYS_EPOLL_H
+        int fd;                     /*!< Epoll instance watching the server sockets. */
+#else
+        struct pollfd *fds;         /*!< Server sockets, indexed like the servers array. */
+#endif
+        mpr_tcp_conn_t *conns;      /*!< Connections accepted by device TCP data servers. */
+        int num_conns;
+        int size_conns;
+        int wake[2];                /*!< Pipe written to wake the polling thread. */
+        uint8_t dirty;              /*!< Set when servers have been added or removed. */
+        uint8_t mesh_tcp;           /*!< Set once the TCP mesh server has accepted a connection. */
+    } poller;
+#endif
+
+#ifdef HAVE_LIBPTHREAD
+    pthread_t poll_thread;          /*!< The thread that last polled the network. */
+#elif defined(HAVE_WIN32_THREADS)
+    DWORD poll_thread;
+#endif
+    uint32_t has_poll_thread;
+
+    uint32_t devs_updated;          /*!< Set when a local device has maps or updates to process. */
+    double next_update;             /*!< Time a timed map is next due, or 0 if none. */
+
+    mpr_local_dev *subscribed;      /*!< Local devices that may have subscribers to refresh. */
+    int num_subscribed;
+
+    struct {
+        mpr_link *links;
+        int num;
+        int size;
+    } links[NUM_NET_LINK_LISTS];    /*!< Local links visited by the poll loop. */
+
     mpr_thread_data thread_data;
 
+#ifdef HAVE_RECVMMSG
+    struct {
+        struct mmsghdr msgs[RECV_BATCH];
+        struct iovec iov[RECV_BATCH];
+        char *buf;
+#ifdef HAVE_RECV_TIMESTAMPS
+        char ctrl[RECV_BATCH][RECV_CTRL_LEN];
+#endif
+    } recv_q;                       /*!< Datagrams received from device UDP servers. */
+#endif
+
+#ifdef HAVE_SENDMMSG
+    struct {
+        struct mmsghdr msgs[SEND_BATCH];
+        struct iovec iov[SEND_BATCH];
+        struct sockaddr_storage addrs[SEND_BATCH];
+        size_t offsets[SEND_BATCH];
+        char *buf;                  /*!< Serialised bundles waiting to be sent. */
+        size_t len;
+        size_t size;
+        int num;
+        int num_shared;             /*!< Number of queued datagrams using the shared buffer. */
+        lo_server server;           /*!< Server all queued datagrams are sent from. */
+    } send_q;                       /*!< Datagrams sent from device UDP servers. */
+#endif
+
+    struct {
+        char *buf;                  /*!< Bundle serialised once for several destinations. */
+        size_t len;
+        size_t size;
+    } shared;
+
     struct {
         lo_address bus;             /*!< LibLo address for the multicast bus. */
         lo_address mesh;            /*!< LibLo address for p2p. */
@@ -91,19 +268,41 @@ typedef struct _mpr_net {
     } iface;
 
     struct _mpr_local_dev **devs;   /*!< Local devices managed by this network structure. */
+    mpr_dev_methods *methods;       /*!< Data server methods of each local device. */
     lo_bundle bundle;               /*!< Bundle pointer for sending messages on the multicast bus. */
     mpr_time bundle_time;
 
+    struct {
+        mpr_time time;
+        int is_set;
+    } recv_time;                    /*!< Kernel arrival time of the datagram being dispatched. */
+    int is_redundant;               /*!< Messages being dispatched have already been received. */
+
     struct {
         char *group;
         int port;
     } multicast;
 
+    struct {
+        mpr_mcast_group *out;       /*!< Groups fanning out updates of local signals. */
+        mpr_mcast_group *in;        /*!< Groups joined on behalf of local maps. */
+        int num_out;
+        int num_in;
+    } mcast;
+
     int random_id;                  /*!< Random id for allocation speedup. */
     int msg_type;
     int num_devs;
     int num_servers;
-    uint32_t next_bus_ping;
+    struct {
+        uint32_t next;              /*!< Time of the next heartbeat. */
+        uint32_t last;              /*!< Time of the last heartbeat. */
+        int interval;               /*!< Heartbeat interval in seconds. */
+        int heard;                  /*!< Sum of the intervals advertised by the sync messages
+                                     *   received since the last heartbeat. */
+        double population;          /*!< Smoothed estimate of the number of devices on the bus. */
+    } sync;                         /*!< Heartbeat of the local devices on the bus. */
+    uint32_t next_link_ping;
     uint32_t next_sub_ping;
     uint8_t generic_dev_methods_added;
     uint8_t registered;
@@ -165,6 +364,10 @@ static int handler_map_mod(HANDLER_ARGS);
 static int handler_name_probe(HANDLER_ARGS);
 static int handler_name_registered(HANDLER_ARGS);
 static int handler_ping(HANDLER_ARGS);
+static int handler_rudp(HANDLER_ARGS);
+static int handler_fec(HANDLER_ARGS);
+static int handler_chunk(HANDLER_ARGS);
+static int handler_dev_data(HANDLER_ARGS);
 static int handler_sig(HANDLER_ARGS);
 static int handler_sig_removed(HANDLER_ARGS);
 static int handler_sig_mod(HANDLER_ARGS);
@@ -224,15 +427,89 @@ static void handler_error(int num, const char *msg, const char *where)
 
 int mpr_net_bundle_start(lo_timetag t, void *data)
 {
-    mpr_time_set(&((mpr_net)data)->bundle_time, t);
+    mpr_net net = (mpr_net)data;
+    /* bundles sent for immediate dispatch are stamped with their arrival time, which is taken by
+     * the kernel if the platform supports receive timestamps */
+    if (0 == t.sec && 1 == t.frac && net->recv_time.is_set)
+        net->bundle_time = net->recv_time.time;
+    else
+        mpr_time_set(&net->bundle_time, t);
+    net->is_redundant = 0;
     return 0;
 }
 
+static int mpr_net_bundle_end(void *data)
+{
+    ((mpr_net)data)->is_redundant = 0;
+    return 0;
+}
+
+int mpr_net_get_is_redundant(mpr_net net)
+{
+    return net->is_redundant;
+}
+
 mpr_time mpr_net_get_bundle_time(mpr_net net)
 {
     return net->bundle_time;
 }
 
+mpr_time mpr_net_get_recv_time(mpr_net net)
+{
+    mpr_time t;
+    if (net->recv_time.is_set)
+        return net->recv_time.time;
+    mpr_time_set(&t, MPR_NOW);
+    return t;
+}
+
+#ifdef HAVE_RECV_TIMESTAMPS
+/* Ask the kernel to timestamp datagrams as they arrive on a UDP server. */
+static void enable_recv_timestamps(lo_server server)
+{
+    int enable = 1;
+    if (setsockopt(lo_server_get_socket_fd(server), SOL_SOCKET, SO_TIMESTAMPNS,
+                   &enable, sizeof(enable)))
+        trace("couldn't enable receive timestamps on server socket\n");
+}
+
+/* Extract the arrival time from the control messages of a received datagram. */
+static int get_recv_time(struct msghdr *hdr, mpr_time *t)
+{
+    struct cmsghdr *cmsg;
+    for (cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+        if (SOL_SOCKET == cmsg->cmsg_level && SCM_TIMESTAMPNS == cmsg->cmsg_type) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            RETURN_ARG_UNLESS(ts.tv_sec, 0);
+            t->sec = (uint32_t)(ts.tv_sec + NTP_EPOCH_OFFSET);
+            t->frac = (uint32_t)(ts.tv_nsec * 4.294967296);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Read the arrival time of the next datagram waiting on a server without consuming it, so that
+ * liblo can still receive it along with its source address. */
+static void peek_recv_time(mpr_net net, lo_server server)
+{
+    char buf[1], ctrl[RECV_CTRL_LEN];
+    struct iovec iov;
+    struct msghdr hdr;
+    iov.iov_base = buf;
+    iov.iov_len = 1;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctrl;
+    hdr.msg_controllen = RECV_CTRL_LEN;
+    net->recv_time.is_set = 0;
+    if (recvmsg(lo_server_get_socket_fd(server), &hdr, MSG_PEEK | MSG_DONTWAIT) >= 0)
+        net->recv_time.is_set = get_recv_time(&hdr, &net->recv_time.time);
+}
+#endif
+
 /*! Local function to get the IP address of a network interface. */
 static int get_iface_addr(const char* pref, struct in_addr* addr, char **iface)
 {
@@ -410,6 +687,21 @@ static void seed_srand(void)
     srand(s);
 }
 
+static void free_dev_methods(mpr_dev_methods tbl)
+{
+    int i;
+    for (i = 0; i < tbl->size; i++) {
+        while (tbl->buckets[i]) {
+            mpr_dev_method m = tbl->buckets[i];
+            tbl->buckets[i] = m->next;
+            free(m->path);
+            free(m);
+        }
+    }
+    FUNC_IF(free, tbl->buckets);
+    free(tbl);
+}
+
 void mpr_net_add_dev_methods(mpr_net net, mpr_local_dev dev)
 {
     int i;
@@ -436,14 +728,51 @@ void mpr_net_add_dev_methods(mpr_net net, mpr_local_dev dev)
     }
 }
 
+#ifdef HAVE_UNIX_SOCKETS
+/* Build the AF_UNIX socket path of a device in a directory only accessible to the current user,
+ * so that stale sockets can be removed without following links placed by other users. Devices
+ * run by other users cannot connect to the socket and fall back to UDP. Returns 0 if no such
+ * directory is available. */
+static int get_unix_path(char *path, size_t size, int port)
+{
+    char dir[64];
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    struct stat st;
+    int len;
+
+    if (runtime_dir && '/' == runtime_dir[0]) {
+        /* created by the login manager, owned by the user with mode 0700 */
+        len = snprintf(path, size, UNIX_PATH_FMT, runtime_dir, (int)getpid(), port);
+        return len > 0 && (size_t)len < size;
+    }
+    snprintf(dir, 64, UNIX_DIR_FMT, (unsigned int)getuid());
+    if (mkdir(dir, S_IRWXU) < 0 && EEXIST != errno)
+        return 0;
+    /* an existing path must be our own private directory and not a link */
+    if (   lstat(dir, &st) < 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid()
+        || (st.st_mode & (S_IRWXG | S_IRWXO))) {
+        trace("refusing to use '%s' for AF_UNIX sockets\n", dir);
+        return 0;
+    }
+    len = snprintf(path, size, UNIX_PATH_FMT, dir, (int)getpid(), port);
+    return len > 0 && (size_t)len < size;
+}
+#endif /* HAVE_UNIX_SOCKETS */
+
 /*! Add an uninitialized device to this network. */
 /* TODO: consider sorting net->devs array for faster lookup */
 void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
 {
     int dev_idx, server_idx, port;
     char port_str[10], *host, *url;
-    lo_server_config config = {sizeof(lo_server_config), NULL, NULL, net->iface.name, NULL, LO_UDP, handler_error, NULL};
+    lo_server_config config = {.size = sizeof(lo_server_config), .iface = net->iface.name,
+                               .proto = LO_UDP, .err_h = handler_error};
     lo_server temp, temp2;
+#ifdef HAVE_UNIX_SOCKETS
+    char unix_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+    lo_server_config unix_config = {.size = sizeof(lo_server_config), .port = unix_path,
+                                    .proto = LO_UNIX, .err_h = handler_error};
+#endif
     RETURN_UNLESS(dev);
 
     /* Check if device was already added. */
@@ -455,6 +784,8 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
         /* Initialize data structures */
         net->devs = realloc(net->devs, (net->num_devs + 1) * sizeof(mpr_local_dev));
         net->devs[net->num_devs] = dev;
+        net->methods = realloc(net->methods, (net->num_devs + 1) * sizeof(mpr_dev_methods));
+        net->methods[net->num_devs] = calloc(1, sizeof(mpr_dev_methods_t));
         ++net->num_devs;
 
         if ((net->num_servers - NUM_NET_SERVERS) < (net->num_devs * NUM_DEV_SERVERS)) {
@@ -475,8 +806,20 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
     }
     /* Disable liblo message queueing */
     lo_server_enable_queue(temp, 0, 1);
+#ifdef HAVE_RECV_TIMESTAMPS
+    enable_recv_timestamps(temp);
+#endif
     /* Add bundle handlers */
-    lo_server_add_bundle_handlers(temp, mpr_net_bundle_start, NULL, (void*)net);
+    lo_server_add_bundle_handlers(temp, mpr_net_bundle_start, mpr_net_bundle_end, (void*)net);
+    /* Add handlers for reliable UDP maps and forward error correction */
+    lo_server_add_method(temp, MPR_RUDP_SEQ, NULL, handler_rudp, dev);
+    lo_server_add_method(temp, MPR_RUDP_LAST, NULL, handler_rudp, dev);
+    lo_server_add_method(temp, MPR_RUDP_NACK, NULL, handler_rudp, dev);
+    lo_server_add_method(temp, MPR_RUDP_RTX, NULL, handler_rudp, dev);
+    lo_server_add_method(temp, MPR_FEC_SEQ, "hi", handler_fec, dev);
+    lo_server_add_method(temp, MPR_CHUNK, "hiiib", handler_chunk, dev);
+    /* Signal updates are dispatched using the device method table */
+    lo_server_add_method(temp, NULL, NULL, handler_dev_data, net->methods[dev_idx]);
 
     /* Swap and free old server structure if necessary */
     temp2 = net->servers[server_idx];
@@ -495,11 +838,51 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
     lo_server_enable_queue(temp, 0, 1);
     /* Add bundle handlers */
     lo_server_add_bundle_handlers(temp, mpr_net_bundle_start, NULL, (void*)net);
+    lo_server_add_method(temp, NULL, NULL, handler_dev_data, net->methods[dev_idx]);
 
     /* Swap and free old server structure if necessary */
     temp2 = net->servers[server_idx + 1];
     net->servers[server_idx + 1] = temp;
-    FUNC_IF(lo_server_free, temp2);
+    if (temp2) {
+#ifdef HAVE_NET_POLLER
+        close_tcp_conns(net, temp2);
+#endif
+        lo_server_free(temp2);
+    }
+
+#ifdef HAVE_UNIX_SOCKETS
+    /* (re)create device AF_UNIX datagram server for devices on the same host; this is optional
+     * since the socket path may not be writable. The old server is freed first since liblo
+     * removes the socket path. */
+    FUNC_IF(lo_server_free, net->servers[server_idx + SERVER_DATA_UNIX]);
+    temp = NULL;
+    if (get_unix_path(unix_path, sizeof(unix_path), port)) {
+        /* remove any socket left behind by an exited process with the same id */
+        unlink(unix_path);
+        temp = lo_server_new_from_config(&unix_config);
+    }
+    if (temp) {
+        /* Disable liblo message queueing */
+        lo_server_enable_queue(temp, 0, 1);
+#ifdef HAVE_RECV_TIMESTAMPS
+        enable_recv_timestamps(temp);
+#endif
+        /* Same handlers as the UDP server */
+        lo_server_add_bundle_handlers(temp, mpr_net_bundle_start, mpr_net_bundle_end, (void*)net);
+        lo_server_add_method(temp, MPR_RUDP_SEQ, NULL, handler_rudp, dev);
+        lo_server_add_method(temp, MPR_RUDP_LAST, NULL, handler_rudp, dev);
+        lo_server_add_method(temp, MPR_RUDP_NACK, NULL, handler_rudp, dev);
+        lo_server_add_method(temp, MPR_RUDP_RTX, NULL, handler_rudp, dev);
+        lo_server_add_method(temp, MPR_FEC_SEQ, "hi", handler_fec, dev);
+        lo_server_add_method(temp, MPR_CHUNK, "hiiib", handler_chunk, dev);
+        lo_server_add_method(temp, NULL, NULL, handler_dev_data, net->methods[dev_idx]);
+    }
+    net->servers[server_idx + SERVER_DATA_UNIX] = temp;
+#endif
+
+#ifdef HAVE_NET_POLLER
+    net->poller.dirty = 1;
+#endif
 
     trace_dev(dev, "bound to UDP port %i\n", lo_server_get_port(net->servers[server_idx]));
     trace_dev(dev, "bound to TCP port %i\n", lo_server_get_port(net->servers[server_idx + 1]));
@@ -511,6 +894,15 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
     mpr_obj_set_prop((mpr_obj)dev, MPR_PROP_HOST, NULL, 1, MPR_STR, host, 0);
     // TODO: check this on windows!
     free(host);
+#ifdef HAVE_UNIX_SOCKETS
+    /* devices on the same host can send to the AF_UNIX socket instead of the UDP port */
+    if (net->servers[server_idx + SERVER_DATA_UNIX]) {
+        trace_dev(dev, "bound to AF_UNIX socket %s\n", unix_path);
+        mpr_obj_set_prop((mpr_obj)dev, MPR_PROP_EXTRA, "unix_path", 1, MPR_STR, unix_path, 1);
+    }
+    else
+        mpr_obj_remove_prop((mpr_obj)dev, MPR_PROP_EXTRA, "unix_path");
+#endif
 
 #ifndef WIN32
     /* For some reason Windows thinks return of lo_address_get_url() should not be freed */
@@ -537,11 +929,12 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
 
     /* Probe potential name. */
     mpr_local_dev_probe_name(dev, dev_idx + 1, net);
+    mpr_net_set_updated(net);
 }
 
 void mpr_net_remove_dev(mpr_net net, mpr_local_dev dev)
 {
-    int i;
+    int i, j;
     char path[256];
 
     for (i = 0; i < net->num_devs; i++) {
@@ -555,22 +948,40 @@ void mpr_net_remove_dev(mpr_net net, mpr_local_dev dev)
     --net->num_devs;
     net->num_servers -= NUM_DEV_SERVERS;
 
+    for (j = 0; j < net->num_subscribed; j++) {
+        if (dev == net->subscribed[j]) {
+            net->subscribed[j] = net->subscribed[--net->num_subscribed];
+            break;
+        }
+    }
+
     /* free device servers */
+#ifdef HAVE_NET_POLLER
+    close_tcp_conns(net, net->servers[i * NUM_DEV_SERVERS + NUM_NET_SERVERS + 1]);
+#endif
     lo_server_free(net->servers[i * NUM_DEV_SERVERS + NUM_NET_SERVERS]); /* UDP server */
     lo_server_free(net->servers[i * NUM_DEV_SERVERS + NUM_NET_SERVERS + 1]); /* TCP server */
+#ifdef HAVE_UNIX_SOCKETS
+    FUNC_IF(lo_server_free, net->servers[i * NUM_DEV_SERVERS + NUM_NET_SERVERS + SERVER_DATA_UNIX]);
+#endif
+    free_dev_methods(net->methods[i]);
 
     for (; i < net->num_devs; i++) {
         net->devs[i] = net->devs[i + 1];
+        net->methods[i] = net->methods[i + 1];
         memcpy(&net->servers[i * NUM_DEV_SERVERS + NUM_NET_SERVERS],
                &net->servers[i * NUM_DEV_SERVERS + NUM_NET_SERVERS + NUM_DEV_SERVERS],
                NUM_DEV_SERVERS * sizeof(lo_server));
     }
     net->devs = realloc(net->devs, net->num_devs * sizeof(mpr_local_dev));
+    net->methods = realloc(net->methods, net->num_devs * sizeof(mpr_dev_methods));
     net->servers = realloc(net->servers, net->num_servers * sizeof(lo_server));
     net->server_status = realloc(net->server_status, net->num_servers * sizeof(int));
+#ifdef HAVE_NET_POLLER
+    net->poller.dirty = 1;
+#endif
 
     for (i = 0; i < NUM_DEV_HANDLERS_SPECIFIC; i++) {
-        int j;
         snprintf(path, 256, net_msg_strings[dev_handlers_specific[i].str_idx],
                  mpr_dev_get_name((mpr_dev)dev));
         for (j = 0; j < NUM_NET_SERVERS; j++) {
@@ -579,6 +990,23 @@ void mpr_net_remove_dev(mpr_net net, mpr_local_dev dev)
     }
 }
 
+void mpr_net_add_subscribed_dev(mpr_net net, mpr_local_dev dev)
+{
+    int i;
+    for (i = 0; i < net->num_subscribed; i++) {
+        if (dev == net->subscribed[i])
+            return;
+    }
+    net->subscribed = realloc(net->subscribed, (i + 1) * sizeof(mpr_local_dev));
+    net->subscribed[net->num_subscribed++] = dev;
+}
+
+/* may be called from any thread */
+void mpr_net_set_updated(mpr_net net)
+{
+    mpr_atomic_set(&net->devs_updated, 1);
+}
+
 int mpr_net_get_num_devs(mpr_net net)
 {
     return net->num_devs;
@@ -587,6 +1015,7 @@ int mpr_net_get_num_devs(mpr_net net)
 lo_server mpr_net_get_dev_server(mpr_net net, mpr_local_dev dev, dev_server_t idx)
 {
     int i;
+    RETURN_ARG_UNLESS(idx < NUM_DEV_SERVERS, 0);
     for (i = 0; i < net->num_devs; i++) {
         if (dev == net->devs[i])
             return net->servers[i * NUM_DEV_SERVERS + NUM_NET_SERVERS + idx];
@@ -594,32 +1023,79 @@ lo_server mpr_net_get_dev_server(mpr_net net, mpr_local_dev dev, dev_server_t id
     return 0;
 }
 
-void mpr_net_add_dev_server_method(mpr_net net, mpr_local_dev dev, const char *path,
-                                   lo_method_handler h, void *data)
+static mpr_dev_methods get_dev_methods(mpr_net net, mpr_local_dev dev)
 {
     int i;
     for (i = 0; i < net->num_devs; i++) {
-        int start, end, j;
-        if (dev != net->devs[i])
-            continue;
-        start = NUM_NET_SERVERS + i * NUM_DEV_SERVERS;
-        end = start + NUM_DEV_SERVERS;
-        for (j = start; j < end; j++)
-            lo_server_add_method(net->servers[j], path, NULL, h, data);
+        if (dev == net->devs[i])
+            return net->methods[i];
+    }
+    return 0;
+}
+
+static void grow_dev_methods(mpr_dev_methods tbl)
+{
+    int i, size = tbl->size ? tbl->size * 2 : 64;
+    mpr_dev_method *buckets = calloc(size, sizeof(mpr_dev_method));
+    for (i = 0; i < tbl->size; i++) {
+        while (tbl->buckets[i]) {
+            mpr_dev_method m = tbl->buckets[i];
+            tbl->buckets[i] = m->next;
+            m->next = buckets[m->hash & (size - 1)];
+            buckets[m->hash & (size - 1)] = m;
+        }
+    }
+    FUNC_IF(free, tbl->buckets);
+    tbl->buckets = buckets;
+    tbl->size = size;
+}
+
+void mpr_net_add_dev_server_method(mpr_net net, mpr_local_dev dev, const char *path,
+                                   lo_method_handler h, void *data)
+{
+    mpr_dev_methods tbl = get_dev_methods(net, dev);
+    mpr_dev_method m;
+    uint32_t hash;
+    RETURN_UNLESS(tbl && path);
+
+    hash = mpr_path_hash(path);
+    for (m = tbl->size ? tbl->buckets[hash & (tbl->size - 1)] : 0; m; m = m->next) {
+        if (hash == m->hash && 0 == strcmp(path, m->path)) {
+            /* replace the existing method */
+            m->h = h;
+            m->data = data;
+            return;
+        }
     }
+    if (tbl->num >= tbl->size)
+        grow_dev_methods(tbl);
+    m = malloc(sizeof(mpr_dev_method_t));
+    m->path = strdup(path);
+    m->hash = hash;
+    m->h = h;
+    m->data = data;
+    m->next = tbl->buckets[hash & (tbl->size - 1)];
+    tbl->buckets[hash & (tbl->size - 1)] = m;
+    ++tbl->num;
 }
 
 void mpr_net_remove_dev_server_method(mpr_net net, mpr_local_dev dev, const char *path)
 {
-    int i;
-    for (i = 0; i < net->num_devs; i++) {
-        int start, end, j;
-        if (dev != net->devs[i])
-            continue;
-        start = NUM_NET_SERVERS + i * NUM_DEV_SERVERS;
-        end = start + NUM_DEV_SERVERS;
-        for (j = start; j < end; j++)
-            lo_server_del_method(net->servers[j], path, NULL);
+    mpr_dev_methods tbl = get_dev_methods(net, dev);
+    mpr_dev_method *m;
+    uint32_t hash;
+    RETURN_UNLESS(tbl && tbl->size && path);
+
+    hash = mpr_path_hash(path);
+    for (m = &tbl->buckets[hash & (tbl->size - 1)]; *m; m = &(*m)->next) {
+        if (hash == (*m)->hash && 0 == strcmp(path, (*m)->path)) {
+            mpr_dev_method temp = *m;
+            *m = temp->next;
+            free(temp->path);
+            free(temp);
+            --tbl->num;
+            return;
+        }
     }
 }
 
@@ -638,6 +1114,19 @@ mpr_net mpr_net_new(mpr_graph g)
 {
     mpr_net net = (mpr_net) calloc(1, sizeof(mpr_net_t));
     net->graph = g;
+#ifdef HAVE_SYS_EPOLL_H
+    net->poller.fd = -1;
+#endif
+#ifdef HAVE_NET_POLLER
+    if (pipe(net->poller.wake)) {
+        trace("error: couldn't create wake-up pipe.\n");
+        net->poller.wake[0] = net->poller.wake[1] = -1;
+    }
+    else {
+        fcntl(net->poller.wake[0], F_SETFL, O_NONBLOCK);
+        fcntl(net->poller.wake[1], F_SETFL, O_NONBLOCK);
+    }
+#endif
     mpr_net_init(net, 0, 0, 0);
     return net;
 }
@@ -717,6 +1206,9 @@ int mpr_net_init(mpr_net net, const char *iface, const char *group, int port)
 
     /* Disable liblo message queueing and add methods. */
     lo_server_enable_queue(temp_server1, 0, 1);
+#ifdef HAVE_RECV_TIMESTAMPS
+    enable_recv_timestamps(temp_server1);
+#endif
     mpr_net_add_graph_methods(net, temp_server1);
 
     /* Swap and free old server structure if necessary */
@@ -726,11 +1218,15 @@ int mpr_net_init(mpr_net net, const char *iface, const char *group, int port)
 
     /* Open address/server for UDP mesh communications */
     /* Use lo_server_new_from_config() so we can specify the network interface */
-    lo_server_config config = {sizeof(lo_server_config), NULL, NULL, net->iface.name, NULL, LO_UDP, handler_error, NULL};
+    lo_server_config config = {.size = sizeof(lo_server_config), .iface = net->iface.name,
+                               .proto = LO_UDP, .err_h = handler_error};
     while (!(temp_server1 = lo_server_new_from_config(&config))) {}
 
     /* Disable liblo message queueing and add methods. */
     lo_server_enable_queue(temp_server1, 0, 1);
+#ifdef HAVE_RECV_TIMESTAMPS
+    enable_recv_timestamps(temp_server1);
+#endif
     mpr_net_add_graph_methods(net, temp_server1);
 
     /* Swap and free old server structure if necessary */
@@ -755,6 +1251,9 @@ int mpr_net_init(mpr_net net, const char *iface, const char *group, int port)
     temp_server2 = net->servers[SERVER_MESH_TCP];
     net->servers[SERVER_MESH_TCP] = temp_server1;
     FUNC_IF(lo_server_free, temp_server2);
+#ifdef HAVE_NET_POLLER
+    net->poller.dirty = 1;
+#endif
 
     for (i = 0; i < net->num_devs; i++) {
         mpr_net_add_dev(net, net->devs[i]);
@@ -775,6 +1274,14 @@ const char *mpr_net_get_address(mpr_net net)
     return net->addr.url;
 }
 
+int mpr_net_get_host_is_local(mpr_net net, const char *host)
+{
+    RETURN_ARG_UNLESS(host, 0);
+    if (!strcmp(host, "127.0.0.1") || !strcmp(host, "localhost"))
+        return 1;
+    return !strcmp(host, inet_ntoa(net->iface.addr));
+}
+
 const char *mpr_get_version(void)
 {
     return PACKAGE_VERSION;
@@ -813,8 +1320,411 @@ void mpr_net_send(mpr_net net)
             lo_send_bundle_from(net->addr.bus, net->servers[SERVER_MESH_UDP], bundle);
             break;
     }
-
-    lo_bundle_free_recursive(bundle);
+
+    lo_bundle_free_recursive(bundle);
+}
+
+int mpr_net_resolve_dst(mpr_net_dst dst, const char *host, const char *port)
+{
+#ifdef HAVE_RAW_DGRAMS
+    struct addrinfo hints, *res;
+    dst->len = 0;
+    RETURN_ARG_UNLESS(host && port, 0);
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    RETURN_ARG_UNLESS(!getaddrinfo(host, port, &hints, &res), 0);
+    if (res->ai_addrlen <= sizeof(dst->addr)) {
+        memcpy(dst->addr, res->ai_addr, res->ai_addrlen);
+        dst->len = res->ai_addrlen;
+    }
+    freeaddrinfo(res);
+    return dst->len > 0;
+#else
+    dst->len = 0;
+    return 0;
+#endif
+}
+
+#ifdef HAVE_SENDMMSG
+static void queue_dgram(mpr_net net, lo_server server, mpr_net_dst dst, size_t offset, size_t len)
+{
+    int idx = net->send_q.num++;
+    net->send_q.server = server;
+    net->send_q.offsets[idx] = offset;
+    net->send_q.iov[idx].iov_len = len;
+    memcpy(&net->send_q.addrs[idx], dst->addr, dst->len);
+    memset(&net->send_q.msgs[idx].msg_hdr, 0, sizeof(struct msghdr));
+    net->send_q.msgs[idx].msg_hdr.msg_name = &net->send_q.addrs[idx];
+    net->send_q.msgs[idx].msg_hdr.msg_namelen = dst->len;
+}
+#endif
+
+#ifdef HAVE_SENDMMSG
+/* Return space for a datagram of the given length at the end of the send queue. */
+static char *reserve_dgram(mpr_net net, lo_server server, size_t len)
+{
+    if (net->send_q.num >= SEND_BATCH || (net->send_q.num && server != net->send_q.server))
+        mpr_net_flush_dgrams(net);
+    if (net->send_q.len + len > net->send_q.size) {
+        net->send_q.size = net->send_q.size ? net->send_q.size * 2 : MAX_BUNDLE_LEN;
+        if (net->send_q.size < net->send_q.len + len)
+            net->send_q.size = net->send_q.len + len;
+        net->send_q.buf = realloc(net->send_q.buf, net->send_q.size);
+    }
+    return net->send_q.buf + net->send_q.len;
+}
+#endif
+
+int mpr_net_queue_dgram(mpr_net net, lo_server server, mpr_net_dst dst, lo_bundle bundle)
+{
+#ifdef HAVE_SENDMMSG
+    size_t len;
+    char *buf;
+    RETURN_ARG_UNLESS(server && dst && dst->len > 0, 0);
+    RETURN_ARG_UNLESS(dst->len <= (int)sizeof(struct sockaddr_storage), 0);
+    len = lo_bundle_length(bundle);
+    RETURN_ARG_UNLESS(len <= MAX_DGRAM_LEN, 0);
+
+    buf = reserve_dgram(net, server, len);
+    RETURN_ARG_UNLESS(lo_bundle_serialise(bundle, buf, &len), 0);
+
+    queue_dgram(net, server, dst, net->send_q.len, len);
+    net->send_q.len += len;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int mpr_net_send_dgram(mpr_net net, lo_server server, mpr_net_dst dst, const char *data,
+                       size_t len)
+{
+#ifdef HAVE_RAW_DGRAMS
+    RETURN_ARG_UNLESS(server && dst && dst->len > 0 && len <= MAX_DGRAM_LEN, 0);
+#ifdef HAVE_SENDMMSG
+    RETURN_ARG_UNLESS(dst->len <= (int)sizeof(struct sockaddr_storage), 0);
+    memcpy(reserve_dgram(net, server, len), data, len);
+    queue_dgram(net, server, dst, net->send_q.len, len);
+    net->send_q.len += len;
+    return 1;
+#else
+    return sendto(lo_server_get_socket_fd(server), data, len, 0,
+                  (const struct sockaddr*)dst->addr, dst->len) >= 0;
+#endif
+#else
+    return 0;
+#endif
+}
+
+size_t mpr_net_serialise(mpr_net net, lo_bundle bundle)
+{
+    size_t len = lo_bundle_length(bundle);
+#ifdef HAVE_SENDMMSG
+    /* queued datagrams may still refer to the previous contents */
+    if (net->send_q.num_shared)
+        mpr_net_flush_dgrams(net);
+#endif
+    if (len > net->shared.size) {
+        net->shared.size = len > MAX_BUNDLE_LEN ? len : MAX_BUNDLE_LEN;
+        net->shared.buf = realloc(net->shared.buf, net->shared.size);
+    }
+    if (!lo_bundle_serialise(bundle, net->shared.buf, &len))
+        len = 0;
+    net->shared.len = len;
+    return len;
+}
+
+int mpr_net_send_serialised(mpr_net net, lo_server server, mpr_net_dst dst)
+{
+#ifdef HAVE_RAW_DGRAMS
+    RETURN_ARG_UNLESS(server && dst && dst->len > 0, 0);
+    RETURN_ARG_UNLESS(net->shared.len && net->shared.len <= MAX_DGRAM_LEN, 0);
+#ifdef HAVE_SENDMMSG
+    if (net->send_q.num >= SEND_BATCH || (net->send_q.num && server != net->send_q.server))
+        mpr_net_flush_dgrams(net);
+    queue_dgram(net, server, dst, SHARED_OFFSET, net->shared.len);
+    ++net->send_q.num_shared;
+    return 1;
+#else
+    return sendto(lo_server_get_socket_fd(server), net->shared.buf, net->shared.len, 0,
+                  (const struct sockaddr*)dst->addr, dst->len) >= 0;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void mpr_net_flush_dgrams(mpr_net net)
+{
+#ifdef HAVE_SENDMMSG
+    int i, sent = 0, num = net->send_q.num, fd;
+    RETURN_UNLESS(num);
+    fd = lo_server_get_socket_fd(net->send_q.server);
+
+    /* the buffer may have moved while queueing so set the data pointers now */
+    for (i = 0; i < num; i++) {
+        if (SHARED_OFFSET == net->send_q.offsets[i])
+            net->send_q.iov[i].iov_base = net->shared.buf;
+        else
+            net->send_q.iov[i].iov_base = net->send_q.buf + net->send_q.offsets[i];
+        net->send_q.msgs[i].msg_hdr.msg_iov = &net->send_q.iov[i];
+        net->send_q.msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while (sent < num) {
+        int ret = sendmmsg(fd, net->send_q.msgs + sent, num - sent, 0);
+        if (ret <= 0) {
+            trace("error: sendmmsg failed, dropping %d datagrams.\n", num - sent);
+            break;
+        }
+        sent += ret;
+    }
+    net->send_q.num = 0;
+    net->send_q.num_shared = 0;
+    net->send_q.len = 0;
+    net->send_q.server = 0;
+#endif
+}
+
+/* Each signal gets its own administratively-scoped group and port, derived from the signal id.
+ * Groups already used by other local signals are skipped; signals of other devices may still
+ * collide, so updates are addressed to the full signal name and receivers only dispatch the
+ * signals they subscribed to. */
+static void get_mcast_spec(mpr_net net, mpr_sig sig, char *spec)
+{
+    mpr_id id = mpr_obj_get_id((mpr_obj)sig);
+    uint32_t hash = (uint32_t)(id ^ (id >> 32)), probe;
+    int i;
+    for (probe = 0; probe <= (uint32_t)net->mcast.num_out; probe++) {
+        /* probe with a large odd stride; a group is only shared if every probe collides */
+        uint32_t h = hash + probe * 0x9E3779B9;
+        snprintf(spec, MCAST_SPEC_LEN, "239.255.%u.%u:%d", (h >> 8) & 0xFF, 1 + (h & 0xFF) % 254,
+                 net->multicast.port + 1 + (int)((h >> 16) % MCAST_NUM_PORTS));
+        for (i = 0; i < net->mcast.num_out; i++) {
+            if (0 == strcmp(net->mcast.out[i]->spec, spec))
+                break;
+        }
+        if (i == net->mcast.num_out)
+            return;
+    }
+}
+
+static int split_mcast_spec(const char *spec, char *group, char *port)
+{
+    const char *colon = strrchr(spec, ':');
+    RETURN_ARG_UNLESS(colon && colon > spec && colon - spec < MCAST_SPEC_LEN, 0);
+    snprintf(group, colon - spec + 1, "%s", spec);
+    snprintf(port, 8, "%s", colon + 1);
+    return 1;
+}
+
+static void free_mcast_group(mpr_mcast_group group)
+{
+    int i;
+    FUNC_IF(lo_address_free, group->addr);
+    FUNC_IF(lo_bundle_free_recursive, group->bundle);
+    FUNC_IF(lo_server_free, group->server);
+    for (i = 0; i < group->num_subs; i++)
+        free(group->subs[i].path);
+    FUNC_IF(free, group->subs);
+    free(group);
+}
+
+const char *mpr_net_get_sig_mcast(mpr_net net, mpr_sig sig, int use_inst)
+{
+    mpr_mcast_group group;
+    char host[MCAST_SPEC_LEN], port[8];
+    int i;
+
+    for (i = 0; i < net->mcast.num_out; i++) {
+        group = net->mcast.out[i];
+        if (group->sig != sig)
+            continue;
+        /* maps sharing the group must send identical messages */
+        RETURN_ARG_UNLESS(group->use_inst == use_inst, 0);
+        ++group->num_maps;
+        return group->spec;
+    }
+    RETURN_ARG_UNLESS(net->iface.name && net->multicast.port, 0);
+
+    group = (mpr_mcast_group)calloc(1, sizeof(mpr_mcast_group_t));
+    get_mcast_spec(net, sig, group->spec);
+    split_mcast_spec(group->spec, host, port);
+    if (!(group->addr = lo_address_new(host, port))) {
+        trace("problem allocating multicast address for signal '%s'.\n", mpr_sig_get_name(sig));
+        free(group);
+        return 0;
+    }
+    /* same scope and interface as the bus */
+    lo_address_set_ttl(group->addr, 1);
+    lo_address_set_iface(group->addr, net->iface.name, 0);
+    group->sig = sig;
+    group->use_inst = use_inst;
+    group->num_maps = 1;
+
+    i = ++net->mcast.num_out;
+    net->mcast.out = realloc(net->mcast.out, i * sizeof(mpr_mcast_group));
+    net->mcast.out[i - 1] = group;
+    trace("sending updates of signal '%s' to multicast group %s\n", mpr_sig_get_name(sig),
+          group->spec);
+    return group->spec;
+}
+
+void mpr_net_remove_sig_mcast(mpr_net net, mpr_sig sig)
+{
+    int i;
+    for (i = 0; i < net->mcast.num_out; i++) {
+        if (net->mcast.out[i]->sig != sig)
+            continue;
+        free_mcast_group(net->mcast.out[i]);
+        net->mcast.out[i] = net->mcast.out[--net->mcast.num_out];
+        return;
+    }
+}
+
+void mpr_net_release_sig_mcast(mpr_net net, mpr_sig sig)
+{
+    int i;
+    for (i = 0; i < net->mcast.num_out; i++) {
+        if (net->mcast.out[i]->sig != sig)
+            continue;
+        if (--net->mcast.out[i]->num_maps <= 0) {
+            trace("closing multicast group %s\n", net->mcast.out[i]->spec);
+            free_mcast_group(net->mcast.out[i]);
+            net->mcast.out[i] = net->mcast.out[--net->mcast.num_out];
+        }
+        return;
+    }
+}
+
+int mpr_net_add_mcast_msg(mpr_net net, mpr_sig sig, int use_inst, lo_message msg, mpr_time time)
+{
+    mpr_mcast_group group = 0;
+    char path[256];
+    int i;
+
+    for (i = 0; i < net->mcast.num_out; i++) {
+        if (net->mcast.out[i]->sig == sig) {
+            group = net->mcast.out[i];
+            break;
+        }
+    }
+    /* a map whose instance handling has changed since it joined must use its own link */
+    RETURN_ARG_UNLESS(group && msg && group->use_inst == use_inst, 0);
+    if (!group->bundle)
+        group->bundle = lo_bundle_new(time);
+    else if (!lo_bundle_count(group->bundle))
+        lo_bundle_set_timestamp(group->bundle, time);
+    else {
+        /* the maps sending to the group build identical messages, so the first is shared */
+        return 1;
+    }
+    path[0] = '/';
+    mpr_sig_get_full_name(sig, path + 1, 255);
+    lo_bundle_add_message(group->bundle, path, msg);
+    return 1;
+}
+
+void mpr_net_send_mcast(mpr_net net)
+{
+    int i;
+    for (i = 0; i < net->mcast.num_out; i++) {
+        mpr_mcast_group group = net->mcast.out[i];
+        if (!group->bundle || !lo_bundle_count(group->bundle))
+            continue;
+        lo_send_bundle(group->addr, group->bundle);
+        lo_bundle_clear(group->bundle);
+    }
+}
+
+static int handler_mcast(const char *path, const char *types, lo_arg **av, int ac,
+                         lo_message msg, void *user)
+{
+    mpr_mcast_group group = (mpr_mcast_group)user;
+    int i;
+    for (i = 0; i < group->num_subs; i++) {
+        if (0 == strcmp(path, group->subs[i].path))
+            mpr_local_map_recv_mcast(group->subs[i].map, types, av, ac, msg);
+    }
+    return 0;
+}
+
+int mpr_net_join_mcast(mpr_net net, const char *spec, const char *path, mpr_local_map map)
+{
+    mpr_mcast_group group = 0;
+    char host[MCAST_SPEC_LEN], port[8];
+    int i;
+
+    for (i = 0; i < net->mcast.num_in; i++) {
+        if (0 == strcmp(net->mcast.in[i]->spec, spec)) {
+            group = net->mcast.in[i];
+            break;
+        }
+    }
+    if (!group) {
+        RETURN_ARG_UNLESS(split_mcast_spec(spec, host, port), 1);
+        group = (mpr_mcast_group)calloc(1, sizeof(mpr_mcast_group_t));
+        snprintf(group->spec, MCAST_SPEC_LEN, "%s", spec);
+        group->server = lo_server_new_multicast_iface(host, port, net->iface.name, 0,
+                                                      handler_error);
+        if (!group->server) {
+            trace("problem joining multicast group %s.\n", spec);
+            free(group);
+            return 1;
+        }
+#ifdef IP_MULTICAST_ALL
+        {
+            /* by default Linux delivers the datagrams of every group joined on the host to all
+             * sockets bound to the port; only receive those of the group joined here */
+            int all = 0;
+            setsockopt(lo_server_get_socket_fd(group->server), IPPROTO_IP, IP_MULTICAST_ALL,
+                       &all, sizeof(int));
+        }
+#endif
+        /* Disable liblo message queueing and add handlers. */
+        lo_server_enable_queue(group->server, 0, 1);
+        lo_server_add_bundle_handlers(group->server, mpr_net_bundle_start, NULL, (void*)net);
+        lo_server_add_method(group->server, NULL, NULL, handler_mcast, group);
+
+        i = ++net->mcast.num_in;
+        net->mcast.in = realloc(net->mcast.in, i * sizeof(mpr_mcast_group));
+        net->mcast.in[i - 1] = group;
+#ifdef HAVE_NET_POLLER
+        net->poller.dirty = 1;
+#endif
+        trace("joined multicast group %s\n", spec);
+    }
+    i = ++group->num_subs;
+    group->subs = realloc(group->subs, i * sizeof(mpr_mcast_sub_t));
+    group->subs[i - 1].path = strdup(path);
+    group->subs[i - 1].map = map;
+    return 0;
+}
+
+void mpr_net_leave_mcast(mpr_net net, const char *spec, mpr_local_map map)
+{
+    int i, j;
+    for (i = 0; i < net->mcast.num_in; i++) {
+        mpr_mcast_group group = net->mcast.in[i];
+        if (strcmp(group->spec, spec))
+            continue;
+        for (j = 0; j < group->num_subs; j++) {
+            if (group->subs[j].map != map)
+                continue;
+            free(group->subs[j].path);
+            group->subs[j] = group->subs[--group->num_subs];
+            break;
+        }
+        if (!group->num_subs) {
+            free_mcast_group(group);
+            net->mcast.in[i] = net->mcast.in[--net->mcast.num_in];
+#ifdef HAVE_NET_POLLER
+            net->poller.dirty = 1;
+#endif
+            trace("left multicast group %s\n", spec);
+        }
+        return;
+    }
 }
 
 static int init_bundle(mpr_net net, mpr_time *time)
@@ -906,7 +1816,44 @@ void mpr_net_free(mpr_net net)
     for (i = 0; i < net->num_servers; i++)
         FUNC_IF(lo_server_free, net->servers[i]);
     free(net->servers);
+    for (i = 0; i < net->num_devs; i++)
+        free_dev_methods(net->methods[i]);
+    FUNC_IF(free, net->methods);
     free(net->server_status);
+    FUNC_IF(free, net->subscribed);
+#ifdef HAVE_NET_POLLER
+    for (i = 0; i < net->poller.num_conns; i++) {
+        close(net->poller.conns[i].fd);
+        FUNC_IF(free, net->poller.conns[i].buf);
+    }
+    FUNC_IF(free, net->poller.conns);
+#ifdef HAVE_SYS_EPOLL_H
+    if (net->poller.fd >= 0)
+        close(net->poller.fd);
+#else
+    FUNC_IF(free, net->poller.fds);
+#endif
+    if (net->poller.wake[0] >= 0) {
+        close(net->poller.wake[0]);
+        close(net->poller.wake[1]);
+    }
+#endif
+#ifdef HAVE_RECVMMSG
+    FUNC_IF(free, net->recv_q.buf);
+#endif
+#ifdef HAVE_SENDMMSG
+    FUNC_IF(free, net->send_q.buf);
+#endif
+    FUNC_IF(free, net->shared.buf);
+    for (i = 0; i < NUM_NET_LINK_LISTS; i++)
+        FUNC_IF(free, net->links[i].links);
+
+    for (i = 0; i < net->mcast.num_out; i++)
+        free_mcast_group(net->mcast.out[i]);
+    FUNC_IF(free, net->mcast.out);
+    for (i = 0; i < net->mcast.num_in; i++)
+        free_mcast_group(net->mcast.in[i]);
+    FUNC_IF(free, net->mcast.in);
 
     FUNC_IF(lo_address_free, net->addr.bus);
 #ifndef WIN32
@@ -932,9 +1879,56 @@ static void send_device_sync(mpr_net net, mpr_local_dev dev)
     NEW_LO_MSG(msg, return);
     lo_message_add_string(msg, mpr_dev_get_name((mpr_dev)dev));
     lo_message_add_int32(msg, mpr_obj_get_version((mpr_obj)dev));
+    lo_message_add_int32(msg, net->sync.interval ? net->sync.interval : SYNC_MIN_SEC);
     mpr_net_add_msg(net, 0, MSG_SYNC, msg);
 }
 
+/* Estimate the number of devices on the bus from the sync messages heard since the last
+ * heartbeat, each standing for a device syncing at the interval it advertises, and scale the
+ * interval so that the whole bus sends about SYNC_BUS_RATE sync messages per second. */
+static void update_sync_interval(mpr_net net, uint32_t now)
+{
+    double elapsed = now - net->sync.last, population;
+    int interval;
+    if (!net->sync.interval)
+        net->sync.interval = SYNC_MIN_SEC;
+    /* forced heartbeats are too close together to give a useful estimate */
+    RETURN_UNLESS(!net->sync.last || elapsed >= SYNC_MIN_SEC);
+    if (net->sync.last) {
+        /* heartbeats are spaced by the interval plus half the jitter on average */
+        population = net->sync.heard / elapsed * (1 + SYNC_JITTER / 2);
+        if (net->sync.population)
+            population = (net->sync.population + population) * 0.5;
+        net->sync.population = population;
+        interval = population / (SYNC_BUS_RATE * (1 + SYNC_JITTER / 2));
+        if (interval < SYNC_MIN_SEC)
+            interval = SYNC_MIN_SEC;
+        else if (interval > SYNC_MAX_SEC)
+            interval = SYNC_MAX_SEC;
+        if (interval != net->sync.interval)
+            trace("estimated %g devices on the bus, syncing every %d seconds\n", population, interval);
+        net->sync.interval = interval;
+    }
+    net->sync.last = now;
+    net->sync.heard = 0;
+}
+
+int mpr_net_get_sync_timeout(mpr_net net, mpr_dev dev)
+{
+    int interval = dev ? mpr_dev_get_sync_interval(dev) : 0, timeout;
+    if (interval) {
+        /* keep the same margin over the longest heartbeat period as with the shortest interval */
+        if (interval <= SYNC_MIN_SEC)
+            return TIMEOUT_SEC;
+        return TIMEOUT_SEC * interval / SYNC_MIN_SEC;
+    }
+    /* Devices that do not advertise an interval may sync on a fixed schedule, so never expire
+     * them sooner than before heartbeats were scaled. The local interval is still used when it
+     * is longer, since devices only known from maps or links may be scaling theirs too. */
+    timeout = TIMEOUT_SEC * net->sync.interval / SYNC_MIN_SEC;
+    return timeout > TIMEOUT_SEC ? timeout : TIMEOUT_SEC;
+}
+
 /* TODO: rename to mpr_dev...? */
 static void mpr_net_maybe_send_ping(mpr_net net, int force)
 {
@@ -959,26 +1953,32 @@ static void mpr_net_maybe_send_ping(mpr_net net, int force)
         }
     }
     RETURN_UNLESS(net->num_devs);
-    if (!force && (now.sec < net->next_bus_ping))
+    if (force || now.sec >= net->next_link_ping) {
+        /* housekeeping #2: periodically check if our links are still active; link pings are
+         * sent to the linked devices only so they are not scaled with the bus population */
+        net->next_link_ping = now.sec + 5 + (rand() % 4);
+        list = mpr_graph_get_list(gph, MPR_LINK);
+        while (list) {
+            mpr_link link = (mpr_link)*list;
+            /* get next since link may be expired/removed */
+            list = mpr_list_get_next(list);
+            if (mpr_obj_get_is_local((mpr_obj)link)) {
+                mpr_link_housekeeping(link, now);
+            }
+        }
+    }
+    if (!force && (now.sec < net->sync.next))
         return;
-    net->next_bus_ping = now.sec + 5 + (rand() % 4);
+    update_sync_interval(net, now.sec);
+    net->sync.next = (now.sec + net->sync.interval
+                      + (rand() % ((int)(net->sync.interval * SYNC_JITTER) + 1)));
 
+    /* the syncs of all local devices share the bus bundle */
     mpr_net_use_bus(net);
     for (i = 0; i < net->num_devs; i++) {
         if (mpr_dev_get_is_registered((mpr_dev)net->devs[i]))
             send_device_sync(net, net->devs[i]);
     }
-
-    /* housekeeping #2: periodically check if our links are still active */
-    list = mpr_graph_get_list(gph, MPR_LINK);
-    while (list) {
-        mpr_link link = (mpr_link)*list;
-        /* get next since link may be expired/removed */
-        list = mpr_list_get_next(list);
-        if (mpr_obj_get_is_local((mpr_obj)link)) {
-            mpr_link_housekeeping(link, now);
-        }
-    }
 }
 
 /*! This is the main function to be called once in a while from a program so
@@ -1012,20 +2012,531 @@ static void mpr_net_housekeeping(mpr_net net, int force_ping)
     return;
 }
 
+void mpr_net_add_link(mpr_net net, mpr_link link, net_link_list_t list)
+{
+    if (net->links[list].num >= net->links[list].size) {
+        net->links[list].size = net->links[list].size ? net->links[list].size * 2 : 4;
+        net->links[list].links = realloc(net->links[list].links,
+                                         net->links[list].size * sizeof(mpr_link));
+    }
+    net->links[list].links[net->links[list].num++] = link;
+}
+
+void mpr_net_remove_link(mpr_net net, mpr_link link, net_link_list_t list)
+{
+    int i;
+    for (i = 0; i < net->links[list].num; i++) {
+        if (net->links[list].links[i] == link) {
+            net->links[list].links[i] = net->links[list].links[--net->links[list].num];
+            return;
+        }
+    }
+}
+
+/* Check the shared memory rings of links to remote devices on the same host. If waiting is
+ * set, mark the rings as waiting and return whether any data is pending; otherwise clear the
+ * flag and dispatch the waiting bundles. Lists are walked from the end since handlers may
+ * remove links. */
+static int poll_shm(mpr_net net, int waiting)
+{
+    int i, count = 0;
+    for (i = net->links[NET_LINKS_SHM].num - 1; i >= 0; i--) {
+        mpr_link link;
+        if (i >= net->links[NET_LINKS_SHM].num)
+            continue;
+        link = net->links[NET_LINKS_SHM].links[i];
+        if (waiting)
+            count += mpr_link_set_shm_waiting(link, 1);
+        else {
+            mpr_link_set_shm_waiting(link, 0);
+            count += mpr_link_recv_shm(link);
+        }
+    }
+    return count;
+}
+
+/* Retry writing outbound TCP queues backed up by slow receivers. Returns the number of links
+ * that still have data waiting. */
+static int flush_tcp_queues(mpr_net net)
+{
+    int i, pending = 0;
+    /* flushing removes links whose queue has drained from the list */
+    for (i = net->links[NET_LINKS_TCP].num - 1; i >= 0; i--)
+        pending += mpr_link_flush_tcp(net->links[NET_LINKS_TCP].links[i]);
+    return pending;
+}
+
+/* Retry writing bundles held back by full shared memory rings. Returns the number of links that
+ * still have bundles held. */
+static int flush_shm_rings(mpr_net net)
+{
+    int i, pending = 0;
+    for (i = net->links[NET_LINKS_SHM_HELD].num - 1; i >= 0; i--)
+        pending += mpr_link_flush_shm(net->links[NET_LINKS_SHM_HELD].links[i]);
+    return pending;
+}
+
+/* Send any paced link bundles that are due. Returns the number of milliseconds until the next
+ * held bundle is due, or -1 if no messages are being held. */
+static int flush_paced_links(mpr_net net)
+{
+    int i, next_ms = -1;
+    /* sending the held bundle removes a link from the list */
+    for (i = net->links[NET_LINKS_PACED].num - 1; i >= 0; i--) {
+        int ms = mpr_link_flush_paced(net->links[NET_LINKS_PACED].links[i]);
+        if (ms >= 0 && (next_ms < 0 || ms < next_ms))
+            next_ms = ms;
+    }
+    mpr_net_flush_dgrams(net);
+    return next_ms;
+}
+
+/* Fire the reliable UDP retransmit timers that are due. Returns the number of milliseconds until
+ * the next one, or -1 if none is armed. */
+static int check_rudp_links(mpr_net net)
+{
+    int i, next_ms = -1;
+    /* disarming both timers removes a link from the list */
+    for (i = net->links[NET_LINKS_RUDP].num - 1; i >= 0; i--) {
+        int ms = mpr_link_check_rudp(net->links[NET_LINKS_RUDP].links[i]);
+        if (ms >= 0 && (next_ms < 0 || ms < next_ms))
+            next_ms = ms;
+    }
+    return next_ms;
+}
+
+#ifdef HAVE_NET_POLLER
+MPR_INLINE static int is_data_tcp_server(int idx)
+{
+    return idx >= NUM_NET_SERVERS && SERVER_DATA_TCP == (idx - NUM_NET_SERVERS) % NUM_DEV_SERVERS;
+}
+
+/* Watch a socket. The poll() fallback keeps the sockets in an array at the given index. */
+static void poller_watch(mpr_net net, int fd, uint32_t data, int idx)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev;
+    RETURN_UNLESS(fd >= 0);
+    ev.events = EPOLLIN;
+    ev.data.u32 = data;
+    epoll_ctl(net->poller.fd, EPOLL_CTL_ADD, fd, &ev);
+#else
+    net->poller.fds[idx].fd = fd;
+    net->poller.fds[idx].events = POLLIN;
+    net->poller.fds[idx].revents = 0;
+#endif
+}
+
+static int has_server(mpr_net net, lo_server server)
+{
+    int i;
+    for (i = 0; i < net->num_servers; i++) {
+        if (net->servers[i] == server)
+            return 1;
+    }
+    return 0;
+}
+
+/* Close an accepted TCP connection. The last connection takes its place. */
+static void tcp_conn_close(mpr_net net, int i)
+{
+    mpr_tcp_conn_t *conns = net->poller.conns;
+    int last = --net->poller.num_conns;
+#ifdef HAVE_SYS_EPOLL_H
+    if (net->poller.fd >= 0)
+        epoll_ctl(net->poller.fd, EPOLL_CTL_DEL, conns[i].fd, NULL);
+#endif
+    close(conns[i].fd);
+    FUNC_IF(free, conns[i].buf);
+    RETURN_UNLESS(i != last);
+    conns[i] = conns[last];
+#ifdef HAVE_SYS_EPOLL_H
+    if (net->poller.fd >= 0) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = TCP_EVENT | i;
+        epoll_ctl(net->poller.fd, EPOLL_CTL_MOD, conns[i].fd, &ev);
+    }
+#else
+    if (!net->poller.dirty) {
+        int base = net->num_servers + net->mcast.num_in + 1;
+        net->poller.fds[base + i] = net->poller.fds[base + last];
+    }
+#endif
+}
+
+/* Close the connections accepted by a device TCP server before it is freed. */
+static void close_tcp_conns(mpr_net net, lo_server server)
+{
+    int i;
+    /* the watched sockets are rebuilt once the servers array has been updated */
+    net->poller.dirty = 1;
+    for (i = net->poller.num_conns - 1; i >= 0; i--) {
+        if (net->poller.conns[i].server == server)
+            tcp_conn_close(net, i);
+    }
+}
+
+/* Rebuild the set of watched sockets after servers have been added or removed. The server
+ * sockets come first, followed by the signal multicast servers, the wake-up pipe, and the
+ * accepted TCP connections. */
+static void poller_rebuild(mpr_net net)
+{
+    int i, base;
+
+    /* close connections accepted by device servers that have been removed */
+    for (i = net->poller.num_conns - 1; i >= 0; i--) {
+        if (!has_server(net, net->poller.conns[i].server))
+            tcp_conn_close(net, i);
+    }
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (net->poller.fd >= 0)
+        close(net->poller.fd);
+    net->poller.fd = epoll_create1(0);
+    if (net->poller.fd < 0) {
+        trace("error: couldn't create epoll instance.\n");
+        return;
+    }
+#else
+    net->poller.fds = realloc(net->poller.fds, (net->num_servers + net->mcast.num_in + 1
+                                                + net->poller.size_conns) * sizeof(struct pollfd));
+#endif
+    for (i = 0; i < net->num_servers; i++) {
+        int fd = net->servers[i] ? lo_server_get_socket_fd(net->servers[i]) : -1;
+        /* connections to device data servers are accepted by the poller */
+        if (fd >= 0 && is_data_tcp_server(i))
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        poller_watch(net, fd, i, i);
+    }
+    for (i = 0; i < net->mcast.num_in; i++)
+        poller_watch(net, lo_server_get_socket_fd(net->mcast.in[i]->server), MCAST_EVENT | i,
+                     net->num_servers + i);
+    base = net->num_servers + net->mcast.num_in;
+    poller_watch(net, net->poller.wake[0], WAKE_EVENT, base++);
+    for (i = 0; i < net->poller.num_conns; i++)
+        poller_watch(net, net->poller.conns[i].fd, TCP_EVENT | i, base + i);
+
+    memset(net->server_status, 0, net->num_servers * sizeof(int));
+    net->poller.dirty = 0;
+}
+
+/* Accept connections on a device TCP data server. liblo does not expose the sockets of the
+ * connections it accepts, so they are accepted here instead and watched with the other sockets. */
+static void tcp_accept(mpr_net net, int idx)
+{
+    int fd, base = net->num_servers + net->mcast.num_in + 1;
+    while ((fd = accept(lo_server_get_socket_fd(net->servers[idx]), NULL, NULL)) >= 0) {
+        mpr_tcp_conn c;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        if (net->poller.num_conns >= net->poller.size_conns) {
+            net->poller.size_conns = net->poller.size_conns ? net->poller.size_conns * 2 : 4;
+            net->poller.conns = realloc(net->poller.conns,
+                                        net->poller.size_conns * sizeof(mpr_tcp_conn_t));
+#ifndef HAVE_SYS_EPOLL_H
+            net->poller.fds = realloc(net->poller.fds, (base + net->poller.size_conns)
+                                      * sizeof(struct pollfd));
+#endif
+        }
+        c = &net->poller.conns[net->poller.num_conns];
+        memset(c, 0, sizeof(mpr_tcp_conn_t));
+        c->fd = fd;
+        c->server = net->servers[idx];
+        poller_watch(net, fd, TCP_EVENT | net->poller.num_conns, base + net->poller.num_conns);
+        ++net->poller.num_conns;
+    }
+}
+
+/* Receive from an accepted TCP connection and dispatch each complete packet. */
+static void tcp_conn_recv(mpr_net net, int i)
+{
+    mpr_tcp_conn c = &net->poller.conns[i];
+    size_t offset = 0;
+    ssize_t ret;
+
+    if (c->size - c->len < TCP_RECV_CHUNK) {
+        c->size = c->len + TCP_RECV_CHUNK;
+        c->buf = realloc(c->buf, c->size);
+    }
+    ret = recv(c->fd, c->buf + c->len, c->size - c->len, 0);
+    if (ret <= 0) {
+        if (ret < 0 && (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno))
+            return;
+        tcp_conn_close(net, i);
+        return;
+    }
+    c->len += ret;
+
+    /* packets are framed with their length in network byte order */
+    while (c->len - offset >= sizeof(uint32_t)) {
+        uint32_t len;
+        memcpy(&len, c->buf + offset, sizeof(uint32_t));
+        len = ntohl(len);
+        if (len > MAX_TCP_PACKET) {
+            trace("error: closing TCP connection sending a %u byte packet.\n", len);
+            tcp_conn_close(net, i);
+            return;
+        }
+        if (c->len - offset - sizeof(uint32_t) < len)
+            break;
+        lo_server_dispatch_data(c->server, c->buf + offset + sizeof(uint32_t), len);
+        offset += sizeof(uint32_t) + len;
+        /* stop if a handler has removed the device */
+        if (net->poller.dirty && !has_server(net, c->server)) {
+            tcp_conn_close(net, i);
+            return;
+        }
+    }
+    if (offset) {
+        memmove(c->buf, c->buf + offset, c->len - offset);
+        c->len -= offset;
+    }
+}
+
+/* Empty the wake-up pipe once the polling thread is awake. */
+static void poller_clear_wake(mpr_net net)
+{
+    char buf[64];
+    while (read(net->poller.wake[0], buf, sizeof(buf)) > 0) {}
+}
+
+#ifdef HAVE_RECVMMSG
+/* Drain up to RECV_BATCH datagrams from a device datagram server with a single system call. */
+static void recv_dgram_batch(mpr_net net, lo_server server)
+{
+    int i, num;
+    if (!net->recv_q.buf) {
+        net->recv_q.buf = malloc(RECV_BATCH * MAX_DGRAM_LEN);
+        for (i = 0; i < RECV_BATCH; i++) {
+            net->recv_q.iov[i].iov_base = net->recv_q.buf + i * MAX_DGRAM_LEN;
+            net->recv_q.iov[i].iov_len = MAX_DGRAM_LEN;
+        }
+    }
+    for (i = 0; i < RECV_BATCH; i++) {
+        memset(&net->recv_q.msgs[i].msg_hdr, 0, sizeof(struct msghdr));
+        net->recv_q.msgs[i].msg_hdr.msg_iov = &net->recv_q.iov[i];
+        net->recv_q.msgs[i].msg_hdr.msg_iovlen = 1;
+#ifdef HAVE_RECV_TIMESTAMPS
+        net->recv_q.msgs[i].msg_hdr.msg_control = net->recv_q.ctrl[i];
+        net->recv_q.msgs[i].msg_hdr.msg_controllen = RECV_CTRL_LEN;
+#endif
+    }
+    num = recvmmsg(lo_server_get_socket_fd(server), net->recv_q.msgs, RECV_BATCH,
+                   MSG_DONTWAIT, NULL);
+    for (i = 0; i < num; i++) {
+        if (net->recv_q.msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            trace("error: dropping truncated datagram.\n");
+            continue;
+        }
+#ifdef HAVE_RECV_TIMESTAMPS
+        net->recv_time.is_set = get_recv_time(&net->recv_q.msgs[i].msg_hdr, &net->recv_time.time);
+#endif
+        lo_server_dispatch_data(server, net->recv_q.iov[i].iov_base, net->recv_q.msgs[i].msg_len);
+    }
+    net->recv_time.is_set = 0;
+}
+#endif
+
+/* Wait for activity on the server sockets and receive only from the servers that are ready.
+ * Returns the number of network servers plus the number of devices that received data. */
+static int poller_recv(mpr_net net, int timeout_ms)
+{
+    int i, num_ready, count = 0;
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event events[MAX_POLL_EVENTS];
+#else
+    int base;
+#endif
+
+    if (net->poller.dirty)
+        poller_rebuild(net);
+    /* liblo does not expose the connections accepted by the TCP mesh server, and their handlers
+     * need the source address that only liblo provides, so once the server has accepted any they
+     * are also polled through liblo at a short interval */
+    if (net->poller.mesh_tcp && timeout_ms > MESH_TCP_POLL_MS)
+        timeout_ms = MESH_TCP_POLL_MS;
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (net->poller.fd < 0)
+        return 0;
+    num_ready = epoll_wait(net->poller.fd, events, MAX_POLL_EVENTS, timeout_ms);
+    for (i = 0; i < num_ready; i++) {
+        if (events[i].data.u32 & WAKE_EVENT)
+            poller_clear_wake(net);
+        else if (events[i].data.u32 & TCP_EVENT) {
+            /* a connection may have been moved by closing another one */
+            if ((int)(events[i].data.u32 & ~TCP_EVENT) < net->poller.num_conns)
+                tcp_conn_recv(net, events[i].data.u32 & ~TCP_EVENT);
+            ++count;
+            if (net->poller.dirty)
+                return count;
+        }
+        else if (events[i].data.u32 & MCAST_EVENT) {
+            lo_server_recv_noblock(net->mcast.in[events[i].data.u32 & ~MCAST_EVENT]->server, 0);
+            ++count;
+            /* stop if a handler has added or removed servers */
+            if (net->poller.dirty)
+                return count;
+        }
+        else
+            net->server_status[events[i].data.u32] = 1;
+    }
+#else
+    base = net->num_servers + net->mcast.num_in;
+    num_ready = poll(net->poller.fds, base + 1 + net->poller.num_conns, timeout_ms);
+    if (num_ready > 0 && net->poller.fds[base].revents & POLLIN)
+        poller_clear_wake(net);
+    /* from the last connection, since closing one moves the last into its place */
+    for (i = net->poller.num_conns - 1; num_ready > 0 && i >= 0 && !net->poller.dirty; i--) {
+        if (net->poller.fds[base + 1 + i].revents & (POLLIN | POLLHUP | POLLERR)) {
+            tcp_conn_recv(net, i);
+            ++count;
+        }
+    }
+    for (i = 0; num_ready > 0 && i < net->num_servers; i++)
+        net->server_status[i] = (net->poller.fds[i].revents & POLLIN) != 0;
+    for (i = 0; num_ready > 0 && i < net->mcast.num_in && !net->poller.dirty; i++) {
+        if (net->poller.fds[net->num_servers + i].revents & POLLIN) {
+            lo_server_recv_noblock(net->mcast.in[i]->server, 0);
+            ++count;
+        }
+    }
+#endif
+
+#ifdef HAVE_SYS_EPOLL_H
+    for (i = 0; i < num_ready; i++) {
+        int idx;
+        if (events[i].data.u32 & (MCAST_EVENT | WAKE_EVENT | TCP_EVENT))
+            continue;
+        idx = events[i].data.u32;
+#else
+    for (i = 0; num_ready > 0 && i < net->num_servers; i++) {
+        int idx = i;
+#endif
+        /* stop if a handler has added or removed servers */
+        if (net->poller.dirty)
+            break;
+        if (!net->server_status[idx])
+            continue;
+        if (is_data_tcp_server(idx)) {
+            tcp_accept(net, idx);
+            net->server_status[idx] = 0;
+            continue;
+        }
+#ifdef HAVE_RECVMMSG
+        if (idx >= NUM_NET_SERVERS)
+            recv_dgram_batch(net, net->servers[idx]);
+        else
+#endif
+        {
+#ifdef HAVE_RECV_TIMESTAMPS
+            /* admin messages are received by liblo since handlers need the source address */
+            if (SERVER_BUS == idx || SERVER_MESH_UDP == idx)
+                peek_recv_time(net, net->servers[idx]);
+#endif
+            lo_server_recv_noblock(net->servers[idx], 0);
+            net->recv_time.is_set = 0;
+        }
+        if (SERVER_MESH_TCP == idx)
+            net->poller.mesh_tcp = 1;
+        if (idx < NUM_NET_SERVERS)
+            ++count;
+        else {
+            /* count each device once, after the last of its ready servers */
+            int j, first = idx - (idx - NUM_NET_SERVERS) % NUM_DEV_SERVERS;
+            for (j = first; j < first + NUM_DEV_SERVERS; j++) {
+                if (j != idx && net->server_status[j])
+                    break;
+            }
+            if (j == first + NUM_DEV_SERVERS)
+                ++count;
+        }
+        net->server_status[idx] = 0;
+    }
+
+    if (net->poller.mesh_tcp && lo_server_recv_noblock(net->servers[SERVER_MESH_TCP], 0))
+        ++count;
+    return count;
+}
+#endif /* HAVE_NET_POLLER */
+
 MPR_INLINE static int mpr_min(int a, int b)
 {
     return a < b ? a : b;
 }
 
+int mpr_net_get_is_poll_thread(mpr_net net)
+{
+    RETURN_ARG_UNLESS(mpr_atomic_get(&net->has_poll_thread), 1);
+#ifdef HAVE_LIBPTHREAD
+    return pthread_equal(pthread_self(), net->poll_thread);
+#elif defined(HAVE_WIN32_THREADS)
+    return GetCurrentThreadId() == net->poll_thread;
+#else
+    return 1;
+#endif
+}
+
+/* Record the calling thread as the one polling the network. Updates made by other threads are
+ * queued for this thread from now on. */
+static void set_poll_thread(mpr_net net)
+{
+#if defined(HAVE_LIBPTHREAD) || defined(HAVE_WIN32_THREADS)
+    RETURN_UNLESS(!mpr_atomic_get(&net->has_poll_thread) || !mpr_net_get_is_poll_thread(net));
+    mpr_atomic_set(&net->has_poll_thread, 0);
+#ifdef HAVE_LIBPTHREAD
+    net->poll_thread = pthread_self();
+#else
+    net->poll_thread = GetCurrentThreadId();
+#endif
+    mpr_atomic_set(&net->has_poll_thread, 1);
+#endif
+}
+
+void mpr_net_wake(mpr_net net)
+{
+#ifdef HAVE_NET_POLLER
+    char c = 0;
+    if (net->poller.wake[1] >= 0 && write(net->poller.wake[1], &c, 1) < 0) {
+        /* the pipe is already full so the polling thread will wake anyway */
+    }
+#endif
+}
+
+/* Process map updates for the local devices. Devices are only visited once something has marked
+ * them updated or a timed map is due; returns the time in ms until the next timed map. */
+static int update_devs(mpr_net net)
+{
+    int i, next_ms = INT_MAX;
+    double now = mpr_get_current_time();
+
+    if (!mpr_atomic_swap(&net->devs_updated, 0)) {
+        if (!net->next_update)
+            return INT_MAX;
+        if (now < net->next_update)
+            return ceil((net->next_update - now) * 1000.);
+    }
+    for (i = 0; i < net->num_devs; i++)
+        next_ms = mpr_min(next_ms, mpr_local_dev_update_maps(net->devs[i]));
+    if (next_ms <= 0) {
+        /* updates are still pending */
+        mpr_atomic_set(&net->devs_updated, 1);
+        next_ms = 0;
+    }
+    net->next_update = (INT_MAX == next_ms) ? 0 : now + next_ms * 0.001;
+    return next_ms;
+}
+
 static int mpr_net_poll_internal(mpr_net net, int block_ms)
 {
-    int i, count = 0, left_ms = 0, elapsed_ms = 0, admin_elapsed_ms = 0;
+    int i, count = 0, left_ms = 0, elapsed_ms = 0, admin_elapsed_ms = 0, paced_ms;
     double then;
 
     if (++net->polling > 1) {
         trace("Network polling already in process.\n");
         return 0;
     }
+    set_poll_thread(net);
 
     then = mpr_get_current_time();
 
@@ -1041,12 +2552,12 @@ static int mpr_net_poll_internal(mpr_net net, int block_ms)
 
     do {
         register int recvd = 0;
+#ifdef HAVE_NET_POLLER
+        int num_recvd;
+#endif
 
-        left_ms = 100;
-        for (i = 0; i < net->num_devs; i++) {
-            /* reduce the time if devices need to be updated within left_ms window */
-            left_ms = mpr_min(left_ms, mpr_local_dev_update_maps(net->devs[i]));
-        }
+        /* reduce the time if devices need to be updated within a 100ms window */
+        left_ms = mpr_min(100, update_devs(net));
         if (block_ms > 0) {
             /* set timeout to a minimum of remaining block time or 100ms */
             elapsed_ms = (mpr_get_current_time() - then) * 1000.;
@@ -1057,6 +2568,32 @@ static int mpr_net_poll_internal(mpr_net net, int block_ms)
         else
             left_ms = 0;
 
+        /* don't block if a remote device on this host has already written to shared memory */
+        if (left_ms > 0 && poll_shm(net, 1))
+            left_ms = 0;
+
+        /* keep retrying queued TCP data while waiting */
+        if (flush_tcp_queues(net) && left_ms > TCP_POLL_MS)
+            left_ms = TCP_POLL_MS;
+
+        /* and bundles held back by full shared memory rings */
+        if (flush_shm_rings(net) && left_ms > TCP_POLL_MS)
+            left_ms = TCP_POLL_MS;
+
+        /* wake up in time to send paced bundles */
+        if ((paced_ms = flush_paced_links(net)) >= 0 && left_ms > paced_ms)
+            left_ms = paced_ms;
+
+        /* and in time to recover lost reliable UDP bundles */
+        if ((paced_ms = check_rudp_links(net)) >= 0 && left_ms > paced_ms)
+            left_ms = paced_ms;
+
+#ifdef HAVE_NET_POLLER
+        if ((num_recvd = poller_recv(net, left_ms))) {
+            count += num_recvd;
+            recvd = 1;
+        }
+#else
         if (lo_servers_recv_noblock(net->servers, net->server_status, net->num_servers, left_ms)) {
             int idx = NUM_NET_SERVERS;
             for (i = 0; i < NUM_NET_SERVERS; i++)
@@ -1073,6 +2610,17 @@ static int mpr_net_poll_internal(mpr_net net, int block_ms)
             }
             recvd = 1;
         }
+        for (i = 0; i < net->mcast.num_in; i++) {
+            if (lo_server_recv_noblock(net->mcast.in[i]->server, 0)) {
+                ++count;
+                recvd = 1;
+            }
+        }
+#endif
+        if (poll_shm(net, 0)) {
+            ++count;
+            recvd = 1;
+        }
 
         if (!recvd && block_ms < 0)
             break;
@@ -1086,8 +2634,12 @@ static int mpr_net_poll_internal(mpr_net net, int block_ms)
         }
     } while (block_ms < 0 || elapsed_ms < block_ms);
 
-    for (i = 0; i < net->num_devs; i++) {
-        mpr_dev_update_subscribers(net->devs[i]);
+    /* only devices that have been subscribed to need their subscriptions refreshed */
+    for (i = net->num_subscribed - 1; i >= 0; i--) {
+        if (mpr_local_dev_has_subscribers(net->subscribed[i]))
+            mpr_dev_update_subscribers(net->subscribed[i]);
+        else
+            net->subscribed[i] = net->subscribed[--net->num_subscribed];
     }
     mpr_graph_housekeeping(net->graph);
     net->polling = 0;
@@ -2063,6 +3615,8 @@ static int handler_mapped(const char *path, const char *types, lo_arg **av,
         /* TODO: refactor for clarity */
         mpr_map_set_from_msg(map, 0);
     }
+    if (mpr_obj_get_is_local((mpr_obj)map))
+        mpr_local_map_set_mcast((mpr_local_map)map, props);
     mpr_msg_free(props);
 
     if (mpr_obj_get_is_local((mpr_obj)map)) {
@@ -2367,7 +3921,8 @@ static int handler_ping(const char *path, const char *types, lo_arg **av,
     RETURN_ARG_UNLESS(net->num_devs, 0);
     trace_net(net);
 
-    mpr_time_set(&now, MPR_NOW);
+    /* use the kernel arrival time if available to exclude scheduling delays */
+    now = mpr_net_get_recv_time(net);
     then = lo_message_get_timestamp(msg);
 
     remote_dev = (mpr_dev)mpr_graph_get_obj(graph, av[0]->h, MPR_DEV);
@@ -2383,12 +3938,109 @@ static int handler_ping(const char *path, const char *types, lo_arg **av,
     return 0;
 }
 
+/* Catch-all method of the device data servers: look up the handler for the message path in the
+ * device method table. Paths containing any OSC pattern characters are matched against every
+ * method, as liblo would have done. */
+static int handler_dev_data(const char *path, const char *types, lo_arg **av,
+                            int ac, lo_message msg, void *user)
+{
+    mpr_dev_methods tbl = (mpr_dev_methods)user;
+    mpr_dev_method m;
+    uint32_t hash;
+    int i;
+    RETURN_ARG_UNLESS(tbl->size && path, 1);
+
+    if (!strpbrk(path, "*?[]{}")) {
+        hash = mpr_path_hash(path);
+        for (m = tbl->buckets[hash & (tbl->size - 1)]; m; m = m->next) {
+            if (hash == m->hash && 0 == strcmp(path, m->path))
+                return m->h(path, types, av, ac, msg, m->data);
+        }
+        return 1;
+    }
+    for (i = 0; i < tbl->size; i++) {
+        for (m = tbl->buckets[i]; m; m = m->next) {
+            if (lo_pattern_match(m->path, path))
+                m->h(m->path, types, av, ac, msg, m->data);
+        }
+    }
+    return 0;
+}
+
+/* Reliable UDP control messages start with the id of the sending device followed by sequence
+ * numbers. They arrive on the data server of the local device they are addressed to. */
+static int handler_rudp(const char *path, const char *types, lo_arg **av,
+                        int ac, lo_message msg, void *user)
+{
+    mpr_local_dev dev = (mpr_local_dev)user;
+    mpr_dev remote_dev;
+    mpr_link link;
+    int i;
+
+    RETURN_ARG_UNLESS(ac && MPR_INT64 == types[0], 0);
+    for (i = 1; i < ac; i++)
+        RETURN_ARG_UNLESS(MPR_INT32 == types[i], 0);
+    remote_dev = (mpr_dev)mpr_graph_get_obj(mpr_obj_get_graph((mpr_obj)dev), av[0]->h, MPR_DEV);
+    RETURN_ARG_UNLESS(remote_dev, 0);
+    link = mpr_dev_get_link_by_remote((mpr_dev)dev, remote_dev);
+    RETURN_ARG_UNLESS(link, 0);
+    mpr_link_recv_rudp(link, path, ac - 1, av + 1);
+    return 0;
+}
+
+/* Messages repeated for forward error correction are preceded by the id of the sending device
+ * and the sequence number of the bundle they were first sent in. Until the next sequence number
+ * or the end of the bundle, signal updates are skipped if that bundle has already arrived. */
+static int handler_fec(const char *path, const char *types, lo_arg **av,
+                       int ac, lo_message msg, void *user)
+{
+    mpr_local_dev dev = (mpr_local_dev)user;
+    mpr_graph graph = mpr_obj_get_graph((mpr_obj)dev);
+    mpr_net net = mpr_graph_get_net(graph);
+    mpr_dev remote_dev;
+    mpr_link link;
+
+    net->is_redundant = 0;
+    remote_dev = (mpr_dev)mpr_graph_get_obj(graph, av[0]->h, MPR_DEV);
+    RETURN_ARG_UNLESS(remote_dev, 0);
+    link = mpr_dev_get_link_by_remote((mpr_dev)dev, remote_dev);
+    RETURN_ARG_UNLESS(link, 0);
+    net->is_redundant = mpr_link_recv_fec(link, (uint32_t)av[1]->i32);
+    return 0;
+}
+
+/* Chunks of a datagram that was too large for the MTU are collected by the link to the sending
+ * device, which dispatches the datagram once it is complete. */
+static int handler_chunk(const char *path, const char *types, lo_arg **av,
+                         int ac, lo_message msg, void *user)
+{
+    mpr_local_dev dev = (mpr_local_dev)user;
+    mpr_dev remote_dev;
+    mpr_link link;
+
+    remote_dev = (mpr_dev)mpr_graph_get_obj(mpr_obj_get_graph((mpr_obj)dev), av[0]->h, MPR_DEV);
+    RETURN_ARG_UNLESS(remote_dev, 0);
+    link = mpr_dev_get_link_by_remote((mpr_dev)dev, remote_dev);
+    RETURN_ARG_UNLESS(link, 0);
+    mpr_link_recv_chunk(link, (uint32_t)av[1]->i32, av[2]->i32, av[3]->i32,
+                        lo_blob_dataptr((lo_blob)av[4]), lo_blob_datasize((lo_blob)av[4]));
+    return 0;
+}
+
 static int handler_sync(const char *path, const char *types, lo_arg **av,
                         int ac, lo_message msg, void *user)
 {
     mpr_graph graph = (mpr_graph)user;
+    mpr_net net = mpr_graph_get_net(graph);
+    int interval = 0;
     RETURN_ARG_UNLESS(ac && MPR_STR == types[0], 0);
-    trace_net(mpr_graph_get_net(graph));
-    mpr_graph_sync_dev(graph, &av[0]->s);
+    trace_net(net);
+    /* the heartbeat interval follows the name and version, if the device advertises it */
+    if (ac > 2 && MPR_INT32 == types[2] && av[2]->i32 > 0)
+        interval = av[2]->i32;
+    /* count all syncs, including those of unknown devices, to estimate the bus population;
+     * devices that do not advertise an interval sync at the shortest one */
+    net->sync.heard += interval ? interval : SYNC_MIN_SEC;
+    mpr_graph_sync_dev(graph, &av[0]->s, interval);
     return 0;
 }
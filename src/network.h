@@ -11,9 +11,27 @@ typedef struct _mpr_net *mpr_net;
 #include "mpr_time.h"
 #include "mpr_inline.h"
 
+/* Devices on the same host may exchange data over AF_UNIX datagram sockets if the platform
+ * supports them and the network poller can wait on the receiving socket. Both ends of a link
+ * must agree, so this is the only place HAVE_UNIX_SOCKETS is defined. */
+#if    defined(HAVE_SYS_SOCKET_H) && defined(HAVE_FCNTL_H) && defined(HAVE_ERRNO_H) \
+    && (defined(HAVE_SYS_EPOLL_H) || defined(HAVE_POLL_H)) && !defined(WIN32)
+ #include <sys/socket.h>
+ #ifdef AF_UNIX
+  #include <sys/un.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define HAVE_UNIX_SOCKETS
+  /* private directory, then process id and UDP port of the device */
+  #define UNIX_PATH_FMT "%s/mpr.%d.%d"
+  #define UNIX_DIR_FMT "/tmp/mpr-%u"      /* used if XDG_RUNTIME_DIR is not set */
+ #endif
+#endif
+
 typedef enum {
     SERVER_DATA_UDP = 0,
-    SERVER_DATA_TCP = 1
+    SERVER_DATA_TCP = 1,
+    SERVER_DATA_UNIX = 2    /* AF_UNIX datagrams, only on platforms that support them */
 } dev_server_t;
 
 mpr_net mpr_net_new(mpr_graph g);
@@ -22,12 +40,51 @@ int mpr_net_bundle_start(lo_timetag t, void *data);
 
 mpr_time mpr_net_get_bundle_time(mpr_net net);
 
+/*! Get the arrival time of the message currently being dispatched. The time is taken by the
+ *  kernel when the datagram was received if the platform supports receive timestamps, and is
+ *  otherwise the current time.
+ *  \param net          The network structure to use.
+ *  \return             The arrival time. */
+mpr_time mpr_net_get_recv_time(mpr_net net);
+
+/*! Check whether the signal updates currently being dispatched repeat a bundle that has already
+ *  been received, in which case they should be skipped. This is set by the "/@fec" messages of
+ *  bundles sent with forward error correction.
+ *  \param net          The network structure to use.
+ *  \return             1 if the updates have already been received, 0 otherwise. */
+int mpr_net_get_is_redundant(mpr_net net);
+
 
 MPR_INLINE static void mpr_net_set_bundle_time(mpr_net net, mpr_time time)
 {
     mpr_net_bundle_start(time, net);
 }
 
+/*! Lists of local links the network poll loop must visit, so that it does not walk every link
+ *  of the graph on each iteration. */
+typedef enum {
+    NET_LINKS_SHM,                  /*!< Links with a shared memory ring for incoming data. */
+    NET_LINKS_TCP,                  /*!< Links with data waiting in their outbound TCP queue. */
+    NET_LINKS_SHM_HELD,             /*!< Links with bundles waiting for space in a shared memory
+                                     *   ring. */
+    NET_LINKS_PACED,                /*!< Links holding messages until their pacing interval. */
+    NET_LINKS_RUDP,                 /*!< Links waiting on a reliable UDP retransmit timeout. */
+    NUM_NET_LINK_LISTS
+} net_link_list_t;
+
+/*! Add a local link to one of the lists visited by the network poll loop. The link must not
+ *  already be in the list.
+ *  \param net          The network structure to use.
+ *  \param link         The link to add.
+ *  \param list         The list to add the link to. */
+void mpr_net_add_link(mpr_net net, mpr_link link, net_link_list_t list);
+
+/*! Remove a local link from one of the lists visited by the network poll loop.
+ *  \param net          The network structure to use.
+ *  \param link         The link to remove.
+ *  \param list         The list to remove the link from. */
+void mpr_net_remove_link(mpr_net net, mpr_link link, net_link_list_t list);
+
 void mpr_net_add_dev(mpr_net n, mpr_local_dev d);
 
 void mpr_net_remove_dev(mpr_net n, mpr_local_dev d);
@@ -47,6 +104,24 @@ int mpr_net_start_polling(mpr_net net, int block_ms);
 
 int mpr_net_stop_polling(mpr_net net);
 
+/*! Check whether the calling thread is the one polling the network. Until the network has been
+ *  polled every thread is treated as the polling thread.
+ *  \param net          The network structure.
+ *  
+eturn             1 if called from the polling thread, 0 otherwise. */
+int mpr_net_get_is_poll_thread(mpr_net net);
+
+/*! Wake the polling thread if it is blocked waiting on the network. May be called from any
+ *  thread. */
+void mpr_net_wake(mpr_net net);
+
+/*! Mark the local devices as having map updates to process on the next poll. May be called from
+ *  any thread. */
+void mpr_net_set_updated(mpr_net net);
+
+/*! Add a local device to the list of devices whose subscriptions are refreshed after polling. */
+void mpr_net_add_subscribed_dev(mpr_net net, mpr_local_dev dev);
+
 int mpr_net_init(mpr_net n, const char *iface, const char *group, int port);
 
 void mpr_net_use_local(mpr_net n);
@@ -61,6 +136,107 @@ void mpr_net_add_msg(mpr_net n, const char *str, net_msg_t cmd, lo_message msg);
 
 void mpr_net_send(mpr_net n);
 
+/*! A resolved UDP destination for sending serialised datagrams without liblo. */
+typedef struct _mpr_net_dst {
+    unsigned char addr[128];        /*!< Socket address storage. */
+    int len;                        /*!< Length of the socket address, or 0 if unresolved. */
+} mpr_net_dst_t, *mpr_net_dst;
+
+/*! Resolve a UDP destination address.
+ *  \param dst          The destination to initialise.
+ *  \param host         The destination host.
+ *  \param port         The destination port.
+ *  \return             1 if the address was resolved, 0 otherwise. */
+int mpr_net_resolve_dst(mpr_net_dst dst, const char *host, const char *port);
+
+/*! Queue a bundle to be sent as a datagram from a UDP server. Queued datagrams are sent together
+ *  by mpr_net_flush_dgrams().
+ *  \param net          The network structure to use.
+ *  \param server       The UDP server to send from.
+ *  \param dst          The resolved destination.
+ *  \param bundle       The bundle to send. The bundle is serialised immediately.
+ *  \return             1 if the bundle was queued, 0 if it should be sent directly instead. */
+int mpr_net_queue_dgram(mpr_net net, lo_server server, mpr_net_dst dst, lo_bundle bundle);
+
+/*! Send an already encoded datagram from a UDP server. The datagram may be queued until the next
+ *  call to mpr_net_flush_dgrams().
+ *  \param net          The network structure to use.
+ *  \param server       The UDP server to send from.
+ *  \param dst          The resolved destination.
+ *  \param data         The encoded datagram. The data is copied if it is queued.
+ *  \param len          The length of the datagram.
+ *  \return             1 if the datagram was sent or queued, 0 otherwise. */
+int mpr_net_send_dgram(mpr_net net, lo_server server, mpr_net_dst dst, const char *data,
+                       size_t len);
+
+/*! Serialise a bundle once so that it can be sent to several destinations using
+ *  mpr_net_send_serialised(). Replaces any previously serialised bundle.
+ *  \param net          The network structure to use.
+ *  \param bundle       The bundle to serialise.
+ *  \return             The serialised length, or 0 on failure. */
+size_t mpr_net_serialise(mpr_net net, lo_bundle bundle);
+
+/*! Send the bundle last serialised by mpr_net_serialise() as a datagram from a UDP server.
+ *  The datagram may be queued until the next call to mpr_net_flush_dgrams().
+ *  \param net          The network structure to use.
+ *  \param server       The UDP server to send from.
+ *  \param dst          The resolved destination.
+ *  \return             1 if the datagram was sent or queued, 0 if it should be sent using
+ *                      liblo instead. */
+int mpr_net_send_serialised(mpr_net net, lo_server server, mpr_net_dst dst);
+
+/*! Send all datagrams queued by mpr_net_queue_dgram() or mpr_net_send_serialised().
+ *  \param net          The network structure to use. */
+void mpr_net_flush_dgrams(mpr_net net);
+
+/*! Get the multicast group used to send the updates of a local signal once to all destinations
+ *  that have joined it, allocating the group if necessary.
+ *  \param net          The network structure to use.
+ *  \param sig          The local signal.
+ *  \return             The group as a "group:port" string, or NULL if it could not be opened. */
+const char *mpr_net_get_sig_mcast(mpr_net net, mpr_sig sig, int use_inst);
+
+/*! Close the multicast group of a local signal, if any.
+ *  \param net          The network structure to use.
+ *  \param sig          The local signal. */
+void mpr_net_remove_sig_mcast(mpr_net net, mpr_sig sig);
+
+/*! Release the multicast group of a local signal for a map that no longer sends to it, closing
+ *  the group once no maps remain.
+ *  \param net          The network structure to use.
+ *  \param sig          The local signal. */
+void mpr_net_release_sig_mcast(mpr_net net, mpr_sig sig);
+
+/*! Add a signal update message to the bundle for the signal's multicast group. Only the first
+ *  message added for each signal is kept until the bundles are sent by mpr_net_send_mcast().
+ *  \param net          The network structure to use.
+ *  \param sig          The local signal.
+ *  \param use_inst     Whether the map sending the message uses instances.
+ *  \param msg          The update message, addressed to the group by signal name.
+ *  \param time         The bundle timetag in local time, converted by the group members.
+ *  \return             1 if the update will be sent to the group, 0 otherwise. */
+int mpr_net_add_mcast_msg(mpr_net net, mpr_sig sig, int use_inst, lo_message msg, mpr_time time);
+
+/*! Send the bundles queued for signal multicast groups.
+ *  \param net          The network structure to use. */
+void mpr_net_send_mcast(mpr_net net);
+
+/*! Join the multicast group of a remote signal on behalf of a local map. Updates arriving on the
+ *  group are passed to mpr_local_map_recv_mcast().
+ *  \param net          The network structure to use.
+ *  \param spec         The group as a "group:port" string.
+ *  \param path         The path the remote signal updates are addressed to.
+ *  \param map          The local map receiving the updates.
+ *  \return             0 on success, nonzero if the group could not be joined. */
+int mpr_net_join_mcast(mpr_net net, const char *spec, const char *path,
+                       struct _mpr_local_map *map);
+
+/*! Stop receiving multicast updates for a local map, leaving the group if it is no longer used.
+ *  \param net          The network structure to use.
+ *  \param spec         The group as a "group:port" string.
+ *  \param map          The local map. */
+void mpr_net_leave_mcast(mpr_net net, const char *spec, struct _mpr_local_map *map);
+
 void mpr_net_free_msgs(mpr_net n);
 
 void mpr_net_free(mpr_net n);
@@ -73,6 +249,21 @@ const char *mpr_net_get_interface(mpr_net net);
 
 const char *mpr_net_get_address(mpr_net net);
 
+/*! Check whether a remote host address belongs to this host.
+ *  \param net          The network structure to check.
+ *  \param host         The remote host address.
+ *  \return             1 if the host is local, 0 otherwise. */
+int mpr_net_get_host_is_local(mpr_net net, const char *host);
+
+/*! Get the number of seconds without a sync message after which a remote device is considered
+ *  to have left the bus. This grows with the heartbeat interval advertised by the device, or
+ *  with the local interval if the device has not advertised one, in which case it is never
+ *  shorter than TIMEOUT_SEC.
+ *  \param net          The network structure to query.
+ *  \param dev          The remote device.
+ *  \return             The timeout in seconds. */
+int mpr_net_get_sync_timeout(mpr_net net, mpr_dev dev);
+
 #define NEW_LO_MSG(VARNAME, FAIL)           \
 lo_message VARNAME = lo_message_new();      \
 if (!VARNAME) {                             \
@@ -2,11 +2,22 @@
 #ifndef __MPR_PATH_H__
 #define __MPR_PATH_H__
 
+#include <stdint.h>
 #include "mpr_inline.h"
 
 /*! Compare two strings with support for wildcard characters in the second string */
 int mpr_path_match(const char* s, const char* p);
 
+/*! Hash an OSC path for table lookups. */
+MPR_INLINE static uint32_t mpr_path_hash(const char *path)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    while (*path)
+        hash = (hash ^ (uint8_t)*path++) * 16777619u;
+    return hash;
+}
+
 /*! Parse the device and signal names from an OSC path. */
 int mpr_path_parse(const char *string, char **devnameptr, char **signameptr);
 
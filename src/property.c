@@ -86,6 +86,7 @@ const char* mpr_protocol_strings[] =
     NULL,           /* MPR_PROTO_UNDEFINED */
     "osc.udp",      /* MPR_PROTO_UDP */
     "osc.tcp",      /* MPR_PROTO_TCP */
+    "osc.rudp",     /* MPR_PROTO_RUDP */
 };
 
 const char *mpr_steal_strings[] =
@@ -202,7 +203,7 @@ mpr_loc mpr_loc_from_str(const char *str)
 
 const char *mpr_proto_as_str(mpr_proto p)
 {
-    if (p <= 0 || p > MPR_NUM_PROTO)
+    if (p <= 0 || p >= MPR_NUM_PROTO)
         return "unknown";
     return mpr_protocol_strings[p];
 }
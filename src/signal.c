@@ -21,7 +21,7 @@
 #include <malloc.h>
 #endif
 
-#define MAX_INST 128
+#define MAX_INST 65535  /* instance indices are stored as uint16_t */
 #define BUFFSIZE 512
 
 /* Signals and signal instances
@@ -36,6 +36,8 @@ static int mpr_sig_get_id_map_with_LID(mpr_local_sig lsig, mpr_id LID, int flags
 static int mpr_sig_get_id_map_with_GID(mpr_local_sig lsig, mpr_id GID, int flags, mpr_time t,
                                        int activate);
 static void mpr_sig_release_inst_internal(mpr_local_sig lsig, int id_map_idx);
+static int release_inst_begin(mpr_local_sig lsig, int id_map_idx);
+static void release_insts(mpr_local_sig lsig, const int *id_map_idxs, int num);
 
 static int get_inst_by_ids(mpr_local_sig lsig, mpr_id *LID, mpr_id *GID);
 
@@ -68,8 +70,9 @@ typedef struct _mpr_sig_inst
     void *data;                     /*!< User data of this instance. */
     mpr_time created;               /*!< The instance's creation timestamp. */
 
+    int id_map_idx;                 /*!< Index of the signal id map holding this instance, or -1. */
     uint16_t status;                /*!< Status of this instance. */
-    uint8_t idx;                    /*!< Index for accessing value history. */
+    uint16_t idx;                   /*!< Index for accessing value history. */
 } mpr_sig_inst_t;
 
 /* plan: remove inst, add map/slot resource index (is this the same for all source signals?) */
@@ -77,10 +80,26 @@ typedef struct _mpr_sig_id_map
 {
     struct _mpr_id_map *id_map; /*!< Associated mpr_id_map. */
     struct _mpr_sig_inst *inst; /*!< Signal instance. */
+    mpr_id GID;                 /*!< Global id the id map is indexed by. */
+    int prev;                   /*!< Next older id map in the signal's age list, or -1. */
+    int next;                   /*!< Next newer id map in the signal's age list, or -1. */
     int status;                 /*!< Either 0 or a combination of `UPDATED`,
                                  *   `RELEASED_LOCALLY` and `RELEASED_REMOTELY`. */
 } mpr_sig_id_map_t, *mpr_sig_id_map;
 
+/*! An open-addressing hash table from ids to indices using linear probing. Keys may be
+ *  repeated, in which case lookups return the lowest index. */
+typedef struct _mpr_id_tbl_entry {
+    mpr_id key;
+    int val;                        /*!< The indexed value, or -1 if the entry is empty. */
+} mpr_id_tbl_entry_t;
+
+typedef struct _mpr_id_tbl {
+    mpr_id_tbl_entry_t *entries;
+    uint32_t size;                  /*!< The number of entries, always a power of two. */
+    uint32_t num;                   /*!< The number of used entries. */
+} mpr_id_tbl_t;
+
 typedef struct _mpr_local_sig
 {
     MPR_SIG_STRUCT_ITEMS
@@ -92,6 +111,17 @@ typedef struct _mpr_local_sig
     mpr_sig_inst *inst;             /*!< Array of pointers to the signal insts. */
     mpr_bitflags updated_inst;      /*!< Bitflags to indicate updated instances. */
 
+    mpr_id_tbl_t inst_by_id;        /*!< Instance indices by instance id. */
+    mpr_id_tbl_t id_map_by_GID;     /*!< Signal id map indices by global id. */
+    int *free_id_maps;              /*!< Stack of unused signal id map indices. */
+    int num_free_id_maps;
+    mpr_id next_inst_id;            /*!< All instance ids below this one are in use. */
+
+    /* Id maps holding active instances, linked in order of instance creation time. */
+    int oldest;                     /*!< Id map with the oldest active instance, or -1. */
+    int newest;                     /*!< Id map with the newest active instance, or -1. */
+    int num_active;                 /*!< Number of active instances. */
+
     /*! An optional function to be called when the signal value changes or when
      *  signal instance management events occur.. */
     void *handler;
@@ -111,20 +141,161 @@ size_t mpr_sig_get_struct_size(int is_local)
     return is_local ? sizeof(mpr_local_sig_t) : sizeof(mpr_sig_t);
 }
 
-static int _compare_inst_ids(const void *l, const void *r)
+#define ID_TBL_MIN_SIZE 16
+
+static void id_tbl_add(mpr_id_tbl_t *tbl, mpr_id key, int val)
+{
+    uint32_t mask, i;
+    if ((tbl->num + 1) * 2 > tbl->size) {
+        /* keep the table at most half full */
+        mpr_id_tbl_entry_t *entries = tbl->entries;
+        uint32_t size = tbl->size;
+        tbl->size = size ? size * 2 : ID_TBL_MIN_SIZE;
+        tbl->entries = (mpr_id_tbl_entry_t*) malloc(tbl->size * sizeof(mpr_id_tbl_entry_t));
+        for (i = 0; i < tbl->size; i++)
+            tbl->entries[i].val = -1;
+        tbl->num = 0;
+        for (i = 0; i < size; i++) {
+            if (entries[i].val >= 0)
+                id_tbl_add(tbl, entries[i].key, entries[i].val);
+        }
+        FUNC_IF(free, entries);
+    }
+    mask = tbl->size - 1;
+    i = mpr_id_hash(key) & mask;
+    while (tbl->entries[i].val >= 0)
+        i = (i + 1) & mask;
+    tbl->entries[i].key = key;
+    tbl->entries[i].val = val;
+    ++tbl->num;
+}
+
+/* Remove an entry using backward-shift deletion. */
+static void id_tbl_remove(mpr_id_tbl_t *tbl, mpr_id key, int val)
+{
+    uint32_t mask, i, j;
+    RETURN_UNLESS(tbl->num);
+    mask = tbl->size - 1;
+    i = mpr_id_hash(key) & mask;
+    while (tbl->entries[i].key != key || tbl->entries[i].val != val) {
+        RETURN_UNLESS(tbl->entries[i].val >= 0);
+        i = (i + 1) & mask;
+    }
+    j = i;
+    while (1) {
+        uint32_t home;
+        j = (j + 1) & mask;
+        if (tbl->entries[j].val < 0)
+            break;
+        home = mpr_id_hash(tbl->entries[j].key) & mask;
+        /* leave entries whose home slot lies between the hole and their current slot */
+        if (((j - home) & mask) < ((j - i) & mask))
+            continue;
+        tbl->entries[i] = tbl->entries[j];
+        i = j;
+    }
+    tbl->entries[i].val = -1;
+    --tbl->num;
+}
+
+/* Returns the lowest value indexed by key, or -1 if there is none. */
+static int id_tbl_find(mpr_id_tbl_t *tbl, mpr_id key)
 {
-    return (*(mpr_sig_inst*)l)->id - (*(mpr_sig_inst*)r)->id;
+    uint32_t mask, i;
+    int val = -1;
+    RETURN_ARG_UNLESS(tbl->num, -1);
+    mask = tbl->size - 1;
+    i = mpr_id_hash(key) & mask;
+    while (tbl->entries[i].val >= 0) {
+        if (tbl->entries[i].key == key && (val < 0 || tbl->entries[i].val < val))
+            val = tbl->entries[i].val;
+        i = (i + 1) & mask;
+    }
+    return val;
 }
 
 static mpr_sig_inst _find_inst_by_id(mpr_local_sig lsig, mpr_id id)
 {
-    mpr_sig_inst_t si, *sip, **sipp;
+    int idx;
     RETURN_ARG_UNLESS(lsig->num_inst, 0);
     RETURN_ARG_UNLESS(lsig->use_inst, lsig->inst[0]);
-    sip = &si;
-    si.id = id;
-    sipp = bsearch(&sip, lsig->inst, lsig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
-    return (sipp && *sipp) ? *sipp : 0;
+    idx = id_tbl_find(&lsig->inst_by_id, id);
+    return idx >= 0 ? lsig->inst[idx] : 0;
+}
+
+/* Change the id of an instance, keeping the instance index up to date. */
+static void _set_inst_id(mpr_local_sig lsig, mpr_sig_inst si, mpr_id id)
+{
+    RETURN_UNLESS(si->id != id);
+    id_tbl_remove(&lsig->inst_by_id, si->id, si->idx);
+    if (si->id < lsig->next_inst_id)
+        lsig->next_inst_id = si->id;
+    si->id = id;
+    id_tbl_add(&lsig->inst_by_id, id, si->idx);
+}
+
+/* Returns the index of the first signal id map with the given global id, or -1. Signal id maps
+ * stay indexed by the global id they were created with until they are cleared, so entries whose
+ * device id map has since been recycled for another global id are skipped. */
+static int _find_id_map_by_GID(mpr_local_sig lsig, mpr_id GID)
+{
+    mpr_id_tbl_t *tbl = &lsig->id_map_by_GID;
+    uint32_t mask, i;
+    int val = -1;
+    RETURN_ARG_UNLESS(tbl->num, -1);
+    mask = tbl->size - 1;
+    for (i = mpr_id_hash(GID) & mask; tbl->entries[i].val >= 0; i = (i + 1) & mask) {
+        int idx = tbl->entries[i].val;
+        mpr_id_map id_map = lsig->id_maps[idx].id_map;
+        if (tbl->entries[i].key == GID && (val < 0 || idx < val) && id_map && id_map->GID == GID)
+            val = idx;
+    }
+    return val;
+}
+
+/* Detach the device id map from a signal id map, returning it to the unused list. */
+static void _clear_id_map(mpr_local_sig lsig, int id_map_idx)
+{
+    mpr_sig_id_map smap = &lsig->id_maps[id_map_idx];
+    RETURN_UNLESS(smap->id_map);
+    id_tbl_remove(&lsig->id_map_by_GID, smap->GID, id_map_idx);
+    smap->id_map = 0;
+    lsig->free_id_maps[lsig->num_free_id_maps++] = id_map_idx;
+}
+
+/* Add an id map to the age list, which is kept in order of instance creation time so that the
+ * oldest and newest instances can be found without a search. New instances are normally the
+ * newest, so the position is searched for starting from the newest end. */
+static void _age_list_add(mpr_local_sig lsig, int id_map_idx)
+{
+    mpr_sig_id_map smap = &lsig->id_maps[id_map_idx];
+    int prev = lsig->newest;
+    while (prev >= 0 && mpr_time_cmp(lsig->id_maps[prev].inst->created, smap->inst->created) > 0)
+        prev = lsig->id_maps[prev].prev;
+    smap->prev = prev;
+    smap->next = (prev >= 0) ? lsig->id_maps[prev].next : lsig->oldest;
+    if (smap->next >= 0)
+        lsig->id_maps[smap->next].prev = id_map_idx;
+    else
+        lsig->newest = id_map_idx;
+    if (prev >= 0)
+        lsig->id_maps[prev].next = id_map_idx;
+    else
+        lsig->oldest = id_map_idx;
+}
+
+static void _age_list_remove(mpr_local_sig lsig, int id_map_idx)
+{
+    mpr_sig_id_map smap = &lsig->id_maps[id_map_idx];
+    if (smap->prev >= 0)
+        lsig->id_maps[smap->prev].next = smap->next;
+    else
+        lsig->oldest = smap->next;
+    if (smap->next >= 0)
+        lsig->id_maps[smap->next].prev = smap->prev;
+    else
+        lsig->newest = smap->prev;
+    smap->prev = smap->next = -1;
 }
 
 MPR_INLINE static mpr_sig_inst _get_inst_by_id_map_idx(mpr_local_sig sig, int id_map_idx)
@@ -138,10 +309,38 @@ MPR_INLINE static int check_sig_length(int length)
     return (length < 1 || length > MPR_MAX_VECTOR_LEN);
 }
 
+/* Vectors up to this length are handled using fixed-size buffers; longer vectors fall back to
+ * checking elements individually or to heap allocations. */
+#define SHORT_VECTOR_LEN 128
+
+/* Number of instances propagated together by mpr_sig_set_values(). */
+#define BATCH_SIZE 64
+
+/* Type strings of complete vectors of each numeric type, built once so that the common case of an
+ * update with no missing elements can be validated with a single comparison. */
+static const mpr_type *get_vec_types(mpr_type type)
+{
+    static mpr_type vec_types[3][SHORT_VECTOR_LEN];
+    mpr_type *types;
+    switch (type) {
+        case MPR_INT32: types = vec_types[0];   break;
+        case MPR_FLT:   types = vec_types[1];   break;
+        case MPR_DBL:   types = vec_types[2];   break;
+        default:        return 0;
+    }
+    if (types[SHORT_VECTOR_LEN - 1] != type)
+        memset(types, type, SHORT_VECTOR_LEN);
+    return types;
+}
+
 MPR_INLINE static int check_types(const mpr_type *types, int len, mpr_type sig_type, int sig_len)
 {
     int i, vals = 0;
+    const mpr_type *vec_types;
     RETURN_ARG_UNLESS(len >= sig_len, -1);
+    if (   sig_len <= SHORT_VECTOR_LEN && (vec_types = get_vec_types(sig_type))
+        && 0 == memcmp(types, vec_types, sig_len))
+        return sig_len;
     for (i = 0; i < sig_len; i++) {
         if (types[i] == sig_type)
             ++vals;
@@ -151,45 +350,151 @@ MPR_INLINE static int check_types(const mpr_type *types, int len, mpr_type sig_t
     return vals;
 }
 
-static void process_maps(mpr_local_sig sig, int id_map_idx)
+/* Propagate new values of a set of signal instances to the outgoing maps. Each map is visited
+ * once for the whole set; expressions are evaluated later when the device processes its maps. */
+static void process_maps_updated(mpr_local_sig sig, const int *id_map_idxs, int num)
 {
-    mpr_id_map id_map = sig->id_maps[id_map_idx].id_map;
-    mpr_sig_inst si;
     mpr_local_map map;
-    int i, j, inst_idx;
-    uint8_t *locked = &sig->locked;
+    int i, j, k, inst_idx;
     mpr_time time;
 
+    RETURN_UNLESS(sig->num_maps_out);
+
     /* abort if signal is already being processed - might be a local loop */
-    if (*locked) {
+    if (sig->locked) {
         trace("Mapping loop detected on signal %s! (1)\n", sig->name);
         return;
     }
 
-    si = _get_inst_by_id_map_idx(sig, id_map_idx);
-    inst_idx = si->idx;
     time = mpr_dev_get_time((mpr_dev)sig->dev);
 
-    /* TODO: use an incrementing counter for slot ids; remove item and squash array when map is
-     * removed; use bsearch for slot lookup since ids will be monotonic though not sequential */
-
-    if (!mpr_value_get_num_samps(sig->value, inst_idx)) {
-        RETURN_UNLESS(sig->use_inst);
-        RETURN_UNLESS(sig->num_maps_in || sig->num_maps_out);
+    /* mark device as updated */
+    mpr_local_dev_set_sending(sig->dev);
+    sig->locked = 1;
+    for (i = 0; i < sig->num_maps_out; i++) {
+        mpr_local_slot src_slot;
+        mpr_local_sig all_sig;
+        int all, use_inst, process_dst, updated = 0;
 
-        /* mark device as updated */
-        mpr_local_dev_set_sending(sig->dev);
+        src_slot = sig->slots_out[i];
 
-        *locked = 1;
-        for (i = 0; i < sig->num_maps_in; i++) {
-            mpr_proto proto;
-            mpr_local_slot dst_slot = sig->slots_in[i];
-            map = (mpr_local_map)mpr_slot_get_map((mpr_slot)dst_slot);
-            if (   (mpr_obj_get_status((mpr_obj)map, 0) & (MPR_STATUS_ACTIVE | MPR_STATUS_REMOVED))
+        map = (mpr_local_map)mpr_slot_get_map((mpr_slot)src_slot);
+        if (   ((mpr_obj_get_status((mpr_obj)map, 0) & (MPR_STATUS_ACTIVE | MPR_STATUS_REMOVED))
                 != MPR_STATUS_ACTIVE)
+            || mpr_local_map_get_is_self_map(map)) {
+            continue;
+        }
+
+        /* If this signal is non-instanced but the map has other instanced
+         * sources we will need to update all of the active map instances. */
+        all = (   mpr_map_get_num_src((mpr_map)map) > 1
+               && mpr_local_map_get_num_inst(map) > sig->num_inst);
+        use_inst = mpr_map_get_use_inst((mpr_map)map);
+        process_dst = MPR_LOC_DST == mpr_map_get_process_loc((mpr_map)map);
+
+        if (!process_dst && !mpr_local_map_get_expr(map)) {
+            trace("error: missing expression!\n");
+            continue;
+        }
+
+        for (k = 0; k < num; k++) {
+            mpr_id_map id_map = sig->id_maps[id_map_idxs[k]].id_map;
+            mpr_sig_inst si = _get_inst_by_id_map_idx(sig, id_map_idxs[k]);
+            if (!si || !id_map)
+                continue;
+            inst_idx = si->idx;
+
+            /* TODO: should we continue for out-of-scope local destination updates? */
+            if (use_inst && !(mpr_local_map_get_has_scope(map, id_map->GID)))
+                continue;
+
+            if (process_dst) {
+                /* bypass map processing and bundle value without type coercion */
+                mpr_slot_build_msg(src_slot, sig->value, inst_idx,
+                                   (use_inst && mpr_sig_get_use_inst((mpr_sig)sig)) ? id_map : 0);
                 continue;
+            }
+
+            /* copy input value */
+            mpr_slot_set_value(src_slot, inst_idx, mpr_value_get_value(sig->value, inst_idx, 0),
+                               time);
+
+            if (!mpr_slot_get_causes_update((mpr_slot)src_slot)) {
+                trace("slot update does not cause expression evaluation\n");
+                continue;
+            }
+
+            if (all)
+                updated = 1;
+            else
+                mpr_local_map_set_updated(map, inst_idx);
+        }
+        if (!updated)
+            continue;
+
+        /* find a source signal with more instances and mark all of its active instances */
+        all_sig = sig;
+        for (j = 0; j < mpr_map_get_num_src((mpr_map)map); j++) {
+            mpr_slot src_slot2 = mpr_map_get_src_slot((mpr_map)map, j);
+            mpr_sig src_sig = mpr_slot_get_sig(src_slot2);
+            if (   src_sig->obj.is_local
+                && mpr_slot_get_num_inst(src_slot2) > mpr_slot_get_num_inst((mpr_slot)src_slot))
+                all_sig = (mpr_local_sig)src_sig;
+        }
+        for (j = 0; j < all_sig->num_id_maps; j++) {
+            /* check if map instance is active */
+            mpr_sig_inst si = _get_inst_by_id_map_idx(all_sig, j);
+            if (si)
+                mpr_local_map_set_updated(map, si->idx);
+        }
+    }
+    sig->locked = 0;
+}
+
+/* Propagate the release of instances whose values have been reset. Each map is visited once for
+ * the whole batch, and releases sent upstream leave in a single message per source slot. */
+static void process_maps_released(mpr_local_sig sig, const int *id_map_idxs, int num)
+{
+    mpr_local_map map;
+    int i, j, k;
+    mpr_time time;
+
+    RETURN_UNLESS(sig->use_inst);
+    RETURN_UNLESS(sig->num_maps_in || sig->num_maps_out);
+
+    /* abort if signal is already being processed - might be a local loop */
+    if (sig->locked) {
+        trace("Mapping loop detected on signal %s! (1)\n", sig->name);
+        return;
+    }
+
+    time = mpr_dev_get_time((mpr_dev)sig->dev);
+
+    /* mark device as updated */
+    mpr_local_dev_set_sending(sig->dev);
+
+    sig->locked = 1;
+    for (i = 0; i < sig->num_maps_in; i++) {
+        mpr_proto proto;
+        mpr_id_map tmp;
+        mpr_local_slot dst_slot = sig->slots_in[i];
+        map = (mpr_local_map)mpr_slot_get_map((mpr_slot)dst_slot);
+        if (   (mpr_obj_get_status((mpr_obj)map, 0) & (MPR_STATUS_ACTIVE | MPR_STATUS_REMOVED))
+            != MPR_STATUS_ACTIVE)
+            continue;
+
+        proto = mpr_map_get_protocol((mpr_map)map);
+        if (MPR_LOC_BOTH == mpr_map_get_locality((mpr_map)map)) {
+            /* sending upstream to should choose opposite link direction */
+            /* UDP -> TCP; TCP -> UDP */
+            proto = (MPR_PROTO_TCP == proto) ? MPR_PROTO_UDP : MPR_PROTO_TCP;
+        }
+        tmp = mpr_local_map_get_id_map(map);
+
+        for (k = 0; k < num; k++) {
+            mpr_id_map id_map = sig->id_maps[id_map_idxs[k]].id_map;
+            int inst_idx = sig->id_maps[id_map_idxs[k]].inst->idx;
 
-            mpr_id_map tmp = mpr_local_map_get_id_map(map);
             if (tmp->GID == id_map->GID) {
                 tmp->LID = tmp->GID = 0;
                 mpr_dev_GID_decref(sig->dev, sig->group, id_map);
@@ -198,13 +503,6 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
             /* reset associated output memory */
             mpr_slot_set_value(dst_slot, inst_idx, NULL, time);
 
-            proto = mpr_map_get_protocol((mpr_map)map);
-            if (MPR_LOC_BOTH == mpr_map_get_locality((mpr_map)map)) {
-                /* sending upstream to should choose opposite link direction */
-                /* UDP -> TCP; TCP -> UDP */
-                proto = (MPR_NUM_PROTO - proto);
-            }
-
             for (j = 0; j < mpr_map_get_num_src((mpr_map)map); j++) {
                 mpr_local_slot src_slot = (mpr_local_slot)mpr_map_get_src_slot((mpr_map)map, j);
 
@@ -213,68 +511,22 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
 
                 if (!mpr_local_map_get_has_scope(map, id_map->GID))
                     continue;
-                if (sig->id_maps[id_map_idx].status & RELEASED_REMOTELY)
+                if (sig->id_maps[id_map_idxs[k]].status & RELEASED_REMOTELY)
                     continue;
 
-                /* send release to upstream */
+                /* add release to the message sent upstream */
                 mpr_slot_build_msg(src_slot, 0, 0, id_map);
-                /* TODO: consider calling this later for batch releases */
-                mpr_local_slot_send_msg(src_slot, NULL, time, proto);
             }
         }
-        for (i = 0; i < sig->num_maps_out; i++) {
-            mpr_local_slot src_slot = sig->slots_out[i], dst_slot;
-            map = (mpr_local_map)mpr_slot_get_map((mpr_slot)src_slot);
-            if (   ((mpr_obj_get_status((mpr_obj)map, 0) & (MPR_STATUS_ACTIVE | MPR_STATUS_REMOVED))
-                    != MPR_STATUS_ACTIVE)
-                || mpr_local_map_get_is_self_map(map)) {
-                continue;
-            }
 
-            /* reset associated output memory */
-            dst_slot = (mpr_local_slot)mpr_map_get_dst_slot((mpr_map)map);
-            mpr_slot_set_value(dst_slot, inst_idx, NULL, time);
-
-            if (MPR_LOC_SRC == mpr_map_get_process_loc((mpr_map)map)) {
-                /* reset associated input memory */
-                mpr_slot_set_value(src_slot, inst_idx, NULL, time);
-            }
-
-            // TODO: if map expression is reducing we should only send release if num_active_inst goes from >0 -> 0
-
-            if (mpr_map_get_use_inst((mpr_map)map)) {
-                /* send release to downstream */
-                if (MPR_LOC_SRC == mpr_map_get_process_loc((mpr_map)map)) {
-                    mpr_expr expr = mpr_local_map_get_expr(map);
-                    if (expr && !mpr_expr_get_manages_inst(expr)) {
-                        /* need to build msg immediately since id_map won't be available later */
-                        /* TODO: use updated bitflags (or released before/after if necessary) to mark release,
-                         * don't send immediately */
-                        mpr_slot_build_msg(dst_slot, 0, 0, id_map);
-                        mpr_local_map_set_updated(map, inst_idx);
-                    }
-                }
-                else if (mpr_local_map_get_has_scope(map, id_map->GID)) {
-                    /* need to build msg immediately since id_map won't be available later */
-                    mpr_slot_build_msg(src_slot, 0, 0, id_map);
-                }
-            }
-        }
-        *locked = 0;
-        return;
+        /* send releases to upstream */
+        for (j = 0; j < mpr_map_get_num_src((mpr_map)map); j++)
+            mpr_local_slot_send_msg((mpr_local_slot)mpr_map_get_src_slot((mpr_map)map, j), NULL,
+                                    time, proto);
     }
-
-    RETURN_UNLESS(sig->num_maps_out);
-
-    /* mark device as updated */
-    mpr_local_dev_set_sending(sig->dev);
-    *locked = 1;
     for (i = 0; i < sig->num_maps_out; i++) {
-        mpr_local_slot src_slot;
-        int all;
-
-        src_slot = sig->slots_out[i];
-
+        mpr_local_slot src_slot = sig->slots_out[i], dst_slot;
+        int process_src, manages_inst = 1;
         map = (mpr_local_map)mpr_slot_get_map((mpr_slot)src_slot);
         if (   ((mpr_obj_get_status((mpr_obj)map, 0) & (MPR_STATUS_ACTIVE | MPR_STATUS_REMOVED))
                 != MPR_STATUS_ACTIVE)
@@ -282,60 +534,56 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
             continue;
         }
 
-        /* TODO: should we continue for out-of-scope local destination updates? */
-        if (mpr_map_get_use_inst((mpr_map)map) && !(mpr_local_map_get_has_scope(map, id_map->GID)))
-            continue;
-
-        /* If this signal is non-instanced but the map has other instanced
-         * sources we will need to update all of the active map instances. */
-        all = (   mpr_map_get_num_src((mpr_map)map) > 1
-               && mpr_local_map_get_num_inst(map) > sig->num_inst);
-
-        if (MPR_LOC_DST == mpr_map_get_process_loc((mpr_map)map)) {
-            /* bypass map processing and bundle value without type coercion */
-            mpr_slot_build_msg(src_slot, sig->value, inst_idx,
-                               (   mpr_map_get_use_inst((mpr_map)map)
-                                && mpr_sig_get_use_inst((mpr_sig)sig)) ? id_map : 0);
-            continue;
-        }
-
-        if (!mpr_local_map_get_expr(map)) {
-            trace("error: missing expression!\n");
-            continue;
+        dst_slot = (mpr_local_slot)mpr_map_get_dst_slot((mpr_map)map);
+        process_src = MPR_LOC_SRC == mpr_map_get_process_loc((mpr_map)map);
+        if (process_src) {
+            mpr_expr expr = mpr_local_map_get_expr(map);
+            manages_inst = !expr || mpr_expr_get_manages_inst(expr);
         }
 
-        /* copy input value */
-        mpr_slot_set_value(src_slot, inst_idx, mpr_value_get_value(sig->value, inst_idx, 0), time);
+        for (k = 0; k < num; k++) {
+            mpr_id_map id_map = sig->id_maps[id_map_idxs[k]].id_map;
+            int inst_idx = sig->id_maps[id_map_idxs[k]].inst->idx;
 
-        if (!mpr_slot_get_causes_update((mpr_slot)src_slot)) {
-            trace("slot update does not cause expression evaluation\n");
-            continue;
-        }
+            /* reset associated output memory */
+            mpr_slot_set_value(dst_slot, inst_idx, NULL, time);
 
-        if (all) {
-            /* find a source signal with more instances */
-            for (j = 0; j < mpr_map_get_num_src((mpr_map)map); j++) {
-                mpr_slot src_slot2 = mpr_map_get_src_slot((mpr_map)map, j);
-                mpr_sig src_sig = mpr_slot_get_sig(src_slot2);
-                if (   src_sig->obj.is_local
-                    && mpr_slot_get_num_inst(src_slot2) > mpr_slot_get_num_inst((mpr_slot)src_slot))
-                    sig = (mpr_local_sig)src_sig;
+            if (process_src) {
+                /* reset associated input memory */
+                mpr_slot_set_value(src_slot, inst_idx, NULL, time);
             }
-            id_map_idx = 0;
-        }
 
-        for (; id_map_idx < sig->num_id_maps; id_map_idx++) {
-            /* check if map instance is active */
-            mpr_sig_inst si = _get_inst_by_id_map_idx(sig, id_map_idx);
-            if (!si && (all || mpr_sig_get_use_inst((mpr_sig)sig)))
+            // TODO: if map expression is reducing we should only send release if num_active_inst goes from >0 -> 0
+
+            if (!mpr_map_get_use_inst((mpr_map)map))
                 continue;
-            inst_idx = si->idx;
-            mpr_local_map_set_updated(map, inst_idx);
-            if (!all)
-                break;
+            /* send release to downstream */
+            if (process_src) {
+                if (!manages_inst) {
+                    /* need to build msg immediately since id_map won't be available later */
+                    /* TODO: use updated bitflags (or released before/after if necessary) to mark release,
+                     * don't send immediately */
+                    mpr_slot_build_msg(dst_slot, 0, 0, id_map);
+                    mpr_local_map_set_updated(map, inst_idx);
+                }
+            }
+            else if (mpr_local_map_get_has_scope(map, id_map->GID)) {
+                /* need to build msg immediately since id_map won't be available later */
+                mpr_slot_build_msg(src_slot, 0, 0, id_map);
+            }
         }
     }
-    *locked = 0;
+    sig->locked = 0;
+}
+
+static void process_maps(mpr_local_sig sig, int id_map_idx)
+{
+    mpr_sig_inst si = _get_inst_by_id_map_idx(sig, id_map_idx);
+
+    if (!mpr_value_get_num_samps(sig->value, si->idx))
+        process_maps_released(sig, &id_map_idx, 1);
+    else
+        process_maps_updated(sig, &id_map_idx, 1);
 }
 
 /* Notes:
@@ -354,6 +602,12 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
  * - Multiple instance can be updated using a single message, each preceded by the instance id
  *   as decribed above.
  * - example: "/mypath" ,sishffhffN "sl" 0 "in" 1234 1.0 2.0 3.0 "in" 5678 4.0 5.0
+ * - Peers that have been told the signal alias during map setup may instead send a compact form
+ *   addressed to the alias path, with the slot # (or -1) as a leading integer and each instance
+ *   id as a bare 64bit integer.
+ * - example: "/@17" ,ihfffhffN 0 1234 1.0 2.0 3.0 5678 4.0 5.0
+ * - Compact messages may also carry updates for many instances as a packed frame in a single
+ *   blob argument following the slot #. The frame layout is described in slot.h.
  */
 /* Current solution for persistent (non-ephemeral) signal instances:
  * - once a signal instance is active it continues using the same id_map
@@ -361,66 +615,22 @@ static void process_maps(mpr_local_sig sig, int id_map_idx)
  * - flexible input (mapping something new to the persistent instances) is handled
  *   by using dynamic proxy id_maps */
 
-int mpr_sig_osc_handler(const char *path, const char *types, lo_arg **argv, int argc,
-                        lo_message msg, void *data)
+/* Apply an update to a single signal instance, or to all instances if GID is zero. The vector
+ * element types are given by `types`, and the values of the non-null elements are packed back to
+ * back starting at `vals_ptr`. Returns the number of elements consumed, or -1 if the rest of the
+ * message should be discarded. */
+static int update_inst(mpr_local_sig sig, int slot_id, mpr_id GID, const mpr_type *types,
+                       const char *vals_ptr, int val_len, mpr_time time)
 {
-    mpr_local_sig sig = (mpr_local_sig)data;
-    mpr_local_dev dev;
+    mpr_local_dev dev = sig->dev;
     mpr_sig_inst si;
-    mpr_net net = mpr_graph_get_net(sig->obj.graph);
-    int i, offset = 0, val_len = 0, vals = 0;
-    int id_map_idx, inst_idx, slot_id = -1, map_manages_inst = 0;
-    mpr_id GID = 0;
+    int i, vals = 0, id_map_idx, inst_idx, map_manages_inst = 0;
+    int type_size = mpr_type_get_size(sig->type);
+    const char *val;
     mpr_id_map id_map, remote_id_map = 0;
     mpr_local_map map = 0;
     mpr_local_slot slot = 0;
     mpr_sig slot_sig = 0;
-    mpr_time time;
-
-    assert(sig);
-    dev = sig->dev;
-
-#ifdef DEBUG
-    trace("<%s> '%s:%s' received update: ",
-          lo_address_get_protocol(lo_message_get_source(msg)) == LO_TCP ? "TCP" : "UDP",
-          mpr_dev_get_name((mpr_dev)dev), sig->name);
-    lo_message_pp(msg);
-#endif
-
-    TRACE_RETURN_UNLESS(sig->num_inst, 0, "  signal '%s' has no instances.\n", sig->name);
-    RETURN_ARG_UNLESS(argc, 0);
-
-    time = mpr_net_get_bundle_time(net);
-
-    /* We need to consider that there may be properties prepended to the msg
-     * check length and find properties if any */
-    if (types[0] == MPR_STR) {
-        if ((strcmp(&argv[0]->s, "@sl") == 0) && argc >= 2) {
-            TRACE_RETURN_UNLESS(types[1] == MPR_INT32, 0,
-                                "  error in mpr_sig_osc_handler: bad arguments for 'slot' prop.\n")
-            slot_id = argv[1]->i32;
-            trace("  retrieved slot id %d\n", slot_id);
-            offset += 2;
-        }
-    }
-again:
-    if (types[offset] == MPR_STR) {
-        if ((strcmp(&argv[offset]->s, "@in") == 0) && argc >= offset + 2) {
-            TRACE_RETURN_UNLESS(types[offset + 1] == MPR_INT64, 0,
-                                "  error in mpr_sig_osc_handler: bad arguments for 'instance' prop.\n")
-            GID = argv[offset + 1]->i64;
-            trace("  retrieved GUID %"PR_MPR_ID"\n", GID);
-            offset += 2;
-        }
-        else {
-            trace("  error in mpr_sig_osc_handler: unknown property name '%s'.\n", &argv[offset]->s);
-            return 0;
-        }
-    }
-    val_len = offset;
-    while (val_len < argc && types[val_len] != MPR_STR)
-        ++val_len;
-    val_len -= offset;
 
     if (slot_id >= 0) {
         mpr_expr expr;
@@ -430,29 +640,29 @@ again:
             if ((slot = (mpr_local_slot)mpr_map_get_src_slot_by_id((mpr_map)map, slot_id)))
                 break;
         }
-        TRACE_RETURN_UNLESS(slot, 0, "  error in mpr_sig_osc_handler: slot %d not found.\n", slot_id);
+        TRACE_RETURN_UNLESS(slot, -1, "  error in mpr_sig_osc_handler: slot %d not found.\n", slot_id);
         TRACE_RETURN_UNLESS(   (mpr_obj_get_status((mpr_obj)map, 0)
                              & (MPR_STATUS_ACTIVE | MPR_STATUS_REMOVED)) == MPR_STATUS_ACTIVE,
-                            0, "  error in mpr_sig_osc_handler: map not yet ready.\n");
+                            -1, "  error in mpr_sig_osc_handler: map not yet ready.\n");
 
         slot_sig = mpr_slot_get_sig((mpr_slot)slot);
         if ((expr = mpr_local_map_get_expr(map)) && MPR_LOC_BOTH != mpr_map_get_locality((mpr_map)map)) {
-            vals = check_types(types + offset, val_len, slot_sig->type, slot_sig->len);
+            vals = check_types(types, val_len, slot_sig->type, slot_sig->len);
             val_len = slot_sig->len;
             map_manages_inst = mpr_expr_get_manages_inst(expr);
         }
         else if (MPR_LOC_SRC == mpr_map_get_locality((mpr_map)map)) {
             /* value has already been processed at source device */
             map = 0;
-            vals = check_types(types + offset, val_len, sig->type, sig->len);
+            vals = check_types(types, val_len, sig->type, sig->len);
             val_len = sig->len;
         }
     }
     else {
-        vals = check_types(types + offset, val_len, sig->type, sig->len);
+        vals = check_types(types, val_len, sig->type, sig->len);
         val_len = sig->len;
     }
-    RETURN_ARG_UNLESS(vals >= 0, 0);
+    RETURN_ARG_UNLESS(vals >= 0, -1);
 
     /* TODO: optionally discard out-of-order messages
      * requires timebase sync for many-to-one mappings or local updates
@@ -466,7 +676,7 @@ again:
         if (!id_map->GID) {
             if (!vals) {
                 trace("  no map-managed instances available for GUID %"PR_MPR_ID"\n", GID);
-                goto done;
+                return val_len;
             }
             /* id_map is currently empty - claim it now */
             id_map->LID = GID;
@@ -474,7 +684,7 @@ again:
         }
         else if (id_map->LID != GID) {
             trace("  no map-managed instances available for GUID %"PR_MPR_ID"\n", GID);
-            goto done;
+            return val_len;
         }
         trace("  creating new instance GUID remap: %"PR_MPR_ID" -> %"PR_MPR_ID"\n", GID, id_map->GID);
         GID = id_map->GID;
@@ -511,7 +721,7 @@ again:
 
         if (id_map_idx < 0) {
             trace("  no instances available for GUID\n");
-            goto done;
+            return val_len;
         }
 
         if (sig->id_maps[id_map_idx].status & RELEASED_LOCALLY) {
@@ -524,14 +734,14 @@ again:
                     mpr_dev_GID_decref(dev, sig->group, sig->id_maps[id_map_idx].id_map);
                 }
                 /* we can clear signal's reference to map */
-                sig->id_maps[id_map_idx].id_map = 0;
+                _clear_id_map(sig, id_map_idx);
             }
             trace("  instance already released locally\n");
-            goto done;
+            return val_len;
         }
         if (!sig->id_maps[id_map_idx].inst) {
             trace("  error in mpr_sig_osc_handler: missing instance!\n");
-            goto done;
+            return val_len;
         }
     }
     else {
@@ -555,8 +765,8 @@ again:
                     if (src_slot != (mpr_slot)slot) {
                         mpr_sig src_sig = mpr_slot_get_sig(src_slot);
                         if (src_sig->use_inst) {
-                            mpr_slot_set_value(slot, 0, argv[offset], time);
-                            goto done;
+                            mpr_slot_set_value(slot, 0, vals_ptr, time);
+                            return val_len;
                         }
                     }
                 }
@@ -566,7 +776,7 @@ again:
 
         id_map_idx = mpr_sig_get_id_map_with_LID(sig, sig->inst[i]->id, RELEASED_REMOTELY, time, 1, 1);
         if (id_map_idx < 0)
-            goto done;
+            return val_len;
     }
     si = _get_inst_by_id_map_idx(sig, id_map_idx);
     inst_idx = si->idx;
@@ -589,7 +799,7 @@ again:
         /* if user-code has registered callback for release events we will proceed even if the
          * signal is non-ephemeral. Conceptually this matches setting the "released" bitflag. */
         if (map && !mpr_map_get_use_inst((mpr_map)map)) {
-            goto done;
+            return val_len;
         }
 
         /* Try to release instance, but do not call process_maps() here, since we don't
@@ -603,10 +813,10 @@ again:
             /* Reset memory for corresponding source slot. */
             mpr_slot_set_value(slot, inst_idx, NULL, time);
         }
-        goto done;
+        return val_len;
     }
     else if (sig->dir == MPR_DIR_OUT)
-        goto done;
+        return val_len;
 
     if (map) {
         if (vals != slot_sig->len) {
@@ -616,7 +826,7 @@ again:
             trace_dev(dev, "  error in mpr_sig_osc_handler: partial vector update "
                       "applied to convergent mapping slot.");
 #endif
-            return 0;
+            return -1;
         }
         /* Setting to local timestamp here */
         time = mpr_dev_get_time((mpr_dev)dev);
@@ -627,12 +837,12 @@ again:
         if ((si = _get_inst_by_id_map_idx(sig, id_map_idx)) && (si->status & MPR_STATUS_ACTIVE)) {
             inst_idx = si->idx;
             /* TODO: jitter mitigation etc. */
-            if (mpr_slot_set_value(slot, inst_idx, argv[offset], time)) {
+            if (mpr_slot_set_value(slot, inst_idx, vals_ptr, time)) {
                 mpr_local_map_set_updated(map, inst_idx);
                 mpr_local_dev_set_receiving(dev);
             }
         }
-        goto done;
+        return val_len;
     }
 
     /* If no instance id was included in the message we will apply this update to all instances */
@@ -646,19 +856,28 @@ again:
             && (si = _get_inst_by_id_map_idx(sig, id_map_idx))
             && (si->status & MPR_STATUS_ACTIVE)) {
             uint16_t status = 0;
-            /* we can't use mpr_value_set() here since some vector elements may be missing */
-            if (!(si->status & MPR_STATUS_HAS_VALUE)) {
-                status = MPR_STATUS_NEW_VALUE;
-                mpr_value_incr_idx(sig->value, si->idx, time);
+            if (vals == sig->len) {
+                /* complete vector: copy it straight from the message into the value buffer */
+                if (   mpr_value_set_next(sig->value, si->idx, vals_ptr, time)
+                    || !(si->status & MPR_STATUS_HAS_VALUE))
+                    status = MPR_STATUS_NEW_VALUE;
             }
             else {
-                mpr_value_cpy_next(sig->value, si->idx, time);
-            }
-            for (i = offset; i < offset + sig->len; i++) {
-                if (types[i] == MPR_NULL)
-                    continue;
-                if (mpr_value_set_element(sig->value, si->idx, i, argv[i]))
+                /* we can't use mpr_value_set() here since some vector elements are missing */
+                if (!(si->status & MPR_STATUS_HAS_VALUE)) {
                     status = MPR_STATUS_NEW_VALUE;
+                    mpr_value_incr_idx(sig->value, si->idx, time);
+                }
+                else {
+                    mpr_value_cpy_next(sig->value, si->idx, time);
+                }
+                for (i = 0, val = vals_ptr; i < sig->len; i++) {
+                    if (types[i] == MPR_NULL)
+                        continue;
+                    if (mpr_value_set_element(sig->value, si->idx, i, (void*)val))
+                        status = MPR_STATUS_NEW_VALUE;
+                    val += type_size;
+                }
             }
             if (mpr_value_get_has_value(sig->value, si->idx)) {
                 si->status |= (MPR_STATUS_HAS_VALUE | MPR_STATUS_UPDATE_REM | status);
@@ -675,13 +894,258 @@ again:
         if (GID || !sig->use_inst)
             break;
     }
+    return val_len;
+}
+
+/* Parse and apply an update message addressed to a signal. Any slot id has already been read
+ * from the message header and `offset` indexes the first argument following it. */
+static int handle_update(mpr_local_sig sig, int slot_id, int offset, const char *types,
+                         lo_arg **argv, int argc, lo_message msg)
+{
+    int val_len;
+    mpr_id GID = 0;
+    mpr_time time;
+
+#ifdef DEBUG
+    /* messages dispatched locally or from batched reads have no source address */
+    trace("<%s> '%s:%s' received update: ",
+          (   msg && lo_message_get_source(msg)
+           && lo_address_get_protocol(lo_message_get_source(msg)) == LO_TCP) ? "TCP" : "UDP",
+          mpr_dev_get_name((mpr_dev)sig->dev), sig->name);
+    if (msg)
+        lo_message_pp(msg);
+    else
+        printf("(dispatched locally)\n");
+#endif
+
+    TRACE_RETURN_UNLESS(sig->num_inst, 0, "  signal '%s' has no instances.\n", sig->name);
+    RETURN_ARG_UNLESS(argc > offset, 0);
+
+    time = mpr_net_get_bundle_time(mpr_graph_get_net(sig->obj.graph));
+
+    while (offset < argc) {
+        if (types[offset] == MPR_STR) {
+            if ((strcmp(&argv[offset]->s, "@in") == 0) && argc >= offset + 2) {
+                TRACE_RETURN_UNLESS(types[offset + 1] == MPR_INT64, 0, "  error in "
+                                    "mpr_sig_osc_handler: bad arguments for 'instance' prop.\n")
+                GID = argv[offset + 1]->i64;
+                trace("  retrieved GUID %"PR_MPR_ID"\n", GID);
+                offset += 2;
+            }
+            else {
+                trace("  error in mpr_sig_osc_handler: unknown property name '%s'.\n",
+                      &argv[offset]->s);
+                return 0;
+            }
+        }
+        else if (types[offset] == MPR_INT64) {
+            /* compact messages carry the instance GUID without the "@in" label */
+            GID = argv[offset]->i64;
+            trace("  retrieved GUID %"PR_MPR_ID"\n", GID);
+            ++offset;
+        }
+        val_len = offset;
+        while (val_len < argc && types[val_len] != MPR_STR && types[val_len] != MPR_INT64)
+            ++val_len;
+        val_len -= offset;
+
+        /* values are stored contiguously in the message and nils have zero size */
+        val_len = update_inst(sig, slot_id, GID, types + offset,
+                              offset < argc ? (const char*)argv[offset] : NULL, val_len, time);
+        RETURN_ARG_UNLESS(val_len >= 0, 0);
+        offset += val_len;
+    }
+    return 0;
+}
+
+/* Reverse the byte order of `num` consecutive elements of `size` bytes. The 4- and 8-byte cases
+ * are written as simple loops over whole words so that the compiler can vectorise them. */
+static void swap_bytes(char *data, int size, int num)
+{
+    int i, j;
+    char tmp;
+#if defined(__GNUC__) || defined(__clang__)
+    if (4 == size) {
+        uint32_t word;
+        for (i = 0; i < num; i++, data += 4) {
+            memcpy(&word, data, 4);
+            word = __builtin_bswap32(word);
+            memcpy(data, &word, 4);
+        }
+        return;
+    }
+    if (8 == size) {
+        uint64_t word;
+        for (i = 0; i < num; i++, data += 8) {
+            memcpy(&word, data, 8);
+            word = __builtin_bswap64(word);
+            memcpy(data, &word, 8);
+        }
+        return;
+    }
+#endif
+    for (i = 0; i < num; i++, data += size) {
+        for (j = 0; j < size / 2; j++) {
+            tmp = data[j];
+            data[j] = data[size - 1 - j];
+            data[size - 1 - j] = tmp;
+        }
+    }
+}
+
+/* Decode a packed frame of instance updates (described in slot.h) directly from the blob
+ * memory. Returns -1 if the rest of the message should be discarded. */
+static int handle_frame(mpr_local_sig sig, int slot_id, lo_blob blob)
+{
+    mpr_frame_hdr_t hdr;
+    const char *data = lo_blob_dataptr(blob), *ids, *vals, *val;
+    const uint8_t *released;
+    uint32_t i, num_vals = 0, size = lo_blob_datasize(blob);
+    int swap, type_size, vec_size, bitmap_size, ret = -1;
+    mpr_type short_types[SHORT_VECTOR_LEN], short_nils[SHORT_VECTOR_LEN], *types, *nils;
+    double short_buf[SHORT_VECTOR_LEN], *buf;
+    mpr_time time;
+    mpr_id GID;
+
+    TRACE_RETURN_UNLESS(sig->num_inst, -1, "  signal '%s' has no instances.\n", sig->name);
+    TRACE_RETURN_UNLESS(data && size >= sizeof(hdr), -1, "  error: truncated update frame.\n");
+    memcpy(&hdr, data, sizeof(hdr));
+    if ((swap = (MPR_FRAME_ORDER != hdr.order))) {
+        swap_bytes((char*)&hdr.order, sizeof(uint16_t), 1);
+        swap_bytes((char*)&hdr.vlen, sizeof(uint32_t), 3);
+    }
+    TRACE_RETURN_UNLESS(   MPR_FRAME_ORDER == hdr.order && mpr_type_get_is_num(hdr.type)
+                        && hdr.vlen && hdr.vlen <= MPR_MAX_VECTOR_LEN && hdr.num_vals <= hdr.num,
+                        -1, "  error: bad update frame header.\n");
+    type_size = mpr_type_get_size(hdr.type);
+    vec_size = hdr.vlen * type_size;
+    bitmap_size = MPR_FRAME_BITMAP_SIZE(hdr.num);
+    TRACE_RETURN_UNLESS(  (uint64_t)size >= sizeof(hdr) + (uint64_t)hdr.num * sizeof(mpr_id)
+                        + bitmap_size + (uint64_t)hdr.num_vals * vec_size,
+                        -1, "  error: truncated update frame.\n");
+
+    ids = data + sizeof(hdr);
+    released = (const uint8_t*)ids + hdr.num * sizeof(mpr_id);
+    vals = (const char*)released + bitmap_size;
+    if (hdr.vlen <= SHORT_VECTOR_LEN) {
+        types = short_types;
+        nils = short_nils;
+        buf = short_buf;
+    }
+    else {
+        /* long vectors: avoid large stack allocations */
+        types = malloc(hdr.vlen * 2 * sizeof(mpr_type));
+        buf = malloc(hdr.vlen * sizeof(double));
+        if (!types || !buf)
+            goto done;
+        nils = types + hdr.vlen;
+    }
+    memset(types, hdr.type, hdr.vlen);
+    memset(nils, MPR_NULL, hdr.vlen);
+    time = mpr_net_get_bundle_time(mpr_graph_get_net(sig->obj.graph));
+
+    for (i = 0; i < hdr.num; i++) {
+        memcpy(&GID, ids + i * sizeof(mpr_id), sizeof(mpr_id));
+        if (swap)
+            swap_bytes((char*)&GID, sizeof(mpr_id), 1);
+        if (released[i / 8] & (1 << (i % 8))) {
+            if (update_inst(sig, slot_id, GID, nils, NULL, hdr.vlen, time) < 0)
+                goto done;
+            continue;
+        }
+        if (num_vals++ >= hdr.num_vals)
+            goto done;
+        if (swap) {
+            memcpy(buf, vals, vec_size);
+            swap_bytes((char*)buf, type_size, hdr.vlen);
+            val = (const char*)buf;
+        }
+        else
+            val = vals;
+        if (update_inst(sig, slot_id, GID, types, val, hdr.vlen, time) < 0)
+            goto done;
+        vals += vec_size;
+    }
+    ret = 0;
+
 done:
-    offset += val_len;
-    if (offset < argc)
-        goto again;
+    if (types != short_types) {
+        FUNC_IF(free, types);
+        FUNC_IF(free, buf);
+    }
+    return ret;
+}
+
+int mpr_sig_osc_handler(const char *path, const char *types, lo_arg **argv, int argc,
+                        lo_message msg, void *data)
+{
+    mpr_local_sig sig = (mpr_local_sig)data;
+    int offset = 0, slot_id = -1;
+
+    assert(sig);
+    RETURN_ARG_UNLESS(argc, 0);
+    /* skip updates repeated for forward error correction that have already been received */
+    RETURN_ARG_UNLESS(!mpr_net_get_is_redundant(mpr_graph_get_net(sig->obj.graph)), 0);
+
+    /* We need to consider that there may be properties prepended to the msg
+     * check length and find properties if any */
+    if (types[0] == MPR_STR) {
+        if ((strcmp(&argv[0]->s, "@sl") == 0) && argc >= 2) {
+            TRACE_RETURN_UNLESS(types[1] == MPR_INT32, 0,
+                                "  error in mpr_sig_osc_handler: bad arguments for 'slot' prop.\n")
+            slot_id = argv[1]->i32;
+            trace("  retrieved slot id %d\n", slot_id);
+            offset += 2;
+        }
+    }
+    return handle_update(sig, slot_id, offset, types, argv, argc, msg);
+}
+
+int mpr_sig_osc_alias_handler(const char *path, const char *types, lo_arg **argv, int argc,
+                              lo_message msg, void *data)
+{
+    mpr_local_sig sig = (mpr_local_sig)data;
+    assert(sig);
+    RETURN_ARG_UNLESS(!mpr_net_get_is_redundant(mpr_graph_get_net(sig->obj.graph)), 0);
+
+    /* compact messages always begin with the slot id, or -1 for destination slots */
+    TRACE_RETURN_UNLESS(argc >= 2 && types[0] == MPR_INT32, 0,
+                        "  error in mpr_sig_osc_alias_handler: bad header.\n");
+    return mpr_sig_handle_compact(sig, argv[0]->i32, types, argv, argc, msg);
+}
+
+int mpr_sig_handle_compact(mpr_local_sig sig, int slot_id, const char *types, lo_arg **argv,
+                           int argc, lo_message msg)
+{
+    int offset = 1, end;
+    RETURN_ARG_UNLESS(argc >= 2 && types[0] == MPR_INT32, 0);
+
+    while (offset < argc) {
+        if (LO_BLOB == types[offset]) {
+            /* packed frame of instance updates */
+            RETURN_ARG_UNLESS(handle_frame(sig, slot_id, (lo_blob)argv[offset]) >= 0, 0);
+            ++offset;
+            continue;
+        }
+        /* instance updates that could not be packed */
+        for (end = offset; end < argc && LO_BLOB != types[end]; end++) {}
+        handle_update(sig, slot_id, offset, types, argv, end, msg);
+        offset = end;
+    }
     return 0;
 }
 
+int mpr_sig_get_alias(mpr_sig sig)
+{
+    /* the low word of the signal id is unique within its device */
+    return (int)(sig->obj.id & 0x7FFFFFFF);
+}
+
+void mpr_sig_get_alias_path(int alias, char *path, int len)
+{
+    snprintf(path, len, "/@%d", alias);
+}
+
 /* Add a signal to a parent object. */
 mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
                     mpr_type type, const char *unit, const void *min,
@@ -718,7 +1182,10 @@ mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
 
 void mpr_local_sig_add_to_net(mpr_local_sig sig, mpr_net net)
 {
+    char path[SIG_ALIAS_PATH_LEN];
     mpr_net_add_dev_server_method(net, sig->dev, sig->path, mpr_sig_osc_handler, sig);
+    mpr_sig_get_alias_path(mpr_sig_get_alias((mpr_sig)sig), path, SIG_ALIAS_PATH_LEN);
+    mpr_net_add_dev_server_method(net, sig->dev, path, mpr_sig_osc_alias_handler, sig);
 }
 
 void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const char *name, int len,
@@ -781,6 +1248,7 @@ void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const cha
         mpr_local_sig lsig = (mpr_local_sig)sig;
         sig->num_inst = 0;
         lsig->updated_inst = 0;
+        lsig->oldest = lsig->newest = -1;
         lsig->value = mpr_value_new(lsig->len, lsig->type, 1, 0);
         if (num_inst) {
             mpr_sig_reserve_inst((mpr_sig)lsig, *num_inst, 0, 0);
@@ -796,6 +1264,9 @@ void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const cha
         /* Reserve one instance id map */
         lsig->num_id_maps = 1;
         lsig->id_maps = calloc(1, sizeof(struct _mpr_sig_id_map));
+        lsig->free_id_maps = malloc(sizeof(int));
+        lsig->free_id_maps[0] = 0;
+        lsig->num_free_id_maps = 1;
     }
     else {
         sig->num_inst = 1;
@@ -808,6 +1279,7 @@ void mpr_sig_init(mpr_sig sig, mpr_dev dev, int is_local, mpr_dir dir, const cha
 void mpr_sig_free(mpr_sig sig)
 {
     int i;
+    char path[SIG_ALIAS_PATH_LEN];
     mpr_local_dev ldev;
     mpr_net net;
     mpr_local_sig lsig = (mpr_local_sig)sig;
@@ -818,6 +1290,8 @@ void mpr_sig_free(mpr_sig sig)
 
     /* release associated OSC methods */
     mpr_net_remove_dev_server_method(net, ldev, lsig->path);
+    mpr_sig_get_alias_path(mpr_sig_get_alias(sig), path, SIG_ALIAS_PATH_LEN);
+    mpr_net_remove_dev_server_method(net, ldev, path);
     net = mpr_graph_get_net(sig->obj.graph);
 
     /* release active instances */
@@ -825,6 +1299,7 @@ void mpr_sig_free(mpr_sig sig)
         if (lsig->id_maps[i].inst)
             mpr_sig_release_inst_internal(lsig, i);
     }
+    mpr_net_remove_sig_mcast(net, sig);
 
     if (mpr_dev_get_is_registered((mpr_dev)ldev)) {
         /* Notify subscribers */
@@ -870,6 +1345,9 @@ void mpr_sig_free_internal(mpr_sig sig)
     if (sig->obj.is_local) {
         mpr_local_sig lsig = (mpr_local_sig)sig;
         free(lsig->id_maps);
+        FUNC_IF(free, lsig->free_id_maps);
+        FUNC_IF(free, lsig->inst_by_id.entries);
+        FUNC_IF(free, lsig->id_map_by_GID.entries);
         for (i = 0; i < lsig->num_inst; i++) {
             free(lsig->inst[i]);
         }
@@ -984,8 +1462,9 @@ static int get_inst_by_ids(mpr_local_sig lsig, mpr_id *LID, mpr_id *GID)
     trace("  checking inactive instances... %d active, %d reserved\n",
           mpr_sig_get_num_inst((mpr_sig)lsig, MPR_STATUS_ACTIVE),
           mpr_sig_get_num_inst((mpr_sig)lsig, MPR_STATUS_STAGED));
-    /* Next we will try to find an inactive instance */
-    for (i = 0; i < lsig->num_inst; i++) {
+    /* Next we will try to find an inactive instance, unless all ephemeral instances are active */
+    for (i = (lsig->ephemeral && lsig->num_active >= lsig->num_inst) ? lsig->num_inst : 0;
+         i < lsig->num_inst; i++) {
         si = lsig->inst[i];
         trace("    ...%d:%"PR_MPR_ID" (%sactive)\n", i, si->id, si->status & MPR_STATUS_ACTIVE ? "" : "in");
         if (   (!lsig->ephemeral || !(si->status & MPR_STATUS_ACTIVE))
@@ -1051,13 +1530,8 @@ static int get_inst_by_ids(mpr_local_sig lsig, mpr_id *LID, mpr_id *GID)
 
     return -1;
 done:
-    if (LID) {
-        si->id = *LID;
-        /* TODO: we don't really need to use qsort here since the list is already sorted
-         * just need to insert new inst at correct position */
-        /* also we're calling qsort in return */
-        qsort(lsig->inst, lsig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
-    }
+    if (LID)
+        _set_inst_id(lsig, si, *LID);
     if (!id_map) {
         /* Claim id map locally */
         id_map = mpr_dev_add_id_map(lsig->dev, lsig->group, si->id, GID ? *GID : 0, 0);
@@ -1073,28 +1547,10 @@ done:
 }
 
 // TODO: in the case of non-ephemeral instances we could still steal oldest proxy id_map
-static int _oldest_inst(mpr_local_sig lsig)
+MPR_INLINE static int _oldest_inst(mpr_local_sig lsig)
 {
-    int i, oldest;
-    mpr_sig_inst si;
-    for (i = 0; i < lsig->num_id_maps; i++) {
-        if (lsig->id_maps[i].inst)
-            break;
-    }
-    if (i == lsig->num_id_maps) {
-        /* no active instances to steal! */
-        return -1;
-    }
-    oldest = i;
-    for (i = oldest+1; i < lsig->num_id_maps; i++) {
-        if (!(si = _get_inst_by_id_map_idx(lsig, i)))
-            continue;
-        if ((si->created.sec < lsig->id_maps[oldest].inst->created.sec) ||
-            (si->created.sec == lsig->id_maps[oldest].inst->created.sec &&
-             si->created.frac < lsig->id_maps[oldest].inst->created.frac))
-            oldest = i;
-    }
-    return oldest;
+    /* returns -1 if there are no active instances to steal */
+    return lsig->oldest;
 }
 
 mpr_id mpr_sig_get_oldest_inst_id(mpr_sig sig)
@@ -1108,28 +1564,10 @@ mpr_id mpr_sig_get_oldest_inst_id(mpr_sig sig)
     return (idx >= 0) ? lsig->id_maps[idx].id_map->LID : 0;
 }
 
-int _newest_inst(mpr_local_sig lsig)
+MPR_INLINE static int _newest_inst(mpr_local_sig lsig)
 {
-    int i, newest;
-    mpr_sig_inst si;
-    for (i = 0; i < lsig->num_id_maps; i++) {
-        if (lsig->id_maps[i].inst)
-            break;
-    }
-    if (i == lsig->num_id_maps) {
-        /* no active instances to steal! */
-        return -1;
-    }
-    newest = i;
-    for (i = newest + 1; i < lsig->num_id_maps; i++) {
-        if (!(si = _get_inst_by_id_map_idx(lsig, i)))
-            continue;
-        if ((si->created.sec > lsig->id_maps[newest].inst->created.sec) ||
-            (si->created.sec == lsig->id_maps[newest].inst->created.sec &&
-             si->created.frac > lsig->id_maps[newest].inst->created.frac))
-            newest = i;
-    }
-    return newest;
+    /* returns -1 if there are no active instances to steal */
+    return lsig->newest;
 }
 
 mpr_id mpr_sig_get_newest_inst_id(mpr_sig sig)
@@ -1159,14 +1597,15 @@ static int mpr_sig_get_id_map_with_LID(mpr_local_sig lsig, mpr_id LID, int flags
                                        uint8_t activate, uint8_t call_handler_on_activate)
 {
     mpr_sig_handler *h;
+    mpr_sig_inst si;
     int i;
 
     if (!lsig->use_inst)
         LID = MPR_DEFAULT_INST_LID;
     h = (mpr_sig_handler*)lsig->handler;
-    for (i = 0; i < lsig->num_id_maps; i++) {
+    if ((si = _find_inst_by_id(lsig, LID)) && (i = si->id_map_idx) >= 0) {
         mpr_sig_id_map sig_id_map = &lsig->id_maps[i];
-        if (sig_id_map->inst && sig_id_map->id_map && sig_id_map->id_map->LID == LID)
+        if (sig_id_map->inst == si && sig_id_map->id_map && sig_id_map->id_map->LID == LID)
             return (sig_id_map->status & ~flags) ? -1 : i;
     }
     RETURN_ARG_UNLESS(activate, -1);
@@ -1233,11 +1672,8 @@ static int mpr_sig_get_id_map_with_GID(mpr_local_sig lsig, mpr_id GID, int flags
     mpr_sig_inst si;
     int i;
     h = (mpr_sig_handler*)lsig->handler;
-    for (i = 0; i < lsig->num_id_maps; i++) {
-        mpr_sig_id_map sig_id_map = &lsig->id_maps[i];
-        if (sig_id_map->id_map && sig_id_map->id_map->GID == GID)
-            return (sig_id_map->status & ~flags) ? -1 : i;
-    }
+    if ((i = _find_id_map_by_GID(lsig, GID)) >= 0)
+        return (lsig->id_maps[i].status & ~flags) ? -1 : i;
     RETURN_ARG_UNLESS(activate, -1);
 
     /* Here we still risk creating conflicting maps if two signals are updated asynchronously.
@@ -1290,18 +1726,13 @@ static int mpr_sig_get_id_map_with_GID(mpr_local_sig lsig, mpr_id GID, int flags
     return i;
 }
 
-/* finding id_maps here will be a bit inefficient for now */
-/* TODO: optimize storage and lookup */
 static int _get_id_map_idx_by_inst_idx(mpr_local_sig sig, unsigned int inst_idx)
 {
-    int i;
-    for (i = 0; i < sig->num_id_maps; i++) {
-        mpr_sig_id_map sig_id_map = &sig->id_maps[i];
-        if (sig_id_map->inst && sig_id_map->inst->idx == inst_idx) {
-            return i;
-        }
-    }
-    return -1;
+    mpr_sig_inst si;
+    RETURN_ARG_UNLESS(inst_idx < sig->num_inst, -1);
+    /* the instance array is kept in index order */
+    si = sig->inst[inst_idx];
+    return (si->id_map_idx >= 0 && sig->id_maps[si->id_map_idx].inst == si) ? si->id_map_idx : -1;
 }
 
 mpr_id_map mpr_local_sig_get_id_map_by_inst_idx(mpr_local_sig sig, unsigned int inst_idx)
@@ -1312,12 +1743,11 @@ mpr_id_map mpr_local_sig_get_id_map_by_inst_idx(mpr_local_sig sig, unsigned int
 
 static int _reserve_inst(mpr_local_sig lsig, mpr_id *id, void *data)
 {
-    int i, cont;
     mpr_sig_inst si;
     RETURN_ARG_UNLESS(lsig->num_inst < MAX_INST, -1);
 
     /* check if instance with this id already exists! If so, stop here. */
-    if (id && _find_inst_by_id(lsig, *id))
+    if (id && id_tbl_find(&lsig->inst_by_id, *id) >= 0)
         return -1;
 
     /* reallocate array of instances */
@@ -1330,26 +1760,19 @@ static int _reserve_inst(mpr_local_sig lsig, mpr_id *id, void *data)
         si->id = *id;
     else {
         /* find lowest unused id */
-        mpr_id lowest_id = 0;
-        cont = 1;
-        while (cont) {
-            cont = 0;
-            for (i = 0; i < lsig->num_inst; i++) {
-                if (lsig->inst[i]->id == lowest_id) {
-                    cont = 1;
-                    break;
-                }
-            }
-            lowest_id += cont;
-        }
+        mpr_id lowest_id = lsig->next_inst_id;
+        while (id_tbl_find(&lsig->inst_by_id, lowest_id) >= 0)
+            ++lowest_id;
         si->id = lowest_id;
+        lsig->next_inst_id = lowest_id + 1;
     }
     si->idx = lsig->num_inst;
     si->data = data;
+    si->id_map_idx = -1;
+    id_tbl_add(&lsig->inst_by_id, si->id, si->idx);
 
+    /* instances are appended so that the array stays in index order */
     ++lsig->num_inst;
-    /* TODO: move this qsort out to call with multiple ids */
-    qsort(lsig->inst, lsig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
     return lsig->num_inst - 1;
 }
 
@@ -1377,7 +1800,7 @@ int mpr_sig_reserve_inst(mpr_sig sig, int num, mpr_id *ids, void **data)
     if (!sig->use_inst && lsig->num_inst == 1 && !lsig->inst[0]->id && !lsig->inst[0]->data) {
         /* we will overwrite the default instance first */
         if (ids)
-            lsig->inst[0]->id = ids[0];
+            _set_inst_id(lsig, lsig->inst[0], ids[0]);
         if (data)
             lsig->inst[0]->data = data[0];
         ++i;
@@ -1466,12 +1889,50 @@ done:
     FUNC_IF(lo_address_free, addr);
 }
 
+/* Returns 0 if the value contains NaN. */
+static int _check_value(int len, mpr_type type, const void *val)
+{
+    int i;
+    if (type == MPR_FLT) {
+        for (i = 0; i < len; i++)
+            RETURN_ARG_UNLESS(((float*)val)[i] == ((float*)val)[i], 0);
+    }
+    else if (type == MPR_DBL) {
+        for (i = 0; i < len; i++)
+            RETURN_ARG_UNLESS(((double*)val)[i] == ((double*)val)[i], 0);
+    }
+    return 1;
+}
+
+/* Store a new value for the instance at id_map_idx and mark it as updated. */
+static void _set_inst_value(mpr_local_sig lsig, int id_map_idx, int len, mpr_type type,
+                            const void *val, mpr_time time)
+{
+    int status = MPR_STATUS_HAS_VALUE | MPR_STATUS_UPDATE_LOC;
+    mpr_sig_inst si = _get_inst_by_id_map_idx(lsig, id_map_idx);
+
+    /* update value */
+    if (type != lsig->type || len < lsig->len) {
+        if (!mpr_value_set_next_coerced(lsig->value, si->idx, lsig->len, type, val, time))
+            status |= MPR_STATUS_NEW_VALUE;
+    }
+    else {
+        if (mpr_value_cmp(lsig->value, si->idx, 0, val))
+            si->status |= MPR_STATUS_NEW_VALUE;
+        mpr_value_set_next(lsig->value, si->idx, val, time);
+    }
+    si->status |= status;
+    lsig->obj.status |= status;
+
+    /* mark instance as updated */
+    mpr_local_sig_set_updated(lsig, si->idx);
+}
+
 void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const void *val)
 {
     mpr_time time;
-    int id_map_idx, status = MPR_STATUS_HAS_VALUE | MPR_STATUS_UPDATE_LOC;
+    int id_map_idx;
     mpr_local_sig lsig = (mpr_local_sig)sig;
-    mpr_sig_inst si;
     RETURN_UNLESS(sig);
     if (!sig->obj.is_local) {
         _mpr_remote_sig_set_value(sig, len, type, val);
@@ -1487,46 +1948,100 @@ void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const voi
 #endif
         return;
     }
-    if (type != MPR_INT32) {
-        /* check for NaN */
-        int i;
-        if (type == MPR_FLT) {
-            for (i = 0; i < len; i++)
-                RETURN_UNLESS(((float*)val)[i] == ((float*)val)[i]);
-        }
-        else if (type == MPR_DBL) {
-            for (i = 0; i < len; i++)
-                RETURN_UNLESS(((double*)val)[i] == ((double*)val)[i]);
-        }
-    }
+    RETURN_UNLESS(_check_value(len, type, val));
+    /* updates from other threads are applied later by the polling thread */
+    if (mpr_local_dev_queue_update(lsig->dev, sig, id, len, type, val))
+        return;
     time = mpr_dev_get_time(sig->dev);
     id_map_idx = mpr_sig_get_id_map_with_LID(lsig, id, 0, time, 1, 0);
     RETURN_UNLESS(id_map_idx >= 0);
-    si = _get_inst_by_id_map_idx(lsig, id_map_idx);
+    _set_inst_value(lsig, id_map_idx, len, type, val, time);
+    process_maps(lsig, id_map_idx);
+}
 
-    /* update value */
-    if (type != lsig->type || len < lsig->len) {
-        if (!mpr_value_set_next_coerced(lsig->value, si->idx, lsig->len, type, val, time))
-            status |= MPR_STATUS_NEW_VALUE;
+void mpr_sig_set_values(mpr_sig sig, int num, const mpr_id *ids, int len, mpr_type type,
+                        const void *vals)
+{
+    mpr_time time;
+    int i, j, num_idxs = 0, id_map_idxs[BATCH_SIZE];
+    size_t size;
+    mpr_local_sig lsig = (mpr_local_sig)sig;
+    RETURN_UNLESS(sig && num > 0 && ids);
+    if (!len || !vals) {
+        RETURN_UNLESS(sig->obj.is_local && sig->ephemeral);
+        if (mpr_local_dev_queue_update(lsig->dev, sig, ids[0], 0, 0, NULL)) {
+            for (i = 1; i < num; i++)
+                mpr_local_dev_queue_update(lsig->dev, sig, ids[i], 0, 0, NULL);
+            return;
+        }
+        for (i = 0; i < num; i++) {
+            mpr_sig_inst si = _find_inst_by_id(lsig, ids[i]);
+            int id_map_idx;
+            if (!si) {
+                trace("signal instance %s.%"PR_MPR_ID" not found\n", sig->name, ids[i]);
+                continue;
+            }
+            if ((id_map_idx = _get_id_map_idx_by_inst_idx(lsig, si->idx)) < 0)
+                continue;
+            /* skip ids repeated within the batch */
+            for (j = 0; j < num_idxs && id_map_idxs[j] != id_map_idx; j++) {}
+            if (j < num_idxs || !release_inst_begin(lsig, id_map_idx))
+                continue;
+            id_map_idxs[num_idxs++] = id_map_idx;
+            if (BATCH_SIZE == num_idxs) {
+                release_insts(lsig, id_map_idxs, num_idxs);
+                num_idxs = 0;
+            }
+        }
+        if (num_idxs)
+            release_insts(lsig, id_map_idxs, num_idxs);
+        return;
     }
-    else {
-        if (mpr_value_cmp(lsig->value, si->idx, 0, val))
-            si->status |= MPR_STATUS_NEW_VALUE;
-        mpr_value_set_next(lsig->value, si->idx, val, time);
+    if (!mpr_type_get_is_num(type)) {
+#ifdef DEBUG
+        trace("called update on signal '%s' with non-number type '%c'\n", sig->name, type);
+#endif
+        return;
     }
-    si->status |= status;
-    sig->obj.status |= status;
-
-    /* mark instance as updated */
-    mpr_local_sig_set_updated(lsig, si->idx);
+    size = mpr_type_get_size(type) * len;
+    if (!sig->obj.is_local) {
+        for (i = 0; i < num; i++)
+            _mpr_remote_sig_set_value(sig, len, type, (const char*)vals + i * size);
+        return;
+    }
+    if (mpr_local_dev_queue_update(lsig->dev, sig, ids[0], len, type, vals)) {
+        for (i = 1; i < num; i++)
+            mpr_local_dev_queue_update(lsig->dev, sig, ids[i], len, type, (const char*)vals + i * size);
+        return;
+    }
+    time = mpr_dev_get_time(sig->dev);
+    for (i = 0; i < num; i++) {
+        const void *val = (const char*)vals + i * size;
+        int id_map_idx;
+        if (!_check_value(len, type, val))
+            continue;
+        id_map_idx = mpr_sig_get_id_map_with_LID(lsig, ids[i], 0, time, 1, 0);
+        if (id_map_idx < 0)
+            continue;
+        _set_inst_value(lsig, id_map_idx, len, type, val, time);
+        id_map_idxs[num_idxs++] = id_map_idx;
 
-    process_maps(lsig, id_map_idx);
+        /* propagate the batch in chunks */
+        if (BATCH_SIZE == num_idxs) {
+            process_maps_updated(lsig, id_map_idxs, num_idxs);
+            num_idxs = 0;
+        }
+    }
+    if (num_idxs)
+        process_maps_updated(lsig, id_map_idxs, num_idxs);
 }
 
 void mpr_sig_release_inst(mpr_sig sig, mpr_id id)
 {
     mpr_sig_inst si;
     RETURN_UNLESS(sig && sig->obj.is_local && sig->ephemeral);
+    if (mpr_local_dev_queue_update((mpr_local_dev)sig->dev, sig, id, 0, 0, NULL))
+        return;
     si = _find_inst_by_id((mpr_local_sig)sig, id);
     if (si) {
         trace("found signal instance %s.%"PR_MPR_ID"\n", sig->name, id);
@@ -1539,28 +2054,33 @@ void mpr_sig_release_inst(mpr_sig sig, mpr_id id)
     }
 }
 
-static void mpr_sig_release_inst_internal(mpr_local_sig lsig, int id_map_idx)
+/* Reset the value of an instance being released. Returns 0 if it is not active. */
+static int release_inst_begin(mpr_local_sig lsig, int id_map_idx)
 {
     mpr_time time;
     mpr_sig_id_map smap = &lsig->id_maps[id_map_idx];
-    RETURN_UNLESS(smap->inst);
+    RETURN_ARG_UNLESS(smap->inst, 0);
 
     trace("  releasing signal instance\n");
 
-    mpr_dev_get_time((mpr_dev)lsig->dev);
-
     /* mark instance as updated */
     mpr_local_sig_set_updated(lsig, smap->inst->idx);
 
     time = mpr_dev_get_time((mpr_dev)lsig->dev);
     mpr_value_reset_inst(lsig->value, smap->inst->idx, time);
-    process_maps(lsig, id_map_idx);
+    return 1;
+}
+
+/* Return an instance to the reserve once its release has been propagated. */
+static void release_inst_end(mpr_local_sig lsig, int id_map_idx)
+{
+    mpr_sig_id_map smap = &lsig->id_maps[id_map_idx];
     if (smap->id_map && mpr_dev_LID_decref((mpr_local_dev)lsig->dev, lsig->group, smap->id_map)) {
-        smap->id_map = 0;
+        _clear_id_map(lsig, id_map_idx);
     }
     else if ((lsig->dir & MPR_DIR_OUT) || smap->status & RELEASED_REMOTELY) {
         /* TODO: consider multiple upstream source instances? */
-        smap->id_map = 0;
+        _clear_id_map(lsig, id_map_idx);
     }
     else {
         /* mark map as locally-released but do not remove it */
@@ -1568,8 +2088,28 @@ static void mpr_sig_release_inst_internal(mpr_local_sig lsig, int id_map_idx)
     }
 
     /* Put instance back in reserve list */
+    if (smap->inst->status & MPR_STATUS_ACTIVE)
+        --lsig->num_active;
     smap->inst->status = MPR_STATUS_STAGED;
+    smap->inst->id_map_idx = -1;
     smap->inst = 0;
+    _age_list_remove(lsig, id_map_idx);
+}
+
+static void mpr_sig_release_inst_internal(mpr_local_sig lsig, int id_map_idx)
+{
+    RETURN_UNLESS(release_inst_begin(lsig, id_map_idx));
+    process_maps(lsig, id_map_idx);
+    release_inst_end(lsig, id_map_idx);
+}
+
+/* Release a batch of instances, propagating the releases through each map once. */
+static void release_insts(mpr_local_sig lsig, const int *id_map_idxs, int num)
+{
+    int i;
+    process_maps_released(lsig, id_map_idxs, num);
+    for (i = 0; i < num; i++)
+        release_inst_end(lsig, id_map_idxs[i]);
 }
 
 /* this function is called for local destination signals when a map is released or when a map
@@ -1598,28 +2138,39 @@ void mpr_local_sig_release_inst_by_origin(mpr_local_sig lsig, mpr_dev origin)
 
 void mpr_sig_remove_inst(mpr_sig sig, mpr_id id)
 {
-    int i, remove_idx;
+    int i, remove_idx, id_map_idx;
     mpr_local_sig lsig = (mpr_local_sig)sig;
     RETURN_UNLESS(sig && sig->obj.is_local && sig->use_inst);
-    for (i = 0; i < lsig->num_inst; i++) {
-        if (lsig->inst[i]->id == id)
-            break;
-    }
-    RETURN_UNLESS(i < lsig->num_inst);
+    RETURN_UNLESS((i = id_tbl_find(&lsig->inst_by_id, id)) >= 0);
 
     if (lsig->inst[i]->status & MPR_STATUS_ACTIVE) {
        /* First release instance */
-       mpr_sig_release_inst_internal(lsig, i);
+       id_map_idx = _get_id_map_idx_by_inst_idx(lsig, i);
+       if (id_map_idx >= 0)
+           mpr_sig_release_inst_internal(lsig, id_map_idx);
+       if (lsig->inst[i]->status & MPR_STATUS_ACTIVE)
+           --lsig->num_active;
     }
 
     remove_idx = lsig->inst[i]->idx;
+    if (id < lsig->next_inst_id)
+        lsig->next_inst_id = id;
+    id_tbl_remove(&lsig->inst_by_id, id, remove_idx);
 
     /* Free value and timetag memory held by instance */
     mpr_value_remove_inst(lsig->value, i);
     free(lsig->inst[i]);
 
-    for (++i; i < lsig->num_inst; i++)
-    lsig->inst[i-1] = lsig->inst[i];
+    /* Move the following instances down, updating only their entries in the index of ids */
+    for (++i; i < lsig->num_inst; i++) {
+        mpr_sig_inst si = lsig->inst[i];
+        lsig->inst[i-1] = si;
+        if (si->idx > remove_idx) {
+            id_tbl_remove(&lsig->inst_by_id, si->id, si->idx);
+            --si->idx;
+            id_tbl_add(&lsig->inst_by_id, si->id, si->idx);
+        }
+    }
     --lsig->num_inst;
     lsig->inst = realloc(lsig->inst, sizeof(mpr_sig_inst) * lsig->num_inst);
 
@@ -1628,12 +2179,6 @@ void mpr_sig_remove_inst(mpr_sig sig, mpr_id id)
         mpr_slot_remove_inst(lsig->slots_out[i], remove_idx);
     for (i = 0; i < lsig->num_maps_in; i++)
         mpr_slot_remove_inst(lsig->slots_in[i], remove_idx);
-
-    /* Renumber instance indexes */
-    for (i = 0; i < lsig->num_inst; i++) {
-        if (lsig->inst[i]->idx > remove_idx)
-            --lsig->inst[i]->idx;
-    }
     mpr_obj_incr_version((mpr_obj)sig);
 }
 
@@ -1808,32 +2353,37 @@ static int _init_and_add_id_map(mpr_local_sig lsig, mpr_sig_inst si,
         si->status &= ~MPR_STATUS_STAGED;
         si->status |= (MPR_STATUS_NEW | MPR_STATUS_ACTIVE);
         mpr_time_set(&si->created, MPR_NOW);
+        ++lsig->num_active;
     }
 
     /* find unused signal map */
-    for (i = 0; i < lsig->num_id_maps; i++) {
-        if (!lsig->id_maps[i].id_map)
-            break;
-    }
-    if (i == lsig->num_id_maps) {
+    if (!lsig->num_free_id_maps) {
         /* need more memory */
-        if (lsig->num_id_maps >= MAX_INST) {
+        int num = lsig->num_id_maps;
+        if (num >= MAX_INST) {
             /* Arbitrary limit to number of tracked id_maps */
             /* TODO: add checks for this return value */
             trace("warning: reached maximum number of instances for signal %s.\n", lsig->name);
             return -1;
         }
-        lsig->num_id_maps = lsig->num_id_maps ? lsig->num_id_maps * 2 : 1;
+        lsig->num_id_maps = num ? num * 2 : 1;
         lsig->id_maps = realloc(lsig->id_maps, (lsig->num_id_maps * sizeof(struct _mpr_sig_id_map)));
-        memset(lsig->id_maps + i, 0, ((lsig->num_id_maps - i) * sizeof(struct _mpr_sig_id_map)));
+        memset(lsig->id_maps + num, 0, ((lsig->num_id_maps - num) * sizeof(struct _mpr_sig_id_map)));
+        lsig->free_id_maps = realloc(lsig->free_id_maps, lsig->num_id_maps * sizeof(int));
+        /* push in reverse so that the lowest index is used first */
+        for (i = lsig->num_id_maps - 1; i >= num; i--)
+            lsig->free_id_maps[lsig->num_free_id_maps++] = i;
     }
+    i = lsig->free_id_maps[--lsig->num_free_id_maps];
     lsig->id_maps[i].id_map = id_map;
     lsig->id_maps[i].inst = si;
+    lsig->id_maps[i].GID = id_map->GID;
     lsig->id_maps[i].status = 0;
+    id_tbl_add(&lsig->id_map_by_GID, id_map->GID, i);
+    _age_list_add(lsig, i);
 
-    si->id = id_map->LID;
-    /* same comment wrt qsort here */
-    qsort(lsig->inst, lsig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
+    si->id_map_idx = i;
+    _set_inst_id(lsig, si, id_map->LID);
 
     /* return id_map index */
     return i;
@@ -22,7 +22,7 @@
 #define MPR_SLOT_STRUCT_ITEMS                                                   \
     mpr_sig sig;                    /*!< Pointer to parent signal */            \
     int id;                                                                     \
-    uint8_t num_inst;                                                           \
+    int num_inst;                                                               \
     char dir;                       /*!< `DI_INCOMING` or `DI_OUTGOING` */      \
     char causes_update;             /*!< 1 if causes update, 0 otherwise. */    \
     char is_local;
@@ -39,12 +39,182 @@ typedef struct _mpr_local_slot {
     /* TODO: use signal for holding memory of local slots for efficiency */
     mpr_value val;                  /*!< Value histories for each signal instance. */
     mpr_link link;
-    lo_message msg;
+    lo_message msg;                 /*!< Built from osc only when a consumer needs a message. */
+    const char *path;               /*!< Alias path if msg uses the compact form, or NULL. */
+    struct {
+        char *types;                /*!< OSC type tag string, beginning with ','. */
+        char *data;                 /*!< Argument data in network byte order. */
+        int num_types;
+        int types_size;
+        int len;
+        int size;
+    } osc;                          /*!< Outgoing message encoded in place. */
+    struct {
+        mpr_id *ids;                /*!< Instance GIDs. */
+        uint8_t *released;          /*!< Bitmap of released instances. */
+        char *vals;                 /*!< Packed values of instances that were not released. */
+        int num;
+        int num_vals;
+        int size;
+        int vals_size;
+        unsigned int vlen;
+        mpr_type type;
+    } frame;                        /*!< Instance updates not yet added to msg. */
     uint16_t num_msg;
     uint8_t sending;
+    uint8_t has_msg;                /*!< 1 if msg holds the current contents of osc. */
+    int8_t priority;                /*!< Priority class of the map relative to normal. */
     uint8_t is_used;
 } mpr_local_slot_t;
 
+/* Make room in the slot encoder for more arguments. Invalidates the cached lo_message. */
+static void osc_reserve(mpr_local_slot slot, int num_types, int len)
+{
+    /* leave room for the terminating null */
+    if (slot->osc.num_types + num_types + 1 > slot->osc.types_size) {
+        slot->osc.types_size = (slot->osc.num_types + num_types + 1) * 2;
+        slot->osc.types = realloc(slot->osc.types, slot->osc.types_size);
+    }
+    if (slot->osc.len + len > slot->osc.size) {
+        slot->osc.size = (slot->osc.len + len) * 2;
+        slot->osc.data = realloc(slot->osc.data, slot->osc.size);
+    }
+    slot->has_msg = 0;
+}
+
+static void osc_reset(mpr_local_slot slot)
+{
+    osc_reserve(slot, 1, 0);
+    slot->osc.types[0] = ',';
+    slot->osc.num_types = 1;
+    slot->osc.len = 0;
+}
+
+/* Size the encoder for a message carrying every instance of the slot signal, so that building
+ * messages does not need to allocate memory once the map is active. */
+static void alloc_osc(mpr_local_slot slot)
+{
+    int len = mpr_sig_get_len(slot->sig), num = slot->num_inst, size, num_types;
+    mpr_type type = mpr_sig_get_type(slot->sig);
+    size = (len && type) ? len * mpr_type_get_size(type) : 0;
+
+    /* slot id, then an instance id and value per instance or a single packed frame */
+    num_types = 3 + num * (2 + len);
+    size = 8 + num * (12 + size) + 4 + sizeof(mpr_frame_hdr_t) + num * (sizeof(mpr_id) + size)
+           + MPR_FRAME_BITMAP_SIZE(num) + 3;
+    if (num_types > slot->osc.types_size) {
+        slot->osc.types = realloc(slot->osc.types, num_types);
+        slot->osc.types_size = num_types;
+    }
+    if (size > slot->osc.size) {
+        slot->osc.data = realloc(slot->osc.data, size);
+        slot->osc.size = size;
+    }
+    osc_reset(slot);
+}
+
+static void osc_add_int32(mpr_local_slot slot, int32_t val)
+{
+    uint32_t u = lo_htoo32((uint32_t)val);
+    osc_reserve(slot, 1, 4);
+    memcpy(slot->osc.data + slot->osc.len, &u, 4);
+    slot->osc.len += 4;
+    slot->osc.types[slot->osc.num_types++] = MPR_INT32;
+}
+
+static void osc_add_int64(mpr_local_slot slot, int64_t val)
+{
+    uint64_t u = lo_htoo64((uint64_t)val);
+    osc_reserve(slot, 1, 8);
+    memcpy(slot->osc.data + slot->osc.len, &u, 8);
+    slot->osc.len += 8;
+    slot->osc.types[slot->osc.num_types++] = MPR_INT64;
+}
+
+static void osc_add_str(mpr_local_slot slot, const char *str)
+{
+    int len = strlen(str) + 1, padded = (len + 3) & ~3;
+    osc_reserve(slot, 1, padded);
+    memset(slot->osc.data + slot->osc.len + padded - 4, 0, 4);
+    memcpy(slot->osc.data + slot->osc.len, str, len);
+    slot->osc.len += padded;
+    slot->osc.types[slot->osc.num_types++] = MPR_STR;
+}
+
+static void osc_add_nil(mpr_local_slot slot)
+{
+    osc_reserve(slot, 1, 0);
+    slot->osc.types[slot->osc.num_types++] = 'N';
+}
+
+static const char *osc_get_types(mpr_local_slot slot)
+{
+    slot->osc.types[slot->osc.num_types] = 0;
+    return slot->osc.types;
+}
+
+/* Build the liblo message from the encoded arguments for consumers that need one. */
+static lo_message get_lo_msg(mpr_local_slot slot)
+{
+    const char *data = slot->osc.data;
+    int i;
+    uint32_t u32;
+    uint64_t u64;
+    RETURN_ARG_UNLESS(!slot->has_msg, slot->msg);
+
+    lo_message_clear(slot->msg);
+    for (i = 1; i < slot->osc.num_types; i++) {
+        switch (slot->osc.types[i]) {
+            case MPR_INT32:
+            case MPR_FLT:
+                memcpy(&u32, data, 4);
+                u32 = lo_otoh32(u32);
+                if (MPR_INT32 == slot->osc.types[i])
+                    lo_message_add_int32(slot->msg, (int32_t)u32);
+                else {
+                    float f;
+                    memcpy(&f, &u32, 4);
+                    lo_message_add_float(slot->msg, f);
+                }
+                data += 4;
+                break;
+            case MPR_INT64:
+            case MPR_DBL:
+                memcpy(&u64, data, 8);
+                u64 = lo_otoh64(u64);
+                if (MPR_INT64 == slot->osc.types[i])
+                    lo_message_add_int64(slot->msg, (int64_t)u64);
+                else {
+                    double d;
+                    memcpy(&d, &u64, 8);
+                    lo_message_add_double(slot->msg, d);
+                }
+                data += 8;
+                break;
+            case MPR_STR:
+                lo_message_add_string(slot->msg, data);
+                data += (strlen(data) + 4) & ~3;
+                break;
+            case 'b': {
+                lo_blob blob;
+                memcpy(&u32, data, 4);
+                u32 = lo_otoh32(u32);
+                if ((blob = lo_blob_new(u32, data + 4))) {
+                    lo_message_add_blob(slot->msg, blob);
+                    lo_blob_free(blob);
+                }
+                data += 4 + ((u32 + 3) & ~3);
+                break;
+            }
+            default:
+                lo_message_add_nil(slot->msg);
+                break;
+        }
+    }
+    slot->has_msg = 1;
+    return slot->msg;
+}
+
 mpr_slot mpr_slot_new(mpr_map map, mpr_sig sig, mpr_dir dir,
                       unsigned char is_local, unsigned char is_src)
 {
@@ -91,6 +261,7 @@ mpr_slot mpr_slot_new(mpr_map map, mpr_sig sig, mpr_dir dir,
                 trace("Error allocating lo_message\n");
                 assert(0);
             }
+            alloc_osc(lslot);
         }
     }
 
@@ -109,7 +280,12 @@ void mpr_slot_free(mpr_slot slot)
         FUNC_IF(mpr_value_free, lslot->val);
         if (mpr_obj_get_is_local((mpr_obj)slot->sig))
             mpr_local_sig_remove_slot((mpr_local_sig)slot->sig, lslot, lslot->dir);
-        if (lslot->sending) {
+        FUNC_IF(free, lslot->frame.ids);
+        FUNC_IF(free, lslot->frame.released);
+        FUNC_IF(free, lslot->frame.vals);
+        FUNC_IF(free, lslot->osc.types);
+        FUNC_IF(free, lslot->osc.data);
+        if (lslot->sending && lslot->has_msg) {
             /* message has already been added to a bundle */
             lo_message_decref(lslot->msg);
         }
@@ -359,6 +535,8 @@ void mpr_slot_set_id(mpr_slot slot, int id)
 {
     slot->id = id;
     if (slot->is_local) {
+        /* the map is being activated so the signal properties should be known by now */
+        alloc_osc((mpr_local_slot)slot);
         ((mpr_local_slot)slot)->num_msg = -1;
         mpr_slot_clear_msg((mpr_local_slot)slot);
     }
@@ -411,6 +589,11 @@ void mpr_local_slot_set_is_used(mpr_local_slot slot, int is_used)
         slot->causes_update = 0;
 }
 
+void mpr_local_slot_set_priority(mpr_local_slot slot, int priority)
+{
+    slot->priority = priority;
+}
+
 int mpr_slot_get_status(mpr_local_slot slot)
 {
     int status = 0;
@@ -433,21 +616,137 @@ int mpr_slot_get_status(mpr_local_slot slot)
     return status;
 }
 
+/* Serialize any packed instance updates directly into the slot message as a blob. */
+static void add_frame_to_msg(mpr_local_slot slot)
+{
+    mpr_frame_hdr_t hdr;
+    int num = slot->frame.num, bitmap_size = MPR_FRAME_BITMAP_SIZE(num);
+    int vals_size = slot->frame.num_vals * slot->frame.vlen * mpr_type_get_size(slot->frame.type);
+    int size = sizeof(mpr_frame_hdr_t) + num * sizeof(mpr_id) + bitmap_size + vals_size;
+    int padded = (size + 3) & ~3;
+    uint32_t blob_size = lo_htoo32((uint32_t)size);
+    char *pos;
+    RETURN_UNLESS(num);
+
+    osc_reserve(slot, 1, 4 + padded);
+    pos = slot->osc.data + slot->osc.len;
+    memcpy(pos, &blob_size, 4);
+    pos += 4;
+    hdr.order = MPR_FRAME_ORDER;
+    hdr.type = slot->frame.type;
+    hdr.reserved = 0;
+    hdr.vlen = slot->frame.vlen;
+    hdr.num = num;
+    hdr.num_vals = slot->frame.num_vals;
+    memcpy(pos, &hdr, sizeof(mpr_frame_hdr_t));
+    pos += sizeof(mpr_frame_hdr_t);
+    memcpy(pos, slot->frame.ids, num * sizeof(mpr_id));
+    pos += num * sizeof(mpr_id);
+    memcpy(pos, slot->frame.released, bitmap_size);
+    pos += bitmap_size;
+    memcpy(pos, slot->frame.vals, vals_size);
+    pos += vals_size;
+    memset(pos, 0, padded - size);
+
+    slot->osc.len += 4 + padded;
+    slot->osc.types[slot->osc.num_types++] = 'b';
+    slot->frame.num = slot->frame.num_vals = 0;
+}
+
+/* Add an instance update to the packed frame. Returns 0 if the update cannot be packed. */
+static int add_to_frame(mpr_local_slot slot, mpr_value val, unsigned int idx, mpr_id GID)
+{
+    int num = slot->frame.num, size;
+    mpr_type type = val ? mpr_value_get_type(val) : mpr_sig_get_type(slot->sig);
+    unsigned int vlen = val ? mpr_value_get_vlen(val) : mpr_sig_get_len(slot->sig);
+
+    /* partial vectors need per-element nils */
+    RETURN_ARG_UNLESS(!val || mpr_value_get_has_value(val, idx), 0);
+    if (!num) {
+        slot->frame.type = type;
+        slot->frame.vlen = vlen;
+    }
+    else if (val && (type != slot->frame.type || vlen != slot->frame.vlen)) {
+        /* frame was started by releases of another type */
+        RETURN_ARG_UNLESS(!slot->frame.num_vals, 0);
+        slot->frame.type = type;
+        slot->frame.vlen = vlen;
+    }
+
+    if (num >= slot->frame.size) {
+        int old_size = MPR_FRAME_BITMAP_SIZE(slot->frame.size), new_size;
+        slot->frame.size = slot->frame.size ? slot->frame.size * 2 : 8;
+        new_size = MPR_FRAME_BITMAP_SIZE(slot->frame.size);
+        slot->frame.ids = realloc(slot->frame.ids, slot->frame.size * sizeof(mpr_id));
+        slot->frame.released = realloc(slot->frame.released, new_size);
+        memset(slot->frame.released + old_size, 0, new_size - old_size);
+    }
+    if (!num)
+        memset(slot->frame.released, 0, MPR_FRAME_BITMAP_SIZE(slot->frame.size));
+    slot->frame.ids[num] = GID;
+
+    if (val) {
+        size = vlen * mpr_type_get_size(type);
+        if ((slot->frame.num_vals + 1) * size > slot->frame.vals_size) {
+            slot->frame.vals_size = (slot->frame.num_vals + 1) * size * 2;
+            slot->frame.vals = realloc(slot->frame.vals, slot->frame.vals_size);
+        }
+        memcpy(slot->frame.vals + slot->frame.num_vals * size,
+               mpr_value_get_value(val, idx, 0), size);
+        ++slot->frame.num_vals;
+    }
+    else
+        slot->frame.released[num / 8] |= 1 << (num % 8);
+    ++slot->frame.num;
+    return 1;
+}
+
 void mpr_local_slot_send_msg(mpr_local_slot slot, lo_message msg, mpr_time time, mpr_proto proto)
 {
+    const char *path = NULL;
     if (slot->link) {
         if (!msg) {
             if (slot->num_msg > 0 && !slot->sending) {
-                msg = slot->msg;
+                add_frame_to_msg(slot);
                 slot->sending = 1;
+                /* copy the encoded message straight into the outgoing datagram if possible */
+                if (mpr_link_add_osc(slot->link, slot->sig, slot->path, osc_get_types(slot),
+                                     slot->osc.data, slot->osc.len, time, proto, slot->priority))
+                    return;
+                msg = get_lo_msg(slot);
+                path = slot->path;
             }
             else
                 return;
         }
-        mpr_link_add_msg(slot->link, mpr_sig_get_path((mpr_sig)slot->sig), msg, time, proto);
+        mpr_link_add_msg(slot->link, slot->sig, path, msg, time, proto, slot->priority);
     }
 }
 
+void mpr_local_slot_forward_msg(mpr_local_slot slot, mpr_local_slot from, mpr_time time,
+                                mpr_proto proto)
+{
+    lo_message msg;
+    RETURN_UNLESS(slot->link && from->num_msg > 0);
+    add_frame_to_msg(from);
+    if (mpr_link_add_osc(slot->link, slot->sig, from->path, osc_get_types(from),
+                         from->osc.data, from->osc.len, time, proto, slot->priority))
+        return;
+    if ((msg = mpr_slot_get_msg(from)))
+        mpr_link_add_msg(slot->link, slot->sig, from->path, msg, time, proto, slot->priority);
+}
+
+int mpr_local_slot_send_mcast(mpr_local_slot slot, mpr_time time)
+{
+    lo_message msg;
+    /* group members substitute their own slot id, so only the compact form can be shared */
+    RETURN_ARG_UNLESS(slot->path, 0);
+    if (!(msg = mpr_slot_get_msg(slot)))
+        return 1;
+    return mpr_net_add_mcast_msg(mpr_graph_get_net(mpr_obj_get_graph((mpr_obj)slot->sig)),
+                                 slot->sig, mpr_map_get_use_inst((mpr_map)slot->map), msg, time);
+}
+
 int mpr_slot_compare_names(mpr_slot l, mpr_slot r)
 {
     mpr_sig lsig = l->sig;
@@ -472,12 +771,19 @@ void mpr_slot_clear_msg(mpr_local_slot slot)
     /* run if slot has msg or is uninitialized (num_msg == -1) */
     RETURN_UNLESS(slot->num_msg);
 
-    lo_message_clear(slot->msg);
+    osc_reset(slot);
+    slot->frame.num = slot->frame.num_vals = 0;
+    /* use the compact form if the destination device has told us its signal alias */
+    slot->path = (MPR_DIR_OUT == slot->dir) ? mpr_local_map_get_alias_path(slot->map) : NULL;
+    if (slot->path) {
+        /* compact messages always begin with the slot id */
+        osc_add_int32(slot, slot->id);
+    }
     /* destination slots have id: -1 */
-    if (MPR_DIR_OUT == slot->dir && slot->id >= 0) {
+    else if (MPR_DIR_OUT == slot->dir && slot->id >= 0) {
         /* add slot id to msg */
-        lo_message_add_string(slot->msg, "@sl");
-        lo_message_add_int32(slot->msg, slot->id);
+        osc_add_str(slot, "@sl");
+        osc_add_int32(slot, slot->id);
     }
     slot->num_msg = slot->sending = 0;
 }
@@ -485,27 +791,37 @@ void mpr_slot_clear_msg(mpr_local_slot slot)
 void mpr_slot_build_msg(mpr_local_slot slot, mpr_value val, unsigned int idx, mpr_id_map id_map)
 {
     int i;
-    lo_message msg = slot->msg;
 
     if (id_map) {
+        if (slot->path && add_to_frame(slot, val, idx, id_map->GID)) {
+            ++slot->num_msg;
+            return;
+        }
         /* add instance GID */
-        lo_message_add_string(msg, "@in");
-        lo_message_add_int64(msg, id_map->GID);
+        if (!slot->path)
+            osc_add_str(slot, "@in");
+        osc_add_int64(slot, id_map->GID);
     }
 
     if (val) {
-        mpr_value_add_to_msg(val, idx, msg);
+        int vlen = mpr_value_get_vlen(val), len;
+        osc_reserve(slot, vlen, vlen * mpr_type_get_size(mpr_value_get_type(val)));
+        slot->osc.num_types += mpr_value_add_to_osc(val, idx, slot->osc.types + slot->osc.num_types,
+                                                    slot->osc.data + slot->osc.len, &len);
+        slot->osc.len += len;
     }
     else {
         /* retrieve length from slot */
         int len = mpr_sig_get_len(slot->sig);
         for (i = 0; i < len; i++)
-            lo_message_add_nil(msg);
+            osc_add_nil(slot);
     }
     ++slot->num_msg;
 }
 
 lo_message mpr_slot_get_msg(mpr_local_slot slot)
 {
-    return (slot->num_msg > 0) ? slot->msg : NULL;
+    RETURN_ARG_UNLESS(slot->num_msg > 0, NULL);
+    add_frame_to_msg(slot);
+    return get_lo_msg(slot);
 }
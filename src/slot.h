@@ -14,6 +14,24 @@ typedef struct _mpr_local_slot *mpr_local_slot;
 #define MPR_SLOT_SIG_KNOWN  0x2 /* bitflag 0010 */
 #define MPR_SLOT_LINK_KNOWN 0x4 /* bitflag 0100 */
 
+/* Updates to many instances of a slot may be sent as a single packed frame: a blob argument
+ * following the compact message header, holding this header, the instance GIDs, a bitmap flagging
+ * released instances (padded to 8 bytes) and the vector values of the remaining instances packed
+ * back to back. Fields are in the byte order of the sender, which the receiver detects from the
+ * `order` field. */
+#define MPR_FRAME_ORDER 0x0102
+
+typedef struct _mpr_frame_hdr {
+    uint16_t order;                 /*!< Always `MPR_FRAME_ORDER` in sender byte order. */
+    uint8_t type;                   /*!< Value type. */
+    uint8_t reserved;
+    uint32_t vlen;                  /*!< Vector length. */
+    uint32_t num;                   /*!< Number of instances. */
+    uint32_t num_vals;              /*!< Number of instances that were not released. */
+} mpr_frame_hdr_t;
+
+#define MPR_FRAME_BITMAP_SIZE(NUM) ((((NUM) + 63) / 64) * 8)
+
 mpr_slot mpr_slot_new(mpr_map map, mpr_sig sig, mpr_dir dir, unsigned char is_local,
                       unsigned char is_src);
 
@@ -67,12 +85,32 @@ int mpr_local_slot_get_is_used(mpr_local_slot slot);
 
 void mpr_local_slot_set_is_used(mpr_local_slot slot, int is_used);
 
+/*! Set the priority class used for the messages sent by a slot.
+ *  \param slot         The slot to modify.
+ *  \param priority     1 for the high class, -1 for the low class, or 0 for the normal class. */
+void mpr_local_slot_set_priority(mpr_local_slot slot, int priority);
+
 mpr_value mpr_slot_get_value(mpr_local_slot slot);
 
 int mpr_slot_set_value(mpr_local_slot slot, unsigned int inst_idx, const void *value, mpr_time time);
 
 void mpr_local_slot_send_msg(mpr_local_slot slot, lo_message msg, mpr_time time, mpr_proto proto);
 
+/*! Send the message prepared by another slot of the same map over this slot's link.
+ *  \param slot         The slot whose link and signal should be used.
+ *  \param from         The slot that prepared the message.
+ *  \param time         The timetag for the message.
+ *  \param proto        The protocol to use. */
+void mpr_local_slot_forward_msg(mpr_local_slot slot, mpr_local_slot from, mpr_time time,
+                                mpr_proto proto);
+
+/*! Send the message prepared by a source slot to the multicast group of its signal.
+ *  \param slot         The source slot that prepared the message.
+ *  \param time         The timetag for the message.
+ *  \return             1 if the message was sent to the group or there was nothing to send,
+ *                      0 if it should be sent over the map link instead. */
+int mpr_local_slot_send_mcast(mpr_local_slot slot, mpr_time time);
+
 int mpr_slot_compare_names(mpr_slot l, mpr_slot r);
 
 void mpr_slot_set_map_ptr(mpr_slot slot, mpr_map map);
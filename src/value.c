@@ -25,9 +25,9 @@ typedef struct _mpr_value_buffer
 typedef struct _mpr_value
 {
     mpr_value_buffer inst;      /*!< Array of value histories for each signal instance. */
-    uint8_t vlen;               /*!< Vector length. */
-    uint8_t num_inst;           /*!< Number of instances. */
-    uint8_t num_active_inst;    /*!< Number of active instances. */
+    uint16_t vlen;              /*!< Vector length. */
+    uint16_t num_inst;          /*!< Number of instances. */
+    uint16_t num_active_inst;   /*!< Number of active instances. */
     mpr_type type;              /*!< The type of this signal. */
     uint16_t mlen;              /*!< History size of the buffer. */
 
@@ -516,6 +516,39 @@ void mpr_value_add_to_msg(mpr_value v, unsigned int inst_idx, lo_message msg)
     }
 }
 
+int mpr_value_add_to_osc(mpr_value v, unsigned int inst_idx, char *types, char *data, int *len)
+{
+    /* same encoding as mpr_value_add_to_msg() but written in place in network byte order */
+    mpr_value_buffer b = GET_BUFFER();
+    int i, size = mpr_type_get_size(v->type);
+    char *val;
+    *len = 0;
+    RETURN_ARG_UNLESS(b->pos >= 0, 0);
+    val = (char*)b->samps + b->pos * v->vlen * size;
+
+    for (i = 0; i < v->vlen; i++, val += size) {
+        if (!mpr_bitflags_get(b->known, i)) {
+            types[i] = 'N';
+            continue;
+        }
+        types[i] = v->type;
+        if (8 == size) {
+            uint64_t u;
+            memcpy(&u, val, 8);
+            u = lo_htoo64(u);
+            memcpy(data + *len, &u, 8);
+        }
+        else {
+            uint32_t u;
+            memcpy(&u, val, 4);
+            u = lo_htoo32(u);
+            memcpy(data + *len, &u, 4);
+        }
+        *len += size;
+    }
+    return v->vlen;
+}
+
 void mpr_value_link_to_tbl(mpr_value val, mpr_tbl tbl)
 {
     mpr_tbl_link_value(tbl, MPR_PROP_PERIOD, 1, MPR_FLT, &val->period, MPR_TBL_MOD_NONE | MPR_TBL_SET);
@@ -8,7 +8,8 @@
 #include "mpr_type.h"
 #include "bitflags.h"
 
-#define MPR_MAX_VECTOR_LEN 128
+/* vector lengths are stored as 16-bit integers, here and in the expression engine */
+#define MPR_MAX_VECTOR_LEN 65535
 
 /*! A structure that stores the current and historical values of a signal. The
  *  size of the history array is determined by the needs of mapping expressions.
@@ -87,6 +88,16 @@ int mpr_value_cmp(mpr_value v, unsigned int inst_idx, int hist_idx, const void *
 
 void mpr_value_add_to_msg(mpr_value val, unsigned int inst_idx, lo_message msg);
 
+/*! Encode the current value of an instance as OSC arguments without building an lo_message.
+ *  \param val          The value to encode.
+ *  \param inst_idx     The instance index.
+ *  \param types        Destination for the type tags, with room for the vector length.
+ *  \param data         Destination for the big-endian argument data, with room for the vector
+ *                      length times the type size.
+ *  \param len          Set to the number of data bytes written.
+ *  \return             The number of type tags written. */
+int mpr_value_add_to_osc(mpr_value val, unsigned int inst_idx, char *types, char *data, int *len);
+
 void mpr_value_link_to_tbl(mpr_value val, mpr_tbl tbl);
 
 #ifdef DEBUG
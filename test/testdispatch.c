@@ -0,0 +1,172 @@
+#include <mapper/mapper.h>
+#include <lo/lo.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Benchmark measuring the cost of registering signals and dispatching incoming updates as the
+ * number of signals belonging to a device grows. Updates are sent directly to the device data
+ * port using liblo, addressed to signals spread across the whole device. */
+
+#define NUM_UPDATES 2000
+#define BATCH_SIZE 50
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int num_counts = 4;
+int counts[] = {10, 100, 1000, 8000};
+
+int received = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value)
+        ++received;
+}
+
+/* Returns the number of updates lost, or -1 on error. */
+int run(const char *iface, int num_sigs, double *reg_ms, double *dispatch_us)
+{
+    int i, j, sent = 0, result = 0;
+    char name[32], port[16];
+    lo_address addr = 0;
+    mpr_dev dev;
+    mpr_time start, elapsed;
+
+    mpr_time_set(&start, MPR_NOW);
+    dev = mpr_dev_new("testdispatch", 0);
+    if (!dev)
+        return -1;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dev), iface);
+    for (i = 0; i < num_sigs; i++) {
+        snprintf(name, 32, "in%d", i);
+        if (!mpr_sig_new(dev, MPR_DIR_IN, name, 1, MPR_FLT, NULL, NULL, NULL, NULL,
+                         handler, MPR_SIG_UPDATE)) {
+            result = -1;
+            goto done;
+        }
+    }
+    while (!done && !mpr_dev_get_is_ready(dev))
+        mpr_dev_poll(dev, 10);
+    mpr_time_set(&elapsed, MPR_NOW);
+    mpr_time_sub(&elapsed, start);
+    *reg_ms = mpr_time_as_dbl(elapsed) * 1000.;
+
+    snprintf(port, 16, "%d", mpr_obj_get_prop_as_int32((mpr_obj)dev, MPR_PROP_PORT, NULL));
+    addr = lo_address_new(mpr_obj_get_prop_as_str((mpr_obj)dev, MPR_PROP_HOST, NULL), port);
+    if (!addr) {
+        result = -1;
+        goto done;
+    }
+
+    received = 0;
+    mpr_time_set(&start, MPR_NOW);
+    while (!done && sent < NUM_UPDATES) {
+        for (j = 0; j < BATCH_SIZE; j++, sent++) {
+            /* spread the updates over all of the signals */
+            snprintf(name, 32, "/in%d", (int)((sent * 7919L) % num_sigs));
+            lo_send(addr, name, "f", (float)sent);
+        }
+        for (j = 0; j < 100 && received < sent; j++)
+            mpr_dev_poll(dev, 0);
+    }
+    for (j = 0; j < 10 && received < sent; j++)
+        mpr_dev_poll(dev, 10);
+    mpr_time_set(&elapsed, MPR_NOW);
+    mpr_time_sub(&elapsed, start);
+    *dispatch_us = received ? mpr_time_as_dbl(elapsed) * 1000000. / received : 0;
+    result = sent - received;
+
+  done:
+    if (addr)
+        lo_address_free(addr);
+    mpr_dev_free(dev);
+    return result;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testdispatch.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        num_counts = 3;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    eprintf("%10s %18s %22s\n", "signals", "registration (ms)", "dispatch (us/update)");
+    for (i = 0; i < num_counts && !done; i++) {
+        double reg_ms = 0, dispatch_us = 0;
+        int lost = run(iface, counts[i], &reg_ms, &dispatch_us);
+        if (lost < 0) {
+            eprintf("Error initializing device with %d signals.\n", counts[i]);
+            result = 1;
+            break;
+        }
+        eprintf("%10d %18.2f %22.3f\n", counts[i], reg_ms, dispatch_us);
+        /* updates are sent over UDP, but on the local host nearly all should arrive */
+        if (lost > NUM_UPDATES / 10) {
+            eprintf("Lost %d of %d updates.\n", lost, NUM_UPDATES);
+            result = 1;
+        }
+    }
+
+    printf("\r..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
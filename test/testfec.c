@@ -0,0 +1,283 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Test of forward error correction for UDP maps. A multi-instance output is mapped to another
+ * device with the map property "fec" set, and every cycle starts a new instance and releases the
+ * previous one. On Linux the datagrams carrying signal updates are intercepted and some of them
+ * are dropped; every update and release should still arrive exactly once, recovered from the
+ * following datagram. The link is limited to UDP so that the test can run on a single host. */
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <sys/socket.h>
+#define DROP_DATAGRAMS
+#endif
+
+#define NUM_INST 8
+#define LOSS_INTERVAL 5
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 1000;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+int updated = 0;
+int released = 0;
+
+#ifdef DROP_DATAGRAMS
+int dropping = 0;
+unsigned long num_dgrams = 0;
+unsigned long num_dropped = 0;
+
+/* Drop every LOSS_INTERVAL-th datagram sent with forward error correction. */
+static int drop(const void *buf, size_t len)
+{
+    if (!dropping || !memmem(buf, len, "/@fec", 5))
+        return 0;
+    if (++num_dgrams % LOSS_INTERVAL)
+        return 0;
+    ++num_dropped;
+    return 1;
+}
+
+/* Wrappers for the socket calls used to send datagrams: these override the libc symbols for
+ * libmapper and liblo. */
+ssize_t sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *addr,
+               socklen_t addr_len)
+{
+    static ssize_t (*func)(int, const void*, size_t, int, const struct sockaddr*, socklen_t) = 0;
+    if (!func)
+        *(void**)(&func) = dlsym(RTLD_NEXT, "sendto");
+    if (drop(buf, len))
+        return len;
+    return func(fd, buf, len, flags, addr, addr_len);
+}
+
+int sendmmsg(int fd, struct mmsghdr *msgs, unsigned int len, int flags)
+{
+    static int (*func)(int, struct mmsghdr*, unsigned int, int) = 0;
+    struct mmsghdr *kept;
+    unsigned int i, num = 0;
+    int ret;
+    if (!func)
+        *(void**)(&func) = dlsym(RTLD_NEXT, "sendmmsg");
+    if (!(kept = malloc(len * sizeof(struct mmsghdr))))
+        return func(fd, msgs, len, flags);
+    for (i = 0; i < len; i++) {
+        struct iovec *iov = msgs[i].msg_hdr.msg_iov;
+        if (msgs[i].msg_hdr.msg_iovlen && drop(iov[0].iov_base, iov[0].iov_len))
+            continue;
+        kept[num++] = msgs[i];
+    }
+    ret = num ? func(fd, kept, num, flags) : 0;
+    free(kept);
+    /* report the dropped datagrams as sent */
+    return ret < 0 ? ret : (int)len;
+}
+#endif /* DROP_DATAGRAMS */
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (event & MPR_SIG_UPDATE) {
+        ++updated;
+        return;
+    }
+    if (event & MPR_SIG_REL_UPSTRM) {
+        ++released;
+        mpr_sig_release_inst(sig, inst);
+    }
+}
+
+int setup_devs(const char *iface)
+{
+    int num_inst = NUM_INST;
+    src = mpr_dev_new("testfec-send", 0);
+    dst = mpr_dev_new("testfec-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    /* must be set before the link is established */
+    mpr_obj_set_prop((mpr_obj)src, MPR_PROP_EXTRA, "local_transport", 1, MPR_STR, "udp", 0);
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                          NULL, NULL, &num_inst, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_INT32, NULL,
+                          NULL, NULL, &num_inst, handler,
+                          MPR_SIG_UPDATE | MPR_SIG_REL_UPSTRM);
+    return !sendsig || !recvsig;
+}
+
+void cleanup_devs(void)
+{
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+int map_sigs(void)
+{
+    int fec = 1;
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXTRA, "fec", 1, MPR_INT32, &fec, 1);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    eprintf("Map established.\n");
+    return done;
+}
+
+void loop(void)
+{
+    int i;
+
+#ifdef DROP_DATAGRAMS
+    dropping = 1;
+#endif
+    for (i = 0; i < iterations && !done; i++) {
+        mpr_sig_set_value(sendsig, i, 1, MPR_INT32, &i);
+        if (i)
+            mpr_sig_release_inst(sendsig, i - 1);
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 1);
+    }
+    mpr_sig_release_inst(sendsig, i - 1);
+    mpr_dev_poll(src, 0);
+#ifdef DROP_DATAGRAMS
+    dropping = 0;
+#endif
+    /* send one more bundle so that the last release can be recovered too */
+    mpr_sig_set_value(sendsig, i, 1, MPR_INT32, &i);
+    mpr_dev_poll(src, 0);
+    for (i = 0; i < 10; i++) {
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 10);
+    }
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0, recovered;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testfec.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 100;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+    if (wait_ready()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+    if (map_sigs()) {
+        eprintf("Map initialization aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    recovered = mpr_obj_get_prop_as_int32((mpr_obj)dst, MPR_PROP_EXTRA, "fec_recovered");
+#ifdef DROP_DATAGRAMS
+    eprintf("Dropped %lu of %lu datagrams, recovered %d bundles.\n", num_dropped, num_dgrams,
+            recovered);
+    if (num_dropped && !recovered)
+        result = 1;
+#endif
+    /* the instance started after the loop is not released */
+    eprintf("Received %d updates and %d releases of %d.\n", updated, released, iterations);
+    if (updated != iterations + 1 || released != iterations) {
+        eprintf("Expected every update and release exactly once.\n");
+        result = 1;
+    }
+
+  done:
+    cleanup_devs();
+    printf("\r..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
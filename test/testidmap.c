@@ -0,0 +1,156 @@
+#include "../src/device.h"
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Microbenchmark of instance id map lookups on a local device. For a growing number of active
+ * id maps the average cost of looking up an id map by local and global id is measured; since the
+ * id maps are indexed by hash tables the cost should not grow with the number of instances. */
+
+#define MAX_ACTIVE 100000
+#define NUM_LOOKUPS 1000000
+/* generous since larger tables miss the cache more often; a linear search would be ~10^4 times
+ * slower at the largest size */
+#define MAX_RATIO 50.0
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int num_lookups = NUM_LOOKUPS;
+
+mpr_dev dev = 0;
+mpr_id_map *id_maps = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static mpr_id make_GID(int i)
+{
+    /* spread the global ids over the upper bits like those generated by devices */
+    return ((mpr_id)(i + 1) * 0x9E3779B97F4A7C15ULL) | 1;
+}
+
+/* Returns the average time per lookup in nanoseconds, or a negative value on error. */
+double bench(int num_active)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    mpr_time start, end;
+    double elapsed;
+    int i, errors = 0;
+
+    for (i = 0; i < num_active; i++)
+        id_maps[i] = mpr_dev_add_id_map(ldev, 0, i, make_GID(i), 0);
+
+    mpr_time_set(&start, MPR_NOW);
+    for (i = 0; i < num_lookups; i++) {
+        int idx = (int)(((unsigned)i * 2654435761u) % num_active);
+        if (mpr_dev_get_id_map_by_LID(ldev, 0, idx) != id_maps[idx])
+            ++errors;
+        if (mpr_dev_get_id_map_by_GID(ldev, 0, make_GID(idx)) != id_maps[idx])
+            ++errors;
+    }
+    mpr_time_set(&end, MPR_NOW);
+    elapsed = mpr_time_get_diff(end, start);
+
+    /* lookups of ids that are not active should fail */
+    if (mpr_dev_get_id_map_by_LID(ldev, 0, num_active))
+        ++errors;
+
+    for (i = 0; i < num_active; i++)
+        mpr_dev_remove_id_map(ldev, 0, id_maps[i]);
+    if (mpr_local_dev_get_num_id_maps(ldev, 1))
+        ++errors;
+
+    if (errors) {
+        eprintf("  %d lookup errors with %d active id maps\n", errors, num_active);
+        return -1;
+    }
+    return elapsed * 1e9 / (num_lookups * 2);
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0, num_active;
+    double ns, first = 0, worst = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testidmap.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        num_lookups = NUM_LOOKUPS / 10;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    dev = mpr_dev_new("testidmap", 0);
+    id_maps = (mpr_id_map*)malloc(MAX_ACTIVE * sizeof(mpr_id_map));
+    if (!dev || !id_maps) {
+        eprintf("Error initializing device.\n");
+        result = 1;
+        goto done;
+    }
+
+    for (num_active = 10; num_active <= MAX_ACTIVE && !done; num_active *= 10) {
+        if ((ns = bench(num_active)) < 0) {
+            result = 1;
+            goto done;
+        }
+        eprintf("%6d active id maps: %6.1f ns/lookup\n", num_active, ns);
+        if (!first)
+            first = ns;
+        if (ns > worst)
+            worst = ns;
+    }
+
+    if (first > 0 && worst / first > MAX_RATIO) {
+        eprintf("Lookup cost grew by a factor of %.1f (limit %.1f).\n", worst / first, MAX_RATIO);
+        result = 1;
+    }
+
+  done:
+    if (dev)
+        mpr_dev_free(dev);
+    if (id_maps)
+        free(id_maps);
+    printf("\r..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
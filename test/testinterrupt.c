@@ -10,6 +10,14 @@
 #endif
 #include <signal.h>
 #include <string.h>
+#include <pthread.h>
+
+/* Besides the alarm interrupt, several producer threads update their own output signals without
+ * any locking while the source device is being polled. Their updates are queued for the polling
+ * thread. Their maps use TCP, so the latest value from every thread must arrive and the values
+ * received for each signal must never decrease. */
+
+#define NUM_PRODUCERS 4
 
 int verbose = 1;
 int terminate = 0;
@@ -17,6 +25,7 @@ int autoconnect = 1;
 int shared_graph = 0;
 int done = 0;
 int period = 100;
+int producers = NUM_PRODUCERS;
 
 mpr_dev src = 0;
 mpr_dev dst = 0;
@@ -28,6 +37,14 @@ int received = 0;
 
 float expected;
 
+mpr_sig prod_sendsigs[NUM_PRODUCERS];
+mpr_sig prod_recvsigs[NUM_PRODUCERS];
+int prod_sent[NUM_PRODUCERS];
+int prod_received[NUM_PRODUCERS];
+int prod_last[NUM_PRODUCERS];
+int prod_errors = 0;
+volatile int prod_stop = 0;
+
 /* This flag controls termination of the main loop. */
 volatile sig_atomic_t keep_going = 1;
 
@@ -43,7 +60,7 @@ static void eprintf(const char *format, ...)
 
 int setup_src(mpr_graph g, const char *iface)
 {
-    int mn=0, mx=1;
+    int i, mn=0, mx=1;
     mpr_list l;
 
     src = mpr_dev_new("testinterrupt-send", g);
@@ -55,6 +72,12 @@ int setup_src(mpr_graph g, const char *iface)
             mpr_graph_get_interface(mpr_obj_get_graph(src)));
 
     sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL, &mn, &mx, NULL, NULL, 0);
+    for (i = 0; i < producers; i++) {
+        char name[32];
+        snprintf(name, 32, "producer/%d", i);
+        prod_sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, 1, MPR_INT32, NULL,
+                                       NULL, NULL, NULL, NULL, 0);
+    }
 
     eprintf("Output signal 'outsig' registered.\n");
     l = mpr_dev_get_sigs(src, MPR_DIR_OUT);
@@ -88,8 +111,27 @@ void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
     }
 }
 
+void prod_handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+                  mpr_type type, const void *value, mpr_time t)
+{
+    int i;
+    if (!value)
+        return;
+    for (i = 0; i < producers; i++) {
+        if (sig != prod_recvsigs[i])
+            continue;
+        if (*(int*)value < prod_last[i]) {
+            eprintf("producer %d: got %d after %d\n", i, *(int*)value, prod_last[i]);
+            ++prod_errors;
+        }
+        prod_last[i] = *(int*)value;
+        ++prod_received[i];
+    }
+}
+
 int setup_dst(mpr_graph g, const char *iface)
 {
+    int i;
     float mn=0, mx=1;
     mpr_list l;
 
@@ -103,6 +145,13 @@ int setup_dst(mpr_graph g, const char *iface)
 
     recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_FLT, NULL,
                           &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+    for (i = 0; i < producers; i++) {
+        char name[32];
+        snprintf(name, 32, "producer/%d", i);
+        prod_recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_INT32, NULL,
+                                       NULL, NULL, NULL, prod_handler, MPR_SIG_UPDATE);
+        prod_last[i] = -1;
+    }
 
     eprintf("Input signal 'insig' registered.\n");
     l = mpr_dev_get_sigs(dst, MPR_DIR_IN);
@@ -126,17 +175,28 @@ void cleanup_dst(void)
 
 int setup_maps(void)
 {
+    int i, ready = 0, proto = MPR_PROTO_TCP;
     mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_map prod_maps[NUM_PRODUCERS];
 
     char expr[128];
     snprintf(expr, 128, "y=x");
     mpr_obj_set_prop(map, MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
     mpr_obj_push(map);
 
+    for (i = 0; i < producers; i++) {
+        prod_maps[i] = mpr_map_new(1, &prod_sendsigs[i], 1, &prod_recvsigs[i]);
+        mpr_obj_set_prop(prod_maps[i], MPR_PROP_PROTOCOL, NULL, 1, MPR_INT32, &proto, 1);
+        mpr_obj_push(prod_maps[i]);
+    }
+
     /* Wait until mapping has been established */
-    while (!done && !mpr_map_get_is_ready(map)) {
+    while (!done && !ready) {
         mpr_dev_poll(src, 10);
         mpr_dev_poll(dst, 10);
+        ready = mpr_map_get_is_ready(map);
+        for (i = 0; i < producers; i++)
+            ready &= mpr_map_get_is_ready(prod_maps[i]);
     }
 
     eprintf("map initialized with expression '%s'\n",
@@ -187,11 +247,40 @@ void interrupt (int sig)
     interrupt_running = 0;
 }
 
+/* Each producer thread updates its own signal as fast as it can, yielding between updates. */
+void *producer(void *arg)
+{
+    int idx = (int)(long)arg;
+    while (!prod_stop && !done) {
+        ++prod_sent[idx];
+        mpr_sig_set_value(prod_sendsigs[idx], 0, 1, MPR_INT32, &prod_sent[idx]);
+        usleep(period * 10);
+    }
+    return 0;
+}
+
 void loop (void)
 {
+    int i;
+    sigset_t mask;
+    pthread_t threads[NUM_PRODUCERS];
+
     if (!shared_graph)
         mpr_dev_start_polling(dst, 100);
 
+    /* only the main thread should handle the alarm */
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    for (i = 0; i < producers; i++) {
+        if (pthread_create(&threads[i], 0, producer, (void*)(long)i)) {
+            perror("error: pthread_create");
+            producers = i;
+            break;
+        }
+    }
+    pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+
     while (keep_going) {
         mpr_dev_poll(src, 100);
 
@@ -201,6 +290,14 @@ void loop (void)
         }
     }
 
+    prod_stop = 1;
+    for (i = 0; i < producers; i++)
+        pthread_join(threads[i], NULL);
+
+    /* let the latest producer updates arrive */
+    for (i = 0; i < 10; i++)
+        mpr_dev_poll(src, period);
+
     if (!shared_graph)
         mpr_dev_stop_polling(dst);
 
@@ -308,6 +405,18 @@ int main (int argc, char **argv)
                 sent, sent == 1 ? "" : "s", received);
         result = 1;
     }
+    for (i = 0; autoconnect && i < producers; i++) {
+        eprintf("Producer %d sent %d updates, received %d ending with %d.\n", i, prod_sent[i],
+                prod_received[i], prod_last[i]);
+        if (prod_last[i] != prod_sent[i]) {
+            eprintf("Latest update from producer %d was not received.\n", i);
+            result = 1;
+        }
+    }
+    if (prod_errors) {
+        eprintf("Received %d producer updates out of order.\n", prod_errors);
+        result = 1;
+    }
 
   done:
     cleanup_dst();
@@ -0,0 +1,269 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Test of signals with long vectors. A float output with thousands of elements is mapped over UDP
+ * to an input of the same length and to a scalar input using the expression "y=x.mean()". Each
+ * update is much larger than the MTU, so it is sent in chunks that must be reassembled by the
+ * receiving device. The link is limited to UDP so that the test can run on a single host. */
+
+#define MAX_VECTOR_LEN 65535
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 10;
+int vec_len = 16384;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+mpr_sig meansig = 0;
+
+float *vals = 0;
+int received = 0;
+int received_mean = 0;
+int num_errors = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (!value)
+        return;
+    if (length != vec_len || memcmp(value, vals, vec_len * sizeof(float))) {
+        eprintf("Received wrong value.\n");
+        ++num_errors;
+    }
+    ++received;
+}
+
+void mean_handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+                  mpr_type type, const void *value, mpr_time t)
+{
+    if (!value)
+        return;
+    /* the elements cycle through 0..7 so the mean is always 3.5 */
+    if (*(float*)value != 3.5f) {
+        eprintf("Received mean %g, expected 3.5.\n", *(float*)value);
+        ++num_errors;
+    }
+    ++received_mean;
+}
+
+/* Vectors may be up to MAX_VECTOR_LEN elements long. */
+int check_max_len(void)
+{
+    int i, result = 0;
+    int *ivals = malloc(MAX_VECTOR_LEN * sizeof(int));
+    const int *val;
+    mpr_sig sig = mpr_sig_new(src, MPR_DIR_OUT, "maxsig", MAX_VECTOR_LEN, MPR_INT32, NULL,
+                              NULL, NULL, NULL, NULL, 0);
+    if (!sig || !ivals) {
+        eprintf("Error creating signal with %d elements.\n", MAX_VECTOR_LEN);
+        if (ivals)
+            free(ivals);
+        return 1;
+    }
+    for (i = 0; i < MAX_VECTOR_LEN; i++)
+        ivals[i] = i;
+    mpr_sig_set_value(sig, 0, MAX_VECTOR_LEN, MPR_INT32, ivals);
+    val = (const int*)mpr_sig_get_value(sig, 0, 0);
+    if (!val || memcmp(val, ivals, MAX_VECTOR_LEN * sizeof(int))) {
+        eprintf("Error retrieving value with %d elements.\n", MAX_VECTOR_LEN);
+        result = 1;
+    }
+    mpr_sig_free(sig);
+    free(ivals);
+
+    if (mpr_sig_new(src, MPR_DIR_OUT, "toolong", MAX_VECTOR_LEN + 1, MPR_INT32, NULL,
+                    NULL, NULL, NULL, NULL, 0)) {
+        eprintf("Signal with %d elements should not be allowed.\n", MAX_VECTOR_LEN + 1);
+        result = 1;
+    }
+    return result;
+}
+
+int setup_devs(const char *iface)
+{
+    src = mpr_dev_new("testlargevec-send", 0);
+    dst = mpr_dev_new("testlargevec-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    /* must be set before the link is established */
+    mpr_obj_set_prop((mpr_obj)src, MPR_PROP_EXTRA, "local_transport", 1, MPR_STR, "udp", 0);
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", vec_len, MPR_FLT, NULL,
+                          NULL, NULL, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", vec_len, MPR_FLT, NULL,
+                          NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    meansig = mpr_sig_new(dst, MPR_DIR_IN, "meansig", 1, MPR_FLT, NULL,
+                          NULL, NULL, NULL, mean_handler, MPR_SIG_UPDATE);
+    return !sendsig || !recvsig || !meansig;
+}
+
+void cleanup_devs(void)
+{
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+int map_sigs(void)
+{
+    const char *expr = "y=x.mean()";
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_map mean_map = mpr_map_new(1, &sendsig, 1, &meansig);
+    mpr_obj_push((mpr_obj)map);
+    mpr_obj_set_prop((mpr_obj)mean_map, MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
+    mpr_obj_push((mpr_obj)mean_map);
+    while (!done && !(mpr_map_get_is_ready(map) && mpr_map_get_is_ready(mean_map))) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    eprintf("Maps established.\n");
+    return done;
+}
+
+void loop(void)
+{
+    int i, j;
+    for (i = 0; i < iterations && !done; i++) {
+        for (j = 0; j < vec_len; j++)
+            vals[j] = (float)((i + j) % 8);
+        mpr_sig_set_value(sendsig, 0, vec_len, MPR_FLT, vals);
+        mpr_dev_poll(src, 0);
+        for (j = 0; j < 100 && (received <= i || received_mean <= i) && !done; j++) {
+            mpr_dev_poll(src, 0);
+            mpr_dev_poll(dst, 10);
+        }
+        if (verbose) {
+            printf("\r  Iteration: %d, received: %d", i, received);
+            fflush(stdout);
+        }
+    }
+    eprintf("\n");
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0, chunked;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testlargevec.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 3;
+                        vec_len = 4096;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    vals = malloc(vec_len * sizeof(float));
+    if (!vals || setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+    if (check_max_len()) {
+        result = 1;
+        goto done;
+    }
+    if (wait_ready()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+    if (map_sigs()) {
+        eprintf("Map initialization aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    chunked = mpr_obj_get_prop_as_int32((mpr_obj)src, MPR_PROP_EXTRA, "chunked");
+    eprintf("Received %d of %d vectors of length %d and %d means with %d errors, sent %d "
+            "chunked datagrams.\n", received, iterations, vec_len, received_mean, num_errors,
+            chunked);
+    if (received != iterations || received_mean != iterations || num_errors) {
+        eprintf("Expected every update exactly once.\n");
+        result = 1;
+    }
+    else if (chunked <= 0) {
+        eprintf("Expected updates to be sent in chunks.\n");
+        result = 1;
+    }
+
+  done:
+    cleanup_devs();
+    if (vals)
+        free(vals);
+    printf("\r..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,234 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Test of signals with many instances. A signal is given the maximum number of instances, and a
+ * multi-instance output with several thousand instances is mapped to an input with the same
+ * number. Every instance of the output is updated once, and each update should activate its own
+ * instance of the input. */
+
+#define MAX_INST 65535
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int num_inst = 4096;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+char *received = 0;
+int num_received = 0;
+int num_errors = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int val;
+    if (!value)
+        return;
+    val = *(int*)value;
+    if (val < 0 || val >= num_inst || received[val])
+        ++num_errors;
+    else {
+        received[val] = 1;
+        ++num_received;
+    }
+}
+
+/* Reserve the maximum number of instances on an unmapped signal. */
+int check_max_inst(void)
+{
+    int count, result = 0;
+    mpr_id id;
+    mpr_sig sig = mpr_sig_new(src, MPR_DIR_OUT, "maxsig", 1, MPR_INT32, NULL,
+                              NULL, NULL, NULL, NULL, 0);
+    count = mpr_sig_reserve_inst(sig, MAX_INST + 1, 0, 0);
+    eprintf("Reserved %d instances.\n", count);
+    if (count != MAX_INST || mpr_sig_get_num_inst(sig, MPR_STATUS_ANY) != MAX_INST) {
+        eprintf("Expected %d instances.\n", MAX_INST);
+        result = 1;
+    }
+    /* activate and look up instances across the whole range */
+    for (id = 0; id < MAX_INST && !result; id += 257) {
+        int val = (int)id;
+        mpr_sig_set_value(sig, id, 1, MPR_INT32, &val);
+        if (!mpr_sig_get_value(sig, id, 0) || *(int*)mpr_sig_get_value(sig, id, 0) != val) {
+            eprintf("Error retrieving value of instance %d.\n", (int)id);
+            result = 1;
+        }
+    }
+    mpr_sig_free(sig);
+    return result;
+}
+
+int setup_devs(const char *iface)
+{
+    src = mpr_dev_new("testmanyinst-send", 0);
+    dst = mpr_dev_new("testmanyinst-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                          NULL, NULL, &num_inst, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_INT32, NULL,
+                          NULL, NULL, &num_inst, handler, MPR_SIG_UPDATE);
+    return !sendsig || !recvsig;
+}
+
+void cleanup_devs(void)
+{
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+int map_sigs(void)
+{
+    int proto = MPR_PROTO_TCP;
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    /* use TCP so that no updates are lost */
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_PROTOCOL, NULL, 1, MPR_INT32, &proto, 1);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    eprintf("Map established.\n");
+    return done;
+}
+
+void loop(void)
+{
+    int i;
+    for (i = 0; i < num_inst && !done; i++) {
+        mpr_sig_set_value(sendsig, i, 1, MPR_INT32, &i);
+        if (i % 64 == 63) {
+            mpr_dev_poll(src, 0);
+            mpr_dev_poll(dst, 0);
+        }
+    }
+    /* collect any updates still in flight */
+    for (i = 0; i < 100 && num_received + num_errors < num_inst && !done; i++) {
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 10);
+    }
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0, active;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testmanyinst.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        num_inst = 1024;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    received = calloc(1, num_inst);
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+    if (check_max_inst()) {
+        result = 1;
+        goto done;
+    }
+    if (wait_ready()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+    if (map_sigs()) {
+        eprintf("Map initialization aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    active = mpr_sig_get_num_inst(recvsig, MPR_STATUS_ACTIVE);
+    eprintf("Received %d of %d updates with %d errors, %d active instances.\n", num_received,
+            num_inst, num_errors, active);
+    if (num_received != num_inst || num_errors || active != num_inst) {
+        eprintf("Expected one update for each instance.\n");
+        result = 1;
+    }
+
+  done:
+    cleanup_devs();
+    free(received);
+    printf("\r..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
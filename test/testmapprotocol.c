@@ -136,7 +136,8 @@ int set_map_protocol(mpr_proto proto)
         return 0;
     }
     else
-        eprintf("setting map protocol to %s...\n", MPR_PROTO_UDP == proto ? "UDP" : "TCP");
+        eprintf("setting map protocol to %s...\n", MPR_PROTO_UDP == proto ? "UDP"
+                : MPR_PROTO_TCP == proto ? "TCP" : "RUDP");
 
     if (!map)
         return 1;
@@ -304,6 +305,14 @@ int main(int argc, char **argv)
         }
         eprintf("SENDING TCP\n");
         loop();
+
+        if (set_map_protocol(MPR_PROTO_RUDP)) {
+            eprintf("Error setting map protocol. (3)\n");
+            result = 1;
+            goto done;
+        }
+        eprintf("SENDING RUDP\n");
+        loop();
     } while (!terminate && !done);
 
     if (sent != received) {
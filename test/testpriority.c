@@ -0,0 +1,221 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Test of map priority classes. A source device has a control output mapped to the destination
+ * with the property "priority" set to "high", and a bulk output mapped with "low". Both outputs
+ * are updated on every cycle, and the number of messages sent in each class is read back from
+ * the statistics of the source device. The link is limited to UDP so that the marked sockets
+ * are used even though the devices are on the same host. */
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 1000;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig ctl_out = 0;
+mpr_sig bulk_out = 0;
+mpr_sig ctl_in = 0;
+mpr_sig bulk_in = 0;
+
+int ctl_received = 0;
+int bulk_received = 0;
+int ctl_last = -1;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (!value)
+        return;
+    if (sig == ctl_in) {
+        ++ctl_received;
+        ctl_last = *(int*)value;
+    }
+    else
+        ++bulk_received;
+}
+
+int setup_devs(const char *iface)
+{
+    src = mpr_dev_new("testpriority-send", 0);
+    dst = mpr_dev_new("testpriority-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    /* must be set before the link is established */
+    mpr_obj_set_prop((mpr_obj)src, MPR_PROP_EXTRA, "local_transport", 1, MPR_STR, "udp", 0);
+
+    ctl_out = mpr_sig_new(src, MPR_DIR_OUT, "control", 1, MPR_INT32, NULL,
+                          NULL, NULL, NULL, NULL, 0);
+    bulk_out = mpr_sig_new(src, MPR_DIR_OUT, "bulk", 64, MPR_FLT, NULL,
+                           NULL, NULL, NULL, NULL, 0);
+    ctl_in = mpr_sig_new(dst, MPR_DIR_IN, "control", 1, MPR_INT32, NULL,
+                         NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    bulk_in = mpr_sig_new(dst, MPR_DIR_IN, "bulk", 64, MPR_FLT, NULL,
+                          NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    return !ctl_out || !bulk_out || !ctl_in || !bulk_in;
+}
+
+void cleanup_devs(void)
+{
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+int map_sigs(void)
+{
+    mpr_map ctl_map = mpr_map_new(1, &ctl_out, 1, &ctl_in);
+    mpr_map bulk_map = mpr_map_new(1, &bulk_out, 1, &bulk_in);
+    mpr_obj_set_prop((mpr_obj)ctl_map, MPR_PROP_EXTRA, "priority", 1, MPR_STR, "high", 1);
+    mpr_obj_set_prop((mpr_obj)bulk_map, MPR_PROP_EXTRA, "priority", 1, MPR_STR, "low", 1);
+    mpr_obj_push((mpr_obj)ctl_map);
+    mpr_obj_push((mpr_obj)bulk_map);
+    while (!done && !(mpr_map_get_is_ready(ctl_map) && mpr_map_get_is_ready(bulk_map))) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    eprintf("Maps established.\n");
+    return done;
+}
+
+void loop(void)
+{
+    int i;
+    float bulk[64];
+    memset(bulk, 0, sizeof(bulk));
+
+    for (i = 0; i < iterations && !done; i++) {
+        bulk[0] = i;
+        mpr_sig_set_value(bulk_out, 0, 64, MPR_FLT, bulk);
+        mpr_sig_set_value(ctl_out, 0, 1, MPR_INT32, &i);
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 0);
+    }
+    /* collect any updates still in flight */
+    for (i = 0; i < 10 && (ctl_received < iterations || bulk_received < iterations); i++) {
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 10);
+    }
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0, high, normal, low;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testpriority.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 100;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+    if (wait_ready()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+    if (map_sigs()) {
+        eprintf("Map initialization aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    high = mpr_obj_get_prop_as_int32((mpr_obj)src, MPR_PROP_EXTRA, "priority_high_msgs");
+    normal = mpr_obj_get_prop_as_int32((mpr_obj)src, MPR_PROP_EXTRA, "priority_normal_msgs");
+    low = mpr_obj_get_prop_as_int32((mpr_obj)src, MPR_PROP_EXTRA, "priority_low_msgs");
+    eprintf("Sent %d high, %d normal and %d low priority messages.\n", high, normal, low);
+    eprintf("Received %d control and %d bulk updates of %d.\n", ctl_received, bulk_received,
+            iterations);
+
+    if (high != iterations || low != iterations || normal) {
+        eprintf("Expected %d messages in the high and low classes only.\n", iterations);
+        result = 1;
+    }
+    /* updates may be lost over UDP, but the latest control value should make it through */
+    if (ctl_last != iterations - 1 || ctl_received < iterations * 0.9
+        || bulk_received < iterations * 0.9) {
+        eprintf("Missing updates.\n");
+        result = 1;
+    }
+
+  done:
+    cleanup_devs();
+    printf("\r..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
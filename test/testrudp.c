@@ -0,0 +1,280 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Test of retransmission for reliable UDP maps. An output is mapped to another device with the
+ * map protocol set to MPR_PROTO_RUDP. On Linux every other bundle carrying a signal update is
+ * intercepted and dropped, and nothing else is sent until it arrives: since no later bundle
+ * reveals the gap, the sender has to announce the lost bundle when its retransmit timeout
+ * expires. Every dropped update should arrive well before the next clock sync message. The link
+ * is limited to UDP so that the test can run on a single host. */
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <sys/socket.h>
+#define DROP_DATAGRAMS
+#endif
+
+/* generous bound on the retransmit timeout plus a round trip on the loopback interface */
+#define MAX_DELAY_SEC 0.5
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 20;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+int received = -1;
+
+#ifdef DROP_DATAGRAMS
+int drop_next = 0;
+unsigned long num_dropped = 0;
+
+/* Drop the next datagram carrying a sequenced reliable UDP bundle. Retransmissions are tagged
+ * with "/@rtx" instead and are never dropped. */
+static int drop(const void *buf, size_t len)
+{
+    if (!drop_next || !memmem(buf, len, "/@seq", 5))
+        return 0;
+    drop_next = 0;
+    ++num_dropped;
+    return 1;
+}
+
+/* Wrappers for the socket calls used to send datagrams: these override the libc symbols for
+ * libmapper and liblo. */
+ssize_t sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *addr,
+               socklen_t addr_len)
+{
+    static ssize_t (*func)(int, const void*, size_t, int, const struct sockaddr*, socklen_t) = 0;
+    if (!func)
+        *(void**)(&func) = dlsym(RTLD_NEXT, "sendto");
+    if (drop(buf, len))
+        return len;
+    return func(fd, buf, len, flags, addr, addr_len);
+}
+
+int sendmmsg(int fd, struct mmsghdr *msgs, unsigned int len, int flags)
+{
+    static int (*func)(int, struct mmsghdr*, unsigned int, int) = 0;
+    struct mmsghdr *kept;
+    unsigned int i, num = 0;
+    int ret;
+    if (!func)
+        *(void**)(&func) = dlsym(RTLD_NEXT, "sendmmsg");
+    if (!(kept = malloc(len * sizeof(struct mmsghdr))))
+        return func(fd, msgs, len, flags);
+    for (i = 0; i < len; i++) {
+        struct iovec *iov = msgs[i].msg_hdr.msg_iov;
+        if (msgs[i].msg_hdr.msg_iovlen && drop(iov[0].iov_base, iov[0].iov_len))
+            continue;
+        kept[num++] = msgs[i];
+    }
+    ret = num ? func(fd, kept, num, flags) : 0;
+    free(kept);
+    /* report the dropped datagrams as sent */
+    return ret < 0 ? ret : (int)len;
+}
+#endif /* DROP_DATAGRAMS */
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value)
+        received = *(int*)value;
+}
+
+int setup_devs(const char *iface)
+{
+    src = mpr_dev_new("testrudp-send", 0);
+    dst = mpr_dev_new("testrudp-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    /* must be set before the link is established */
+    mpr_obj_set_prop((mpr_obj)src, MPR_PROP_EXTRA, "local_transport", 1, MPR_STR, "udp", 0);
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                          NULL, NULL, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_INT32, NULL,
+                          NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    return !sendsig || !recvsig;
+}
+
+void cleanup_devs(void)
+{
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+int map_sigs(void)
+{
+    int proto = MPR_PROTO_RUDP;
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_PROTOCOL, NULL, 1, MPR_INT32, &proto, 1);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    eprintf("Map established.\n");
+    return done;
+}
+
+/* Update the output and wait for the value to arrive. Returns the delay in seconds, or a negative
+ * number if it did not arrive within MAX_DELAY_SEC. */
+double send_and_wait(int value)
+{
+    mpr_time start, now;
+    double elapsed = 0;
+    mpr_time_set(&start, MPR_NOW);
+    mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &value);
+    mpr_dev_poll(src, 0);
+    while (!done && received != value && elapsed <= MAX_DELAY_SEC) {
+        mpr_dev_poll(dst, 1);
+        mpr_dev_poll(src, 0);
+        mpr_time_set(&now, MPR_NOW);
+        mpr_time_sub(&now, start);
+        elapsed = mpr_time_as_dbl(now);
+    }
+    return received == value ? elapsed : -1;
+}
+
+int loop(void)
+{
+    int i;
+    double delay, max_delay = 0;
+
+    for (i = 0; i < iterations && !done; i++) {
+        /* a bundle must arrive first so that the receiver knows where the sequence starts */
+        if (send_and_wait(i * 2) < 0) {
+            eprintf("Update %d was not received.\n", i * 2);
+            return 1;
+        }
+#ifdef DROP_DATAGRAMS
+        drop_next = 1;
+#endif
+        if ((delay = send_and_wait(i * 2 + 1)) < 0) {
+            eprintf("Dropped update %d was not recovered within %g seconds.\n", i * 2 + 1,
+                    MAX_DELAY_SEC);
+            return 1;
+        }
+        if (delay > max_delay)
+            max_delay = delay;
+    }
+#ifdef DROP_DATAGRAMS
+    drop_next = 0;
+    eprintf("Dropped %lu datagrams, recovered each within %g seconds.\n", num_dropped, max_delay);
+#endif
+    return done;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testrudp.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 5;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+    if (wait_ready()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+    if (map_sigs()) {
+        eprintf("Map initialization aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = loop();
+
+  done:
+    cleanup_devs();
+    printf("\r..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,252 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Test of batch instance updates. A multi-instance output is mapped to another device and every
+ * cycle all of its instances are updated with a single call to mpr_sig_set_values(); each
+ * instance of the input should receive the value of its instance of the output. Finally the
+ * instances are released with another batch call. */
+
+#define NUM_INST 16
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 100;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+int updated = 0;
+int released = 0;
+int num_errors = 0;
+int expected_offset = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (event & MPR_SIG_REL_UPSTRM) {
+        ++released;
+        mpr_sig_release_inst(sig, inst);
+        return;
+    }
+    if (!value)
+        return;
+    /* the value of each instance is its id plus an offset that changes every cycle */
+    if (*(int*)value - expected_offset < 0 || *(int*)value - expected_offset >= NUM_INST)
+        ++num_errors;
+    ++updated;
+}
+
+int setup_devs(const char *iface)
+{
+    int num_inst = NUM_INST;
+    src = mpr_dev_new("testsetvalues-send", 0);
+    dst = mpr_dev_new("testsetvalues-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                          NULL, NULL, &num_inst, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_INT32, NULL,
+                          NULL, NULL, &num_inst, handler,
+                          MPR_SIG_UPDATE | MPR_SIG_REL_UPSTRM);
+    return !sendsig || !recvsig;
+}
+
+void cleanup_devs(void)
+{
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+int map_sigs(void)
+{
+    int proto = MPR_PROTO_TCP;
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    /* use TCP so that no updates are lost */
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_PROTOCOL, NULL, 1, MPR_INT32, &proto, 1);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    eprintf("Map established.\n");
+    return done;
+}
+
+/* Check the local values stored by the last batch update. */
+int check_values(int offset)
+{
+    int i;
+    for (i = 0; i < NUM_INST; i++) {
+        const int *val = (const int*)mpr_sig_get_value(sendsig, i, 0);
+        if (!val || *val != i + offset) {
+            eprintf("Error retrieving value of instance %d.\n", i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int loop(void)
+{
+    mpr_id ids[NUM_INST];
+    int i, j, vals[NUM_INST];
+
+    for (i = 0; i < NUM_INST; i++)
+        ids[i] = i;
+
+    for (i = 0; i < iterations && !done; i++) {
+        expected_offset = i;
+        for (j = 0; j < NUM_INST; j++)
+            vals[j] = j + i;
+        mpr_sig_set_values(sendsig, NUM_INST, ids, 1, MPR_INT32, vals);
+        if (check_values(i))
+            return 1;
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 10);
+        /* collect any updates still in flight */
+        for (j = 0; j < 10 && updated < (i + 1) * NUM_INST; j++) {
+            mpr_dev_poll(src, 0);
+            mpr_dev_poll(dst, 10);
+        }
+        if (verbose) {
+            printf("\r  Iteration: %d, updated: %d", i, updated);
+            fflush(stdout);
+        }
+    }
+    eprintf("\n");
+
+    if (mpr_sig_get_num_inst(sendsig, MPR_STATUS_ACTIVE) != NUM_INST) {
+        eprintf("Expected %d active instances.\n", NUM_INST);
+        return 1;
+    }
+
+    /* release all instances at once */
+    mpr_sig_set_values(sendsig, NUM_INST, ids, 0, MPR_INT32, NULL);
+    for (i = 0; i < 10 && released < NUM_INST; i++) {
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 10);
+    }
+    if (mpr_sig_get_num_inst(sendsig, MPR_STATUS_ACTIVE)) {
+        eprintf("Expected all instances to be released.\n");
+        return 1;
+    }
+    return 0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testsetvalues.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 10;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+    if (wait_ready()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+    if (map_sigs()) {
+        eprintf("Map initialization aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (loop()) {
+        result = 1;
+        goto done;
+    }
+
+    eprintf("Received %d updates with %d errors and %d releases.\n", updated, num_errors,
+            released);
+    if (updated != iterations * NUM_INST || num_errors || released != NUM_INST) {
+        eprintf("Expected one update for each instance per iteration and one release each.\n");
+        result = 1;
+    }
+
+  done:
+    cleanup_devs();
+    printf("\r..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
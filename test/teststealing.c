@@ -30,6 +30,14 @@ int num_inst = 10;
 
 mpr_time *timetags;
 
+/* voice stealing benchmark */
+#define MAX_VOICES 4096
+int max_voices = MAX_VOICES;
+int num_notes = 10000;
+mpr_id expected_victim = 0;
+int num_stolen = 0;
+int wrong_victims = 0;
+
 static void eprintf(const char *format, ...)
 {
     va_list args;
@@ -203,6 +211,74 @@ void loop(void)
     }
 }
 
+void steal_handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+                   mpr_type type, const void *value, mpr_time t)
+{
+    if (!(event & MPR_SIG_REL_UPSTRM))
+        return;
+    if (instance != expected_victim)
+        ++wrong_victims;
+    ++num_stolen;
+    mpr_sig_release_inst(sig, instance);
+}
+
+/* Start notes on a signal with all of its instances busy, so that every note steals an instance.
+ * Returns the average time per note in nanoseconds, or a negative value on error. */
+double bench_stealing(int num_voices, mpr_steal_type mode)
+{
+    mpr_sig sig;
+    mpr_time start, end;
+    mpr_id id;
+    double elapsed;
+    int i, val = 0;
+
+    sig = mpr_sig_new(src, MPR_DIR_OUT, "voices", 1, MPR_INT32, NULL, NULL, NULL, &num_voices,
+                      steal_handler, MPR_SIG_REL_UPSTRM);
+    if (!sig)
+        return -1;
+    mpr_obj_set_prop((mpr_obj)sig, MPR_PROP_STEAL_MODE, NULL, 1, MPR_INT32, &mode, 1);
+
+    /* activate all instances in order */
+    for (id = 0; id < num_voices; id++)
+        mpr_sig_set_value(sig, id, 1, MPR_INT32, &val);
+
+    num_stolen = wrong_victims = 0;
+    mpr_time_set(&start, MPR_NOW);
+    for (i = 0; i < num_notes; i++) {
+        /* the oldest note is always the one started num_voices notes ago, while the newest is
+         * always the previous note */
+        expected_victim = (MPR_STEAL_OLDEST == mode) ? id - num_voices : id - 1;
+        mpr_sig_set_value(sig, id++, 1, MPR_INT32, &i);
+    }
+    mpr_time_set(&end, MPR_NOW);
+    mpr_time_sub(&end, start);
+    elapsed = mpr_time_as_dbl(end);
+
+    mpr_sig_free(sig);
+    if (num_stolen != num_notes || wrong_victims) {
+        eprintf("  stole %d instances for %d notes, %d of them the wrong instance\n",
+                num_stolen, num_notes, wrong_victims);
+        return -1;
+    }
+    return elapsed * 1e9 / num_notes;
+}
+
+int run_benchmark(void)
+{
+    int num_voices;
+    double oldest, newest;
+    eprintf("Voice stealing benchmark:\n");
+    for (num_voices = 16; num_voices <= max_voices && !done; num_voices *= 4) {
+        if ((oldest = bench_stealing(num_voices, MPR_STEAL_OLDEST)) < 0)
+            return 1;
+        if ((newest = bench_stealing(num_voices, MPR_STEAL_NEWEST)) < 0)
+            return 1;
+        eprintf("  %5d voices: %8.1f ns/note (oldest), %8.1f ns/note (newest)\n", num_voices,
+                oldest, newest);
+    }
+    return 0;
+}
+
 void segv(int sig)
 {
     printf("\x1B[31m(SEGV)\n\x1B[0m");
@@ -238,6 +314,8 @@ int main(int argc, char **argv)
                         break;
                     case 'f':
                         period = 1;
+                        max_voices = MAX_VOICES / 4;
+                        num_notes = 1000;
                         break;
                     case 'q':
                         verbose = 0;
@@ -306,6 +384,12 @@ int main(int argc, char **argv)
         result = 1;
     }
 
+    /* test 3: benchmark stealing with many active instances */
+    if (run_benchmark()) {
+        eprintf("Voice stealing chose the wrong instances.\n");
+        result = 1;
+    }
+
   done:
     cleanup_dst();
     cleanup_src();
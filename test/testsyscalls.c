@@ -0,0 +1,331 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Benchmark counting the socket system calls used per signal update. One source device with a
+ * multi-instance output is mapped to several destination devices; every cycle updates all of the
+ * instances and polls the devices. On Linux the send and receive calls made by libmapper and
+ * liblo are intercepted and counted. With -d the maps are processed at the destinations, which
+ * lets the source share a single multicast update between all of them. With -p the maps ask for
+ * their link bundles to be paced, so successive updates are merged and only the latest values of
+ * each instance need to arrive. */
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <sys/socket.h>
+#define COUNT_SYSCALLS
+#endif
+
+#define NUM_DSTS 8
+#define NUM_INST 32
+
+int verbose = 1;
+int terminate = 0;
+int shared_graph = 0;
+int dst_processing = 0;
+int pacing = 0;
+int done = 0;
+int iterations = 2000;
+
+mpr_dev src = 0;
+mpr_dev dsts[NUM_DSTS];
+mpr_sig sendsig = 0;
+mpr_sig recvsigs[NUM_DSTS];
+
+int sent = 0;
+int received = 0;
+float last[NUM_DSTS][NUM_INST];
+
+#ifdef COUNT_SYSCALLS
+unsigned long num_send_calls = 0;
+unsigned long num_recv_calls = 0;
+int counting = 0;
+
+/* Wrappers for the socket calls: these override the libc symbols for libmapper and liblo. */
+#define WRAP(RET, NAME, COUNTER, PROTO, ARGS)                   \
+RET NAME PROTO                                                  \
+{                                                               \
+    static RET (*func) PROTO = 0;                               \
+    if (!func)                                                  \
+        *(void**)(&func) = dlsym(RTLD_NEXT, #NAME);             \
+    if (counting)                                               \
+        ++COUNTER;                                              \
+    return func ARGS;                                           \
+}
+
+WRAP(ssize_t, send, num_send_calls, (int fd, const void *buf, size_t len, int flags),
+     (fd, buf, len, flags))
+WRAP(ssize_t, sendto, num_send_calls, (int fd, const void *buf, size_t len, int flags,
+     const struct sockaddr *addr, socklen_t addr_len), (fd, buf, len, flags, addr, addr_len))
+WRAP(ssize_t, sendmsg, num_send_calls, (int fd, const struct msghdr *msg, int flags),
+     (fd, msg, flags))
+WRAP(int, sendmmsg, num_send_calls, (int fd, struct mmsghdr *msgs, unsigned int len, int flags),
+     (fd, msgs, len, flags))
+WRAP(ssize_t, recv, num_recv_calls, (int fd, void *buf, size_t len, int flags),
+     (fd, buf, len, flags))
+WRAP(ssize_t, recvfrom, num_recv_calls, (int fd, void *buf, size_t len, int flags,
+     struct sockaddr *addr, socklen_t *addr_len), (fd, buf, len, flags, addr, addr_len))
+WRAP(ssize_t, recvmsg, num_recv_calls, (int fd, struct msghdr *msg, int flags),
+     (fd, msg, flags))
+WRAP(int, recvmmsg, num_recv_calls, (int fd, struct mmsghdr *msgs, unsigned int len, int flags,
+     struct timespec *timeout), (fd, msgs, len, flags, timeout))
+#endif /* COUNT_SYSCALLS */
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int i;
+    const float *fvalue = (const float*)value;
+    if (!value)
+        return;
+    ++received;
+    for (i = 0; i < NUM_DSTS; i++) {
+        if (sig == recvsigs[i] && fvalue[1] >= 0 && fvalue[1] < NUM_INST)
+            last[i][(int)fvalue[1]] = fvalue[0];
+    }
+}
+
+int setup_devs(mpr_graph g, const char *iface)
+{
+    int i, num_inst = NUM_INST;
+    src = mpr_dev_new("testsyscalls-send", g);
+    if (!src)
+        return 1;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 3, MPR_FLT, NULL,
+                          NULL, NULL, &num_inst, NULL, 0);
+    if (!sendsig)
+        return 1;
+
+    for (i = 0; i < NUM_DSTS; i++) {
+        dsts[i] = mpr_dev_new("testsyscalls-recv", g);
+        if (!dsts[i])
+            return 1;
+        if (iface)
+            mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dsts[i]), iface);
+        recvsigs[i] = mpr_sig_new(dsts[i], MPR_DIR_IN, "insig", 3, MPR_FLT, NULL,
+                                  NULL, NULL, &num_inst, handler, MPR_SIG_UPDATE);
+        if (!recvsigs[i])
+            return 1;
+    }
+    eprintf("Devices created.\n");
+    return 0;
+}
+
+void cleanup_devs(void)
+{
+    int i;
+    for (i = 0; i < NUM_DSTS; i++) {
+        if (dsts[i])
+            mpr_dev_free(dsts[i]);
+    }
+    if (src)
+        mpr_dev_free(src);
+}
+
+void poll_all(int block_ms)
+{
+    int i;
+    mpr_dev_poll(src, block_ms);
+    for (i = 0; i < NUM_DSTS; i++)
+        mpr_dev_poll(dsts[i], 0);
+}
+
+int wait_ready(void)
+{
+    int i, ready = 0;
+    while (!done && !ready) {
+        poll_all(25);
+        ready = mpr_dev_get_is_ready(src);
+        for (i = 0; i < NUM_DSTS; i++)
+            ready &= mpr_dev_get_is_ready(dsts[i]);
+    }
+    return done;
+}
+
+int map_sigs(void)
+{
+    int i, ready = 0;
+    mpr_map maps[NUM_DSTS];
+    int loc = MPR_LOC_DST;
+    for (i = 0; i < NUM_DSTS; i++) {
+        maps[i] = mpr_map_new(1, &sendsig, 1, &recvsigs[i]);
+        if (dst_processing)
+            mpr_obj_set_prop((mpr_obj)maps[i], MPR_PROP_PROCESS_LOC, NULL, 1, MPR_INT32, &loc, 1);
+        if (pacing) {
+            float rate = 50;
+            mpr_obj_set_prop((mpr_obj)maps[i], MPR_PROP_EXTRA, "pacing_rate", 1, MPR_FLT, &rate, 1);
+        }
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+    while (!done && !ready) {
+        poll_all(10);
+        ready = 1;
+        for (i = 0; i < NUM_DSTS; i++)
+            ready &= mpr_map_get_is_ready(maps[i]);
+    }
+    eprintf("Maps established.\n");
+    return done;
+}
+
+void loop(void)
+{
+    int i, j;
+    float val[3] = {0, 0, 0};
+
+#ifdef COUNT_SYSCALLS
+    counting = 1;
+#endif
+    for (i = 0; i < iterations && !done; i++) {
+        for (j = 0; j < NUM_INST; j++) {
+            val[0] = i;
+            val[1] = j;
+            mpr_sig_set_value(sendsig, j, 3, MPR_FLT, val);
+            ++sent;
+        }
+        poll_all(0);
+    }
+    /* collect any updates still in flight */
+    for (i = 0; i < 10 && received < sent * NUM_DSTS; i++)
+        poll_all(10);
+#ifdef COUNT_SYSCALLS
+    counting = 0;
+#endif
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+    mpr_graph g;
+    mpr_time start, elapsed;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testsyscalls.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-s shared (use one mpr_graph only), "
+                               "-d process maps at destination, "
+                               "-p pace link bundles, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 200;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case 's':
+                        shared_graph = 1;
+                        break;
+                    case 'd':
+                        dst_processing = 1;
+                        break;
+                    case 'p':
+                        pacing = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    g = shared_graph ? mpr_graph_new(0) : 0;
+
+    if (setup_devs(g, iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+    if (wait_ready()) {
+        eprintf("Device registration aborted.\n");
+        result = 1;
+        goto done;
+    }
+    if (map_sigs()) {
+        eprintf("Map initialization aborted.\n");
+        result = 1;
+        goto done;
+    }
+
+    mpr_time_set(&start, MPR_NOW);
+    loop();
+    mpr_time_set(&elapsed, MPR_NOW);
+    mpr_time_sub(&elapsed, start);
+
+    eprintf("Sent %d updates to %d destinations in %f seconds, received %d.\n",
+            sent, NUM_DSTS, mpr_time_as_dbl(elapsed), received);
+#ifdef COUNT_SYSCALLS
+    eprintf("Send calls: %lu (%f per update), receive calls: %lu (%f per update)\n",
+            num_send_calls, sent ? (double)num_send_calls / sent : 0.,
+            num_recv_calls, sent ? (double)num_recv_calls / sent : 0.);
+#endif
+
+    if (pacing) {
+        /* intermediate updates are merged, but the latest values should make it through */
+        for (i = 0; i < NUM_DSTS; i++) {
+            for (j = 0; j < NUM_INST; j++) {
+                if (last[i][j] != iterations - 1) {
+                    eprintf("Destination %d instance %d ended with value %g instead of %d.\n",
+                            i, j, last[i][j], iterations - 1);
+                    result = 1;
+                }
+            }
+        }
+    }
+    /* updates that arrive too late may be lost over UDP, but most should make it through */
+    else if (received < sent * NUM_DSTS * 0.9)
+        result = 1;
+
+  done:
+    cleanup_devs();
+    if (g) mpr_graph_free(g);
+    printf("\r..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
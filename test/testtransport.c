@@ -0,0 +1,214 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Benchmark comparing the transports used between devices in different processes on the same
+ * host. A source and a destination device with separate graphs are mapped together, and the
+ * "local_transport" property of the source limits the link to loopback UDP, AF_UNIX datagrams or
+ * shared memory. If a transport is not available on this platform the next one is used, so the
+ * results for "shm" and "unix" may match the slower transports. */
+
+#define NUM_TRANSPORTS 3
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 10000;
+
+const char *transports[] = {"udp", "unix", "shm"};
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+int received = 0;
+double latency = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    mpr_time now;
+    if (!value)
+        return;
+    ++received;
+    /* both devices share the same clock */
+    mpr_time_set(&now, MPR_NOW);
+    mpr_time_sub(&now, t);
+    latency += mpr_time_as_dbl(now);
+}
+
+int setup_devs(const char *iface, const char *transport)
+{
+    src = mpr_dev_new("testtransport-send", 0);
+    dst = mpr_dev_new("testtransport-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    /* must be set before the link is established */
+    mpr_obj_set_prop((mpr_obj)src, MPR_PROP_EXTRA, "local_transport", 1, MPR_STR, transport, 0);
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 4, MPR_FLT, NULL,
+                          NULL, NULL, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 4, MPR_FLT, NULL,
+                          NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    return !sendsig || !recvsig;
+}
+
+void cleanup_devs(void)
+{
+    if (src) {
+        mpr_dev_free(src);
+        src = 0;
+    }
+    if (dst) {
+        mpr_dev_free(dst);
+        dst = 0;
+    }
+}
+
+int wait_ready(void)
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    return done;
+}
+
+int map_sigs(void)
+{
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    return done;
+}
+
+/* Returns the number of updates lost, or -1 on error. */
+int run(const char *iface, const char *transport, double *update_us, double *latency_us)
+{
+    int i, result = 0;
+    float val[4] = {0, 1, 2, 3};
+    mpr_time start, elapsed;
+
+    received = 0;
+    latency = 0;
+    if (setup_devs(iface, transport) || wait_ready() || map_sigs()) {
+        result = -1;
+        goto done;
+    }
+
+    mpr_time_set(&start, MPR_NOW);
+    for (i = 0; i < iterations && !done; i++) {
+        val[0] = i;
+        mpr_sig_set_value(sendsig, 0, 4, MPR_FLT, val);
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 0);
+    }
+    /* collect any updates still in flight */
+    for (i = 0; i < 10 && received < iterations; i++) {
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 10);
+    }
+    mpr_time_set(&elapsed, MPR_NOW);
+    mpr_time_sub(&elapsed, start);
+
+    *update_us = mpr_time_as_dbl(elapsed) * 1000000. / iterations;
+    *latency_us = received ? latency * 1000000. / received : 0;
+    result = iterations - received;
+
+  done:
+    cleanup_devs();
+    return result;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testtransport.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 1000;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface") == 0 && argc > i + 1) {
+                            ++i;
+                            iface = argv[i];
+                            j = len;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    eprintf("%10s %18s %18s %10s\n", "transport", "time (us/update)", "latency (us)", "lost");
+    for (i = 0; i < NUM_TRANSPORTS && !done; i++) {
+        double update_us = 0, latency_us = 0;
+        int lost = run(iface, transports[i], &update_us, &latency_us);
+        if (lost < 0) {
+            eprintf("Error initializing devices for transport '%s'.\n", transports[i]);
+            result = 1;
+            break;
+        }
+        eprintf("%10s %18.3f %18.3f %10d\n", transports[i], update_us, latency_us, lost);
+        /* datagrams may be dropped if the receive queue fills, but nearly all should arrive */
+        if (lost > iterations / 10) {
+            eprintf("Lost %d of %d updates.\n", lost, iterations);
+            result = 1;
+        }
+    }
+
+    printf("\r..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}